@@ -1,12 +1,6 @@
 #define SP_IMPLEMENTATION
 #include "sp.h"
 
-s32 compare_entries(const void* pa, const void* pb) {
-  const sp_fs_entry_t* a = (const sp_fs_entry_t*)pa;
-  const sp_fs_entry_t* b = (const sp_fs_entry_t*)pb;
-  return sp_str_compare_alphabetical(a->name, b->name);
-}
-
 s32 run(s32 num_args, const c8** args) {
   sp_mem_heap_t* heap = sp_mem_heap_new();
   sp_mem_t mem = sp_mem_heap_as_allocator(heap);
@@ -15,7 +9,7 @@ s32 run(s32 num_args, const c8** args) {
   if (num_args == 2) dir = sp_fs_join_path(mem, cwd, sp_str_view(args[1]));
 
   sp_da(sp_fs_entry_t) entries = sp_fs_collect(mem, dir);
-  sp_da_sort(entries, compare_entries);
+  sp_da_sort_by(entries, sp_fs_entry_t, x, y, sp_str_compare_alphabetical(x->name, y->name) < 0);
 
   sp_da_for(entries, it) {
     sp_fs_entry_t* entry = &entries[it];
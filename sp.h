@@ -184,6 +184,12 @@
   #define SP_ARM
 #endif
 
+#if defined(SP_AMD64) && !defined(SP_TCC) && !defined(SP_FREESTANDING)
+  #define SP_SSE2
+#elif defined(SP_ARM64) && !defined(SP_TCC) && !defined(SP_FREESTANDING)
+  #define SP_NEON
+#endif
+
 //////////////
 // LANGUAGE //
 //////////////
@@ -338,6 +344,17 @@
   #define SP_NOINLINE SP_ATTRIBUTE(noinline)
 #endif
 
+/////////////////
+// SP_PREFETCH //
+/////////////////
+#if defined(SP_GNUC)
+  #define SP_PREFETCH(ptr) __builtin_prefetch((ptr))
+#elif defined(SP_MSVC) && defined(SP_SSE2)
+  #define SP_PREFETCH(ptr) _mm_prefetch((const char*)(ptr), _MM_HINT_T0)
+#else
+  #define SP_PREFETCH(ptr) ((void)(ptr))
+#endif
+
 ////////////////////
 // SP_FALLTHROUGH //
 ////////////////////
@@ -709,6 +726,12 @@ SP_BEGIN_EXTERN_C()
   #include <sys/mman.h>
 #endif
 
+#if defined(SP_SSE2)
+  #include <emmintrin.h>
+#elif defined(SP_NEON)
+  #include <arm_neon.h>
+#endif
+
 
 //  ███████████ █████ █████ ███████████  ██████████  █████████
 // ░█░░░███░░░█░░███ ░░███ ░░███░░░░░███░░███░░░░░█ ███░░░░░███
@@ -814,6 +837,8 @@ typedef struct sp_io_file_writer sp_io_file_writer_t;
 typedef struct sp_io_mem_writer sp_io_mem_writer_t;
 typedef struct sp_io_dyn_mem_writer sp_io_dyn_mem_writer_t;
 typedef struct sp_io_stream_writer sp_io_stream_writer_t;
+typedef struct sp_io_hash_writer sp_io_hash_writer_t;
+typedef struct sp_io_mirror_rb_writer sp_io_mirror_rb_writer_t;
 
 #if defined(SP_WIN32)
 typedef HANDLE           sp_win32_handle_t;
@@ -1279,6 +1304,10 @@ SP_API s32         sp_sys_fd_wait(sp_sys_fd_t fd);
 SP_API s32         sp_sys_fds_wait(const sp_sys_fd_t* fds, u8* ready, u64 nfds);
 SP_API void*       sp_sys_alloc(u64 size);
 SP_API void        sp_sys_free(void* ptr, u64 size);
+SP_API void*       sp_sys_map_file(sp_sys_fd_t fd, u64 size);
+SP_API void        sp_sys_unmap_file(void* ptr, u64 size);
+SP_API void*       sp_sys_map_mirror(u64 size);
+SP_API void        sp_sys_unmap_mirror(void* ptr, u64 size);
 SP_API void*       sp_sys_memcpy(void* dest, const void* src, u64 n);
 SP_API void*       sp_sys_memmove(void* dest, const void* src, u64 n);
 SP_API void*       sp_sys_memset(void* dest, u8 fill, u64 n);
@@ -1706,11 +1735,42 @@ SP_API c8*               sp_mem_buffer_as_cstr(sp_mem_buffer_t* buffer);
 //  █████   █████ █████   █████░░█████████  █████   █████
 // ░░░░░   ░░░░░ ░░░░░   ░░░░░  ░░░░░░░░░  ░░░░░   ░░░░░
 // @hash
+//
+// sp_hash_bytes() is SipHash, and is the right choice for anything keyed by untrusted input.
+// sp_hash_fast() is a rapidhash (wyhash family) multiply-mix hash which is several times
+// faster, particularly for short keys, but makes no attempt to resist collision attacks.
+//
+// sp_hasher_t is sp_hash_bytes() split into init, update and final, for input which isn't
+// in one buffer; a file read in chunks, or a key made of several fields. However the bytes
+// are split across updates, the result is the same as sp_hash_bytes() over all of them:
+//
+//   sp_hasher_t hasher;
+//   sp_hasher_init(&hasher, seed);
+//   sp_hasher_update_str(&hasher, name);
+//   sp_hasher_update(&hasher, &version, sizeof(version));
+//   sp_hash_t hash = sp_hasher_final(&hasher);
+//
+// sp_hasher_update_str() hashes the length before the bytes, so ("ab", "c") and ("a", "bc")
+// hash differently. sp_hasher_read() hashes everything left in an sp_io_reader_t, and
+// sp_io_hash_writer_t hashes bytes as they're written through it.
 typedef u64 sp_hash_t;
 
+typedef struct {
+  size_t v0, v1, v2, v3;
+  size_t tail;
+  u64 len;
+} sp_hasher_t;
+
 SP_API sp_hash_t sp_hash_cstr(const c8* str);
 SP_API sp_hash_t sp_hash_combine(sp_hash_t* hashes, u32 num_hashes);
 SP_API sp_hash_t sp_hash_bytes(const void* p, u64 len, u64 seed);
+SP_API sp_hash_t sp_hash_fast(const void* p, u64 len, u64 seed);
+SP_API void      sp_hasher_init(sp_hasher_t* hasher, u64 seed);
+SP_API void      sp_hasher_update(sp_hasher_t* hasher, const void* p, u64 len);
+SP_API void      sp_hasher_update_str(sp_hasher_t* hasher, sp_str_t str);
+SP_API void      sp_hasher_update_u64(sp_hasher_t* hasher, u64 value);
+SP_API sp_hash_t sp_hasher_final(sp_hasher_t* hasher);
+SP_API sp_err_t  sp_hasher_read(sp_hasher_t* hasher, sp_io_reader_t* reader, u64* bytes_read);
 
 
 //  ██████████   █████ █████ ██████   █████      █████████   ███████████   ███████████     █████████   █████ █████
@@ -1735,6 +1795,10 @@ SP_API void* sp_da_init_ex(sp_mem_t mem, u32 stride);
 SP_API void* sp_da_resize(void* arr, u32 stride, u64 len);
 SP_API void* sp_da_grow_ex(void* arr, u32 stride, u64 addlen);
 SP_API void  sp_da_push_ex(void** arr, void* val, u32 stride);
+SP_API void* sp_da_push_n_ex(void* arr, const void* vals, u32 stride, u64 n);
+SP_API void* sp_da_insert_n_ex(void* arr, u64 at, const void* vals, u32 stride, u64 n);
+SP_API void  sp_da_insert_back_ex(void* arr, u64 at, u32 stride);
+SP_API void  sp_da_erase_range_ex(void* arr, u64 at, u64 n, u32 stride);
 
 #define sp_da_for(__ARR, __IT)  for (u64 __IT = 0; __IT < sp_da_size((__ARR)); __IT++)
 #define sp_da_rfor(__ARR, __IT) for (u64 __IT = sp_da_size(__ARR); __IT-- > 0; )
@@ -1801,9 +1865,650 @@ SP_API void  sp_da_push_ex(void** arr, void* val, u32 stride);
 #define sp_da_back(__ARR)\
     (__ARR + (sp_da_size(__ARR) ? sp_da_size(__ARR) - 1 : 0))
 
+// Bulk operations grow the array at most once per call. Passing NULL for the values
+// appends (or inserts) n zeroed elements for the caller to fill in. The values may come
+// from the array itself, e.g. sp_da_push_n(arr, arr, sp_da_size(arr)) doubles it.
+#define sp_da_push_n(__ARR, __VALS, __N)\
+  *sp_da_vp(__ARR) = sp_da_push_n_ex((__ARR), (__VALS), sp_da_stride(__ARR), (__N))
+
+#define sp_da_insert_n(__ARR, __AT, __VALS, __N)\
+  *sp_da_vp(__ARR) = sp_da_insert_n_ex((__ARR), (__AT), (__VALS), sp_da_stride(__ARR), (__N))
+
+// The value is stored past the end before anything shifts, so it may name an element
+#define sp_da_insert(__ARR, __AT, __VAL)\
+  do {\
+    u64 sp_da_insert_at = (__AT);\
+    *sp_da_vp(__ARR) = sp_da_grow(__ARR, 1);\
+    (__ARR)[sp_da_head(__ARR)->size] = (__VAL);\
+    sp_da_insert_back_ex((__ARR), sp_da_insert_at, sp_da_stride(__ARR));\
+  } while (0)
+
+#define sp_da_erase_range(__ARR, __AT, __N)\
+  sp_da_erase_range_ex((__ARR), (__AT), (__N), sp_da_stride(__ARR))
+
+#define sp_da_erase(__ARR, __AT)\
+  sp_da_erase_range((__ARR), (__AT), 1)
+
+// O(1) removal that doesn't preserve order: the last element moves into the hole
+#define sp_da_swap_remove(__ARR, __IT)\
+  do {\
+    u64 sp_da_remove_at = (__IT);\
+    sp_assert(sp_da_bounds_ok((__ARR), sp_da_remove_at));\
+    (__ARR)[sp_da_remove_at] = (__ARR)[sp_da_size(__ARR) - 1];\
+    sp_da_head(__ARR)->size -= 1;\
+  } while (0)
+
 #define sp_da_sort(arr, fn) sp_os_qsort(arr, sp_da_size(arr), sizeof((arr)[0]), fn)
 #define sp_da_bounds_ok(arr, it) ((it) < sp_da_size(arr))
 
+// A small array keeps up to N elements inline in the owning struct and only touches the
+// allocator once it grows past that. A zeroed sp_sa is a valid empty array, but it needs
+// an allocator (sp_sa_init) before it can spill. Copying the struct copies the inline
+// elements; once spilled, copies share the heap storage. If spilling fails, sp_sa_grow
+// returns false and sp_sa_push drops the element rather than writing past the end.
+typedef struct {
+  u32 size;
+  u32 capacity;
+  sp_mem_t mem;
+  void* heap;
+} sp_sa_header_t;
+
+#define sp_sa(T, N) \
+  struct {          \
+    u32 size;       \
+    u32 capacity;   \
+    sp_mem_t mem;   \
+    T* heap;        \
+    T items [N];    \
+  }
+
+SP_API bool sp_sa_grow_ex(sp_sa_header_t* sa, void* items, u32 inline_capacity, u32 stride, u32 n);
+SP_API void sp_sa_free_ex(sp_sa_header_t* sa, u32 stride);
+
+#define sp_sa_for(__SA, __IT)  for (u32 __IT = 0; __IT < (__SA).size; __IT++)
+#define sp_sa_rfor(__SA, __IT) for (u32 __IT = (__SA).size; __IT-- > 0; )
+
+#define sp_sa_head(__SA) \
+  ((sp_sa_header_t*)&(__SA))
+
+#define sp_sa_stride(__SA) \
+  (sizeof((__SA).items[0]))
+
+#define sp_sa_inline_capacity(__SA) \
+  ((u32)sp_carr_len((__SA).items))
+
+#define sp_sa_is_inline(__SA) \
+  ((__SA).heap == SP_NULLPTR)
+
+#define sp_sa_data(__SA) \
+  ((__SA).heap ? (__SA).heap : (__SA).items)
+
+#define sp_sa_at(__SA, __IT) \
+  (sp_sa_data(__SA)[__IT])
+
+#define sp_sa_size(__SA) \
+  ((__SA).size)
+
+#define sp_sa_capacity(__SA) \
+  ((__SA).heap ? (__SA).capacity : sp_sa_inline_capacity(__SA))
+
+#define sp_sa_empty(__SA) \
+  ((__SA).size == 0)
+
+#define sp_sa_full(__SA) \
+  ((__SA).size == sp_sa_capacity(__SA))
+
+#define sp_sa_clear(__SA) \
+  (__SA).size = 0
+
+#define sp_sa_init(__mem, __SA)   \
+  do {                            \
+    (__SA).size = 0;              \
+    (__SA).capacity = 0;          \
+    (__SA).mem = (__mem);         \
+    (__SA).heap = SP_NULLPTR;     \
+  } while (0)
+
+#define sp_sa_free(__SA) \
+  sp_sa_free_ex(sp_sa_head(__SA), sp_sa_stride(__SA))
+
+#define sp_sa_grow(__SA, __N) \
+  sp_sa_grow_ex(sp_sa_head(__SA), (__SA).items, sp_sa_inline_capacity(__SA), sp_sa_stride(__SA), (__N))
+
+#define sp_sa_reserve(__SA, __N)                          \
+  do {                                                    \
+    if ((u32)(__N) > sp_sa_capacity(__SA)) {              \
+      sp_sa_grow((__SA), (u32)(__N) - (__SA).size);       \
+    }                                                     \
+  } while (0)
+
+#define sp_sa_push(__SA, __VAL)                           \
+  do {                                                    \
+    if (!sp_sa_full(__SA) || sp_sa_grow((__SA), 1)) {     \
+      sp_sa_data(__SA)[(__SA).size] = (__VAL);            \
+      (__SA).size++;                                      \
+    }                                                     \
+  } while (0)
+
+#define sp_sa_pop(__SA)                                   \
+  do {                                                    \
+    if (!sp_sa_empty(__SA)) (__SA).size -= 1;             \
+  } while (0)
+
+#define sp_sa_back(__SA) \
+  (sp_sa_data(__SA) + ((__SA).size ? (__SA).size - 1 : 0))
+
+/////////////////
+// CHUNK ARRAY //
+/////////////////
+// A chunk array stores elements in fixed-size, power-of-two chunks behind a directory of
+// chunk pointers. Appending only ever allocates a new chunk (and occasionally regrows the
+// directory), so elements never move and pointers to them stay valid until the array is
+// freed. Like sp_da, the handle is the directory itself with a header in front of it, so
+// sp_chunk_array(T) is a T** and sp_chunk_array_at is a shift and a mask. If an allocation
+// fails, the handle stays valid and sp_chunk_array_push drops the element.
+//
+//   sp_chunk_array(particle_t) particles = sp_chunk_array_new(mem, particle_t);
+//   sp_chunk_array_push(particles, p);
+//   sp_chunk_array_for_chunk(particles, c) {
+//     particle_t* chunk = sp_chunk_array_chunk(particles, c);
+//     sp_for(it, sp_chunk_array_chunk_size(particles, c)) { ... }
+//   }
+#define SP_CHUNK_ARRAY_CHUNK_BYTES (64 * 1024)
+
+typedef struct SP_ALIGNED {
+  u64 size;
+  u32 num_chunks;
+  u32 capacity;
+  u32 shift;
+  u32 stride;
+  sp_mem_t allocator;
+} sp_chunk_array_header_t;
+
+#define sp_chunk_array(T) T**
+SP_API void* sp_chunk_array_init_ex(sp_mem_t mem, u32 stride, u32 chunk_len);
+SP_API bool  sp_chunk_array_grow_ex(void** arr, u64 n);
+SP_API void  sp_chunk_array_free_ex(void* arr);
+
+#define sp_chunk_array_head(__ARR)\
+  ((sp_chunk_array_header_t*)((u8*)(__ARR) - sizeof(sp_chunk_array_header_t)))
+
+#define sp_chunk_array_size(__ARR)\
+  ((__ARR) ? sp_chunk_array_head(__ARR)->size : 0)
+
+#define sp_chunk_array_empty(__ARR)\
+  (sp_chunk_array_size(__ARR) == 0)
+
+#define sp_chunk_array_chunk_len(__ARR)\
+  ((u64)1 << sp_chunk_array_head(__ARR)->shift)
+
+#define sp_chunk_array_capacity(__ARR)\
+  ((__ARR) ? sp_chunk_array_head(__ARR)->num_chunks * sp_chunk_array_chunk_len(__ARR) : 0)
+
+#define sp_chunk_array_new(__mem, __T)\
+  ((__T**)sp_chunk_array_init_ex((__mem), sizeof(__T), 0))
+
+#define sp_chunk_array_init(__mem, __ARR)\
+  *sp_da_vp(__ARR) = sp_chunk_array_init_ex((__mem), sizeof(**(__ARR)), 0)
+
+#define sp_chunk_array_init_n(__mem, __ARR, __CHUNK_LEN)\
+  *sp_da_vp(__ARR) = sp_chunk_array_init_ex((__mem), sizeof(**(__ARR)), (__CHUNK_LEN))
+
+#define sp_chunk_array_free(__ARR)\
+  do {\
+    if (__ARR) {\
+      sp_chunk_array_free_ex(__ARR);\
+      (__ARR) = SP_NULLPTR;\
+    }\
+  } while (0)
+
+#define sp_chunk_array_at(__ARR, __IT)\
+  ((__ARR)[(u64)(__IT) >> sp_chunk_array_head(__ARR)->shift][(u64)(__IT) & (sp_chunk_array_chunk_len(__ARR) - 1)])
+
+#define sp_chunk_array_back(__ARR)\
+  (&sp_chunk_array_at((__ARR), sp_chunk_array_size(__ARR) ? sp_chunk_array_size(__ARR) - 1 : 0))
+
+#define sp_chunk_array_reserve(__ARR, __N)\
+  do {\
+    if ((u64)(__N) > sp_chunk_array_size(__ARR)) {\
+      sp_chunk_array_grow_ex(sp_da_vp(__ARR), (u64)(__N) - sp_chunk_array_size(__ARR));\
+    }\
+  } while (0)
+
+#define sp_chunk_array_push(__ARR, __VAL)\
+  do {\
+    if (sp_chunk_array_grow_ex(sp_da_vp(__ARR), 1)) {\
+      sp_chunk_array_at((__ARR), sp_chunk_array_head(__ARR)->size) = (__VAL);\
+      sp_chunk_array_head(__ARR)->size++;\
+    }\
+  } while (0)
+
+#define sp_chunk_array_pop(__ARR)\
+  do {\
+    if (!sp_chunk_array_empty(__ARR)) sp_chunk_array_head(__ARR)->size -= 1;\
+  } while (0)
+
+// Chunks are kept when the array shrinks, so refilling a cleared array doesn't allocate
+#define sp_chunk_array_clear(__ARR)\
+  do {\
+    if (__ARR) sp_chunk_array_head(__ARR)->size = 0;\
+  } while (0)
+
+#define sp_chunk_array_for(__ARR, __IT)\
+  for (u64 __IT = 0; __IT < sp_chunk_array_size(__ARR); __IT++)
+
+#define sp_chunk_array_num_chunks(__ARR)\
+  ((sp_chunk_array_size(__ARR) + sp_chunk_array_chunk_len(__ARR) - 1) >> sp_chunk_array_head(__ARR)->shift)
+
+#define sp_chunk_array_for_chunk(__ARR, __C)\
+  for (u64 __C = 0; __C < sp_chunk_array_num_chunks(__ARR); __C++)
+
+#define sp_chunk_array_chunk(__ARR, __C)\
+  ((__ARR)[__C])
+
+#define sp_chunk_array_chunk_size(__ARR, __C)\
+  sp_min(sp_chunk_array_size(__ARR) - ((u64)(__C) << sp_chunk_array_head(__ARR)->shift), sp_chunk_array_chunk_len(__ARR))
+
+/////////
+// SOA //
+/////////
+// SP_SOA_DEFINE declares a struct-of-arrays container: one typed column pointer per field,
+// all sharing a single size, capacity and allocator, so a loop over one or two fields walks
+// contiguous memory. Fields are given as an X-macro of (type, name) pairs:
+//
+//   #define PARTICLE_FIELDS(X) X(f32, x) X(f32, vx) X(u32, flags)
+//   SP_SOA_DEFINE(particles, PARTICLE_FIELDS)
+//
+//   particles_t p;
+//   particles_init(mem, &p);
+//   particles_push(&p, (particles_row_t) { .x = 1.f, .vx = 2.f });
+//   sp_soa_for(p, it) p.x[it] += p.vx[it];
+//
+// The generated functions move whole rows; everything else is the sp_soa_* macros below,
+// which work on any generated container.
+#define SP_SOA_INVALID_INDEX ((u64)-1)
+
+typedef struct {
+  u64 size;
+  u64 capacity;
+  sp_mem_t mem;
+  const u32* strides;
+  u32 num_columns;
+} sp_soa_t;
+
+SP_API void sp_soa_init_ex(sp_mem_t mem, sp_soa_t* soa, const u32* strides, u32 num_columns);
+SP_API void sp_soa_free_ex(sp_soa_t* soa, void** columns);
+SP_API bool sp_soa_reserve_ex(sp_soa_t* soa, void** columns, u64 capacity);
+SP_API u64  sp_soa_push_n_ex(sp_soa_t* soa, void** columns, u64 n);
+SP_API void sp_soa_erase_range_ex(sp_soa_t* soa, void** columns, u64 at, u64 n);
+SP_API void sp_soa_swap_remove_ex(sp_soa_t* soa, void** columns, u64 it);
+SP_API void sp_soa_swap_ex(sp_soa_t* soa, void** columns, u64 a, u64 b);
+
+#define SP_SOA_FIELD(T, field)  T field;
+#define SP_SOA_COLUMN(T, field) T* field;
+#define SP_SOA_STRIDE(T, field) sizeof(T),
+#define SP_SOA_COUNT(T, field)  + 1
+#define SP_SOA_STORE(T, field)  soa->field[it] = row.field;
+#define SP_SOA_LOAD(T, field)   row.field = soa->field[it];
+
+#define SP_SOA_DEFINE(name, FIELDS)                                                           \
+  typedef struct {                                                                            \
+    FIELDS(SP_SOA_FIELD)                                                                      \
+  } name##_row_t;                                                                             \
+                                                                                              \
+  typedef struct {                                                                            \
+    sp_soa_t soa;                                                                             \
+    union {                                                                                   \
+      struct { FIELDS(SP_SOA_COLUMN) };                                                       \
+      void* columns [0 FIELDS(SP_SOA_COUNT)];                                                 \
+    };                                                                                        \
+  } name##_t;                                                                                 \
+                                                                                              \
+  static SP_INLINE void name##_init(sp_mem_t mem, name##_t* soa) {                            \
+    static const u32 strides [] = { FIELDS(SP_SOA_STRIDE) };                                  \
+    sp_mem_zero(soa, sizeof(name##_t));                                                       \
+    sp_soa_init_ex(mem, &soa->soa, strides, (u32)sp_carr_len(strides));                      \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE u64 name##_push(name##_t* soa, name##_row_t row) {                         \
+    u64 it = sp_soa_push_n_ex(&soa->soa, soa->columns, 1);                                    \
+    if (it == SP_SOA_INVALID_INDEX) return it;                                                \
+    FIELDS(SP_SOA_STORE)                                                                      \
+    return it;                                                                                \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE void name##_set(name##_t* soa, u64 it, name##_row_t row) {                 \
+    sp_assert(it < soa->soa.size);                                                            \
+    FIELDS(SP_SOA_STORE)                                                                      \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE name##_row_t name##_get(name##_t* soa, u64 it) {                           \
+    sp_assert(it < soa->soa.size);                                                            \
+    name##_row_t row;                                                                         \
+    FIELDS(SP_SOA_LOAD)                                                                       \
+    return row;                                                                               \
+  }
+
+#define sp_soa_size(__SOA)     ((__SOA).soa.size)
+#define sp_soa_capacity(__SOA) ((__SOA).soa.capacity)
+#define sp_soa_empty(__SOA)    ((__SOA).soa.size == 0)
+#define sp_soa_clear(__SOA)    (__SOA).soa.size = 0
+
+#define sp_soa_for(__SOA, __IT)  for (u64 __IT = 0; __IT < sp_soa_size(__SOA); __IT++)
+#define sp_soa_rfor(__SOA, __IT) for (u64 __IT = sp_soa_size(__SOA); __IT-- > 0; )
+
+#define sp_soa_free(__SOA) \
+  sp_soa_free_ex(&(__SOA).soa, (__SOA).columns)
+
+#define sp_soa_reserve(__SOA, __N) \
+  sp_soa_reserve_ex(&(__SOA).soa, (__SOA).columns, (__N))
+
+// Appends n zeroed rows and returns the index of the first, for filling column by column
+#define sp_soa_push_n(__SOA, __N) \
+  sp_soa_push_n_ex(&(__SOA).soa, (__SOA).columns, (__N))
+
+#define sp_soa_pop(__SOA) \
+  do { if (!sp_soa_empty(__SOA)) (__SOA).soa.size -= 1; } while (0)
+
+#define sp_soa_erase_range(__SOA, __AT, __N) \
+  sp_soa_erase_range_ex(&(__SOA).soa, (__SOA).columns, (__AT), (__N))
+
+#define sp_soa_erase(__SOA, __AT) \
+  sp_soa_erase_range((__SOA), (__AT), 1)
+
+#define sp_soa_swap_remove(__SOA, __IT) \
+  sp_soa_swap_remove_ex(&(__SOA).soa, (__SOA).columns, (__IT))
+
+#define sp_soa_swap(__SOA, __A, __B) \
+  sp_soa_swap_ex(&(__SOA).soa, (__SOA).columns, (__A), (__B))
+
+//////////
+// SORT //
+//////////
+// sp_sort is pattern-defeating quicksort: median-of-three pivots (a ninther on large ranges),
+// insertion sort below SP_SORT_INSERTION_THRESHOLD, a partition that puts runs of equal keys
+// to one side, and a heapsort fallback once too many partitions come out unbalanced. It's
+// O(n log n) worst case, close to linear on sorted, reversed and low-cardinality inputs, and
+// not stable.
+//
+// sp_sort_by runs the same algorithm as a statement macro, with less_expr expanded where the
+// comparator call would be. The caller names the two const T* that less_expr compares, so
+// they can't shadow anything the expression uses:
+//
+//   sp_da_sort_by(entries, sp_fs_entry_t, x, y, sp_str_compare_alphabetical(x->name, y->name) < 0);
+//
+// sp_radix_sort_ex is a stable LSD radix sort of records by a 32 or 64 bit integer or float
+// key at key_offset, which needn't be aligned. It borrows a buffer the size of the array from
+// mem, and leaves the array untouched if it can't get one. Passes where every key has the same
+// byte are skipped. Floats order -inf < ... < -0 < +0 < ... < +inf, with NaNs at either end
+// depending on their sign bit.
+#define SP_SORT_INSERTION_THRESHOLD 24
+#define SP_SORT_NINTHER_THRESHOLD 128
+#define SP_SORT_PARTIAL_INSERTION_LIMIT 8
+#define SP_SORT_MAX_DEPTH 64
+
+typedef enum {
+  SP_RADIX_KEY_U32,
+  SP_RADIX_KEY_S32,
+  SP_RADIX_KEY_F32,
+  SP_RADIX_KEY_U64,
+  SP_RADIX_KEY_S64,
+  SP_RADIX_KEY_F64,
+} sp_radix_key_t;
+
+typedef struct {
+  u8* data;
+  u64 stride;
+  sp_qsort_fn_t cmp;
+  u8* tmp;
+} sp_sort_t;
+
+typedef struct {
+  u64 begin;
+  u64 end;
+  u32 bad_allowed;
+  bool leftmost;
+} sp_sort_frame_t;
+
+SP_API void sp_sort(void* arr, u64 len, u64 stride, sp_qsort_fn_t cmp);
+SP_API u32  sp_sort_log2(u64 n);
+SP_API sp_err_t sp_radix_sort_ex(sp_mem_t mem, void* arr, u64 len, u64 stride, u64 key_offset, sp_radix_key_t key);
+SP_IMP bool sp_sort_less(sp_sort_t* sort, u64 i, u64 j);
+SP_IMP void sp_sort_swap(sp_sort_t* sort, u64 i, u64 j);
+SP_IMP void sp_sort_sort3(sp_sort_t* sort, u64 i, u64 j, u64 k);
+SP_IMP void sp_sort_rotate(sp_sort_t* sort, u64 to, u64 from);
+SP_IMP void sp_sort_insertion(sp_sort_t* sort, u64 begin, u64 end, bool leftmost);
+SP_IMP bool sp_sort_partial_insertion(sp_sort_t* sort, u64 begin, u64 end);
+SP_IMP u64  sp_sort_partition_right(sp_sort_t* sort, u64 begin, u64 end, bool* already_partitioned);
+SP_IMP u64  sp_sort_partition_left(sp_sort_t* sort, u64 begin, u64 end);
+SP_IMP void sp_sort_heap(sp_sort_t* sort, u64 begin, u64 end);
+SP_IMP void sp_sort_loop(sp_sort_t* sort, u64 begin, u64 end, u32 bad_allowed, bool leftmost);
+SP_IMP u64  sp_radix_key(const u8* record, sp_radix_key_t key);
+
+#define sp_radix_sort_u32(mem, arr, len) sp_radix_sort_ex((mem), (arr), (len), sizeof(u32), 0, SP_RADIX_KEY_U32)
+#define sp_radix_sort_s32(mem, arr, len) sp_radix_sort_ex((mem), (arr), (len), sizeof(s32), 0, SP_RADIX_KEY_S32)
+#define sp_radix_sort_f32(mem, arr, len) sp_radix_sort_ex((mem), (arr), (len), sizeof(f32), 0, SP_RADIX_KEY_F32)
+#define sp_radix_sort_u64(mem, arr, len) sp_radix_sort_ex((mem), (arr), (len), sizeof(u64), 0, SP_RADIX_KEY_U64)
+#define sp_radix_sort_s64(mem, arr, len) sp_radix_sort_ex((mem), (arr), (len), sizeof(s64), 0, SP_RADIX_KEY_S64)
+#define sp_radix_sort_f64(mem, arr, len) sp_radix_sort_ex((mem), (arr), (len), sizeof(f64), 0, SP_RADIX_KEY_F64)
+
+#define sp_sort_by_less(__I, __J, __A, __B, __LESS) \
+  (__A = sp_sort_data + (__I), __B = sp_sort_data + (__J), (__LESS))
+
+#define sp_sort_by_swap(__T, __I, __J)       \
+  do {                                       \
+    __T sp_sort_tmp = sp_sort_data[__I];     \
+    sp_sort_data[__I] = sp_sort_data[__J];   \
+    sp_sort_data[__J] = sp_sort_tmp;         \
+  } while (0)
+
+#define sp_sort_by_insert(__T, __FROM, __TO)                           \
+  do {                                                                  \
+    __T sp_sort_tmp = sp_sort_data[__FROM];                             \
+    for (u64 sp_sort_k = (__FROM); sp_sort_k > (__TO); sp_sort_k--) {   \
+      sp_sort_data[sp_sort_k] = sp_sort_data[sp_sort_k - 1];            \
+    }                                                                   \
+    sp_sort_data[__TO] = sp_sort_tmp;                                   \
+  } while (0)
+
+#define sp_sort_by_push(__BEGIN, __END, __LEFTMOST)                                            \
+  do {                                                                                        \
+    sp_assert(sp_sort_top < SP_SORT_MAX_DEPTH);                                               \
+    sp_sort_stack[sp_sort_top].begin = (__BEGIN);                                             \
+    sp_sort_stack[sp_sort_top].end = (__END);                                                 \
+    sp_sort_stack[sp_sort_top].bad_allowed = sp_sort_frame.bad_allowed;                       \
+    sp_sort_stack[sp_sort_top].leftmost = (__LEFTMOST);                                       \
+    sp_sort_top++;                                                                            \
+  } while (0)
+
+// The recursion of sp_sort_loop becomes an explicit stack: the larger side of each
+// partition is pushed and the smaller one is sorted next, so the stack never holds more
+// than log2(len) frames.
+#define sp_sort_by(__ARR, __LEN, __T, __A, __B, __LESS)                                                    \
+  do {                                                                                                     \
+    __T* sp_sort_data = (__ARR);                                                                           \
+    u64 sp_sort_len = (__LEN);                                                                             \
+    const __T* __A = SP_NULLPTR;                                                                           \
+    const __T* __B = SP_NULLPTR;                                                                           \
+    sp_sort_frame_t sp_sort_stack [SP_SORT_MAX_DEPTH];                                                     \
+    sp_sort_frame_t sp_sort_frame;                                                                         \
+    u32 sp_sort_top = 0;                                                                                   \
+    if (sp_sort_len > 1) {                                                                                 \
+      sp_sort_frame.bad_allowed = sp_sort_log2(sp_sort_len);                                               \
+      sp_sort_by_push(0, sp_sort_len, true);                                                               \
+    }                                                                                                      \
+                                                                                                           \
+    while (sp_sort_top) {                                                                                  \
+      sp_sort_frame = sp_sort_stack[--sp_sort_top];                                                        \
+      u64 sp_sort_lo = sp_sort_frame.begin;                                                                \
+      u64 sp_sort_hi = sp_sort_frame.end;                                                                  \
+                                                                                                           \
+      for (;;) {                                                                                           \
+        u64 sp_sort_size = sp_sort_hi - sp_sort_lo;                                                        \
+        if (sp_sort_size < SP_SORT_INSERTION_THRESHOLD) {                                                  \
+          for (u64 sp_sort_cur = sp_sort_lo + 1; sp_sort_cur < sp_sort_hi; sp_sort_cur++) {                \
+            u64 sp_sort_sift = sp_sort_cur;                                                                \
+            while ((!sp_sort_frame.leftmost || sp_sort_sift > sp_sort_lo) &&                               \
+                   sp_sort_by_less(sp_sort_cur, sp_sort_sift - 1, __A, __B, __LESS)) {                     \
+              sp_sort_sift--;                                                                              \
+            }                                                                                              \
+            if (sp_sort_sift == sp_sort_cur) continue;                                                     \
+            sp_sort_by_insert(__T, sp_sort_cur, sp_sort_sift);                                             \
+          }                                                                                                \
+          break;                                                                                           \
+        }                                                                                                  \
+                                                                                                           \
+        u64 sp_sort_half = sp_sort_size / 2;                                                               \
+        u64 sp_sort_median [4][3] = {                                                                      \
+          { sp_sort_lo + sp_sort_half, sp_sort_lo, sp_sort_hi - 1 },                                       \
+          { sp_sort_lo + 1, sp_sort_lo + sp_sort_half - 1, sp_sort_hi - 2 },                               \
+          { sp_sort_lo + 2, sp_sort_lo + sp_sort_half + 1, sp_sort_hi - 3 },                               \
+          { sp_sort_lo + sp_sort_half - 1, sp_sort_lo + sp_sort_half, sp_sort_lo + sp_sort_half + 1 },     \
+        };                                                                                                 \
+        bool sp_sort_ninther = sp_sort_size > SP_SORT_NINTHER_THRESHOLD;                                   \
+        if (sp_sort_ninther) {                                                                             \
+          sp_sort_median[0][0] = sp_sort_lo;                                                               \
+          sp_sort_median[0][1] = sp_sort_lo + sp_sort_half;                                                \
+        }                                                                                                  \
+        for (u32 sp_sort_m = 0; sp_sort_m < (sp_sort_ninther ? 4u : 1u); sp_sort_m++) {                    \
+          for (u32 sp_sort_p = 0; sp_sort_p < 3; sp_sort_p++) {                                            \
+            u64 sp_sort_x = sp_sort_median[sp_sort_m][sp_sort_p == 1];                                     \
+            u64 sp_sort_y = sp_sort_median[sp_sort_m][(sp_sort_p == 1) + 1];                               \
+            if (sp_sort_by_less(sp_sort_y, sp_sort_x, __A, __B, __LESS)) {                                 \
+              sp_sort_by_swap(__T, sp_sort_x, sp_sort_y);                                                  \
+            }                                                                                              \
+          }                                                                                                \
+        }                                                                                                  \
+        if (sp_sort_ninther) sp_sort_by_swap(__T, sp_sort_lo, sp_sort_lo + sp_sort_half);                  \
+                                                                                                           \
+        if (!sp_sort_frame.leftmost && !sp_sort_by_less(sp_sort_lo - 1, sp_sort_lo, __A, __B, __LESS)) {   \
+          u64 sp_sort_first = sp_sort_lo;                                                                  \
+          u64 sp_sort_last = sp_sort_hi;                                                                   \
+          while (sp_sort_by_less(sp_sort_lo, --sp_sort_last, __A, __B, __LESS));                           \
+          bool sp_sort_guarded = sp_sort_last + 1 == sp_sort_hi;                                           \
+          while ((!sp_sort_guarded || sp_sort_first < sp_sort_last) &&                                     \
+                 !sp_sort_by_less(sp_sort_lo, ++sp_sort_first, __A, __B, __LESS));                         \
+          while (sp_sort_first < sp_sort_last) {                                                           \
+            sp_sort_by_swap(__T, sp_sort_first, sp_sort_last);                                             \
+            while (sp_sort_by_less(sp_sort_lo, --sp_sort_last, __A, __B, __LESS));                         \
+            while (!sp_sort_by_less(sp_sort_lo, ++sp_sort_first, __A, __B, __LESS));                       \
+          }                                                                                                \
+          sp_sort_by_swap(__T, sp_sort_lo, sp_sort_last);                                                  \
+          sp_sort_lo = sp_sort_last + 1;                                                                   \
+          continue;                                                                                        \
+        }                                                                                                  \
+                                                                                                           \
+        u64 sp_sort_first = sp_sort_lo;                                                                    \
+        u64 sp_sort_last = sp_sort_hi;                                                                     \
+        while (sp_sort_by_less(++sp_sort_first, sp_sort_lo, __A, __B, __LESS));                            \
+        bool sp_sort_guarded = sp_sort_first - 1 == sp_sort_lo;                                            \
+        while ((!sp_sort_guarded || sp_sort_first < sp_sort_last) &&                                       \
+               !sp_sort_by_less(--sp_sort_last, sp_sort_lo, __A, __B, __LESS));                            \
+        bool sp_sort_already_partitioned = sp_sort_first >= sp_sort_last;                                  \
+        while (sp_sort_first < sp_sort_last) {                                                             \
+          sp_sort_by_swap(__T, sp_sort_first, sp_sort_last);                                               \
+          while (sp_sort_by_less(++sp_sort_first, sp_sort_lo, __A, __B, __LESS));                          \
+          while (!sp_sort_by_less(--sp_sort_last, sp_sort_lo, __A, __B, __LESS));                          \
+        }                                                                                                  \
+        u64 sp_sort_pivot = sp_sort_first - 1;                                                             \
+        sp_sort_by_swap(__T, sp_sort_lo, sp_sort_pivot);                                                   \
+                                                                                                           \
+        u64 sp_sort_l = sp_sort_pivot - sp_sort_lo;                                                        \
+        u64 sp_sort_r = sp_sort_hi - sp_sort_pivot - 1;                                                    \
+        if (sp_sort_l < sp_sort_size / 8 || sp_sort_r < sp_sort_size / 8) {                                \
+          if (--sp_sort_frame.bad_allowed == 0) {                                                          \
+            u64 sp_sort_n = sp_sort_size;                                                                  \
+            for (u64 sp_sort_step = sp_sort_n / 2 + sp_sort_n - 1; sp_sort_step-- > 0; ) {                 \
+              u64 sp_sort_root = 0;                                                                        \
+              u64 sp_sort_heap_size = sp_sort_n;                                                           \
+              if (sp_sort_step >= sp_sort_n - 1) {                                                         \
+                sp_sort_root = sp_sort_step - (sp_sort_n - 1);                                             \
+              }                                                                                            \
+              else {                                                                                       \
+                sp_sort_heap_size = sp_sort_step + 1;                                                      \
+                sp_sort_by_swap(__T, sp_sort_lo, sp_sort_lo + sp_sort_heap_size);                          \
+              }                                                                                            \
+              for (;;) {                                                                                   \
+                u64 sp_sort_child = 2 * sp_sort_root + 1;                                                  \
+                if (sp_sort_child >= sp_sort_heap_size) break;                                             \
+                u64 sp_sort_right = sp_sort_child + 1;                                                     \
+                if (sp_sort_right < sp_sort_heap_size &&                                                   \
+                    sp_sort_by_less(sp_sort_lo + sp_sort_child, sp_sort_lo + sp_sort_right,                \
+                                    __A, __B, __LESS)) {                                                   \
+                  sp_sort_child++;                                                                         \
+                }                                                                                          \
+                u64 sp_sort_parent = sp_sort_lo + sp_sort_root;                                            \
+                if (!sp_sort_by_less(sp_sort_parent, sp_sort_lo + sp_sort_child, __A, __B, __LESS)) break; \
+                sp_sort_by_swap(__T, sp_sort_lo + sp_sort_root, sp_sort_lo + sp_sort_child);               \
+                sp_sort_root = sp_sort_child;                                                              \
+              }                                                                                            \
+            }                                                                                              \
+            break;                                                                                         \
+          }                                                                                                \
+                                                                                                           \
+          if (sp_sort_l >= SP_SORT_INSERTION_THRESHOLD) {                                                  \
+            sp_sort_by_swap(__T, sp_sort_lo, sp_sort_lo + sp_sort_l / 4);                                  \
+            sp_sort_by_swap(__T, sp_sort_pivot - 1, sp_sort_pivot - sp_sort_l / 4);                        \
+            if (sp_sort_l > SP_SORT_NINTHER_THRESHOLD) {                                                   \
+              sp_sort_by_swap(__T, sp_sort_lo + 1, sp_sort_lo + (sp_sort_l / 4 + 1));                      \
+              sp_sort_by_swap(__T, sp_sort_lo + 2, sp_sort_lo + (sp_sort_l / 4 + 2));                      \
+              sp_sort_by_swap(__T, sp_sort_pivot - 2, sp_sort_pivot - (sp_sort_l / 4 + 1));                \
+              sp_sort_by_swap(__T, sp_sort_pivot - 3, sp_sort_pivot - (sp_sort_l / 4 + 2));                \
+            }                                                                                              \
+          }                                                                                                \
+          if (sp_sort_r >= SP_SORT_INSERTION_THRESHOLD) {                                                  \
+            sp_sort_by_swap(__T, sp_sort_pivot + 1, sp_sort_pivot + (1 + sp_sort_r / 4));                  \
+            sp_sort_by_swap(__T, sp_sort_hi - 1, sp_sort_hi - sp_sort_r / 4);                              \
+            if (sp_sort_r > SP_SORT_NINTHER_THRESHOLD) {                                                   \
+              sp_sort_by_swap(__T, sp_sort_pivot + 2, sp_sort_pivot + (2 + sp_sort_r / 4));                \
+              sp_sort_by_swap(__T, sp_sort_pivot + 3, sp_sort_pivot + (3 + sp_sort_r / 4));                \
+              sp_sort_by_swap(__T, sp_sort_hi - 2, sp_sort_hi - (1 + sp_sort_r / 4));                      \
+              sp_sort_by_swap(__T, sp_sort_hi - 3, sp_sort_hi - (2 + sp_sort_r / 4));                      \
+            }                                                                                              \
+          }                                                                                                \
+        }                                                                                                  \
+        else if (sp_sort_already_partitioned) {                                                            \
+          bool sp_sort_sorted = true;                                                                      \
+          for (u32 sp_sort_side = 0; sp_sort_side < 2 && sp_sort_sorted; sp_sort_side++) {                 \
+            u64 sp_sort_begin = sp_sort_side ? sp_sort_pivot + 1 : sp_sort_lo;                             \
+            u64 sp_sort_end = sp_sort_side ? sp_sort_hi : sp_sort_pivot;                                   \
+            u64 sp_sort_moved = 0;                                                                         \
+            for (u64 sp_sort_cur = sp_sort_begin + 1; sp_sort_cur < sp_sort_end; sp_sort_cur++) {          \
+              if (sp_sort_moved > SP_SORT_PARTIAL_INSERTION_LIMIT) {                                       \
+                sp_sort_sorted = false;                                                                    \
+                break;                                                                                     \
+              }                                                                                            \
+              u64 sp_sort_sift = sp_sort_cur;                                                              \
+              while (sp_sort_sift > sp_sort_begin &&                                                       \
+                     sp_sort_by_less(sp_sort_cur, sp_sort_sift - 1, __A, __B, __LESS)) {                   \
+                sp_sort_sift--;                                                                            \
+              }                                                                                            \
+              if (sp_sort_sift == sp_sort_cur) continue;                                                   \
+              sp_sort_by_insert(__T, sp_sort_cur, sp_sort_sift);                                           \
+              sp_sort_moved += sp_sort_cur - sp_sort_sift;                                                 \
+            }                                                                                              \
+          }                                                                                                \
+          if (sp_sort_sorted) break;                                                                       \
+        }                                                                                                  \
+                                                                                                           \
+        if (sp_sort_l > sp_sort_r) {                                                                       \
+          sp_sort_by_push(sp_sort_lo, sp_sort_pivot, sp_sort_frame.leftmost);                              \
+          sp_sort_lo = sp_sort_pivot + 1;                                                                  \
+          sp_sort_frame.leftmost = false;                                                                  \
+        }                                                                                                  \
+        else {                                                                                             \
+          sp_sort_by_push(sp_sort_pivot + 1, sp_sort_hi, false);                                           \
+          sp_sort_hi = sp_sort_pivot;                                                                      \
+        }                                                                                                  \
+      }                                                                                                    \
+    }                                                                                                      \
+    (void)__A;                                                                                             \
+    (void)__B;                                                                                             \
+  } while (0)
+
+#define sp_da_sort_by(__ARR, __T, __A, __B, __LESS) \
+  sp_sort_by((__ARR), sp_da_size(__ARR), __T, __A, __B, __LESS)
+
 
 //  ███████████   █████ ██████   █████   █████████     ███████████  █████  █████ ███████████ ███████████ ██████████ ███████████
 // ░░███░░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███   ░░███░░░░░███░░███  ░░███ ░░███░░░░░░█░░███░░░░░░█░░███░░░░░█░░███░░░░░███
@@ -1819,10 +2524,13 @@ typedef enum sp_rb_mode {
     SP_RQ_MODE_OVERWRITE,
 } sp_rb_mode;
 
-typedef struct sp_ring_buffer {
+// The storage is rounded up to a power of two, so indexing is a mask rather than a division;
+// capacity is still what you asked for, and is when a full buffer grows or overwrites.
+typedef struct SP_ALIGNED sp_ring_buffer {
     u32 head;
     u32 size;
     u32 capacity;
+    u32 mask;
     sp_rb_mode mode;
     sp_mem_t allocator;
 } sp_ring_buffer_t;
@@ -1866,7 +2574,7 @@ SP_API void* sp_rb_grow_ex(void* arr, u32 stride, u32 new_cap);
 #define sp_rb_free(__ARR)\
     do {\
         if (__ARR) {\
-            sp_mem_allocator_free(sp_rb_mem(__ARR), sp_rb_head(__ARR), sp_rb_capacity(__ARR) * sizeof(*(__ARR)) + sizeof(sp_ring_buffer_t));\
+            sp_mem_allocator_free(sp_rb_mem(__ARR), sp_rb_head(__ARR), (sp_rb_head(__ARR)->mask + 1) * sizeof(*(__ARR)) + sizeof(sp_ring_buffer_t));\
             (__ARR) = SP_NULLPTR;\
         }\
     } while (0)
@@ -1881,7 +2589,7 @@ SP_API void* sp_rb_grow_ex(void* arr, u32 stride, u32 new_cap);
     } while (0)
 
 #define sp_rb_at(__ARR, __IDX)\
-    ((__ARR)[(sp_rb_head(__ARR)->head + (__IDX)) % sp_rb_capacity(__ARR)])
+    ((__ARR)[(sp_rb_head(__ARR)->head + (__IDX)) & sp_rb_head(__ARR)->mask])
 
 #define sp_rb_peek(__ARR)\
     (sp_rb_empty(__ARR) ? SP_NULLPTR : &sp_rb_at(__ARR, 0))
@@ -1894,13 +2602,13 @@ SP_API void* sp_rb_grow_ex(void* arr, u32 stride, u32 new_cap);
         sp_assert((__ARR) != SP_NULLPTR);\
         if (sp_rb_full(__ARR)) {\
             if (sp_rb_mode(__ARR) == SP_RQ_MODE_OVERWRITE) {\
-                sp_rb_head(__ARR)->head = (sp_rb_head(__ARR)->head + 1) % sp_rb_capacity(__ARR);\
+                sp_rb_head(__ARR)->head = (sp_rb_head(__ARR)->head + 1) & sp_rb_head(__ARR)->mask;\
                 sp_rb_head(__ARR)->size--;\
             } else {\
                 *((void**)&(__ARR)) = sp_rb_grow_ex(__ARR, sizeof(*(__ARR)), sp_rb_capacity(__ARR) * 2u);\
             }\
         }\
-        u32 __sp_rb_tail = (sp_rb_head(__ARR)->head + sp_rb_head(__ARR)->size) % sp_rb_capacity(__ARR);\
+        u32 __sp_rb_tail = (sp_rb_head(__ARR)->head + sp_rb_head(__ARR)->size) & sp_rb_head(__ARR)->mask;\
         (__ARR)[__sp_rb_tail] = (__VAL);\
         sp_rb_head(__ARR)->size++;\
     } while (0)
@@ -1908,7 +2616,7 @@ SP_API void* sp_rb_grow_ex(void* arr, u32 stride, u32 new_cap);
 #define sp_rb_pop(__ARR)\
     do {\
         if ((__ARR) && !sp_rb_empty(__ARR)) {\
-            sp_rb_head(__ARR)->head = (sp_rb_head(__ARR)->head + 1) % sp_rb_capacity(__ARR);\
+            sp_rb_head(__ARR)->head = (sp_rb_head(__ARR)->head + 1) & sp_rb_head(__ARR)->mask;\
             sp_rb_head(__ARR)->size--;\
         }\
     } while (0)
@@ -1979,6 +2687,13 @@ SP_API void* sp_rb_grow_ex(void* arr, u32 stride, u32 new_cap);
 // 1. Strings
 // 2. Structs into which the compiler inserts padding
 //
+// ## HASHING
+// The default hash functions use sp_hash_fast(), which is quick but not collision resistant.
+// If a table's keys come from untrusted input, switch it to the SipHash variant of its hash
+// function (and define SP_HT_SIP_SEED to a secret):
+//
+//   sp_ht_set_hash(ht, sp_ht_on_hash_str_key_sip);
+//
 // # TYPES
 // sp_ht(K, V) defines a strongly-typed struct. A hash table is a pointer to such
 // a struct which is lazily allocated on first use. Internally, a hash table is laid
@@ -1987,9 +2702,121 @@ SP_API void* sp_rb_grow_ex(void* arr, u32 stride, u32 new_cap);
 //    [KEY VALUE STATE] [KEY VALUE STATE] [KEY VALUE STATE]
 //
 // In other words, sp_ht() is not designed for high performance linear iteration
-// over a tightly packed array of keys or values
+// over a tightly packed array of keys or values; sp_im() is.
+//
+// ## MODES
+// By default, probing walks the entries one slot at a time. For large tables where lookups
+// dominate, a table can instead be switched to a Swiss table layout, which keeps a separate
+// one byte per slot control array (empty, deleted, or a 7-bit tag from the hash) and probes
+// sixteen slots at a time with SSE2 or NEON:
+//
+//   sp_ht_set_mode(ht, SP_HT_MODE_SWISS);
+//
+// In the default linear layout, erased entries leave tombstones which lookups must probe
+// past until the next rehash. SP_HT_MODE_BACKSHIFT instead shifts the rest of the probe run
+// back into the hole, so erase never leaves a tombstone. The catch is that erasing inside an
+// sp_ht_for() loop may move an entry you haven't visited yet into a slot you already have.
+// Use sp_ht_stats() to see how long probes are in practice.
+//
+// SP_HT_MODE_CACHE_HASH may be combined with either layout. It stores each entry's full hash
+// in a parallel array, so growing the table never calls the hash function again, and probes
+// only call the comparator for entries whose hash matches exactly. It's worth the extra eight
+// bytes per slot for keys which are expensive to hash or compare, like strings.
+//
+// Growing the table normally rehashes every entry inside the insert which crossed the load
+// factor, which is a latency spike proportional to the table's size. SP_HT_MODE_INCREMENTAL
+// (linear layout only) instead allocates the bigger table and leaves the old one alongside
+// it; every insert and lookup then moves the next SP_HT_MIGRATE_STEP slots across. Lookups
+// which hit an entry still in the old table move it first, so returned pointers always point
+// into the live table. Iterating, sp_ht_stats() and sp_ht_migrate(ht, UINT64_MAX) finish the
+// migration outright.
+//
+// The entries themselves and the rest of the API are unchanged; sp_ht_set_mode() may be
+// called at any time and rebuilds the table in place. Define SP_HT_DEFAULT_MODE to change
+// the mode every table starts in.
+//
+// ## BATCHES
+// When you have many keys to look up at once, sp_ht_get_many() hashes them in batches and
+// prefetches each key's home slot before probing, so the cache misses overlap instead of
+// being paid one after another. It fills an array of value pointers (NULL for missing keys)
+// and returns how many were found:
+//
+//   u32 keys [1024];
+//   u64* values [1024];
+//   u64 found = sp_ht_get_many(ht, keys, 1024, values);
+//
+// sp_ht_insert_many(ht, keys, n, values) does the same for inserts, from parallel arrays of
+// keys and values. Both work in every mode.
+//
+// If you know roughly how many entries a table will hold, sp_ht_reserve(ht, n) sizes it once
+// up front instead of doubling (and rehashing everything) log2(n) times on the way there. n is
+// the total the table should hold without resizing, not a count of further inserts. To build a
+// table from arrays in one go:
+//
+//   sp_ht(u32, u64) ht = SP_NULLPTR;
+//   sp_ht_from_arrays(mem, ht, keys, values, n);
+//
+// ## SPECIALIZED TABLES
+// Every generic lookup hashes and compares through function pointers, and computes entry
+// addresses from strides stored in the table, so the compiler can't inline any of it. For hot
+// tables with simple keys, SP_HT_DEFINE() generates functions specialized to one key and value
+// type, with the hash and equality expressions inlined:
+//
+//   SP_HT_DEFINE(entity_ht, u32, entity_t*, key, a == b)
+//
+//   entity_ht_t ht = SP_NULLPTR;
+//   entity_ht_init(mem, &ht);
+//   entity_ht_insert(ht, 69, entity);
+//   entity_t** found = entity_ht_get(ht, 69);
+//   entity_ht_erase(ht, 69);
+//   sp_ht_free(ht);
+//
+// Because the home slot is taken from the top bits of hash * phi, the identity hash above is
+// fine for integer keys. The table is a plain sp_ht(K, V) with the same hash and compare set
+// as its callbacks, so the generic macros keep working on it. Only the default linear layout
+// gets the fully inlined probe; in any other mode, the generated functions hash inline and
+// then call into the generic implementation.
+//
+// ## IMAGES
+// sp_ht_image_write() saves a read-only, position independent snapshot of a table, meant to
+// be written once and then mapped straight from disk on every start instead of rebuilt:
+//
+//   sp_ht_image_write(ht, &writer.base);       // or sp_str_ht_image_write() for sp_str_t keys
+//
+//   sp_ht_image_t image = sp_zero;
+//   sp_ht_image_open(&image, sp_str_lit("index.bin"));
+//   const u64* value = (const u64*)sp_ht_image_get(&image, &key);
+//   sp_ht_image_close(&image);
+//
+// Opening an image only validates its header; lookups run directly against the mapped
+// pages, which the OS faults in as they're touched. The image has its own linear probed
+// layout: the header, then an array of full hashes (zero for an empty slot), then the
+// entries, then (for string keys) every key's bytes. All offsets are relative to the start
+// of the image.
+//
+// Keys are rehashed with sp_hash_fast() when the image is written, whatever hash function the
+// table used, because a function pointer can't be saved to disk. So keys must be plain bytes
+// (or sp_str_t), and values must not contain pointers. The image is in the writer's byte
+// order and isn't portable across endianness.
+#ifndef SP_HT_DEFAULT_MODE
+  #define SP_HT_DEFAULT_MODE SP_HT_MODE_LINEAR
+#endif
+
+#ifndef SP_HT_SIP_SEED
+  #define SP_HT_SIP_SEED SP_HT_HASH_SEED
+#endif
+
 #define SP_HT_HASH_SEED         0x31415296
 #define SP_HT_INVALID_INDEX     UINT32_MAX
+#define SP_HT_GROUP_WIDTH       16
+#define SP_HT_BATCH_SIZE        16
+#define SP_HT_CTRL_EMPTY        0x80
+#define SP_HT_CTRL_DELETED      0xFE
+#define SP_HT_MAX_RESERVE       (1ull << 58)
+
+#ifndef SP_HT_MIGRATE_STEP
+  #define SP_HT_MIGRATE_STEP 64
+#endif
 
 typedef u64 sp_ht_it_t;
 SP_TYPEDEF_FN(sp_hash_t, sp_ht_hash_key_fn_t, void*, u64);
@@ -2001,6 +2828,32 @@ typedef enum sp_ht_entry_state {
   SP_HT_ENTRY_DELETED,
 } sp_ht_entry_state;
 
+typedef enum {
+  SP_HT_MODE_LINEAR = 0,
+  SP_HT_MODE_SWISS  = 1 << 0,
+  SP_HT_MODE_CACHE_HASH = 1 << 1,
+  SP_HT_MODE_BACKSHIFT = 1 << 2,
+  SP_HT_MODE_INCREMENTAL = 1 << 3,
+} sp_ht_mode_t;
+
+// The table being drained while an SP_HT_MODE_INCREMENTAL table grows
+typedef struct {
+  void* data;
+  sp_hash_t* hashes;
+  u64 capacity;
+  u64 cursor;
+} sp_ht_migration_t;
+
+typedef struct {
+  u64 size;
+  u64 capacity;
+  u64 tombstones;
+  u64 max_probe;
+  u64 total_probe;
+  f64 mean_probe;
+  f64 load;
+} sp_ht_stats_t;
+
 typedef struct {
   struct {
     sp_ht_hash_key_fn_t hash;
@@ -2018,8 +2871,13 @@ typedef struct {
   struct {
     u64 size;
     u64 capacity;
+    u64 ctrl;
+    u64 hashes;
+    u64 tombstones;
+    u64 migration;
   } header;
   sp_mem_t allocator;
+  u32 mode;
   u64 tmp_idx;
 } sp_ht_info_t;
 
@@ -2034,6 +2892,32 @@ SP_BEGIN_EXTERN_C()
 #define sp_ht_alloc_type(a, key, size) sp_mem_allocator_alloc((a), (size))
 #endif
 
+static SP_INLINE u32 sp_ht_ctz(u64 x) {
+#if defined(SP_GNUC)
+  return (u32)__builtin_ctzll(x);
+#elif defined(SP_MSVC) && (defined(SP_AMD64) || defined(SP_ARM64))
+  unsigned long idx;
+  _BitScanForward64(&idx, x);
+  return (u32)idx;
+#else
+  u32 n = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+// Capacities are always a power of two. Rather than masking off the low bits of the hash,
+// which throws away everything else and clusters badly for weak hashes, multiply by 2^64 / phi
+// and take the top bits (Fibonacci hashing). These are inline so that SP_HT_DEFINE() tables can
+// probe without a call.
+static SP_INLINE u64 sp_ht_home(sp_hash_t hash, u64 capacity) {
+  u32 bits = sp_ht_ctz(capacity);
+  return bits ? (hash * 0x9E3779B97F4A7C15ull) >> (64 - bits) : 0;
+}
+
 #define __sp_ht_entry(__K, __V)            \
   struct {                                 \
     __K key;                               \
@@ -2048,6 +2932,10 @@ SP_BEGIN_EXTERN_C()
     __V tmp_val;                           \
     u64 size;                              \
     u64 capacity;                          \
+    u8* ctrl;                              \
+    sp_hash_t* hashes;                     \
+    u64 tombstones;                        \
+    sp_ht_migration_t migration;           \
     sp_ht_info_t info;                     \
   }
 
@@ -2063,6 +2951,12 @@ SP_BEGIN_EXTERN_C()
   (ht)->info.fn.hash = (hash_fn);          \
   (ht)->info.fn.compare = (cmp_fn)
 
+#define sp_ht_set_hash(ht, hash_fn)              \
+  do {                                           \
+    (ht)->info.fn.hash = (hash_fn);              \
+    sp_ht_rehash_impl((void*)(ht), (ht)->info);  \
+  } while (0)
+
 #define sp_ht_size(ht) \
   ((ht) ? (ht)->size : 0)
 
@@ -2072,13 +2966,54 @@ SP_BEGIN_EXTERN_C()
 #define sp_ht_empty(ht) \
   ((ht) ? (ht)->size == 0 : true)
 
+#define sp_ht_set_mode(ht, __mode)                         \
+  do {                                                     \
+    if ((ht) && (ht)->info.mode != (u32)(__mode)) {        \
+      (ht)->info.mode = (u32)(__mode);                     \
+      sp_ht_rebuild_impl((void*)(ht), (ht)->info);         \
+    }                                                      \
+  } while (0)
+
+#define sp_ht_stats(ht) \
+  ((ht) ? sp_ht_stats_impl((void*)(ht), (ht)->info) : sp_ht_stats_impl(SP_NULLPTR, sp_zero_s(sp_ht_info_t)))
+
+#define sp_ht_get_many(ht, keys, n, values)                                                      \
+  ((ht) ? sp_ht_get_many_impl((void*)(ht), (void*)(keys), (n), (void**)(values), (ht)->info)     \
+        : sp_ht_get_many_impl(SP_NULLPTR, (void*)(keys), (n), (void**)(values), sp_zero_s(sp_ht_info_t)))
+
+#define sp_ht_insert_many(ht, keys, n, values) \
+  sp_ht_insert_many_impl((void*)(ht), (void*)(keys), (n), (void*)(values), (ht)->info)
+
+#define sp_ht_reserve(ht, n) \
+  ((ht) ? sp_ht_reserve_impl((void*)(ht), (n), (ht)->info) : (void)0)
+
+#define sp_ht_migrate(ht, n) \
+  ((ht) ? sp_ht_migrate_impl((void*)(ht), (n), (ht)->info) : (void)0)
+
+#define sp_ht_migrating(ht) \
+  ((ht) && (ht)->migration.data)
+
+#define sp_ht_from_arrays(mem, ht, keys, values, n)  \
+  do {                                                \
+    sp_ht_init((mem), ht);                            \
+    sp_ht_reserve(ht, n);                             \
+    sp_ht_insert_many(ht, keys, n, values);           \
+  } while (0)
+
 #define sp_ht_clear(ht)                                    \
   do {                                                     \
     if ((ht)) {                                            \
       for (u32 i = 0; i < (ht)->capacity; ++i) {           \
         (ht)->data[i].state = SP_HT_ENTRY_INACTIVE;        \
       }                                                    \
+      if ((ht)->ctrl) {                                    \
+        sp_mem_fill_u8((ht)->ctrl, (ht)->capacity, SP_HT_CTRL_EMPTY); \
+      }                                                    \
       (ht)->size = 0;                                      \
+      (ht)->tombstones = 0;                                \
+      if ((ht)->migration.data) {                          \
+        sp_ht_migration_drop_impl((void*)(ht), (ht)->info); \
+      }                                                    \
     }                                                      \
   } while (0)
 
@@ -2087,6 +3022,11 @@ SP_BEGIN_EXTERN_C()
     if ((ht)) {               \
       sp_mem_allocator_free((ht)->info.allocator, (ht)->data, (ht)->capacity * sizeof((ht)->data[0]));    \
       (ht)->data = SP_NULLPTR;\
+      if ((ht)->ctrl) sp_mem_allocator_free((ht)->info.allocator, (ht)->ctrl, (ht)->capacity); \
+      (ht)->ctrl = SP_NULLPTR;\
+      if ((ht)->hashes) sp_mem_allocator_free((ht)->info.allocator, (ht)->hashes, (ht)->capacity * sizeof(sp_hash_t)); \
+      (ht)->hashes = SP_NULLPTR;\
+      if ((ht)->migration.data) sp_ht_migration_drop_impl((void*)(ht), (ht)->info); \
       sp_mem_allocator_free((ht)->info.allocator, (ht), sizeof(*(ht)));            \
       (ht) = SP_NULLPTR;      \
     }                         \
@@ -2109,6 +3049,11 @@ SP_BEGIN_EXTERN_C()
     (ht)->info.allocator       = (mem);                                                        \
     (ht)->size                 = 0;                                                            \
     (ht)->capacity             = 2;                                                            \
+    (ht)->ctrl                 = SP_NULLPTR;                                                   \
+    (ht)->hashes               = SP_NULLPTR;                                                   \
+    (ht)->tombstones           = 0;                                                            \
+    sp_mem_zero(&(ht)->migration, sizeof(sp_ht_migration_t));                                  \
+    (ht)->info.mode            = SP_HT_MODE_LINEAR;                                            \
     (ht)->info.size.key        = sizeof((ht)->data[0].key);                                    \
     (ht)->info.size.value      = sizeof((ht)->data[0].val);                                    \
     (ht)->info.stride.entry    = sp_ht_data_u8_n(ht, 1) - sp_ht_data_u8_n(ht, 0);              \
@@ -2116,8 +3061,13 @@ SP_BEGIN_EXTERN_C()
     (ht)->info.stride.kv       = sp_ht_data_offset_u8(ht, state);                              \
     (ht)->info.header.size     = sp_ht_field_offset_u8(ht, size);                              \
     (ht)->info.header.capacity = sp_ht_field_offset_u8(ht, capacity);                          \
+    (ht)->info.header.ctrl     = sp_ht_field_offset_u8(ht, ctrl);                              \
+    (ht)->info.header.hashes   = sp_ht_field_offset_u8(ht, hashes);                            \
+    (ht)->info.header.tombstones = sp_ht_field_offset_u8(ht, tombstones);                      \
+    (ht)->info.header.migration = sp_ht_field_offset_u8(ht, migration);                        \
     (ht)->info.fn.hash         = sp_ht_on_hash_key;                                            \
     (ht)->info.fn.compare      = sp_ht_on_compare_key;                                         \
+    sp_ht_set_mode(ht, SP_HT_DEFAULT_MODE);                                                    \
   } while (0)
 
 #define sp_ht_insert_ex(ht, k, v)                                      \
@@ -2164,8 +3114,7 @@ SP_BEGIN_EXTERN_C()
       (ht)->tmp_key = (k);                               \
       u64 _ht_idx = sp_ht_tmp_key_index(ht);             \
       if (_ht_idx != SP_HT_INVALID_INDEX) {              \
-        (ht)->data[_ht_idx].state = SP_HT_ENTRY_DELETED; \
-        if ((ht)->size) (ht)->size--;                    \
+        sp_ht_erase_impl((void*)(ht), _ht_idx, (ht)->info); \
       }                                                  \
     }                                                    \
   } while (0)
@@ -2231,8 +3180,18 @@ SP_BEGIN_EXTERN_C()
 #define sp_str_ht_insert(ht, key, value)  \
   sp_ht_insert_ex(ht, key, value);
 
+#define sp_str_ht_from_arrays(mem, ht, keys, values, n)  \
+  do {                                                    \
+    sp_str_ht_init((mem), ht);                            \
+    sp_ht_reserve(ht, n);                                 \
+    sp_ht_insert_many(ht, keys, n, values);               \
+  } while (0)
+
 #define sp_str_ht_get(ht, key)       sp_ht_getp(ht, key)
 #define sp_str_ht_get_ex(ht, key, n) sp_ht_get_ex(ht, key, n)
+#define sp_str_ht_get_many(ht, keys, n, values)    sp_ht_get_many(ht, keys, n, values)
+#define sp_str_ht_reserve(ht, n)                   sp_ht_reserve(ht, n)
+#define sp_str_ht_insert_many(ht, keys, n, values) sp_ht_insert_many(ht, keys, n, values)
 #define sp_str_ht_erase(ht, key)     sp_ht_erase(ht, key)
 #define sp_str_ht_size(ht)           sp_ht_size(ht)
 #define sp_str_ht_capacity(ht)       sp_ht_capacity(ht)
@@ -2266,7 +3225,17 @@ SP_BEGIN_EXTERN_C()
 #define sp_cstr_ht_insert(ht, key, value)  \
   sp_ht_insert_ex(ht, key, value);
 
+#define sp_cstr_ht_from_arrays(mem, ht, keys, values, n)  \
+  do {                                                     \
+    sp_cstr_ht_init((mem), ht);                            \
+    sp_ht_reserve(ht, n);                                  \
+    sp_ht_insert_many(ht, keys, n, values);                \
+  } while (0)
+
 #define sp_cstr_ht_get(ht, key)       sp_ht_getp(ht, key)
+#define sp_cstr_ht_get_many(ht, keys, n, values)    sp_ht_get_many(ht, keys, n, values)
+#define sp_cstr_ht_reserve(ht, n)                   sp_ht_reserve(ht, n)
+#define sp_cstr_ht_insert_many(ht, keys, n, values) sp_ht_insert_many(ht, keys, n, values)
 #define sp_cstr_ht_erase(ht, key)     sp_ht_erase(ht, key)
 #define sp_cstr_ht_size(ht)           sp_ht_size(ht)
 #define sp_cstr_ht_capacity(ht)       sp_ht_capacity(ht)
@@ -2285,71 +3254,650 @@ SP_BEGIN_EXTERN_C()
 SP_API u64         sp_ht_get_key_index_fn(void** data, void* key, u64 capacity, sp_ht_info_t info);
 SP_API void        sp_ht_resize_impl(void** data, u64 old_cap, u64 new_cap, sp_ht_info_t info);
 SP_API void        sp_ht_insert_impl(void* ht, void* key, void* val, sp_ht_info_t info);
+SP_API u64         sp_ht_find_hashed(void* ht, void* key, sp_hash_t hash, sp_ht_info_t info);
+SP_API void        sp_ht_insert_hashed(void* ht, void* key, void* val, sp_hash_t hash, sp_ht_info_t info);
+SP_API u64         sp_ht_get_many_impl(void* ht, void* keys, u64 n, void** values, sp_ht_info_t info);
+SP_API void        sp_ht_insert_many_impl(void* ht, void* keys, u64 n, void* values, sp_ht_info_t info);
+SP_API void        sp_ht_erase_impl(void* ht, u64 idx, sp_ht_info_t info);
+SP_API void        sp_ht_rebuild_impl(void* ht, sp_ht_info_t info);
+SP_API void        sp_ht_rehash_impl(void* ht, sp_ht_info_t info);
+SP_API void        sp_ht_reserve_impl(void* ht, u64 n, sp_ht_info_t info);
+SP_API void        sp_ht_migrate_impl(void* ht, u64 n, sp_ht_info_t info);
+SP_API void        sp_ht_migration_drop_impl(void* ht, sp_ht_info_t info);
+SP_API sp_ht_stats_t sp_ht_stats_impl(void* ht, sp_ht_info_t info);
 SP_API sp_ht_it_t  sp_ht_it_init_fn(void** data, u64 capacity, sp_ht_info_t info);
 SP_API void        sp_ht_it_advance_fn(void** data, u64 capacity, u64* it, sp_ht_info_t info);
 SP_API sp_hash_t   sp_ht_on_hash_key(void* key, u64 size);
+SP_API sp_hash_t   sp_ht_on_hash_key_sip(void* key, u64 size);
 SP_API bool        sp_ht_on_compare_key(void* ka, void* kb, u64 size);
 SP_API sp_hash_t   sp_ht_on_hash_str_key(void* key, u64 size);
+SP_API sp_hash_t   sp_ht_on_hash_str_key_sip(void* key, u64 size);
 SP_API bool        sp_ht_on_compare_str_key(void* ka, void* kb, u64 size);
 SP_API sp_hash_t   sp_ht_on_hash_cstr_key(void* key, u64 size);
+SP_API sp_hash_t   sp_ht_on_hash_cstr_key_sip(void* key, u64 size);
 SP_API bool        sp_ht_on_compare_cstr_key(void* ka, void* kb, u64 size);
 
+//////////////////
+// SP_HT_DEFINE //
+//////////////////
+// Generates a set of static functions specialized for one key and value type, with the hash
+// and equality expressions inlined into the probe loop. hash_expr may refer to `key`, and
+// eq_expr to `a` and `b`, all of type K. The table itself is an ordinary sp_ht(K, V), so every
+// other sp_ht macro (size, free, clear, iteration, set_mode, stats) works on it as usual.
+#define SP_HT_DEFINE(name, K, V, hash_expr, eq_expr)                                          \
+  typedef sp_ht(K, V) name##_t;                                                               \
+                                                                                              \
+  static SP_INLINE sp_hash_t name##_hash(K key) {                                             \
+    return (sp_hash_t)(hash_expr);                                                            \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE bool name##_eq(K a, K b) {                                                 \
+    return (eq_expr);                                                                         \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE sp_hash_t name##_on_hash(void* key, u64 size) {                            \
+    (void)size;                                                                               \
+    return name##_hash(*(K*)key);                                                             \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE bool name##_on_compare(void* ka, void* kb, u64 size) {                     \
+    (void)size;                                                                               \
+    return name##_eq(*(K*)ka, *(K*)kb);                                                       \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE void name##_init(sp_mem_t mem, name##_t* ht) {                             \
+    sp_ht_init(mem, *ht);                                                                     \
+    sp_ht_set_fns(*ht, name##_on_hash, name##_on_compare);                                    \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE u64 name##_index(name##_t ht, K key) {                                     \
+    if (!ht) return SP_HT_INVALID_INDEX;                                                      \
+    sp_hash_t hash = name##_hash(key);                                                        \
+    if (ht->info.mode != SP_HT_MODE_LINEAR) {                                                 \
+      return sp_ht_find_hashed((void*)ht, &key, hash, ht->info);                              \
+    }                                                                                         \
+    u64 mask = ht->capacity - 1;                                                              \
+    u64 i = sp_ht_home(hash, ht->capacity);                                                   \
+    for (u64 c = 0; c < ht->capacity; c++, i = (i + 1) & mask) {                              \
+      if (ht->data[i].state == SP_HT_ENTRY_INACTIVE) break;                                   \
+      if (ht->data[i].state == SP_HT_ENTRY_ACTIVE && name##_eq(ht->data[i].key, key)) {       \
+        return i;                                                                             \
+      }                                                                                       \
+    }                                                                                         \
+    return SP_HT_INVALID_INDEX;                                                               \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE V* name##_get(name##_t ht, K key) {                                        \
+    u64 idx = name##_index(ht, key);                                                          \
+    return idx == SP_HT_INVALID_INDEX ? SP_NULLPTR : &ht->data[idx].val;                      \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE bool name##_contains(name##_t ht, K key) {                                 \
+    return name##_index(ht, key) != SP_HT_INVALID_INDEX;                                      \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE void name##_insert(name##_t ht, K key, V val) {                            \
+    sp_hash_t hash = name##_hash(key);                                                        \
+    if (ht->info.mode != SP_HT_MODE_LINEAR || (ht->size + ht->tombstones) * 4 >= ht->capacity * 3) { \
+      sp_ht_insert_hashed((void*)ht, &key, &val, hash, ht->info);                             \
+      return;                                                                                 \
+    }                                                                                         \
+    u64 mask = ht->capacity - 1;                                                              \
+    u64 i = sp_ht_home(hash, ht->capacity);                                                   \
+    u64 first_free = SP_HT_INVALID_INDEX;                                                     \
+    for (u64 c = 0; c < ht->capacity; c++, i = (i + 1) & mask) {                              \
+      sp_ht_entry_state state = ht->data[i].state;                                            \
+      if (state == SP_HT_ENTRY_INACTIVE) {                                                    \
+        if (first_free == SP_HT_INVALID_INDEX) first_free = i;                                \
+        break;                                                                                \
+      }                                                                                       \
+      if (state == SP_HT_ENTRY_DELETED) {                                                     \
+        if (first_free == SP_HT_INVALID_INDEX) first_free = i;                                \
+        continue;                                                                             \
+      }                                                                                       \
+      if (name##_eq(ht->data[i].key, key)) {                                                  \
+        ht->data[i].val = val;                                                                \
+        return;                                                                               \
+      }                                                                                       \
+    }                                                                                         \
+    if (ht->data[first_free].state == SP_HT_ENTRY_DELETED) ht->tombstones--;                  \
+    ht->data[first_free].key = key;                                                           \
+    ht->data[first_free].val = val;                                                           \
+    ht->data[first_free].state = SP_HT_ENTRY_ACTIVE;                                          \
+    ht->size++;                                                                               \
+  }                                                                                           \
+                                                                                              \
+  static SP_INLINE bool name##_erase(name##_t ht, K key) {                                    \
+    u64 idx = name##_index(ht, key);                                                          \
+    if (idx == SP_HT_INVALID_INDEX) return false;                                             \
+    sp_ht_erase_impl((void*)ht, idx, ht->info);                                               \
+    return true;                                                                              \
+  }
 
-/*
-    █████████  ███████████ ███████████   █████ ██████   █████   █████████
-   ███░░░░░███░█░░░███░░░█░░███░░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███
-  ░███    ░░░ ░   ░███  ░  ░███    ░███  ░███  ░███░███ ░███  ███     ░░░
-  ░░█████████     ░███     ░██████████   ░███  ░███░░███░███ ░███
-   ░░░░░░░░███    ░███     ░███░░░░░███  ░███  ░███ ░░██████ ░███    █████
-   ███    ░███    ░███     ░███    ░███  ░███  ░███  ░░█████ ░░███  ░░███
-  ░░█████████     █████    █████   █████ █████ █████  ░░█████ ░░█████████
-   ░░░░░░░░░     ░░░░░    ░░░░░   ░░░░░ ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░
-  @string
-
-  ## ENCODING
-
-  ### WTF
-  Windows does not store filenames as UTF-16; it will happily accept unpaired surrogates!
-  If a filename isn't valid UTF-16, then round tripping it with functiont that only deal
-  in UTF-16 is not correct. It will corrupt the true filename.
-
-  Note the "can be" above; the A versions of Win32 functions convert the path you give it via
-  the active code page. The W functions don't. Point being, this problem of encoding is not
-  strictly because we use NT.
+//////////////
+// HT_IMAGE //
+//////////////
+#define SP_HT_IMAGE_MAGIC   0x54485053
+#define SP_HT_IMAGE_VERSION 1
 
-  Zig, one of the giants upon whose shoulders this library stands, coined a name for this
-  almost-but-not-quite-UTF encoding: WTF-8 and WTF-16. These encodings mean, simply, the
-  same as their UTF counterpart but allowing unpaired surrogates to pass through.
+typedef enum {
+  SP_HT_IMAGE_KEY_BYTES = 0,
+  SP_HT_IMAGE_KEY_STR   = 1,
+} sp_ht_image_key_kind_t;
 
- */
 typedef struct {
-  void* user_data;
-
-  sp_io_writer_t* writer;
-  struct {
-    sp_str_t* data;
-    u32 len;
-  } elements;
-
-  sp_str_t str;
-  u32 index;
-} sp_str_reduce_context_t;
+  u32 magic;
+  u32 version;
+  u32 key_kind;
+  u32 key_size;
+  u32 value_size;
+  u32 value_offset;
+  u32 entry_stride;
+  u32 reserved;
+  u64 seed;
+  u64 size;
+  u64 capacity;
+  u64 hashes;
+  u64 entries;
+  u64 strings;
+  u64 strings_size;
+  u64 image_size;
+} sp_ht_image_header_t;
 
 typedef struct {
-  sp_mem_t mem;
-  sp_str_t str;
-  void* user_data;
-} sp_str_map_context_t;
+  u64 offset;
+  u64 len;
+} sp_ht_image_str_t;
 
 typedef struct {
-  sp_str_t first;
-  sp_str_t second;
-} sp_str_pair_t;
+  const u8* base;
+  const sp_ht_image_header_t* header;
+  void* map;
+  u64 map_size;
+} sp_ht_image_t;
+
+#define sp_ht_image_write(ht, io) \
+  sp_ht_image_write_impl((void*)(ht), (io), SP_HT_IMAGE_KEY_BYTES, (ht)->info)
+
+#define sp_str_ht_image_write(ht, io) \
+  sp_ht_image_write_impl((void*)(ht), (io), SP_HT_IMAGE_KEY_STR, (ht)->info)
+
+SP_API sp_err_t    sp_ht_image_write_impl(void* ht, sp_io_writer_t* io, sp_ht_image_key_kind_t kind, sp_ht_info_t info);
+SP_API sp_err_t    sp_ht_image_from_mem(sp_ht_image_t* image, const void* data, u64 size);
+SP_API sp_err_t    sp_ht_image_open(sp_ht_image_t* image, sp_str_t path);
+SP_API void        sp_ht_image_close(sp_ht_image_t* image);
+SP_API u64         sp_ht_image_size(const sp_ht_image_t* image);
+SP_API const void* sp_ht_image_get(const sp_ht_image_t* image, const void* key);
+SP_API const void* sp_ht_image_get_str(const sp_ht_image_t* image, sp_str_t key);
 
-typedef struct {
-  sp_str_t str;
-  u32 index;
-  c8 c;
+///////////////
+// INDEX_MAP //
+///////////////
+// sp_im(K, V) is an index map: a hash table whose keys and values live in two dense arrays,
+// in insertion order, with a separate open addressed table of u32 slots pointing into them.
+// Iterating is a plain loop over packed arrays, with nothing to skip, which makes it the
+// better choice over sp_ht for tables that are read and iterated far more than they change.
+//
+//   sp_im(u32, f32) im = SP_NULLPTR;
+//   sp_im_init(mem, im);
+//   sp_im_insert(im, 69, 4.20f);
+//   f32* value = sp_im_getp(im, 69);
+//   sp_im_for(im, it) {
+//     u32 key = im->keys[it];
+//     f32 value = im->values[it];
+//   }
+//   sp_im_erase(im, 69);
+//   sp_im_free(im);
+//
+// Erase is a swap-remove: the last entry moves into the erased entry's place, so erasing
+// keeps the arrays dense at the cost of moving that one entry out of insertion order. An
+// entry's position is stable until something before the end of the arrays is erased.
+//
+// Hashes are kept in a third dense array, so growing never calls the hash function again and
+// a probe only compares keys whose hash matches. Keys use the same hash and compare callbacks
+// as sp_ht; sp_str_im_init() sets up the sp_str_t ones.
+typedef struct {
+  struct {
+    sp_ht_hash_key_fn_t hash;
+    sp_ht_compare_key_fn_t compare;
+  } fn;
+  struct {
+    u64 key;
+    u64 value;
+  } size;
+  sp_mem_t allocator;
+} sp_im_info_t;
+
+// The untyped prefix every sp_im(K, V) shares
+typedef struct {
+  void* keys;
+  void* values;
+  sp_hash_t* hashes;
+  u32* slots;
+  u64 size;
+  u64 capacity;
+  u64 num_slots;
+  u64 tmp_idx;
+  sp_im_info_t info;
+} sp_im_header_t;
+
+#define sp_im_s(__K, __V)  \
+  {                        \
+    __K* keys;             \
+    __V* values;           \
+    sp_hash_t* hashes;     \
+    u32* slots;            \
+    u64 size;              \
+    u64 capacity;          \
+    u64 num_slots;         \
+    u64 tmp_idx;           \
+    sp_im_info_t info;     \
+    __K tmp_key;           \
+    __V tmp_val;           \
+  }
+
+#define sp_im(__K, __V) \
+  struct sp_im_s(__K, __V)*
+
+#define sp_im_init(mem, im)                                      \
+  do {                                                           \
+    (im) = sp_ht_alloc_type((mem), im, sizeof(*(im)));           \
+    sp_mem_zero((im), sizeof(*(im)));                            \
+    (im)->info.allocator  = (mem);                               \
+    (im)->info.size.key   = sizeof((im)->tmp_key);               \
+    (im)->info.size.value = sizeof((im)->tmp_val);               \
+    (im)->info.fn.hash    = sp_ht_on_hash_key;                   \
+    (im)->info.fn.compare = sp_ht_on_compare_key;                \
+  } while (0)
+
+#define sp_str_im(__V) sp_im(sp_str_t, __V)
+
+#define sp_str_im_init(mem, im)                                  \
+  do {                                                           \
+    sp_im_init((mem), im);                                       \
+    sp_im_set_fns(im, sp_ht_on_hash_str_key, sp_ht_on_compare_str_key); \
+  } while (0)
+
+#define sp_im_set_fns(im, hash_fn, cmp_fn) \
+  (im)->info.fn.hash = (hash_fn);          \
+  (im)->info.fn.compare = (cmp_fn)
+
+#define sp_im_free(im)                                              \
+  do {                                                              \
+    if ((im)) {                                                     \
+      sp_mem_t _im_mem = (im)->info.allocator;                      \
+      sp_im_clear_impl((sp_im_header_t*)(void*)(im), true);         \
+      sp_mem_allocator_free(_im_mem, (im), sizeof(*(im)));          \
+      (im) = SP_NULLPTR;                                            \
+    }                                                               \
+  } while (0)
+
+#define sp_im_clear(im) \
+  ((im) ? sp_im_clear_impl((sp_im_header_t*)(void*)(im), false) : (void)0)
+
+#define sp_im_reserve(im, n) \
+  ((im) ? sp_im_reserve_impl((sp_im_header_t*)(void*)(im), (n)) : (void)0)
+
+#define sp_im_size(im) \
+  ((im) ? (im)->size : 0)
+
+#define sp_im_empty(im) \
+  (sp_im_size(im) == 0)
+
+#define sp_im_insert(im, k, v)                                                          \
+  do {                                                                                  \
+    (im)->tmp_key = (k);                                                                \
+    (im)->tmp_val = (v);                                                                \
+    sp_im_insert_impl((sp_im_header_t*)(void*)(im), &(im)->tmp_key, &(im)->tmp_val);    \
+  } while (0)
+
+#define sp_im_index(im, k) \
+  (!(im) ? SP_HT_INVALID_INDEX : ((im)->tmp_key = (k), sp_im_find_impl((sp_im_header_t*)(void*)(im), &(im)->tmp_key)))
+
+#define sp_im_getp(im, k) \
+  (!(im) ? SP_NULLPTR : ( \
+    (im)->tmp_key = (k), \
+    (im)->tmp_idx = sp_im_find_impl((sp_im_header_t*)(void*)(im), &(im)->tmp_key), \
+    (im)->tmp_idx == SP_HT_INVALID_INDEX ? SP_NULLPTR : &(im)->values[(im)->tmp_idx] \
+    ) \
+  )
+
+#define sp_im_contains(im, k) \
+  (sp_im_index(im, k) != SP_HT_INVALID_INDEX)
+
+#define sp_im_erase(im, k) \
+  (!(im) ? false : ((im)->tmp_key = (k), sp_im_erase_impl((sp_im_header_t*)(void*)(im), &(im)->tmp_key)))
+
+#define sp_im_for(im, it) \
+  for (u64 it = 0; it < sp_im_size(im); it++)
+
+SP_API u64  sp_im_find_impl(sp_im_header_t* im, void* key);
+SP_API u64  sp_im_insert_impl(sp_im_header_t* im, void* key, void* value);
+SP_API bool sp_im_erase_impl(sp_im_header_t* im, void* key);
+SP_API void sp_im_reserve_impl(sp_im_header_t* im, u64 n);
+SP_API void sp_im_clear_impl(sp_im_header_t* im, bool release);
+
+//////////////
+// HASH_SET //
+//////////////
+// sp_hs(K) is a hash set. A map with a dummy value pays for that value, plus the padding to
+// align it and the entry state, in every slot; a set stores nothing but its keys, in one
+// array, with a separate control byte per slot:
+//
+//   sp_hs(u32) seen = SP_NULLPTR;
+//   sp_hs_init(mem, seen);
+//   if (sp_hs_insert(seen, 69)) { /* first time */ }
+//   bool found = sp_hs_contains(seen, 69);
+//   sp_hs_erase(seen, 69);
+//   sp_hs_for(seen, it) {
+//     u32 key = *sp_hs_it_getkp(seen, it);
+//   }
+//   sp_hs_free(seen);
+//
+// The control bytes work like the Swiss table's: empty, deleted, or seven bits of the key's
+// hash, so a probe skips almost every non-matching key without reading it. A u32 set costs
+// five bytes a slot, against twelve for sp_ht(u32, u8).
+//
+// Set algebra works in place on the first set, so nothing is allocated for a result:
+//
+//   sp_hs_union(a, b);        // a = a | b
+//   sp_hs_intersect(a, b);    // a = a & b
+//   sp_hs_difference(a, b);   // a = a - b
+//
+// Both sets must have the same key type and the same hash and compare functions.
+typedef struct {
+  struct {
+    sp_ht_hash_key_fn_t hash;
+    sp_ht_compare_key_fn_t compare;
+  } fn;
+  u64 key_size;
+  sp_mem_t allocator;
+} sp_hs_info_t;
+
+// The untyped prefix every sp_hs(K) shares
+typedef struct {
+  void* keys;
+  u8* ctrl;
+  u64 size;
+  u64 capacity;
+  u64 tombstones;
+  sp_hs_info_t info;
+} sp_hs_header_t;
+
+#define sp_hs_s(__K)       \
+  {                        \
+    __K* keys;             \
+    u8* ctrl;              \
+    u64 size;              \
+    u64 capacity;          \
+    u64 tombstones;        \
+    sp_hs_info_t info;     \
+    __K tmp_key;           \
+  }
+
+#define sp_hs(__K) \
+  struct sp_hs_s(__K)*
+
+#define sp_hs_header(hs) \
+  ((sp_hs_header_t*)(void*)(hs))
+
+#define sp_hs_init(mem, hs)                                      \
+  do {                                                           \
+    (hs) = sp_ht_alloc_type((mem), hs, sizeof(*(hs)));           \
+    sp_mem_zero((hs), sizeof(*(hs)));                            \
+    (hs)->info.allocator = (mem);                                \
+    (hs)->info.key_size  = sizeof((hs)->tmp_key);                \
+    (hs)->info.fn.hash    = sp_ht_on_hash_key;                   \
+    (hs)->info.fn.compare = sp_ht_on_compare_key;                \
+  } while (0)
+
+#define sp_str_hs_init(mem, hs)                                  \
+  do {                                                           \
+    sp_hs_init((mem), hs);                                       \
+    sp_hs_set_fns(hs, sp_ht_on_hash_str_key, sp_ht_on_compare_str_key); \
+  } while (0)
+
+#define sp_hs_set_fns(hs, hash_fn, cmp_fn) \
+  (hs)->info.fn.hash = (hash_fn);          \
+  (hs)->info.fn.compare = (cmp_fn)
+
+#define sp_hs_free(hs)                                              \
+  do {                                                              \
+    if ((hs)) {                                                     \
+      sp_mem_t _hs_mem = (hs)->info.allocator;                      \
+      sp_hs_clear_impl(sp_hs_header(hs), true);                     \
+      sp_mem_allocator_free(_hs_mem, (hs), sizeof(*(hs)));          \
+      (hs) = SP_NULLPTR;                                            \
+    }                                                               \
+  } while (0)
+
+#define sp_hs_clear(hs) \
+  ((hs) ? sp_hs_clear_impl(sp_hs_header(hs), false) : (void)0)
+
+#define sp_hs_reserve(hs, n) \
+  ((hs) ? sp_hs_reserve_impl(sp_hs_header(hs), (n)) : (void)0)
+
+#define sp_hs_size(hs) \
+  ((hs) ? (hs)->size : 0)
+
+#define sp_hs_capacity(hs) \
+  ((hs) ? (hs)->capacity : 0)
+
+#define sp_hs_empty(hs) \
+  (sp_hs_size(hs) == 0)
+
+#define sp_hs_insert(hs, k) \
+  ((hs)->tmp_key = (k), sp_hs_insert_impl(sp_hs_header(hs), &(hs)->tmp_key))
+
+#define sp_hs_contains(hs, k) \
+  (!(hs) ? false : ((hs)->tmp_key = (k), sp_hs_find_impl(sp_hs_header(hs), &(hs)->tmp_key) != SP_HT_INVALID_INDEX))
+
+#define sp_hs_erase(hs, k) \
+  (!(hs) ? false : ((hs)->tmp_key = (k), sp_hs_erase_impl(sp_hs_header(hs), &(hs)->tmp_key)))
+
+#define sp_hs_union(a, b)      sp_hs_union_impl(sp_hs_header(a), sp_hs_header(b))
+#define sp_hs_intersect(a, b)  sp_hs_intersect_impl(sp_hs_header(a), sp_hs_header(b))
+#define sp_hs_difference(a, b) sp_hs_difference_impl(sp_hs_header(a), sp_hs_header(b))
+
+#define sp_hs_it_init(hs) \
+  (!(hs) ? 0 : sp_hs_it_next_impl(sp_hs_header(hs), 0))
+
+#define sp_hs_it_valid(hs, it) \
+  ((it) < sp_hs_capacity(hs))
+
+#define sp_hs_it_advance(hs, it) \
+  ((it) = sp_hs_it_next_impl(sp_hs_header(hs), (it) + 1))
+
+#define sp_hs_it_getkp(hs, it) \
+  (&(hs)->keys[(it)])
+
+#define sp_hs_for(hs, it) \
+  for (sp_ht_it_t it = sp_hs_it_init(hs); sp_hs_it_valid(hs, it); sp_hs_it_advance(hs, it))
+
+SP_API u64  sp_hs_find_impl(sp_hs_header_t* hs, void* key);
+SP_API bool sp_hs_insert_impl(sp_hs_header_t* hs, void* key);
+SP_API bool sp_hs_erase_impl(sp_hs_header_t* hs, void* key);
+SP_API void sp_hs_reserve_impl(sp_hs_header_t* hs, u64 n);
+SP_API void sp_hs_clear_impl(sp_hs_header_t* hs, bool release);
+SP_API u64  sp_hs_it_next_impl(sp_hs_header_t* hs, u64 it);
+SP_API void sp_hs_union_impl(sp_hs_header_t* a, sp_hs_header_t* b);
+SP_API void sp_hs_intersect_impl(sp_hs_header_t* a, sp_hs_header_t* b);
+SP_API void sp_hs_difference_impl(sp_hs_header_t* a, sp_hs_header_t* b);
+
+/////////
+// MPH //
+/////////
+// sp_mph_t is a minimal perfect hash: built once from a fixed set of n distinct keys, it maps
+// each of them to its own index in [0, n), with no empty slots and no collisions. It's meant
+// for tables which are built once and then only read, like keyword or option names. Store the
+// keys and values in arrays ordered by that index, and a lookup is one hash, one read from a
+// small table of per-bucket displacements, and one probe into your arrays:
+//
+//   sp_mph_t mph = sp_zero;
+//   sp_mph_build_str(mem, &mph, names, n);
+//   sp_for(i, n) {
+//     u32 index = sp_mph_index_str(&mph, names[i]);
+//     table[index] = (entry_t) { .name = names[i], .value = values[i] };
+//   }
+//
+//   entry_t* entry = &table[sp_mph_index_str(&mph, name)];
+//   if (!sp_str_equal(entry->name, name)) { /* not in the set */ }
+//
+// Keys outside the set hash to some arbitrary index, so a lookup which may miss has to compare
+// the key it finds there (and an empty set maps every key to zero). The function itself costs
+// four bytes per four keys, however long the keys are.
+//
+// It's CHD (hash, displace, and compress) with a load factor of one: keys are hashed into
+// buckets of about four, then the buckets are placed largest first, each one trying
+// displacements until all of its keys land in free slots. Building is deterministic, so the
+// same keys always give the same function; sp_mph_write() serializes it, and
+// sp_mph_from_mem() wraps serialized bytes in place, e.g. from a file or an array compiled
+// into the binary; freeing such a view leaves the bytes alone. Building fails if the keys
+// aren't distinct.
+#define SP_MPH_MAGIC   0x48504d53
+#define SP_MPH_VERSION 1
+#define SP_MPH_KEYS_PER_BUCKET 4
+
+typedef struct {
+  u32 magic;
+  u32 version;
+  u32 num_keys;
+  u32 num_buckets;
+  u64 seed;
+} sp_mph_header_t;
+
+typedef struct {
+  u64 seed;
+  u32 num_keys;
+  u32 num_buckets;
+  const u32* pilots;
+  sp_mem_t mem;
+} sp_mph_t;
+
+SP_API sp_err_t sp_mph_build(sp_mem_t mem, sp_mph_t* mph, const void* keys, u32 key_size, u32 n);
+SP_API sp_err_t sp_mph_build_str(sp_mem_t mem, sp_mph_t* mph, const sp_str_t* keys, u32 n);
+SP_API void     sp_mph_free(sp_mph_t* mph);
+SP_API u32      sp_mph_index(const sp_mph_t* mph, const void* key, u64 size);
+SP_API u32      sp_mph_index_str(const sp_mph_t* mph, sp_str_t key);
+SP_API u64      sp_mph_size(const sp_mph_t* mph);
+SP_API sp_err_t sp_mph_write(const sp_mph_t* mph, sp_io_writer_t* io);
+SP_API sp_err_t sp_mph_from_mem(sp_mph_t* mph, const void* data, u64 size);
+
+///////////
+// BLOOM //
+///////////
+// sp_bloom_t is a Bloom filter: a compact set which can say for certain that a key was never
+// inserted, and otherwise says it probably was. Put one in front of a big table whose lookups
+// mostly miss, and most misses never touch the table:
+//
+//   sp_bloom_t bloom = sp_zero;
+//   sp_bloom_init(mem, &bloom, expected_keys, 0.01);
+//   sp_bloom_insert(&bloom, &key, sizeof(key));
+//   if (sp_bloom_contains(&bloom, &key, sizeof(key))) { /* now look in the table */ }
+//   sp_bloom_free(&bloom);
+//
+// It's split into 256 bit blocks, and a key sets exactly one bit in each of a block's eight
+// 32 bit words, so every insert or lookup touches a single cache line; the eight words are
+// independent, which compilers turn into a handful of SIMD instructions. The size is chosen
+// from the expected number of keys and the false positive rate you want at that count; rates
+// below SP_BLOOM_MIN_FP_RATE (about 64 bits a key) are raised to it. If you've already hashed
+// the key with sp_hash_fast() for the table behind the filter, pass the hash to
+// sp_bloom_insert_hash() / sp_bloom_contains_hash() instead of hashing twice.
+//
+// sp_bloom_merge() ORs one filter into another of the same size, which is then the filter of
+// both sets of keys. sp_bloom_write() serializes a filter, and sp_bloom_from_mem() wraps the
+// serialized bytes in place as a read-only filter.
+#define SP_BLOOM_MAGIC   0x4d4c4253
+#define SP_BLOOM_VERSION 1
+#define SP_BLOOM_BLOCK_WORDS 8
+#define SP_BLOOM_MIN_FP_RATE 1e-6
+
+typedef struct {
+  u32 magic;
+  u32 version;
+  u64 num_blocks;
+  u64 seed;
+  u64 reserved;
+} sp_bloom_header_t;
+
+typedef struct {
+  u32* blocks;
+  u64 num_blocks;
+  u64 seed;
+  void* storage;
+  sp_mem_t mem;
+} sp_bloom_t;
+
+SP_API void     sp_bloom_init(sp_mem_t mem, sp_bloom_t* bloom, u64 num_keys, f64 fp_rate);
+SP_API void     sp_bloom_free(sp_bloom_t* bloom);
+SP_API void     sp_bloom_clear(sp_bloom_t* bloom);
+SP_API void     sp_bloom_insert(sp_bloom_t* bloom, const void* key, u64 size);
+SP_API void     sp_bloom_insert_str(sp_bloom_t* bloom, sp_str_t key);
+SP_API void     sp_bloom_insert_hash(sp_bloom_t* bloom, sp_hash_t hash);
+SP_API bool     sp_bloom_contains(const sp_bloom_t* bloom, const void* key, u64 size);
+SP_API bool     sp_bloom_contains_str(const sp_bloom_t* bloom, sp_str_t key);
+SP_API bool     sp_bloom_contains_hash(const sp_bloom_t* bloom, sp_hash_t hash);
+SP_API sp_err_t sp_bloom_merge(sp_bloom_t* bloom, const sp_bloom_t* other);
+SP_API f64      sp_bloom_fp_rate(u64 num_blocks, u64 num_keys);
+SP_API sp_err_t sp_bloom_write(const sp_bloom_t* bloom, sp_io_writer_t* io);
+SP_API sp_err_t sp_bloom_from_mem(sp_bloom_t* bloom, const void* data, u64 size);
+
+
+/*
+    █████████  ███████████ ███████████   █████ ██████   █████   █████████
+   ███░░░░░███░█░░░███░░░█░░███░░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███
+  ░███    ░░░ ░   ░███  ░  ░███    ░███  ░███  ░███░███ ░███  ███     ░░░
+  ░░█████████     ░███     ░██████████   ░███  ░███░░███░███ ░███
+   ░░░░░░░░███    ░███     ░███░░░░░███  ░███  ░███ ░░██████ ░███    █████
+   ███    ░███    ░███     ░███    ░███  ░███  ░███  ░░█████ ░░███  ░░███
+  ░░█████████     █████    █████   █████ █████ █████  ░░█████ ░░█████████
+   ░░░░░░░░░     ░░░░░    ░░░░░   ░░░░░ ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░
+  @string
+
+  ## ENCODING
+
+  ### WTF
+  Windows does not store filenames as UTF-16; it will happily accept unpaired surrogates!
+  If a filename isn't valid UTF-16, then round tripping it with functiont that only deal
+  in UTF-16 is not correct. It will corrupt the true filename.
+
+  Note the "can be" above; the A versions of Win32 functions convert the path you give it via
+  the active code page. The W functions don't. Point being, this problem of encoding is not
+  strictly because we use NT.
+
+  Zig, one of the giants upon whose shoulders this library stands, coined a name for this
+  almost-but-not-quite-UTF encoding: WTF-8 and WTF-16. These encodings mean, simply, the
+  same as their UTF counterpart but allowing unpaired surrogates to pass through.
+
+ */
+typedef struct {
+  void* user_data;
+
+  sp_io_writer_t* writer;
+  struct {
+    sp_str_t* data;
+    u32 len;
+  } elements;
+
+  sp_str_t str;
+  u32 index;
+} sp_str_reduce_context_t;
+
+typedef struct {
+  sp_mem_t mem;
+  sp_str_t str;
+  void* user_data;
+} sp_str_map_context_t;
+
+typedef struct {
+  sp_str_t first;
+  sp_str_t second;
+} sp_str_pair_t;
+
+typedef struct {
+  sp_str_t str;
+  u32 index;
+  c8 c;
 } sp_str_it_t;
 
 #define SP_UTF8_REPLACEMENT   0xFFFD
@@ -2751,6 +4299,7 @@ SP_API sp_str_t             sp_fs_get_config_path(sp_mem_t mem);
 // @threading @concurrency
 // @atomic
 typedef s32 sp_atomic_s32_t;
+typedef u32 sp_atomic_u32_t;
 typedef void* sp_atomic_ptr_t;
 
 SP_API bool  sp_atomic_s32_cas(sp_atomic_s32_t* value, s32 current, s32 desired);
@@ -2760,6 +4309,9 @@ SP_API s32   sp_atomic_s32_get(sp_atomic_s32_t* value);
 SP_API bool  sp_atomic_ptr_cas(sp_atomic_ptr_t* value, void* current, void* desired);
 SP_API void* sp_atomic_ptr_set(sp_atomic_ptr_t* value, void* desired);
 SP_API void* sp_atomic_ptr_get(sp_atomic_ptr_t* value);
+SP_API u32   sp_atomic_u32_load_acquire(sp_atomic_u32_t* value);
+SP_API void  sp_atomic_u32_store_release(sp_atomic_u32_t* value, u32 desired);
+SP_API bool  sp_atomic_u32_cas(sp_atomic_u32_t* value, u32 current, u32 desired);
 
 // @mutex
 typedef enum {
@@ -2853,6 +4405,376 @@ SP_API void sp_thread_init(sp_thread_t* thread, sp_thread_fn_t fn, void* userdat
 SP_API void sp_thread_join(sp_thread_t* thread);
 SP_API s32  sp_thread_launch(void* userdata);
 
+// @concurrent_hash_table @cht
+//
+// sp_cht is a thread safe hash table, built from SP_CHT_NUM_SHARDS ordinary sp_ht tables,
+// each behind its own mutex. A key is hashed once, outside of any lock; a remixed copy of
+// the hash picks the shard, and only that shard is locked for the operation. Threads working
+// on different keys rarely contend, which a single mutex around one sp_ht can't offer.
+//
+//   sp_cht(u32, u64) cht = SP_NULLPTR;
+//   sp_cht_init(sp_mem_os_new(), cht);
+//
+//   u32 key = 69;
+//   u64 value = 420;
+//   sp_cht_insert(cht, &key, &value);
+//   if (sp_cht_get(cht, &key, &value)) { ... }
+//   sp_cht_erase(cht, &key);
+//   sp_cht_free(cht);
+//
+// Unlike sp_ht, keys and values are passed by pointer and copied in and out under the
+// shard's lock; you never get a pointer into the table, since another thread may grow it
+// as soon as the lock is released. For the same reason, there's no iteration.
+//
+// sp_cht_compute_if_absent() looks up a key and, only if it's missing, calls your function
+// to produce the value and inserts it, all under the shard's lock. Two threads racing to
+// populate the same key will call the function exactly once:
+//
+//   u64 value;
+//   sp_cht_compute_if_absent(cht, &key, load_value, user_data, &value);
+//
+// Every shard allocates from the allocator passed to sp_cht_init(), from whichever thread
+// happens to be inserting, so it must be thread safe (e.g. sp_mem_os_new()). Each shard is
+// padded so that no two shards' locks share a cache line.
+#ifndef SP_CHT_NUM_SHARDS
+  #define SP_CHT_NUM_SHARDS 64
+#endif
+
+#define SP_CHT_CACHE_LINE 64
+#define SP_CHT_SHARD_PADDING (2 * SP_CHT_CACHE_LINE - (sizeof(sp_mutex_t) + sizeof(void*)) % SP_CHT_CACHE_LINE)
+
+SP_TYPEDEF_FN(void, sp_cht_compute_fn_t, const void* key, void* value, void* user_data);
+
+typedef struct {
+  sp_mutex_t mutex;
+  void* ht;
+  u8 padding [SP_CHT_SHARD_PADDING];
+} sp_cht_shard_t;
+
+#define sp_cht_s(__K, __V)                       \
+  {                                              \
+    struct {                                     \
+      sp_mutex_t mutex;                          \
+      sp_ht(__K, __V) ht;                        \
+      u8 padding [SP_CHT_SHARD_PADDING];         \
+    } shards [SP_CHT_NUM_SHARDS];                \
+    sp_ht_info_t info;                           \
+  }
+
+#define sp_cht(__K, __V) \
+  struct sp_cht_s(__K, __V)*
+
+#define sp_cht_shards(cht) \
+  ((sp_cht_shard_t*)(void*)(cht)->shards)
+
+#define sp_cht_init(mem, cht)                                              \
+  do {                                                                     \
+    (cht) = sp_ht_alloc_type((mem), cht, sizeof(*(cht)));                  \
+    for (u32 _cht_i = 0; _cht_i < SP_CHT_NUM_SHARDS; _cht_i++) {           \
+      sp_mutex_init(&(cht)->shards[_cht_i].mutex, SP_MUTEX_PLAIN);         \
+      sp_ht_init((mem), (cht)->shards[_cht_i].ht);                         \
+    }                                                                      \
+    (cht)->info = (cht)->shards[0].ht->info;                               \
+  } while (0)
+
+#define sp_str_cht_init(mem, cht)                                          \
+  do {                                                                     \
+    sp_cht_init((mem), cht);                                               \
+    sp_cht_set_fns(cht, sp_ht_on_hash_str_key, sp_ht_on_compare_str_key);  \
+  } while (0)
+
+// Not thread safe; call these before sharing the table
+#define sp_cht_set_fns(cht, hash_fn, cmp_fn)                               \
+  do {                                                                     \
+    for (u32 _cht_i = 0; _cht_i < SP_CHT_NUM_SHARDS; _cht_i++) {           \
+      sp_ht_set_fns((cht)->shards[_cht_i].ht, (hash_fn), (cmp_fn));        \
+    }                                                                      \
+    (cht)->info = (cht)->shards[0].ht->info;                               \
+  } while (0)
+
+#define sp_cht_set_mode(cht, __mode)                                       \
+  do {                                                                     \
+    for (u32 _cht_i = 0; _cht_i < SP_CHT_NUM_SHARDS; _cht_i++) {           \
+      sp_ht_set_mode((cht)->shards[_cht_i].ht, (__mode));                  \
+    }                                                                      \
+    (cht)->info = (cht)->shards[0].ht->info;                               \
+  } while (0)
+
+#define sp_cht_free(cht)                                                   \
+  do {                                                                     \
+    if ((cht)) {                                                           \
+      sp_mem_t _cht_mem = (cht)->info.allocator;                           \
+      for (u32 _cht_i = 0; _cht_i < SP_CHT_NUM_SHARDS; _cht_i++) {         \
+        sp_ht_free((cht)->shards[_cht_i].ht);                              \
+        sp_mutex_destroy(&(cht)->shards[_cht_i].mutex);                    \
+      }                                                                    \
+      sp_mem_allocator_free(_cht_mem, (cht), sizeof(*(cht)));              \
+      (cht) = SP_NULLPTR;                                                  \
+    }                                                                      \
+  } while (0)
+
+#define sp_cht_get(cht, key, value) \
+  sp_cht_get_impl(sp_cht_shards(cht), (void*)(key), (void*)(value), (cht)->info)
+
+#define sp_cht_contains(cht, key) \
+  sp_cht_get_impl(sp_cht_shards(cht), (void*)(key), SP_NULLPTR, (cht)->info)
+
+#define sp_cht_insert(cht, key, value) \
+  sp_cht_insert_impl(sp_cht_shards(cht), (void*)(key), (void*)(value), (cht)->info)
+
+#define sp_cht_erase(cht, key) \
+  sp_cht_erase_impl(sp_cht_shards(cht), (void*)(key), (cht)->info)
+
+#define sp_cht_compute_if_absent(cht, key, fn, user_data, value) \
+  sp_cht_compute_if_absent_impl(sp_cht_shards(cht), (void*)(key), (fn), (user_data), (void*)(value), (cht)->info)
+
+#define sp_cht_size(cht) \
+  ((cht) ? sp_cht_size_impl(sp_cht_shards(cht), (cht)->info) : 0)
+
+SP_API bool sp_cht_get_impl(sp_cht_shard_t* shards, void* key, void* value, sp_ht_info_t info);
+SP_API void sp_cht_insert_impl(sp_cht_shard_t* shards, void* key, void* value, sp_ht_info_t info);
+SP_API bool sp_cht_erase_impl(sp_cht_shard_t* shards, void* key, sp_ht_info_t info);
+SP_API bool sp_cht_compute_if_absent_impl(sp_cht_shard_t* shards, void* key, sp_cht_compute_fn_t fn, void* user_data, void* value, sp_ht_info_t info);
+SP_API u64  sp_cht_size_impl(sp_cht_shard_t* shards, sp_ht_info_t info);
+
+// @intern
+//
+// sp_intern_t stores each distinct string once and hands out a dense u32 symbol for it, so
+// code that keeps many copies of the same keys can hold and compare symbols instead. Symbols
+// start at zero and count up, which makes them usable as indices into a plain array:
+//
+//   sp_intern_t intern = sp_zero;
+//   sp_intern_init(&intern, mem);
+//   u32 foo = sp_intern(&intern, sp_str_lit("foo"));     // 0
+//   u32 bar = sp_intern(&intern, sp_str_lit("bar"));     // 1
+//   SP_ASSERT(sp_intern(&intern, sp_str_lit("foo")) == foo);
+//   sp_str_t str = sp_intern_get(&intern, bar);          // "bar"
+//   sp_intern_free(&intern);
+//
+// Interned bytes are copied into an arena owned by the table, so the strings you pass in
+// don't need to outlive the call, and the strings you get back stay valid (and never move)
+// until the table is freed. sp_intern_find() looks a string up without adding it, and returns
+// SP_INTERN_INVALID if it's never been interned.
+//
+// sp_intern_sync_t is the thread safe version. Strings are sharded across SP_CHT_NUM_SHARDS
+// tables, each with its own lock and arena, the same way sp_cht is; symbols come from one
+// atomic counter, so they're still dense across every shard. sp_intern_sync_get() takes no
+// lock at all: each symbol's string lives in a fixed slot of a paged array, written once
+// before the symbol is handed out. A sync table holds at most SP_INTERN_PAGE_SIZE *
+// SP_INTERN_MAX_PAGES strings, and like sp_cht its allocator must be thread safe.
+#define SP_INTERN_INVALID SP_HT_INVALID_INDEX
+
+#ifndef SP_INTERN_PAGE_SIZE
+  #define SP_INTERN_PAGE_SIZE 4096
+#endif
+
+#ifndef SP_INTERN_MAX_PAGES
+  #define SP_INTERN_MAX_PAGES 4096
+#endif
+
+#define SP_INTERN_SHARD_PADDING (2 * SP_CHT_CACHE_LINE - (sizeof(sp_mutex_t) + 2 * sizeof(void*)) % SP_CHT_CACHE_LINE)
+
+typedef struct {
+  sp_mem_t mem;
+  sp_mem_arena_t* arena;
+  sp_str_ht(u32) ids;
+  sp_da(sp_str_t) strings;
+} sp_intern_t;
+
+typedef struct {
+  sp_mutex_t mutex;
+  sp_mem_arena_t* arena;
+  sp_str_ht(u32) ids;
+  u8 padding [SP_INTERN_SHARD_PADDING];
+} sp_intern_shard_t;
+
+typedef struct {
+  sp_intern_shard_t shards [SP_CHT_NUM_SHARDS];
+  sp_atomic_ptr_t pages [SP_INTERN_MAX_PAGES];
+  sp_atomic_s32_t size;
+  sp_mem_t mem;
+} sp_intern_sync_t;
+
+SP_API void     sp_intern_init(sp_intern_t* intern, sp_mem_t mem);
+SP_API void     sp_intern_free(sp_intern_t* intern);
+SP_API u32      sp_intern(sp_intern_t* intern, sp_str_t str);
+SP_API u32      sp_intern_cstr(sp_intern_t* intern, const c8* str);
+SP_API u32      sp_intern_find(sp_intern_t* intern, sp_str_t str);
+SP_API sp_str_t sp_intern_get(sp_intern_t* intern, u32 id);
+SP_API u32      sp_intern_size(sp_intern_t* intern);
+SP_API void     sp_intern_sync_init(sp_intern_sync_t* intern, sp_mem_t mem);
+SP_API void     sp_intern_sync_free(sp_intern_sync_t* intern);
+SP_API u32      sp_intern_sync(sp_intern_sync_t* intern, sp_str_t str);
+SP_API u32      sp_intern_sync_find(sp_intern_sync_t* intern, sp_str_t str);
+SP_API sp_str_t sp_intern_sync_get(sp_intern_sync_t* intern, u32 id);
+SP_API u32      sp_intern_sync_size(sp_intern_sync_t* intern);
+
+// @spsc
+//
+// sp_spsc_t is a fixed capacity queue for exactly one producer thread and one consumer
+// thread, which hands items across without taking any lock. Items are copied in and out by
+// value, like sp_cht:
+//
+//   sp_spsc_t queue = sp_zero;
+//   sp_spsc_init(mem, &queue, sizeof(job_t), 1024);
+//
+//   // producer                            // consumer
+//   if (!sp_spsc_push(&queue, &job)) {     job_t job;
+//     // full; try again later             while (sp_spsc_pop(&queue, &job)) { ... }
+//   }
+//
+// The head (advanced by the consumer) and tail (advanced by the producer) are free running
+// counters on separate cache lines, published with release stores and read with acquire
+// loads. Each side also keeps a private copy of the other's counter, and only reloads it when
+// the copy says the queue is full or empty, so in the steady state the two threads don't
+// touch each other's cache lines at all. The capacity is rounded up to a power of two, so
+// indexing is a mask rather than a division.
+//
+// sp_spsc_push_n() and sp_spsc_pop_n() move as many items as fit in one go, with at most two
+// copies for the two halves of the ring. To produce or consume in place, ask for the
+// contiguous span at the tail or head, fill or read some prefix of it, then commit that many:
+//
+//   u32 n = 0;
+//   job_t* jobs = (job_t*)sp_spsc_write_span(&queue, &n);
+//   ...
+//   sp_spsc_write_commit(&queue, n);
+typedef struct {
+  sp_atomic_u32_t head;
+  u32 tail_cache;
+  u8 head_padding [SP_CHT_CACHE_LINE - 2 * sizeof(u32)];
+  sp_atomic_u32_t tail;
+  u32 head_cache;
+  u8 tail_padding [SP_CHT_CACHE_LINE - 2 * sizeof(u32)];
+  u8* data;
+  u32 stride;
+  u32 mask;
+  sp_mem_t mem;
+} sp_spsc_t;
+
+SP_API void        sp_spsc_init(sp_mem_t mem, sp_spsc_t* queue, u32 stride, u32 capacity);
+SP_API void        sp_spsc_free(sp_spsc_t* queue);
+SP_API u32         sp_spsc_capacity(sp_spsc_t* queue);
+SP_API u32         sp_spsc_size(sp_spsc_t* queue);
+SP_API bool        sp_spsc_push(sp_spsc_t* queue, const void* item);
+SP_API bool        sp_spsc_pop(sp_spsc_t* queue, void* item);
+SP_API u32         sp_spsc_push_n(sp_spsc_t* queue, const void* items, u32 n);
+SP_API u32         sp_spsc_pop_n(sp_spsc_t* queue, void* items, u32 n);
+SP_API void*       sp_spsc_write_span(sp_spsc_t* queue, u32* n);
+SP_API void        sp_spsc_write_commit(sp_spsc_t* queue, u32 n);
+SP_API const void* sp_spsc_read_span(sp_spsc_t* queue, u32* n);
+SP_API void        sp_spsc_read_commit(sp_spsc_t* queue, u32 n);
+
+// @mpmc
+//
+// sp_mpmc_t is a fixed capacity queue that any number of threads may push to and pop from
+// concurrently. It's Dmitry Vyukov's bounded array queue: every slot carries a sequence number
+// that says whether it's ready to be written or read for the current lap around the ring, so a
+// producer or consumer claims a slot with a single CAS on the tail or head and then publishes
+// it with a release store on the slot itself. Nothing is ever locked, and producers and
+// consumers only contend with each other when the queue is nearly empty or full.
+//
+//   sp_mpmc_t queue = sp_zero;
+//   sp_mpmc_init(mem, &queue, sizeof(job_t), 1024, SP_MPMC_WAIT_SEMAPHORE);
+//
+//   // any producer                        // any consumer
+//   sp_mpmc_push(&queue, &job);            job_t job;
+//                                          sp_mpmc_pop(&queue, &job);
+//
+// sp_mpmc_try_push() and sp_mpmc_try_pop() return false instead of waiting when the queue is
+// full or empty. sp_mpmc_push() and sp_mpmc_pop() wait, and the _for() variants wait at most
+// the given number of milliseconds. Either way, a waiting thread spins briefly and yields its
+// timeslice a few times first, and then:
+//
+//   SP_MPMC_WAIT_SPIN       keeps yielding and trying again; lowest latency, but a waiting
+//                           thread keeps a core busy
+//   SP_MPMC_WAIT_SEMAPHORE  sleeps on an sp_semaphore_t until the other side makes progress;
+//                           idle consumers cost nothing, at the price of a syscall to wake them
+//
+// The capacity is rounded up to a power of two, and is at least two.
+typedef enum {
+  SP_MPMC_WAIT_SPIN,
+  SP_MPMC_WAIT_SEMAPHORE,
+} sp_mpmc_wait_t;
+
+typedef struct {
+  sp_atomic_u32_t tail;
+  u8 tail_padding [SP_CHT_CACHE_LINE - sizeof(u32)];
+  sp_atomic_u32_t head;
+  u8 head_padding [SP_CHT_CACHE_LINE - sizeof(u32)];
+  u8* cells;
+  u32 stride;
+  u32 cell_stride;
+  u32 mask;
+  sp_mpmc_wait_t wait;
+  sp_atomic_s32_t push_waiters;
+  sp_atomic_s32_t pop_waiters;
+  sp_semaphore_t not_full;
+  sp_semaphore_t not_empty;
+  sp_mem_t mem;
+} sp_mpmc_t;
+
+SP_API void sp_mpmc_init(sp_mem_t mem, sp_mpmc_t* queue, u32 stride, u32 capacity, sp_mpmc_wait_t wait);
+SP_API void sp_mpmc_free(sp_mpmc_t* queue);
+SP_API u32  sp_mpmc_capacity(sp_mpmc_t* queue);
+SP_API u32  sp_mpmc_size(sp_mpmc_t* queue);
+SP_API bool sp_mpmc_try_push(sp_mpmc_t* queue, const void* item);
+SP_API bool sp_mpmc_try_pop(sp_mpmc_t* queue, void* item);
+SP_API void sp_mpmc_push(sp_mpmc_t* queue, const void* item);
+SP_API void sp_mpmc_pop(sp_mpmc_t* queue, void* item);
+SP_API bool sp_mpmc_push_for(sp_mpmc_t* queue, const void* item, u32 ms);
+SP_API bool sp_mpmc_pop_for(sp_mpmc_t* queue, void* item, u32 ms);
+
+// @mirror_rb
+//
+// sp_mirror_rb_t is a byte ring whose storage is mapped twice, back to back, so that the byte
+// after the last one is the first one again. Whatever is readable, and whatever is writable, is
+// always a single contiguous span, however it straddles the end of the ring; nothing ever has
+// to split a read or copy a wrapped record back together to look at it.
+//
+//   sp_mirror_rb_t rb = sp_zero;
+//   sp_try(sp_mirror_rb_init(&rb, 1 << 20));
+//
+//   u64 n = 0;
+//   u8* dst = sp_mirror_rb_write_span(&rb, &n);   // read(fd, dst, n) straight into the ring
+//   sp_mirror_rb_write_commit(&rb, bytes_read);
+//
+//   const u8* src = sp_mirror_rb_read_span(&rb, &n);
+//   u64 used = parse(src, n);                     // every unconsumed byte, in order
+//   sp_mirror_rb_read_commit(&rb, used);
+//
+// The capacity is rounded up to a multiple of SP_MIRROR_RB_GRANULARITY, which is the largest
+// page (or, on Windows, allocation) granularity we map on. The storage comes straight from the
+// OS (a memfd on Linux, a shared memory object on macOS, a pagefile section on Windows) rather
+// than an sp_mem_t, and this isn't available on WASM. Like sp_rb, it's not thread safe.
+//
+// sp_io_mirror_rb_reader_t and sp_io_mirror_rb_writer_t adapt a ring to sp_io. The reader's
+// buffer *is* the readable span, so a parser that's handed the reader can look at every
+// unconsumed byte at base.buffer.data + base.cursor in place, and sp_io_read() copies once, out
+// of the ring, rather than via a staging buffer.
+#ifndef SP_MIRROR_RB_GRANULARITY
+  #define SP_MIRROR_RB_GRANULARITY (64 * 1024)
+#endif
+
+typedef struct {
+  u8* data;
+  u64 capacity;
+  u64 head;
+  u64 size;
+} sp_mirror_rb_t;
+
+SP_API sp_err_t  sp_mirror_rb_init(sp_mirror_rb_t* rb, u64 capacity);
+SP_API void      sp_mirror_rb_free(sp_mirror_rb_t* rb);
+SP_API u64       sp_mirror_rb_capacity(sp_mirror_rb_t* rb);
+SP_API u64       sp_mirror_rb_size(sp_mirror_rb_t* rb);
+SP_API u64       sp_mirror_rb_space(sp_mirror_rb_t* rb);
+SP_API void      sp_mirror_rb_clear(sp_mirror_rb_t* rb);
+SP_API u64       sp_mirror_rb_write(sp_mirror_rb_t* rb, const void* ptr, u64 size);
+SP_API u64       sp_mirror_rb_read(sp_mirror_rb_t* rb, void* ptr, u64 size);
+SP_API u8*       sp_mirror_rb_write_span(sp_mirror_rb_t* rb, u64* n);
+SP_API void      sp_mirror_rb_write_commit(sp_mirror_rb_t* rb, u64 n);
+SP_API const u8* sp_mirror_rb_read_span(sp_mirror_rb_t* rb, u64* n);
+SP_API void      sp_mirror_rb_read_commit(sp_mirror_rb_t* rb, u64 n);
+
 
 //     ███████     █████████
 //   ███░░░░░███  ███░░░░░███
@@ -3415,6 +5337,26 @@ struct sp_io_dyn_mem_writer {
   u64 cursor;
 };
 
+// Hashes every byte written through it, then passes them on to inner (which may be NULL)
+struct sp_io_hash_writer {
+  sp_io_writer_t base;
+  sp_io_writer_t* inner;
+  sp_hasher_t hasher;
+};
+
+// Reads consume from the ring. Bytes that sp_io_read() drains from the buffer are handed back
+// to the ring the next time the reader goes to its backend, or on sp_io_mirror_rb_reader_sync()
+typedef struct {
+  sp_io_reader_t base;
+  sp_mirror_rb_t* rb;
+} sp_io_mirror_rb_reader_t;
+
+// Writes append to the ring, and fail with SP_ERR_IO_NO_SPACE once it's full
+struct sp_io_mirror_rb_writer {
+  sp_io_writer_t base;
+  sp_mirror_rb_t* rb;
+};
+
 
 SP_API sp_err_t       sp_io_copy(sp_io_writer_t* dst, sp_io_reader_t* src, u64* bytes_copied);
 SP_API sp_err_t       sp_io_copy_b(sp_io_writer_t* dst, sp_io_reader_t* src, u8* buffer, u64 n, u64* bytes_copied);
@@ -3472,6 +5414,14 @@ SP_API sp_str_t       sp_io_dyn_mem_writer_as_str(sp_io_dyn_mem_writer_t* w);
 SP_API sp_str_t       sp_io_dyn_mem_writer_take_str(sp_io_dyn_mem_writer_t* w);
 SP_API const c8*      sp_io_dyn_mem_writer_as_cstr(sp_io_dyn_mem_writer_t* w);
 
+SP_API void           sp_io_hash_writer_init(sp_io_hash_writer_t* w, sp_io_writer_t* inner, u64 seed);
+SP_API sp_hash_t      sp_io_hash_writer_final(sp_io_hash_writer_t* w);
+SP_API sp_err_t       sp_io_hash_file(sp_str_t path, u64 seed, sp_hash_t* hash);
+
+SP_API void           sp_io_mirror_rb_reader_init(sp_io_mirror_rb_reader_t* r, sp_mirror_rb_t* rb);
+SP_API void           sp_io_mirror_rb_reader_sync(sp_io_mirror_rb_reader_t* r);
+SP_API void           sp_io_mirror_rb_writer_init(sp_io_mirror_rb_writer_t* w, sp_mirror_rb_t* rb);
+
 SP_API sp_io_stream_writer_t sp_io_get_std_out();
 SP_API sp_io_stream_writer_t sp_io_get_std_err();
 
@@ -3781,6 +5731,51 @@ SP_IMP sp_fmt_arg_t        sp_fmt_arg_from_argv(sp_fmt_argv_t v);
 
 // @hash
 SP_IMP sp_hash_t sp_hash_str(sp_str_t str);
+SP_IMP void      sp_hash_mum(u64* a, u64* b);
+SP_IMP u64       sp_hash_mix(u64 a, u64 b);
+SP_IMP u64       sp_hash_read_u64(const u8* p);
+SP_IMP u64       sp_hash_read_u32(const u8* p);
+
+// @hash_table
+SP_IMP u32 sp_ht_group_match(const u8* group, u8 tag);
+SP_IMP u32 sp_ht_group_match_empty(const u8* group);
+SP_IMP u32 sp_ht_group_match_free(const u8* group);
+SP_IMP u64 sp_ht_swiss_find(void* data, u8* ctrl, sp_hash_t* hashes, u64 capacity, void* key, sp_hash_t hash, sp_ht_info_t info);
+SP_IMP u64 sp_ht_linear_find(void* data, sp_hash_t* hashes, u64 capacity, void* key, sp_hash_t hash, sp_ht_info_t info);
+SP_IMP u64 sp_ht_swiss_find_free(u8* ctrl, u64 capacity, sp_hash_t hash);
+SP_IMP void sp_ht_swiss_insert(void* ht, void* key, void* val, sp_hash_t hash, sp_ht_info_t info);
+SP_IMP void sp_ht_backshift_erase(void* ht, u64 idx, sp_ht_info_t info);
+SP_IMP u64 sp_ht_probe_length(void* ht, u64 idx, sp_ht_info_t info);
+SP_IMP void sp_ht_prefetch(void* ht, sp_hash_t hash, sp_ht_info_t info);
+SP_IMP u64 sp_ht_migrate_entry(void* ht, u64 idx, sp_ht_info_t info);
+SP_IMP void sp_ht_migration_begin(void* ht, u64 new_cap, sp_ht_info_t info);
+SP_IMP u64 sp_ht_incremental_find(void* ht, void* key, sp_hash_t hash, sp_ht_info_t info);
+SP_IMP const void* sp_ht_image_find(const sp_ht_image_t* image, sp_hash_t hash, const void* key, u64 len);
+SP_IMP void* sp_im_resize_array(sp_mem_t mem, void* ptr, u64 old_size, u64 size);
+SP_IMP void sp_im_rebuild_slots(sp_im_header_t* im, u64 num_slots);
+SP_IMP u64 sp_im_find_slot(sp_im_header_t* im, void* key, sp_hash_t hash);
+SP_IMP void sp_im_remove_slot(sp_im_header_t* im, u64 hole);
+SP_IMP u64 sp_hs_find_slot(sp_hs_header_t* hs, void* key, sp_hash_t hash);
+SP_IMP void sp_hs_place(sp_hs_header_t* hs, void* key, sp_hash_t hash);
+SP_IMP void sp_hs_rebuild(sp_hs_header_t* hs, u64 capacity);
+SP_IMP void sp_hs_erase_slot(sp_hs_header_t* hs, u64 slot);
+SP_IMP u32 sp_mph_reduce(u64 x, u32 n);
+SP_IMP u32 sp_mph_slot(u64 hash, u32 pilot, u32 n);
+SP_IMP sp_err_t sp_mph_build_hashed(sp_mem_t mem, sp_mph_t* mph, u64* hashes, u32 n, u64 seed);
+SP_IMP f64 sp_bloom_exp_neg(f64 x);
+SP_IMP u32* sp_bloom_block(const sp_bloom_t* bloom, sp_hash_t hash);
+
+// @rb
+SP_IMP u32 sp_rb_storage(u32 capacity);
+
+// @mpmc
+SP_IMP sp_atomic_u32_t* sp_mpmc_cell(sp_mpmc_t* queue, u32 pos);
+SP_IMP void sp_mpmc_wake(sp_mpmc_t* queue, sp_atomic_s32_t* waiters, sp_semaphore_t* semaphore);
+SP_IMP bool sp_mpmc_wait_for(sp_mpmc_t* queue, void* item, bool push, u32 ms);
+
+// @cht
+SP_IMP u64 sp_cht_shard_index(sp_hash_t hash);
+SP_IMP sp_cht_shard_t* sp_cht_shard(sp_cht_shard_t* shards, sp_hash_t hash);
 
 // @memory
 SP_IMP sp_mem_arena_block_t* sp_mem_arena_block_new(sp_mem_arena_t* arena, u64 block_size);
@@ -3828,6 +5823,9 @@ SP_IMP sp_err_t sp_io_file_writer_write(sp_io_writer_t* writer, const void* ptr,
 SP_IMP sp_err_t sp_io_stream_writer_write(sp_io_writer_t* writer, const void* ptr, u64 size, u64* bytes_written);
 SP_IMP sp_err_t sp_io_mem_writer_write(sp_io_writer_t* writer, const void* ptr, u64 size, u64* bytes_written);
 SP_IMP sp_err_t sp_io_dyn_mem_writer_write(sp_io_writer_t* writer, const void* ptr, u64 size, u64* bytes_written);
+SP_IMP sp_err_t sp_io_hash_writer_write(sp_io_writer_t* writer, const void* ptr, u64 size, u64* bytes_written);
+SP_IMP sp_err_t sp_io_mirror_rb_reader_read(sp_io_reader_t* reader, void* ptr, u64 size, u64* bytes_read);
+SP_IMP sp_err_t sp_io_mirror_rb_writer_write(sp_io_writer_t* writer, const void* ptr, u64 size, u64* bytes_written);
 
 // @app
 SP_IMP s32 sp_app_finalize_rc(sp_app_t* app);
@@ -4218,6 +6216,8 @@ s32 errno;
   #define SP_SYSCALL_NUM_PIPE2             293
   #define SP_SYSCALL_NUM_INOTIFY_INIT1     294
   #define SP_SYSCALL_NUM_PERF_EVENT_OPEN   298
+  #define SP_SYSCALL_NUM_FTRUNCATE         77
+  #define SP_SYSCALL_NUM_MEMFD_CREATE      319
 
 #elif defined(SP_ARM64)
   #define SP_SYSCALL_NUM_GETCWD            17
@@ -4267,6 +6267,8 @@ s32 errno;
   #define SP_SYSCALL_NUM_WAIT4             260
   #define SP_SYSCALL_NUM_SENDFILE          71
   #define SP_SYSCALL_NUM_COPY_FILE_RANGE   285
+  #define SP_SYSCALL_NUM_FTRUNCATE         46
+  #define SP_SYSCALL_NUM_MEMFD_CREATE      279
   #define SP_SYSCALL_NUM_OPEN              SP_SYSCALL_NUM_OPENAT
   #define SP_SYSCALL_NUM_STAT              SP_SYSCALL_NUM_NEWFSTATAT
   #define SP_SYSCALL_NUM_LSTAT             SP_SYSCALL_NUM_NEWFSTATAT
@@ -6039,7 +8041,54 @@ void sp_sys_free(void* ptr, u64 size) {
   if (ptr) VirtualFree(ptr, 0, MEM_RELEASE);
 }
 
-#elif defined(SP_LINUX)
+void* sp_sys_map_file(sp_sys_fd_t fd, u64 size) {
+  if (!size) return SP_NULLPTR;
+  HANDLE mapping = CreateFileMappingW((HANDLE)fd, SP_NULLPTR, PAGE_READONLY, 0, 0, SP_NULLPTR);
+  if (!mapping) return SP_NULLPTR;
+  void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T)size);
+  CloseHandle(mapping);
+  return p;
+}
+
+void sp_sys_unmap_file(void* ptr, u64 size) {
+  (void)size;
+  if (ptr) UnmapViewOfFile(ptr);
+}
+
+void* sp_sys_map_mirror(u64 size) {
+  HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, SP_NULLPTR, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, SP_NULLPTR);
+  if (!mapping) return SP_NULLPTR;
+
+  // Find a free range twice the size, give it back, and map both views into it. Another thread
+  // can grab part of the range in between, so retry a few times.
+  void* result = SP_NULLPTR;
+  for (u32 attempt = 0; attempt < 16 && !result; attempt++) {
+    u8* base = (u8*)VirtualAlloc(SP_NULLPTR, 2 * size, MEM_RESERVE, PAGE_NOACCESS);
+    if (!base) break;
+    VirtualFree(base, 0, MEM_RELEASE);
+
+    void* lo = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size, base);
+    if (!lo) continue;
+    void* hi = MapViewOfFileEx(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size, base + size);
+    if (!hi) {
+      UnmapViewOfFile(lo);
+      continue;
+    }
+    result = base;
+  }
+
+  // The views keep the section alive
+  CloseHandle(mapping);
+  return result;
+}
+
+void sp_sys_unmap_mirror(void* ptr, u64 size) {
+  if (!ptr) return;
+  UnmapViewOfFile(ptr);
+  UnmapViewOfFile((u8*)ptr + size);
+}
+
+#elif defined(SP_LINUX)
 void* sp_sys_alloc(u64 size) {
   void* p = (void*)sp_syscall(SP_SYSCALL_NUM_MMAP, 0, size, SP_PROT_READ | SP_PROT_WRITE, SP_MAP_PRIVATE | SP_MAP_ANONYMOUS, -1, 0);
   return p == SP_MAP_FAILED ? 0 : p;
@@ -6050,6 +8099,49 @@ void sp_sys_free(void* ptr, u64 size) {
   sp_syscall(SP_SYSCALL_NUM_MUNMAP, ptr, size);
 }
 
+void* sp_sys_map_file(sp_sys_fd_t fd, u64 size) {
+  if (!size) return SP_NULLPTR;
+  void* p = (void*)sp_syscall(SP_SYSCALL_NUM_MMAP, 0, size, SP_PROT_READ, SP_MAP_PRIVATE, fd, 0);
+  return p == SP_MAP_FAILED ? SP_NULLPTR : p;
+}
+
+void sp_sys_unmap_file(void* ptr, u64 size) {
+  sp_sys_free(ptr, size);
+}
+
+void* sp_sys_map_mirror(u64 size) {
+  s32 fd = (s32)sp_syscall(SP_SYSCALL_NUM_MEMFD_CREATE, "sp_mirror", 1 /* MFD_CLOEXEC */);
+  if (fd < 0) return SP_NULLPTR;
+
+  u8* base = SP_NULLPTR;
+  if (sp_syscall(SP_SYSCALL_NUM_FTRUNCATE, fd, size) < 0) goto done;
+
+  // Reserve the whole range first so that nothing else can land between the two views
+  base = (u8*)sp_syscall(SP_SYSCALL_NUM_MMAP, 0, 2 * size, SP_PROT_NONE, SP_MAP_PRIVATE | SP_MAP_ANONYMOUS, -1, 0);
+  if ((void*)base == SP_MAP_FAILED) {
+    base = SP_NULLPTR;
+    goto done;
+  }
+
+  sp_for(it, 2) {
+    void* view = (void*)sp_syscall(SP_SYSCALL_NUM_MMAP, base + it * size, size, SP_PROT_READ | SP_PROT_WRITE, SP_MAP_SHARED | SP_MAP_FIXED, fd, 0);
+    if (view == SP_MAP_FAILED) {
+      sp_syscall(SP_SYSCALL_NUM_MUNMAP, base, 2 * size);
+      base = SP_NULLPTR;
+      goto done;
+    }
+  }
+
+done:
+  // The mappings keep the memfd alive
+  sp_sys_close(fd);
+  return base;
+}
+
+void sp_sys_unmap_mirror(void* ptr, u64 size) {
+  sp_sys_free(ptr, 2 * size);
+}
+
 #elif defined(SP_MACOS) || defined(SP_COSMO)
 void* sp_sys_alloc(u64 size) {
   void* p = mmap(SP_NULLPTR, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
@@ -6060,6 +8152,56 @@ void sp_sys_free(void* ptr, u64 size) {
   if (ptr) munmap(ptr, size);
 }
 
+void* sp_sys_map_file(sp_sys_fd_t fd, u64 size) {
+  if (!size) return SP_NULLPTR;
+  void* p = mmap(SP_NULLPTR, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  return p == MAP_FAILED ? SP_NULLPTR : p;
+}
+
+void sp_sys_unmap_file(void* ptr, u64 size) {
+  if (ptr) munmap(ptr, size);
+}
+
+void* sp_sys_map_mirror(u64 size) {
+  // There's no memfd here, so use a POSIX shared memory object and unlink it straight away
+  static sp_atomic_s32_t counter = 0;
+  c8 name [32] = "/sp_mirror_";
+  u64 id = ((u64)getpid() << 24) | (u32)sp_atomic_s32_add(&counter, 1);
+  u32 len = sp_cstr_len(name);
+  for (; id; id >>= 4) name[len++] = "0123456789abcdef"[id & 0xF];
+  name[len] = 0;
+
+  s32 fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return SP_NULLPTR;
+  shm_unlink(name);
+
+  u8* base = SP_NULLPTR;
+  if (ftruncate(fd, (off_t)size) < 0) goto done;
+
+  base = (u8*)mmap(SP_NULLPTR, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if ((void*)base == MAP_FAILED) {
+    base = SP_NULLPTR;
+    goto done;
+  }
+
+  sp_for(it, 2) {
+    void* view = mmap(base + it * size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (view == MAP_FAILED) {
+      munmap(base, 2 * size);
+      base = SP_NULLPTR;
+      goto done;
+    }
+  }
+
+done:
+  close(fd);
+  return base;
+}
+
+void sp_sys_unmap_mirror(void* ptr, u64 size) {
+  if (ptr) munmap(ptr, 2 * size);
+}
+
 #elif defined(SP_WASM)
 void* sp_sys_alloc(u64 size) {
   const u64 page_size = 65536;
@@ -6073,9 +8215,31 @@ void sp_sys_free(void* ptr, u64 size) {
   sp_unused(ptr); sp_unused(size);
 }
 
+void* sp_sys_map_file(sp_sys_fd_t fd, u64 size) {
+  sp_unused(fd); sp_unused(size);
+  return SP_NULLPTR;
+}
+
+void sp_sys_unmap_file(void* ptr, u64 size) {
+  sp_unused(ptr); sp_unused(size);
+}
+
+void* sp_sys_map_mirror(u64 size) {
+  sp_unused(size);
+  return SP_NULLPTR;
+}
+
+void sp_sys_unmap_mirror(void* ptr, u64 size) {
+  sp_unused(ptr); sp_unused(size);
+}
+
 #else
 #error "sp_sys_alloc"
 #error "sp_sys_free"
+#error "sp_sys_map_file"
+#error "sp_sys_unmap_file"
+#error "sp_sys_map_mirror"
+#error "sp_sys_unmap_mirror"
 #endif
 
 ///////////////////
@@ -6872,6 +9036,196 @@ sp_hash_t sp_hash_combine(sp_hash_t* hashes, u32 num_hashes) {
   return sp_hash_bytes(hashes, num_hashes * sizeof(sp_hash_t), 0);
 }
 
+void sp_hasher_init(sp_hasher_t* hasher, u64 seed) {
+  hasher->v0 = ((((size_t) 0x736f6d65 << 16) << 16) + 0x70736575) ^  seed;
+  hasher->v1 = ((((size_t) 0x646f7261 << 16) << 16) + 0x6e646f6d) ^ ~seed;
+  hasher->v2 = ((((size_t) 0x6c796765 << 16) << 16) + 0x6e657261) ^  seed;
+  hasher->v3 = ((((size_t) 0x74656462 << 16) << 16) + 0x79746573) ^ ~seed;
+  hasher->tail = 0;
+  hasher->len = 0;
+}
+
+void sp_hasher_update(sp_hasher_t* hasher, const void* p, u64 len) {
+  const u8* d = (const u8*)p;
+  u64 n = len;
+  size_t v0 = hasher->v0, v1 = hasher->v1, v2 = hasher->v2, v3 = hasher->v3;
+  size_t data = hasher->tail;
+  u64 used = hasher->len % sizeof(size_t);
+  u32 j;
+
+  // Finish the word left over from the last update; words are assembled a byte at a time,
+  // like sp_hash_bytes(), so the result doesn't depend on where the caller split the input
+  if (used) {
+    while (n && used < sizeof(size_t)) {
+      data |= (size_t)*d++ << (used * 8);
+      used++;
+      n--;
+    }
+    if (used < sizeof(size_t)) {
+      hasher->tail = data;
+      hasher->len += len;
+      return;
+    }
+
+    v3 ^= data;
+    for (j = 0; j < SP_SIPHASH_C_ROUNDS; ++j)
+      sp_sipround();
+    v0 ^= data;
+  }
+
+  for (; n >= sizeof(size_t); n -= sizeof(size_t), d += sizeof(size_t)) {
+    data = d[0] | ((size_t) d[1] << 8) | ((size_t) d[2] << 16) | ((size_t) d[3] << 24);
+    if (sizeof(size_t) > 4) data |= ((size_t) d[4] | ((size_t) d[5] << 8) | ((size_t) d[6] << 16) | ((size_t) d[7] << 24)) << 16 << 16;
+
+    v3 ^= data;
+    for (j = 0; j < SP_SIPHASH_C_ROUNDS; ++j)
+      sp_sipround();
+    v0 ^= data;
+  }
+
+  data = 0;
+  sp_for(i, n) {
+    data |= (size_t)d[i] << (i * 8);
+  }
+
+  hasher->v0 = v0; hasher->v1 = v1; hasher->v2 = v2; hasher->v3 = v3;
+  hasher->tail = data;
+  hasher->len += len;
+}
+
+void sp_hasher_update_str(sp_hasher_t* hasher, sp_str_t str) {
+  sp_hasher_update_u64(hasher, str.len);
+  sp_hasher_update(hasher, str.data, str.len);
+}
+
+void sp_hasher_update_u64(sp_hasher_t* hasher, u64 value) {
+  u8 bytes [8];
+  sp_for(i, 8) {
+    bytes[i] = (u8)(value >> (i * 8));
+  }
+  sp_hasher_update(hasher, bytes, sizeof(bytes));
+}
+
+sp_hash_t sp_hasher_final(sp_hasher_t* hasher) {
+  size_t v0 = hasher->v0, v1 = hasher->v1, v2 = hasher->v2, v3 = hasher->v3;
+  size_t data = hasher->tail | ((size_t)hasher->len << (SP_SIZE_T_BITS-8));
+  u32 j;
+
+  v3 ^= data;
+  for (j = 0; j < SP_SIPHASH_C_ROUNDS; ++j)
+    sp_sipround();
+  v0 ^= data;
+  v2 ^= 0xff;
+  for (j = 0; j < SP_SIPHASH_D_ROUNDS; ++j)
+    sp_sipround();
+
+  return v1^v2^v3;
+}
+
+sp_err_t sp_hasher_read(sp_hasher_t* hasher, sp_io_reader_t* reader, u64* bytes_read) {
+  u8 buffer [4096];
+  u64 total = 0;
+  sp_err_t err = SP_OK;
+
+  while (true) {
+    u64 chunk = 0;
+    err = sp_io_read(reader, buffer, sizeof(buffer), &chunk);
+    sp_hasher_update(hasher, buffer, chunk);
+    total += chunk;
+    if (err) break;
+  }
+
+  if (err == SP_ERR_IO_EOF) err = SP_OK;
+  if (bytes_read) *bytes_read = total;
+  return err;
+}
+
+// 64x64 -> 128 bit multiply; the low half is returned in a, the high half in b
+void sp_hash_mum(u64* a, u64* b) {
+#if defined(__SIZEOF_INT128__) && !defined(SP_WASM)
+  __uint128_t r = (__uint128_t)*a * *b;
+  *a = (u64)r;
+  *b = (u64)(r >> 64);
+#elif defined(SP_MSVC) && defined(SP_AMD64)
+  *a = _umul128(*a, *b, b);
+#else
+  u64 ha = *a >> 32, hb = *b >> 32, la = (u32)*a, lb = (u32)*b;
+  u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  u64 t = rl + (rm0 << 32);
+  u64 c = t < rl;
+  u64 lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+u64 sp_hash_mix(u64 a, u64 b) {
+  sp_hash_mum(&a, &b);
+  return a ^ b;
+}
+
+u64 sp_hash_read_u64(const u8* p) {
+  return (u64)p[0]       | (u64)p[1] << 8  | (u64)p[2] << 16 | (u64)p[3] << 24 |
+         (u64)p[4] << 32 | (u64)p[5] << 40 | (u64)p[6] << 48 | (u64)p[7] << 56;
+}
+
+u64 sp_hash_read_u32(const u8* p) {
+  return (u64)p[0] | (u64)p[1] << 8 | (u64)p[2] << 16 | (u64)p[3] << 24;
+}
+
+// rapidhash, by Nicolas De Carli; see https://github.com/Nicoshev/rapidhash
+sp_hash_t sp_hash_fast(const void* key, u64 len, u64 seed) {
+  static const u64 secret[3] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull };
+  const u8* p = (const u8*)key;
+  u64 a, b;
+
+  seed ^= sp_hash_mix(seed ^ secret[0], secret[1]) ^ len;
+
+  if (len <= 16) {
+    if (len >= 4) {
+      const u8* last = p + len - 4;
+      u64 delta = (len & 24) >> (len >> 3);
+      a = (sp_hash_read_u32(p) << 32) | sp_hash_read_u32(last);
+      b = (sp_hash_read_u32(p + delta) << 32) | sp_hash_read_u32(last - delta);
+    }
+    else if (len > 0) {
+      a = ((u64)p[0] << 56) | ((u64)p[len >> 1] << 32) | p[len - 1];
+      b = 0;
+    }
+    else {
+      a = b = 0;
+    }
+  }
+  else {
+    u64 i = len;
+    if (i > 48) {
+      u64 see1 = seed, see2 = seed;
+      do {
+        seed = sp_hash_mix(sp_hash_read_u64(p)      ^ secret[0], sp_hash_read_u64(p + 8)  ^ seed);
+        see1 = sp_hash_mix(sp_hash_read_u64(p + 16) ^ secret[1], sp_hash_read_u64(p + 24) ^ see1);
+        see2 = sp_hash_mix(sp_hash_read_u64(p + 32) ^ secret[2], sp_hash_read_u64(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      seed ^= see1 ^ see2;
+    }
+    if (i > 16) {
+      seed = sp_hash_mix(sp_hash_read_u64(p) ^ secret[2], sp_hash_read_u64(p + 8) ^ seed ^ secret[1]);
+      if (i > 32) {
+        seed = sp_hash_mix(sp_hash_read_u64(p + 16) ^ secret[2], sp_hash_read_u64(p + 24) ^ seed);
+      }
+    }
+    a = sp_hash_read_u64(p + i - 16);
+    b = sp_hash_read_u64(p + i - 8);
+  }
+
+  a ^= secret[1];
+  b ^= seed;
+  sp_hash_mum(&a, &b);
+  return sp_hash_mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
 
 //  █████   █████   █████████    █████████  █████   █████    ███████████   █████████   ███████████  █████       ██████████
 // ░░███   ░░███   ███░░░░░███  ███░░░░░███░░███   ░░███    ░█░░░███░░░█  ███░░░░░███ ░░███░░░░░███░░███       ░░███░░░░░█
@@ -6887,13 +9241,23 @@ bool sp_ht_on_compare_key(void* ka, void* kb, u64 size) {
 }
 
 sp_hash_t sp_ht_on_hash_key(void *key, u64 size) {
-  return sp_hash_bytes(key, size, SP_HT_HASH_SEED);
+  return sp_hash_fast(key, size, SP_HT_HASH_SEED);
+}
+
+sp_hash_t sp_ht_on_hash_key_sip(void *key, u64 size) {
+  return sp_hash_bytes(key, size, SP_HT_SIP_SEED);
 }
 
 sp_hash_t sp_ht_on_hash_str_key(void* key, u64 size) {
   (void)size;
   sp_str_t* str = (sp_str_t*)key;
-  return sp_hash_str(*str);
+  return sp_hash_fast(str->data, str->len, SP_HT_HASH_SEED);
+}
+
+sp_hash_t sp_ht_on_hash_str_key_sip(void* key, u64 size) {
+  (void)size;
+  sp_str_t* str = (sp_str_t*)key;
+  return sp_hash_bytes(str->data, str->len, SP_HT_SIP_SEED);
 }
 
 bool sp_ht_on_compare_str_key(void* ka, void* kb, u64 size) {
@@ -6906,7 +9270,13 @@ bool sp_ht_on_compare_str_key(void* ka, void* kb, u64 size) {
 sp_hash_t sp_ht_on_hash_cstr_key(void* key, u64 size) {
   (void)size;
   const c8** str = (const c8**)key;
-  return sp_hash_cstr(*str);
+  return sp_hash_fast(*str, sp_cstr_len(*str), SP_HT_HASH_SEED);
+}
+
+sp_hash_t sp_ht_on_hash_cstr_key_sip(void* key, u64 size) {
+  (void)size;
+  const c8** str = (const c8**)key;
+  return sp_hash_bytes(*str, sp_cstr_len(*str), SP_HT_SIP_SEED);
 }
 
 bool sp_ht_on_compare_cstr_key(void* ka, void* kb, u64 size) {
@@ -6916,16 +9286,157 @@ bool sp_ht_on_compare_cstr_key(void* ka, void* kb, u64 size) {
   return sp_cstr_equal(*sa, *sb);
 }
 
+// Each group match returns a mask with bit i set if control byte i of the group matched
+#if defined(SP_NEON)
+SP_IMP u32 sp_ht_neon_movemask(uint8x16_t eq) {
+  static const u8 bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint8x16_t masked = vandq_u8(eq, vld1q_u8(bits));
+  return (u32)vaddv_u8(vget_low_u8(masked)) | ((u32)vaddv_u8(vget_high_u8(masked)) << 8);
+}
+#endif
+
+u32 sp_ht_group_match(const u8* group, u8 tag) {
+#if defined(SP_SSE2)
+  __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+  return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((c8)tag)));
+#elif defined(SP_NEON)
+  return sp_ht_neon_movemask(vceqq_u8(vld1q_u8(group), vdupq_n_u8(tag)));
+#else
+  u32 mask = 0;
+  for (u32 i = 0; i < SP_HT_GROUP_WIDTH; i++) {
+    mask |= (u32)(group[i] == tag) << i;
+  }
+  return mask;
+#endif
+}
+
+u32 sp_ht_group_match_empty(const u8* group) {
+  return sp_ht_group_match(group, SP_HT_CTRL_EMPTY);
+}
+
+u32 sp_ht_group_match_free(const u8* group) {
+#if defined(SP_SSE2)
+  return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#elif defined(SP_NEON)
+  return sp_ht_neon_movemask(vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(group)), vdupq_n_s8(0)));
+#else
+  u32 mask = 0;
+  for (u32 i = 0; i < SP_HT_GROUP_WIDTH; i++) {
+    mask |= (u32)(group[i] >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+// Swiss tables split the hash in two: the group where probing starts comes from the high bits
+// of the Fibonacci product, and the low seven bits are stored in the control byte as a tag.
+// Groups are probed triangularly, which visits every group exactly once since the group count
+// is a power of two.
+u64 sp_ht_swiss_find(void* data, u8* ctrl, sp_hash_t* hashes, u64 capacity, void* key, sp_hash_t hash, sp_ht_info_t info) {
+  u64 mask = capacity / SP_HT_GROUP_WIDTH - 1;
+  u64 group = sp_ht_home(hash, mask + 1);
+  u8 tag = (u8)(hash & 0x7F);
+
+  for (u64 probe = 1; probe <= mask + 1; probe++) {
+    u8* g = ctrl + group * SP_HT_GROUP_WIDTH;
+    for (u32 match = sp_ht_group_match(g, tag); match; match &= match - 1) {
+      u64 i = group * SP_HT_GROUP_WIDTH + sp_ht_ctz(match);
+      if (hashes && hashes[i] != hash) continue;
+      if (info.fn.compare((u8*)data + i * info.stride.entry, key, info.size.key)) {
+        return i;
+      }
+    }
+    if (sp_ht_group_match_empty(g)) break;
+    group = (group + probe) & mask;
+  }
+  return SP_HT_INVALID_INDEX;
+}
+
+u64 sp_ht_swiss_find_free(u8* ctrl, u64 capacity, sp_hash_t hash) {
+  u64 mask = capacity / SP_HT_GROUP_WIDTH - 1;
+  u64 group = sp_ht_home(hash, mask + 1);
+
+  for (u64 probe = 1; probe <= mask + 1; probe++) {
+    u32 slots = sp_ht_group_match_free(ctrl + group * SP_HT_GROUP_WIDTH);
+    if (slots) {
+      return group * SP_HT_GROUP_WIDTH + sp_ht_ctz(slots);
+    }
+    group = (group + probe) & mask;
+  }
+  return SP_HT_INVALID_INDEX;
+}
+
+void sp_ht_swiss_insert(void* ht, void* key, void* val, sp_hash_t hash, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  void** data = (void**)base;
+  u64* size = (u64*)(base + info.header.size);
+  u64* capacity = (u64*)(base + info.header.capacity);
+  u8** ctrl = (u8**)(base + info.header.ctrl);
+  sp_hash_t** hashes = (sp_hash_t**)(base + info.header.hashes);
+  u64* tombstones = (u64*)(base + info.header.tombstones);
+
+  // Tombstones count against the 7/8 load factor. When most of the load is tombstones,
+  // rehash at the same capacity instead of growing.
+  u64 cap = *capacity;
+  if ((*size + *tombstones + 1) * 8 > cap * 7) {
+    u64 new_cap = (*size + 1) * 16 > cap * 7 ? cap * 2 : cap;
+    sp_ht_resize_impl(data, cap, new_cap, info);
+    *capacity = new_cap;
+    cap = new_cap;
+  }
+
+  u64 idx = sp_ht_swiss_find(*data, *ctrl, *hashes, cap, key, hash, info);
+  if (idx != SP_HT_INVALID_INDEX) {
+    u8* entry = (u8*)(*data) + idx * info.stride.entry;
+    sp_mem_copy(entry + info.stride.value, val, info.size.value);
+    return;
+  }
+
+  idx = sp_ht_swiss_find_free(*ctrl, cap, hash);
+  if ((*ctrl)[idx] == SP_HT_CTRL_DELETED) (*tombstones)--;
+  (*ctrl)[idx] = (u8)(hash & 0x7F);
+  if (*hashes) (*hashes)[idx] = hash;
+
+  u8* entry = (u8*)(*data) + idx * info.stride.entry;
+  sp_mem_copy(entry, key, info.size.key);
+  sp_mem_copy(entry + info.stride.value, val, info.size.value);
+  *(sp_ht_entry_state*)(entry + info.stride.kv) = SP_HT_ENTRY_ACTIVE;
+  (*size)++;
+}
+
 u64 sp_ht_get_key_index_fn(void** data, void* key, u64 capacity, sp_ht_info_t info) {
   if (!data || !*data || !key || !capacity) return SP_HT_INVALID_INDEX;
 
-  sp_hash_t hash = info.fn.hash(key, info.size.key);
-  u64 hash_idx = hash % capacity;
+  return sp_ht_find_hashed(data, key, info.fn.hash(key, info.size.key), info);
+}
+
+u64 sp_ht_find_hashed(void* ht, void* key, sp_hash_t hash, sp_ht_info_t info) {
+  void** data = (void**)ht;
+  if (!data || !*data || !key) return SP_HT_INVALID_INDEX;
+
+  u64 capacity = *(u64*)((u8*)data + info.header.capacity);
+  sp_hash_t* hashes = *(sp_hash_t**)((u8*)data + info.header.hashes);
+  if (info.mode & SP_HT_MODE_SWISS) {
+    u8* ctrl = *(u8**)((u8*)data + info.header.ctrl);
+    return sp_ht_swiss_find(*data, ctrl, hashes, capacity, key, hash, info);
+  }
+
+  if (info.mode & SP_HT_MODE_INCREMENTAL) {
+    sp_ht_migration_t* migration = (sp_ht_migration_t*)((u8*)data + info.header.migration);
+    if (migration->data) return sp_ht_incremental_find(ht, key, hash, info);
+  }
+
+  return sp_ht_linear_find(*data, hashes, capacity, key, hash, info);
+}
+
+u64 sp_ht_linear_find(void* data, sp_hash_t* hashes, u64 capacity, void* key, sp_hash_t hash, sp_ht_info_t info) {
+  u64 mask = capacity - 1;
+  u64 hash_idx = sp_ht_home(hash, capacity);
 
   for (u64 c = 0; c < capacity; ++c) {
-    u64 i = (hash_idx + c) % capacity;
+    u64 i = (hash_idx + c) & mask;
     u64 offset = i * info.stride.entry;
-    sp_ht_entry_state state = *(sp_ht_entry_state*)((c8*)(*data) + offset + info.stride.kv);
+    sp_ht_entry_state state = *(sp_ht_entry_state*)((c8*)data + offset + info.stride.kv);
 
     if (state == SP_HT_ENTRY_INACTIVE) {
       break;
@@ -6933,7 +9444,10 @@ u64 sp_ht_get_key_index_fn(void** data, void* key, u64 capacity, sp_ht_info_t in
     if (state == SP_HT_ENTRY_DELETED) {
       continue;
     }
-    void* k = (c8*)(*data) + offset;
+    if (hashes && hashes[i] != hash) {
+      continue;
+    }
+    void* k = (c8*)data + offset;
     if (info.fn.compare(k, key, info.size.key)) {
       return i;
     }
@@ -6942,10 +9456,29 @@ u64 sp_ht_get_key_index_fn(void** data, void* key, u64 capacity, sp_ht_info_t in
 }
 
 void sp_ht_resize_impl(void** data, u64 old_cap, u64 new_cap, sp_ht_info_t info) {
-  if (!data || new_cap <= old_cap) return;
+  if (!data || new_cap < old_cap) return;
+
+  // A full rebuild subsumes whatever was left of an incremental one
+  sp_ht_migrate_impl((void*)data, UINT64_MAX, info);
+
+  u8** ctrl = (u8**)((u8*)data + info.header.ctrl);
+  sp_hash_t** hashes = (sp_hash_t**)((u8*)data + info.header.hashes);
+  u64* tombstones = (u64*)((u8*)data + info.header.tombstones);
+  bool swiss = info.mode & SP_HT_MODE_SWISS;
 
   void* old_data = *data;
+  u8* old_ctrl = *ctrl;
+  sp_hash_t* old_hashes = *hashes;
   void* new_data = sp_alloc(info.allocator, new_cap * info.stride.entry);
+  u8* new_ctrl = SP_NULLPTR;
+  sp_hash_t* new_hashes = SP_NULLPTR;
+  if (swiss) {
+    new_ctrl = (u8*)sp_alloc(info.allocator, new_cap);
+    sp_mem_fill_u8(new_ctrl, new_cap, SP_HT_CTRL_EMPTY);
+  }
+  if (info.mode & SP_HT_MODE_CACHE_HASH) {
+    new_hashes = (sp_hash_t*)sp_alloc(info.allocator, new_cap * sizeof(sp_hash_t));
+  }
 
   for (u64 i = 0; i < old_cap; ++i) {
     u64 offset = i * info.stride.entry;
@@ -6953,4208 +9486,6657 @@ void sp_ht_resize_impl(void** data, u64 old_cap, u64 new_cap, sp_ht_info_t info)
     if (state != SP_HT_ENTRY_ACTIVE) continue;
 
     void* old_key = (c8*)old_data + offset;
-    sp_hash_t hash = info.fn.hash(old_key, info.size.key);
-    u64 new_idx = hash % new_cap;
-
-    while (*(sp_ht_entry_state*)((c8*)new_data + new_idx * info.stride.entry + info.stride.kv) == SP_HT_ENTRY_ACTIVE) {
-      new_idx = (new_idx + 1) % new_cap;
+    sp_hash_t hash = old_hashes ? old_hashes[i] : info.fn.hash(old_key, info.size.key);
+    u64 new_idx;
+    if (swiss) {
+      new_idx = sp_ht_swiss_find_free(new_ctrl, new_cap, hash);
+      new_ctrl[new_idx] = (u8)(hash & 0x7F);
+    }
+    else {
+      new_idx = sp_ht_home(hash, new_cap);
+      while (*(sp_ht_entry_state*)((c8*)new_data + new_idx * info.stride.entry + info.stride.kv) == SP_HT_ENTRY_ACTIVE) {
+        new_idx = (new_idx + 1) & (new_cap - 1);
+      }
     }
 
+    if (new_hashes) new_hashes[new_idx] = hash;
+
     sp_mem_copy((c8*)new_data + new_idx * info.stride.entry, (c8*)old_data + offset, info.stride.kv);
     *(sp_ht_entry_state*)((c8*)new_data + new_idx * info.stride.entry + info.stride.kv) = SP_HT_ENTRY_ACTIVE;
   }
 
   sp_free(info.allocator, old_data, old_cap * info.stride.entry);
+  if (old_ctrl) sp_free(info.allocator, old_ctrl, old_cap);
+  if (old_hashes) sp_free(info.allocator, old_hashes, old_cap * sizeof(sp_hash_t));
   *data = new_data;
+  *ctrl = new_ctrl;
+  *hashes = new_hashes;
+  *tombstones = 0;
 }
 
-void sp_ht_insert_impl(void* ht, void* key, void* val, sp_ht_info_t info) {
+void sp_ht_rebuild_impl(void* ht, sp_ht_info_t info) {
   u8* base = (u8*)ht;
-  void** data = (void**)base;
-  u64* size = (u64*)(base + info.header.size);
   u64* capacity = (u64*)(base + info.header.capacity);
 
-  u64 cap = *capacity;
-  if (*size * 4 >= cap * 3) {
-    u64 new_cap = cap ? cap * 2 : 2;
-    sp_ht_resize_impl(data, cap, new_cap, info);
-    *capacity = new_cap;
-    cap = new_cap;
+  u64 new_cap = sp_max(*capacity, 2);
+  if (info.mode & SP_HT_MODE_SWISS) {
+    new_cap = sp_max(new_cap, SP_HT_GROUP_WIDTH);
   }
+  while (new_cap & (new_cap - 1)) new_cap += new_cap & (~new_cap + 1);
 
-  sp_hash_t hash = info.fn.hash(key, info.size.key);
-  u64 hash_idx = hash % cap;
-  u64 first_free = SP_HT_INVALID_INDEX;
+  sp_ht_resize_impl((void**)base, *capacity, new_cap, info);
+  *capacity = new_cap;
+}
 
-  for (u64 c = 0; c < cap; ++c) {
-    u64 i = (hash_idx + c) % cap;
-    u64 offset = i * info.stride.entry;
-    sp_ht_entry_state state = *(sp_ht_entry_state*)((u8*)(*data) + offset + info.stride.kv);
+// Grow (never shrink) to the smallest capacity which holds n entries in total below the load
+// factor, so inserting until the table holds n entries doesn't resize. Growing rehashes, which
+// drops tombstones; a table that's already big enough is left as it is, tombstones and all.
+void sp_ht_reserve_impl(void* ht, u64 n, sp_ht_info_t info) {
+  if (!ht) return;
 
-    if (state == SP_HT_ENTRY_INACTIVE) {
-      if (first_free == SP_HT_INVALID_INDEX) first_free = i;
-      break;
-    }
-    if (state == SP_HT_ENTRY_DELETED) {
-      if (first_free == SP_HT_INVALID_INDEX) first_free = i;
-      continue;
-    }
-    void* k = (u8*)(*data) + offset;
-    if (info.fn.compare(k, key, info.size.key)) {
-      u8* entry = (u8*)(*data) + offset;
-      sp_mem_copy(entry + info.stride.value, val, info.size.value);
-      return;
-    }
+  // No table this big could be allocated, and the sizing below would overflow
+  sp_assert(n <= SP_HT_MAX_RESERVE);
+  if (n > SP_HT_MAX_RESERVE) return;
+
+  u8* base = (u8*)ht;
+  u64* capacity = (u64*)(base + info.header.capacity);
+
+  u64 new_cap = 2;
+  if (info.mode & SP_HT_MODE_SWISS) {
+    new_cap = SP_HT_GROUP_WIDTH;
+    while (n * 8 > new_cap * 7) new_cap *= 2;
+  }
+  else {
+    while (n * 4 >= new_cap * 3) new_cap *= 2;
   }
+  if (new_cap <= *capacity) return;
 
-  u64 idx = first_free != SP_HT_INVALID_INDEX ? first_free : hash_idx;
-  u8* entry = (u8*)(*data) + idx * info.stride.entry;
-  sp_mem_copy(entry, key, info.size.key);
-  sp_mem_copy(entry + info.stride.value, val, info.size.value);
-  *(sp_ht_entry_state*)(entry + info.stride.kv) = SP_HT_ENTRY_ACTIVE;
-  (*size)++;
+  sp_ht_resize_impl((void**)base, *capacity, new_cap, info);
+  *capacity = new_cap;
 }
 
-sp_ht_it_t sp_ht_it_init_fn(void** data, u64 capacity, sp_ht_info_t info) {
-  if (!data || !*data) return 0;
-  sp_ht_it_t it = 0;
-  for (; it < capacity; ++it) {
-    u64 offset = it * info.stride.entry;
-    sp_ht_entry_state state = *(sp_ht_entry_state*)((u8*)*data + offset + info.stride.kv);
-    if (state == SP_HT_ENTRY_ACTIVE) {
-      break;
-    }
+// Move one active entry out of the table being drained and into the live table. The key
+// can't already be in the live table, so it takes the first free slot of its probe run. The
+// old slot becomes a tombstone, so lookups in the old table skip it.
+u64 sp_ht_migrate_entry(void* ht, u64 idx, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  u64 capacity = *(u64*)(base + info.header.capacity);
+  sp_hash_t* hashes = *(sp_hash_t**)(base + info.header.hashes);
+  u64* tombstones = (u64*)(base + info.header.tombstones);
+  sp_ht_migration_t* migration = (sp_ht_migration_t*)(base + info.header.migration);
+
+  u8* entry = (u8*)migration->data + idx * info.stride.entry;
+  sp_hash_t hash = migration->hashes ? migration->hashes[idx] : info.fn.hash(entry, info.size.key);
+
+  u64 slot = sp_ht_home(hash, capacity);
+  while (*(sp_ht_entry_state*)(data + slot * info.stride.entry + info.stride.kv) == SP_HT_ENTRY_ACTIVE) {
+    slot = (slot + 1) & (capacity - 1);
   }
-  return it;
+
+  u8* dst = data + slot * info.stride.entry;
+  if (*(sp_ht_entry_state*)(dst + info.stride.kv) == SP_HT_ENTRY_DELETED && *tombstones) (*tombstones)--;
+  sp_mem_copy(dst, entry, info.stride.kv);
+  *(sp_ht_entry_state*)(dst + info.stride.kv) = SP_HT_ENTRY_ACTIVE;
+  if (hashes) hashes[slot] = hash;
+
+  *(sp_ht_entry_state*)(entry + info.stride.kv) = SP_HT_ENTRY_DELETED;
+  return slot;
 }
 
-void sp_ht_it_advance_fn(void** data, u64 capacity, u64* it, sp_ht_info_t info) {
-  if (!data || !*data) return;
-  (*it)++;
-  for (; *it < capacity; ++*it) {
-    u64 offset = *it * info.stride.entry;
-    sp_ht_entry_state state = *(sp_ht_entry_state*)((u8*)*data + offset + info.stride.kv);
-    if (state == SP_HT_ENTRY_ACTIVE) {
-      break;
+// Scan up to n slots of the table being drained, moving what's left in them into the live
+// table, and free the old table once the scan reaches its end.
+void sp_ht_migrate_impl(void* ht, u64 n, sp_ht_info_t info) {
+  if (!ht) return;
+
+  sp_ht_migration_t* migration = (sp_ht_migration_t*)((u8*)ht + info.header.migration);
+  if (!migration->data) return;
+
+  for (; n && migration->cursor < migration->capacity; n--, migration->cursor++) {
+    u8* entry = (u8*)migration->data + migration->cursor * info.stride.entry;
+    if (*(sp_ht_entry_state*)(entry + info.stride.kv) == SP_HT_ENTRY_ACTIVE) {
+      sp_ht_migrate_entry(ht, migration->cursor, info);
     }
   }
+
+  if (migration->cursor == migration->capacity) {
+    sp_ht_migration_drop_impl(ht, info);
+  }
 }
 
+void sp_ht_migration_drop_impl(void* ht, sp_ht_info_t info) {
+  sp_ht_migration_t* migration = (sp_ht_migration_t*)((u8*)ht + info.header.migration);
+  if (migration->data) sp_free(info.allocator, migration->data, migration->capacity * info.stride.entry);
+  if (migration->hashes) sp_free(info.allocator, migration->hashes, migration->capacity * sizeof(sp_hash_t));
+  sp_mem_zero(migration, sizeof(sp_ht_migration_t));
+}
 
-//  ██████████   █████ █████ ██████   █████      █████████   ███████████   ███████████     █████████   █████ █████
-// ░░███░░░░███ ░░███ ░░███ ░░██████ ░░███      ███░░░░░███ ░░███░░░░░███ ░░███░░░░░███   ███░░░░░███ ░░███ ░░███
-//  ░███   ░░███ ░░███ ███   ░███░███ ░███     ░███    ░███  ░███    ░███  ░███    ░███  ░███    ░███  ░░███ ███
-//  ░███    ░███  ░░█████    ░███░░███░███     ░███████████  ░██████████   ░██████████   ░███████████   ░░█████
-//  ░███    ░███   ░░███     ░███ ░░██████     ░███░░░░░███  ░███░░░░░███  ░███░░░░░███  ░███░░░░░███    ░░███
-//  ░███    ███     ░███     ░███  ░░█████     ░███    ░███  ░███    ░███  ░███    ░███  ░███    ░███     ░███
-//  ██████████      █████    █████  ░░█████    █████   █████ █████   █████ █████   █████ █████   █████    █████
-// ░░░░░░░░░░      ░░░░░    ░░░░░    ░░░░░    ░░░░░   ░░░░░ ░░░░░   ░░░░░ ░░░░░   ░░░░░ ░░░░░   ░░░░░    ░░░░░
-// @array @dyn_array @da
-void* sp_da_resize(void* arr, u32 stride, u64 cap) {
-  sp_assert(arr);
+// Instead of rehashing everything now, swap in an empty table of the new capacity and keep the
+// old one around to be drained a few slots at a time by the operations that follow.
+void sp_ht_migration_begin(void* ht, u64 new_cap, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  void** data = (void**)base;
+  u64* capacity = (u64*)(base + info.header.capacity);
+  sp_hash_t** hashes = (sp_hash_t**)(base + info.header.hashes);
+  u64* tombstones = (u64*)(base + info.header.tombstones);
+  sp_ht_migration_t* migration = (sp_ht_migration_t*)(base + info.header.migration);
 
-  cap = sp_max(cap, 4);
-  sp_da_header_t* header = sp_da_head(arr);
-  u64 old_size = header->capacity * stride + sizeof(sp_da_header_t);
-  header = sp_cast(sp_da_header_t*, sp_realloc(header->allocator, header, old_size, cap * stride + sizeof(sp_da_header_t)));
+  // Growing again before the last migration finished; the sizing below makes this rare
+  sp_ht_migrate_impl(ht, UINT64_MAX, info);
 
-  if (!header) return SP_NULLPTR;
+  migration->data = *data;
+  migration->hashes = *hashes;
+  migration->capacity = *capacity;
+  migration->cursor = 0;
 
-  header->capacity = cap;
-  return header + 1;
+  *data = sp_alloc(info.allocator, new_cap * info.stride.entry);
+  *hashes = migration->hashes ? (sp_hash_t*)sp_alloc(info.allocator, new_cap * sizeof(sp_hash_t)) : SP_NULLPTR;
+  *capacity = new_cap;
+  *tombstones = 0;
 }
 
-void* sp_da_grow_ex(void* arr, u32 stride, u64 n) {
-  sp_assert(arr);
+// Look in the live table first. A key which is still in the old table is moved over before
+// returning, so the index returned always refers to the live table.
+u64 sp_ht_incremental_find(void* ht, void* key, sp_hash_t hash, sp_ht_info_t info) {
+  sp_ht_migrate_impl(ht, SP_HT_MIGRATE_STEP, info);
 
-  u64 required = sp_da_size(arr) + n;
-  if (required <= sp_da_capacity(arr)) return arr;
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  u64 capacity = *(u64*)(base + info.header.capacity);
+  sp_hash_t* hashes = *(sp_hash_t**)(base + info.header.hashes);
+  sp_ht_migration_t* migration = (sp_ht_migration_t*)(base + info.header.migration);
 
-  u64 cap = sp_da_capacity(arr) * 2;
-  cap = sp_max(cap, required);
-  return sp_da_resize(arr, stride, cap);
+  u64 idx = sp_ht_linear_find(data, hashes, capacity, key, hash, info);
+  if (idx != SP_HT_INVALID_INDEX || !migration->data) return idx;
+
+  u64 old = sp_ht_linear_find(migration->data, migration->hashes, migration->capacity, key, hash, info);
+  if (old == SP_HT_INVALID_INDEX) return SP_HT_INVALID_INDEX;
+  return sp_ht_migrate_entry(ht, old, info);
 }
 
-void sp_da_push_ex(void** arr, void* val, u32 stride) {
-  *arr = sp_da_grow_ex(*arr, stride, 1);
-  if (*arr) {
-    sp_mem_copy(((u8*)(*arr)) + sp_da_size(*arr) * stride, val, stride);
-    sp_da_head(*arr)->size++;
+void sp_ht_rehash_impl(void* ht, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  u64* capacity = (u64*)(base + info.header.capacity);
+  sp_hash_t** hashes = (sp_hash_t**)(base + info.header.hashes);
+
+  // Any cached hashes came from the previous hash function
+  if (*hashes) {
+    sp_free(info.allocator, *hashes, *capacity * sizeof(sp_hash_t));
+    *hashes = SP_NULLPTR;
   }
+  sp_ht_rebuild_impl(ht, info);
 }
 
-void* sp_da_init_ex(sp_mem_t mem, u32 stride) {
-  u32 cap = 4;
-  sp_da_header_t* head = (sp_da_header_t*)sp_alloc(mem, cap * stride + sizeof(sp_da_header_t));
-  *head = (sp_da_header_t) {
-    .size = 0,
-    .capacity = cap,
-    .allocator = mem,
-  };
-
-  return head + 1;
+void sp_ht_insert_impl(void* ht, void* key, void* val, sp_ht_info_t info) {
+  sp_ht_insert_hashed(ht, key, val, info.fn.hash(key, info.size.key), info);
 }
 
+void sp_ht_insert_hashed(void* ht, void* key, void* val, sp_hash_t hash, sp_ht_info_t info) {
+  if (info.mode & SP_HT_MODE_SWISS) {
+    sp_ht_swiss_insert(ht, key, val, hash, info);
+    return;
+  }
 
+  u8* base = (u8*)ht;
+  void** data = (void**)base;
+  u64* size = (u64*)(base + info.header.size);
+  u64* capacity = (u64*)(base + info.header.capacity);
+  sp_hash_t** hashes = (sp_hash_t**)(base + info.header.hashes);
+  u64* tombstones = (u64*)(base + info.header.tombstones);
 
-//  ███████████   █████ ██████   █████   █████████     ███████████  █████  █████ ███████████ ███████████ ██████████ ███████████
-// ░░███░░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███   ░░███░░░░░███░░███  ░░███ ░░███░░░░░░█░░███░░░░░░█░░███░░░░░█░░███░░░░░███
-//  ░███    ░███  ░███  ░███░███ ░███  ███     ░░░     ░███    ░███ ░███   ░███  ░███   █ ░  ░███   █ ░  ░███  █ ░  ░███    ░███
-//  ░██████████   ░███  ░███░░███░███ ░███             ░██████████  ░███   ░███  ░███████    ░███████    ░██████    ░██████████
-//  ░███░░░░░███  ░███  ░███ ░░██████ ░███    █████    ░███░░░░░███ ░███   ░███  ░███░░░█    ░███░░░█    ░███░░█    ░███░░░░░███
-//  ░███    ░███  ░███  ░███  ░░█████ ░░███  ░░███     ░███    ░███ ░███   ░███  ░███  ░     ░███  ░     ░███ ░   █ ░███    ░███
-//  █████   █████ █████ █████  ░░█████ ░░█████████     ███████████  ░░████████   █████       █████       ██████████ █████   █████
-// ░░░░░   ░░░░░ ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░     ░░░░░░░░░░░    ░░░░░░░░   ░░░░░       ░░░░░       ░░░░░░░░░░ ░░░░░   ░░░░░
-// @ring_buffer @rb
-void sp_rb_init_ex(sp_mem_t mem, void** arr, u32 stride, u32 capacity) {
-  sp_ring_buffer_t* rb = (sp_ring_buffer_t*)sp_alloc(mem, capacity * stride + sizeof(sp_ring_buffer_t));
-  rb->head = 0;
-  rb->size = 0;
-  rb->capacity = capacity;
-  rb->mode = SP_RQ_MODE_GROW;
-  rb->allocator = mem;
-  *arr = (u8*)(rb + 1);
-}
+  // Tombstones count against the 3/4 load factor. When most of the load is tombstones,
+  // rehash at the same capacity instead of growing.
+  u64 cap = *capacity;
+  if ((*size + *tombstones) * 4 >= cap * 3) {
+    u64 new_cap = cap ? cap * 2 : 2;
+    if (*size * 2 < cap) new_cap = cap;
+    if ((info.mode & SP_HT_MODE_INCREMENTAL) && *size) {
+      sp_ht_migration_begin(ht, new_cap, info);
+    }
+    else {
+      sp_ht_resize_impl(data, cap, new_cap, info);
+      *capacity = new_cap;
+    }
+    cap = new_cap;
+  }
 
-void* sp_rb_grow_ex(void* arr, u32 stride, u32 capacity) {
-  sp_assert(arr);
-  sp_ring_buffer_t* old = sp_rb_head(arr);
-  sp_mem_t mem = old->allocator;
-  sp_ring_buffer_t* rb = (sp_ring_buffer_t*)sp_alloc(mem, capacity * stride + sizeof(sp_ring_buffer_t));
-  if (!rb) return SP_NULLPTR;
+  // Pull the key out of the old table first, so that it's overwritten below rather than
+  // inserted a second time
+  if (info.mode & SP_HT_MODE_INCREMENTAL) {
+    sp_ht_migration_t* migration = (sp_ht_migration_t*)(base + info.header.migration);
+    sp_ht_migrate_impl(ht, SP_HT_MIGRATE_STEP, info);
+    if (migration->data) {
+      u64 old = sp_ht_linear_find(migration->data, migration->hashes, migration->capacity, key, hash, info);
+      if (old != SP_HT_INVALID_INDEX) sp_ht_migrate_entry(ht, old, info);
+    }
+  }
 
-  rb->head = 0;
-  rb->size = old->size;
-  rb->capacity = capacity;
-  rb->mode = old->mode;
-  rb->allocator = mem;
+  u64 hash_idx = sp_ht_home(hash, cap);
+  u64 first_free = SP_HT_INVALID_INDEX;
 
-  u32 old_size = old->size;
-  u32 old_cap = old->capacity;
-  u32 old_head = old->head;
+  for (u64 c = 0; c < cap; ++c) {
+    u64 i = (hash_idx + c) & (cap - 1);
+    u64 offset = i * info.stride.entry;
+    sp_ht_entry_state state = *(sp_ht_entry_state*)((u8*)(*data) + offset + info.stride.kv);
 
-  u8* new_arr = (u8*)rb + sizeof(sp_ring_buffer_t);
-  u8* old_arr = (u8*)arr;
+    if (state == SP_HT_ENTRY_INACTIVE) {
+      if (first_free == SP_HT_INVALID_INDEX) first_free = i;
+      break;
+    }
+    if (state == SP_HT_ENTRY_DELETED) {
+      if (first_free == SP_HT_INVALID_INDEX) first_free = i;
+      continue;
+    }
+    if (*hashes && (*hashes)[i] != hash) {
+      continue;
+    }
+    void* k = (u8*)(*data) + offset;
+    if (info.fn.compare(k, key, info.size.key)) {
+      u8* entry = (u8*)(*data) + offset;
+      sp_mem_copy(entry + info.stride.value, val, info.size.value);
+      return;
+    }
+  }
 
-  u32 first_chunk = old_cap - old_head;
-  if (first_chunk > old_size) first_chunk = old_size;
-  sp_mem_copy(new_arr, old_arr + old_head * stride, first_chunk * stride);
+  u64 idx = first_free != SP_HT_INVALID_INDEX ? first_free : hash_idx;
+  u8* entry = (u8*)(*data) + idx * info.stride.entry;
+  if (*(sp_ht_entry_state*)(entry + info.stride.kv) == SP_HT_ENTRY_DELETED && *tombstones) (*tombstones)--;
+  if (*hashes) (*hashes)[idx] = hash;
+  sp_mem_copy(entry, key, info.size.key);
+  sp_mem_copy(entry + info.stride.value, val, info.size.value);
+  *(sp_ht_entry_state*)(entry + info.stride.kv) = SP_HT_ENTRY_ACTIVE;
+  (*size)++;
+}
 
-  u32 second_chunk = old_size - first_chunk;
-  if (second_chunk > 0) {
-    sp_mem_copy(new_arr + first_chunk * stride, old_arr, second_chunk * stride);
+// Touch the memory a probe for this hash reads first: the home group's control bytes and
+// entries for a Swiss table, or the home entry (and its cached hash) for a linear one.
+void sp_ht_prefetch(void* ht, sp_hash_t hash, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  u64 capacity = *(u64*)(base + info.header.capacity);
+  u8* ctrl = *(u8**)(base + info.header.ctrl);
+  sp_hash_t* hashes = *(sp_hash_t**)(base + info.header.hashes);
+
+  if (ctrl) {
+    u64 slot = sp_ht_home(hash, capacity / SP_HT_GROUP_WIDTH) * SP_HT_GROUP_WIDTH;
+    SP_PREFETCH(ctrl + slot);
+    SP_PREFETCH(data + slot * info.stride.entry);
+    if (hashes) SP_PREFETCH(hashes + slot);
+    return;
   }
 
-  sp_mem_allocator_free(mem, old, old_cap * stride + sizeof(sp_ring_buffer_t));
-
-  return (u8*)(rb + 1);
+  u64 slot = sp_ht_home(hash, capacity);
+  SP_PREFETCH(data + slot * info.stride.entry);
+  if (hashes) SP_PREFETCH(hashes + slot);
 }
 
+// Each probe is a dependent cache miss, so looking keys up one at a time leaves the core
+// waiting on memory. Instead, hash a batch of keys and prefetch all of their home slots before
+// probing any of them, so the misses for the batch overlap.
+u64 sp_ht_get_many_impl(void* ht, void* keys, u64 n, void** values, sp_ht_info_t info) {
+  if (!ht) {
+    for (u64 i = 0; i < n; i++) values[i] = SP_NULLPTR;
+    return 0;
+  }
 
-//  ███████████    ███████    ███████████   ██████   ██████   █████████   ███████████
-// ░░███░░░░░░█  ███░░░░░███ ░░███░░░░░███ ░░██████ ██████   ███░░░░░███ ░█░░░███░░░█
-//  ░███   █ ░  ███     ░░███ ░███    ░███  ░███░█████░███  ░███    ░███ ░   ░███  ░
-//  ░███████   ░███      ░███ ░██████████   ░███░░███ ░███  ░███████████     ░███
-//  ░███░░░█   ░███      ░███ ░███░░░░░███  ░███ ░░░  ░███  ░███░░░░░███     ░███
-//  ░███  ░    ░░███     ███  ░███    ░███  ░███      ░███  ░███    ░███     ░███
-//  █████       ░░░███████░   █████   █████ █████     █████ █████   █████    █████
-// ░░░░░          ░░░░░░░    ░░░░░   ░░░░░ ░░░░░     ░░░░░ ░░░░░   ░░░░░    ░░░░░
-// @format
-static u8 sp_fmt_peek(sp_fmt_parser_t* p, u32 offset) {
-  u32 idx = p->i + offset;
-  if (idx >= p->str.len) return 0;
-  return (u8)p->str.data[idx];
-}
+  sp_hash_t hashes [SP_HT_BATCH_SIZE];
+  u64 found = 0;
+  for (u64 batch = 0; batch < n; batch += SP_HT_BATCH_SIZE) {
+    u64 count = sp_min(n - batch, (u64)SP_HT_BATCH_SIZE);
+    u8* batch_keys = (u8*)keys + batch * info.size.key;
 
-typedef struct {
-  u8 first;
-  u8 second;
-} sp_fmt_peek_t;
+    sp_for(i, count) {
+      hashes[i] = info.fn.hash(batch_keys + i * info.size.key, info.size.key);
+      sp_ht_prefetch(ht, hashes[i], info);
+    }
 
-static sp_fmt_peek_t sp_fmt_peek2(sp_fmt_parser_t* p) {
-  return (sp_fmt_peek_t){
-    .first  = sp_fmt_peek(p, 0),
-    .second = sp_fmt_peek(p, 1),
-  };
-}
+    u8* data = *(u8**)ht;
+    sp_for(i, count) {
+      u64 idx = sp_ht_find_hashed(ht, batch_keys + i * info.size.key, hashes[i], info);
+      if (idx == SP_HT_INVALID_INDEX) {
+        values[batch + i] = SP_NULLPTR;
+        continue;
+      }
+      values[batch + i] = data + idx * info.stride.entry + info.stride.value;
+      found++;
+    }
+  }
 
-static u8 sp_fmt_advance(sp_fmt_parser_t* p) {
-  if (p->i >= p->str.len) return 0;
-  return (u8)p->str.data[p->i++];
+  return found;
 }
 
-static bool sp_fmt_match(sp_fmt_parser_t* p, c8 c) {
-  if (sp_fmt_peek(p, 0) != (u8)c) return false;
-  p->i++;
-  return true;
-}
+void sp_ht_insert_many_impl(void* ht, void* keys, u64 n, void* values, sp_ht_info_t info) {
+  sp_hash_t hashes [SP_HT_BATCH_SIZE];
+  for (u64 batch = 0; batch < n; batch += SP_HT_BATCH_SIZE) {
+    u64 count = sp_min(n - batch, (u64)SP_HT_BATCH_SIZE);
+    u8* batch_keys = (u8*)keys + batch * info.size.key;
+    u8* batch_values = (u8*)values + batch * info.size.value;
 
-static bool sp_fmt_is_whitespace(u8 c) {
-  return c == ' ' || c == '\t';
-}
+    // If an insert in this batch grows the table, the rest of the prefetches were wasted, but
+    // they were only ever hints
+    sp_for(i, count) {
+      hashes[i] = info.fn.hash(batch_keys + i * info.size.key, info.size.key);
+      sp_ht_prefetch(ht, hashes[i], info);
+    }
 
-static bool sp_fmt_is_digit(u8 c) {
-  return c >= '0' && c <= '9';
+    sp_for(i, count) {
+      sp_ht_insert_hashed(ht, batch_keys + i * info.size.key, batch_values + i * info.size.value, hashes[i], info);
+    }
+  }
 }
 
-static bool sp_fmt_is_alpha(u8 c) {
-  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
-}
+// Knuth's algorithm R: walk the probe run after the hole, and move back any entry whose home
+// slot does not lie cyclically in (hole, entry]. Each moved entry leaves a new hole behind it.
+void sp_ht_backshift_erase(void* ht, u64 idx, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  u64 capacity = *(u64*)(base + info.header.capacity);
+  sp_hash_t* hashes = *(sp_hash_t**)(base + info.header.hashes);
+  u64 mask = capacity - 1;
 
-static bool sp_fmt_is_directive_id(u8 c) {
-  return sp_fmt_is_alpha(c) || (c >= '0' && c <= '9') || c == '-' || c == '_';
-}
+  u64 hole = idx;
+  for (u64 j = (idx + 1) & mask; j != idx; j = (j + 1) & mask) {
+    u8* entry = data + j * info.stride.entry;
+    if (*(sp_ht_entry_state*)(entry + info.stride.kv) != SP_HT_ENTRY_ACTIVE) break;
 
-static bool sp_fmt_is_align(u8 c) {
-  return c == '<' || c == '^' || c == '>';
-}
+    sp_hash_t hash = hashes ? hashes[j] : info.fn.hash(entry, info.size.key);
+    u64 home = sp_ht_home(hash, capacity);
+    bool stays = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+    if (stays) continue;
 
-static bool sp_fmt_is_renderer(u8 c) {
-  return c == 'B' || c == 'b' || c == 'x' || c == 'X' || c == 'o' || c == 'c';
-}
+    sp_mem_copy(data + hole * info.stride.entry, entry, info.stride.entry);
+    if (hashes) hashes[hole] = hashes[j];
+    hole = j;
+  }
 
-static sp_str_t sp_fmt_sub(sp_fmt_parser_t* p) {
-  return (sp_str_t) {
-    .data = p->str.data + p->i,
-  };
+  *(sp_ht_entry_state*)(data + hole * info.stride.entry + info.stride.kv) = SP_HT_ENTRY_INACTIVE;
 }
 
-static void sp_fmt_eat_whitespace(sp_fmt_parser_t* p) {
-  while (sp_fmt_is_whitespace(sp_fmt_peek(p, 0))) {
-    sp_fmt_advance(p);
+void sp_ht_erase_impl(void* ht, u64 idx, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  u64* size = (u64*)(base + info.header.size);
+  u8* ctrl = *(u8**)(base + info.header.ctrl);
+  u64* tombstones = (u64*)(base + info.header.tombstones);
+  sp_ht_entry_state* state = (sp_ht_entry_state*)(data + idx * info.stride.entry + info.stride.kv);
+
+  if (!ctrl && (info.mode & SP_HT_MODE_BACKSHIFT)) {
+    sp_ht_backshift_erase(ht, idx, info);
+    if (*size) (*size)--;
+    return;
   }
-}
 
-static sp_str_t sp_fmt_directive_name(sp_fmt_parser_t* p) {
-  sp_str_t word = sp_fmt_sub(p);
-  if (!sp_fmt_is_alpha(sp_fmt_peek(p, 0))) return word;
-  while (sp_fmt_is_directive_id(sp_fmt_peek(p, 0))) {
-    sp_fmt_advance(p);
-    word.len++;
+  // A group which still has an empty slot was never full, so no probe has ever continued
+  // past it, and the slot can go straight back to empty without leaving a tombstone.
+  if (ctrl && sp_ht_group_match_empty(ctrl + (idx & ~(u64)(SP_HT_GROUP_WIDTH - 1)))) {
+    ctrl[idx] = SP_HT_CTRL_EMPTY;
+    *state = SP_HT_ENTRY_INACTIVE;
+  }
+  else {
+    if (ctrl) ctrl[idx] = SP_HT_CTRL_DELETED;
+    *state = SP_HT_ENTRY_DELETED;
+    (*tombstones)++;
   }
-  return word;
-}
 
-static bool sp_fmt_at_directive_boundary(sp_fmt_parser_t* p) {
-  c8 c = sp_fmt_peek(p, 0);
-  return c == 0 || c == '}' || sp_fmt_is_whitespace(c);
+  if (*size) (*size)--;
 }
 
-static sp_fmt_align_t sp_fmt_align_from_char(u8 c) {
-  if (c == '<') return SP_FMT_ALIGN_LEFT;
-  if (c == '^') return SP_FMT_ALIGN_CENTER;
-  if (c == '>') return SP_FMT_ALIGN_RIGHT;
-  return SP_FMT_ALIGN_NONE;
-}
+// The number of slots (linear) or groups (Swiss) a probe for the entry at idx passes before
+// it's found; an entry in its home slot has a probe length of zero.
+u64 sp_ht_probe_length(void* ht, u64 idx, sp_ht_info_t info) {
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  u64 capacity = *(u64*)(base + info.header.capacity);
+  u8* ctrl = *(u8**)(base + info.header.ctrl);
+  sp_hash_t* hashes = *(sp_hash_t**)(base + info.header.hashes);
 
-static sp_err_t sp_fmt_parse_number(sp_fmt_parser_t* p, u32* out) {
-  u32 acc = 0;
-  sp_err_t err = SP_ERR;
-  while (sp_fmt_is_digit(sp_fmt_peek(p, 0))) {
-    acc = acc * 10 + (u32)(sp_fmt_advance(p) - '0');
-    err = SP_OK;
+  sp_hash_t hash = hashes ? hashes[idx] : info.fn.hash(data + idx * info.stride.entry, info.size.key);
+  if (!ctrl) {
+    return (idx - sp_ht_home(hash, capacity)) & (capacity - 1);
   }
-  if (!err) *out = acc;
-  return err;
-}
 
-// Parses the spec body that follows the `:` introducer:
-// [fill_align] [width] [.precision] [renderer]
-static sp_err_t sp_fmt_parse_spec_body(sp_fmt_parser_t* p, sp_fmt_spec_t* spec) {
-  sp_fmt_peek_t peek = sp_fmt_peek2(p);
-  if (sp_fmt_is_align(peek.second)) {
-    if (peek.first == '$') spec->dynamic |= SP_FMT_DYNAMIC_FILL;
-    else                   spec->fill = peek.first;
-    spec->align = sp_fmt_align_from_char(peek.second);
-    sp_fmt_advance(p);
-    sp_fmt_advance(p);
+  u64 mask = capacity / SP_HT_GROUP_WIDTH - 1;
+  u64 group = sp_ht_home(hash, mask + 1);
+  u64 target = idx / SP_HT_GROUP_WIDTH;
+  u64 probe = 0;
+  while (group != target && probe <= mask) {
+    probe++;
+    group = (group + probe) & mask;
   }
-  else if (sp_fmt_is_align(peek.first)) {
-    spec->align = sp_fmt_align_from_char(peek.first);
-    sp_fmt_advance(p);
+  return probe;
+}
+
+sp_ht_stats_t sp_ht_stats_impl(void* ht, sp_ht_info_t info) {
+  sp_ht_stats_t stats = sp_zero;
+  if (!ht) return stats;
+  sp_ht_migrate_impl(ht, UINT64_MAX, info);
+
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  stats.size = *(u64*)(base + info.header.size);
+  stats.capacity = *(u64*)(base + info.header.capacity);
+  stats.tombstones = *(u64*)(base + info.header.tombstones);
+  if (!data || !stats.capacity) return stats;
+
+  for (u64 i = 0; i < stats.capacity; i++) {
+    sp_ht_entry_state state = *(sp_ht_entry_state*)(data + i * info.stride.entry + info.stride.kv);
+    if (state != SP_HT_ENTRY_ACTIVE) continue;
+
+    u64 probe = sp_ht_probe_length(ht, i, info);
+    stats.total_probe += probe;
+    stats.max_probe = sp_max(stats.max_probe, probe);
   }
 
-  c8 c = sp_fmt_peek(p, 0);
-  if (c == '$') {
-    sp_fmt_advance(p);
-    spec->dynamic |= SP_FMT_DYNAMIC_WIDTH;
+  stats.mean_probe = stats.size ? (f64)stats.total_probe / (f64)stats.size : 0.0;
+  stats.load = (f64)stats.size / (f64)stats.capacity;
+  return stats;
+}
+
+sp_ht_it_t sp_ht_it_init_fn(void** data, u64 capacity, sp_ht_info_t info) {
+  if (!data || !*data) return 0;
+  sp_ht_migrate_impl((void*)data, UINT64_MAX, info);
+  sp_ht_it_t it = 0;
+  for (; it < capacity; ++it) {
+    u64 offset = it * info.stride.entry;
+    sp_ht_entry_state state = *(sp_ht_entry_state*)((u8*)*data + offset + info.stride.kv);
+    if (state == SP_HT_ENTRY_ACTIVE) {
+      break;
+    }
   }
-  else if (sp_fmt_is_digit(c)) {
-    sp_fmt_parse_number(p, &spec->width);
-    if (spec->width > SP_FMT_WIDTH_MAX) spec->width = SP_FMT_WIDTH_MAX;
+  return it;
+}
+
+void sp_ht_it_advance_fn(void** data, u64 capacity, u64* it, sp_ht_info_t info) {
+  if (!data || !*data) return;
+  (*it)++;
+  for (; *it < capacity; ++*it) {
+    u64 offset = *it * info.stride.entry;
+    sp_ht_entry_state state = *(sp_ht_entry_state*)((u8*)*data + offset + info.stride.kv);
+    if (state == SP_HT_ENTRY_ACTIVE) {
+      break;
+    }
   }
+}
 
-  if (sp_fmt_peek(p, 0) == '.') {
-    sp_fmt_advance(p);
-    if (sp_fmt_peek(p, 0) == '$') {
-      sp_fmt_advance(p);
-      spec->dynamic |= SP_FMT_DYNAMIC_PRECISION;
+// @ht_image
+sp_err_t sp_ht_image_write_impl(void* ht, sp_io_writer_t* io, sp_ht_image_key_kind_t kind, sp_ht_info_t info) {
+  sp_ht_migrate_impl(ht, UINT64_MAX, info);
+  u8* base = (u8*)ht;
+  u8* data = *(u8**)base;
+  u64 size = *(u64*)(base + info.header.size);
+  u64 ht_capacity = *(u64*)(base + info.header.capacity);
+  sp_mem_t mem = info.allocator;
+
+  // The entry's stride is a multiple of its alignment, so its lowest set bit is a safe
+  // alignment for the value
+  u64 align = sp_min(info.stride.entry & (~info.stride.entry + 1), (u64)SP_MEM_ALIGNMENT);
+  u64 key_size = kind == SP_HT_IMAGE_KEY_STR ? sizeof(sp_ht_image_str_t) : info.size.key;
+
+  sp_ht_image_header_t header = sp_zero;
+  header.magic = SP_HT_IMAGE_MAGIC;
+  header.version = SP_HT_IMAGE_VERSION;
+  header.key_kind = kind;
+  header.key_size = (u32)key_size;
+  header.value_size = (u32)info.size.value;
+  header.value_offset = (u32)sp_align_offset(key_size, align);
+  header.entry_stride = (u32)sp_align_offset(header.value_offset + info.size.value, align);
+  header.seed = SP_HT_HASH_SEED;
+  header.size = size;
+  header.capacity = 2;
+  while (size * 4 >= header.capacity * 3) header.capacity *= 2;
+
+  for (u64 i = 0; i < ht_capacity; i++) {
+    u8* entry = data + i * info.stride.entry;
+    if (*(sp_ht_entry_state*)(entry + info.stride.kv) != SP_HT_ENTRY_ACTIVE) continue;
+    if (kind == SP_HT_IMAGE_KEY_STR) header.strings_size += ((sp_str_t*)entry)->len;
+  }
+
+  header.hashes = sp_align_offset(sizeof(sp_ht_image_header_t), SP_MEM_ALIGNMENT);
+  header.entries = sp_align_offset(header.hashes + header.capacity * sizeof(u64), SP_MEM_ALIGNMENT);
+  header.strings = sp_align_offset(header.entries + header.capacity * header.entry_stride, SP_MEM_ALIGNMENT);
+  header.image_size = header.strings + header.strings_size;
+
+  // Everything after the header is built in one buffer, zeroed so that padding is deterministic
+  u64 body_size = header.image_size - header.hashes;
+  u8* body = (u8*)sp_alloc(mem, body_size);
+  sp_mem_zero(body, body_size);
+  u64* hashes = (u64*)body;
+  u8* entries = body + (header.entries - header.hashes);
+  u8* strings = body + (header.strings - header.hashes);
+
+  u64 mask = header.capacity - 1;
+  u64 string_offset = 0;
+  for (u64 i = 0; i < ht_capacity; i++) {
+    u8* entry = data + i * info.stride.entry;
+    if (*(sp_ht_entry_state*)(entry + info.stride.kv) != SP_HT_ENTRY_ACTIVE) continue;
+
+    sp_hash_t hash;
+    if (kind == SP_HT_IMAGE_KEY_STR) {
+      sp_str_t* str = (sp_str_t*)entry;
+      hash = sp_hash_fast(str->data, str->len, header.seed);
     }
     else {
-      u32 prec = 0;
-      sp_try_as(sp_fmt_parse_number(p, &prec), SP_ERR_FMT_BAD_PRECISION);
-      sp_opt_set(spec->precision, (u8)prec);
+      hash = sp_hash_fast(entry, key_size, header.seed);
     }
+
+    u64 slot = sp_ht_home(hash, header.capacity);
+    while (hashes[slot]) slot = (slot + 1) & mask;
+    hashes[slot] = hash | 1;
+
+    u8* dst = entries + slot * header.entry_stride;
+    if (kind == SP_HT_IMAGE_KEY_STR) {
+      sp_str_t* str = (sp_str_t*)entry;
+      sp_ht_image_str_t key = { string_offset, str->len };
+      sp_mem_copy(dst, &key, sizeof(key));
+      if (str->len) sp_mem_copy(strings + string_offset, str->data, str->len);
+      string_offset += str->len;
+    }
+    else {
+      sp_mem_copy(dst, entry, key_size);
+    }
+    sp_mem_copy(dst + header.value_offset, entry + info.stride.value, info.size.value);
   }
 
-  if (sp_fmt_is_renderer(sp_fmt_peek(p, 0))) spec->renderer = sp_fmt_advance(p);
-  return SP_OK;
+  sp_err_t err = sp_io_write_all(io, &header, sizeof(header), SP_NULLPTR);
+  if (!err) err = sp_io_pad(io, header.hashes - sizeof(header), SP_NULLPTR);
+  if (!err) err = sp_io_write_all(io, body, body_size, SP_NULLPTR);
+  sp_free(mem, body, body_size);
+  return err;
 }
 
-// Parses a single directive that follows the `.` introducer: just a name. On
-// success, leaves the cursor on a directive boundary (whitespace, `}`, or EOF).
-// The trailing whitespace — if any — is left for the top-level loop to consume:
-// it separates this directive from the next one.
-static sp_err_t sp_fmt_parse_directive(sp_fmt_parser_t* p, sp_fmt_spec_t* spec) {
-  if (spec->directive.num >= SP_FMT_MAX_DIRECTIVES) {
-    return SP_ERR_FMT_TOO_MANY_DIRECTIVES;
-  }
-
-  if (sp_fmt_match(p, '$')) {
-    u32 index = spec->directive.num++;
-    spec->dynamic |= sp_fmt_dynamic_directive(index);
-    if (!sp_fmt_at_directive_boundary(p)) return SP_ERR_FMT_BAD_PLACEHOLDER;
-    return SP_OK;
-  }
+sp_err_t sp_ht_image_from_mem(sp_ht_image_t* image, const void* data, u64 size) {
+  *image = sp_zero_s(sp_ht_image_t);
+  if (!data || size < sizeof(sp_ht_image_header_t)) return SP_ERR;
+  if (sp_uptr(data) & (SP_MEM_ALIGNMENT - 1)) return SP_ERR;
 
-  sp_str_t name = sp_fmt_directive_name(p);
-  if (!name.len) return SP_ERR_FMT_BAD_DIRECTIVE;
+  const sp_ht_image_header_t* h = (const sp_ht_image_header_t*)data;
+  if (h->magic != SP_HT_IMAGE_MAGIC || h->version != SP_HT_IMAGE_VERSION) return SP_ERR;
+  if (h->key_kind != SP_HT_IMAGE_KEY_BYTES && h->key_kind != SP_HT_IMAGE_KEY_STR) return SP_ERR;
+  if (!h->capacity || (h->capacity & (h->capacity - 1)) || h->size >= h->capacity) return SP_ERR;
+  if (h->value_offset < h->key_size || h->value_offset + h->value_size > h->entry_stride) return SP_ERR;
 
-  u32 index = spec->directive.num++;
-  spec->directive.names[index] = name;
+  // Check each region against the image size without letting the arithmetic overflow
+  if (h->image_size > size) return SP_ERR;
+  if (h->hashes > size || h->capacity > (size - h->hashes) / sizeof(u64)) return SP_ERR;
+  if (h->entries > size || h->capacity > (size - h->entries) / sp_max(h->entry_stride, 1)) return SP_ERR;
+  if (h->strings > size || h->strings_size > size - h->strings) return SP_ERR;
+  if ((h->hashes | h->entries) & (SP_MEM_ALIGNMENT - 1)) return SP_ERR;
 
-  if (!sp_fmt_at_directive_boundary(p)) return SP_ERR_FMT_BAD_PLACEHOLDER;
+  image->base = (const u8*)data;
+  image->header = h;
   return SP_OK;
 }
 
-sp_err_t sp_fmt_parse_specifier(sp_fmt_parser_t* p, sp_fmt_spec_t* spec) {
-  if (!sp_fmt_match(p, '{')) return SP_ERR_FMT_BAD_PLACEHOLDER;
+sp_err_t sp_ht_image_open(sp_ht_image_t* image, sp_str_t path) {
+  *image = sp_zero_s(sp_ht_image_t);
 
-  if (sp_fmt_match(p, ':')) {
-    sp_try(sp_fmt_parse_spec_body(p, spec));
-  }
+  sp_sys_fd_t fd = sp_sys_open_s(sp_sys_get_root(0), path, SP_O_RDONLY | SP_O_BINARY, 0);
+  if (fd == SP_SYS_INVALID_FD) return SP_ERR_IO_OPEN_FAILED;
 
-  sp_fmt_eat_whitespace(p);
-  while (sp_fmt_match(p, '.')) {
-    sp_try(sp_fmt_parse_directive(p, spec));
-    sp_fmt_eat_whitespace(p);
+  sp_sys_file_meta_t meta = sp_zero;
+  if (sp_sys_get_file_metadata(fd, &meta) < 0 || meta.size <= 0) {
+    sp_sys_close(fd);
+    return SP_ERR_IO_READ_FAILED;
   }
 
-  if (!sp_fmt_match(p, '}')) {
-    if (sp_fmt_peek(p, 0) == 0) return SP_ERR_FMT_UNTERMINATED_PLACEHOLDER;
-    return SP_ERR_FMT_BAD_PLACEHOLDER;
+  // The mapping outlives the descriptor
+  u64 size = (u64)meta.size;
+  void* map = sp_sys_map_file(fd, size);
+  sp_sys_close(fd);
+  if (!map) return SP_ERR_IO_READ_FAILED;
+
+  sp_err_t err = sp_ht_image_from_mem(image, map, size);
+  if (err) {
+    sp_sys_unmap_file(map, size);
+    return err;
   }
+
+  image->map = map;
+  image->map_size = size;
   return SP_OK;
 }
 
+void sp_ht_image_close(sp_ht_image_t* image) {
+  if (image->map) sp_sys_unmap_file(image->map, image->map_size);
+  *image = sp_zero_s(sp_ht_image_t);
+}
 
-static sp_err_t sp_fmt_pull_specifier_arg(sp_fmt_argv_t a, s64* out) {
-  if (a.id != sp_fmt_id_u64 && a.id != sp_fmt_id_s64) {
-    return SP_ERR;
+u64 sp_ht_image_size(const sp_ht_image_t* image) {
+  return image->header ? image->header->size : 0;
+}
+
+const void* sp_ht_image_find(const sp_ht_image_t* image, sp_hash_t hash, const void* key, u64 len) {
+  const sp_ht_image_header_t* h = image->header;
+  const u64* hashes = (const u64*)(image->base + h->hashes);
+  const u8* entries = image->base + h->entries;
+  const c8* strings = (const c8*)(image->base + h->strings);
+  u64 mask = h->capacity - 1;
+  u64 tag = hash | 1;
+
+  u64 slot = sp_ht_home(hash, h->capacity);
+  for (u64 c = 0; c < h->capacity; c++, slot = (slot + 1) & mask) {
+    if (!hashes[slot]) return SP_NULLPTR;
+    if (hashes[slot] != tag) continue;
+
+    const u8* entry = entries + slot * h->entry_stride;
+    if (h->key_kind == SP_HT_IMAGE_KEY_STR) {
+      sp_ht_image_str_t str;
+      sp_mem_copy(&str, entry, sizeof(str));
+      if (str.len != len || str.offset > h->strings_size || str.len > h->strings_size - str.offset) continue;
+      if (!len || sp_mem_is_equal(strings + str.offset, key, len)) return entry + h->value_offset;
+    }
+    else if (sp_mem_is_equal(entry, key, len)) {
+      return entry + h->value_offset;
+    }
   }
-  *out = (a.id == sp_fmt_id_s64) ? a.value.i : (s64)a.value.u;
-  return SP_OK;
+
+  return SP_NULLPTR;
 }
 
-sp_err_t sp_fmt_style_from_name(sp_str_t name, sp_fmt_style_t* out) {
-  if (sp_str_equal_cstr(name, "black")) { *out = sp_fmt_style_black; return SP_OK; }
-  if (sp_str_equal_cstr(name, "red")) { *out = sp_fmt_style_red; return SP_OK; }
-  if (sp_str_equal_cstr(name, "green")) { *out = sp_fmt_style_green; return SP_OK; }
-  if (sp_str_equal_cstr(name, "yellow")) { *out = sp_fmt_style_yellow; return SP_OK; }
-  if (sp_str_equal_cstr(name, "blue")) { *out = sp_fmt_style_blue; return SP_OK; }
-  if (sp_str_equal_cstr(name, "magenta")) { *out = sp_fmt_style_magenta; return SP_OK; }
-  if (sp_str_equal_cstr(name, "cyan")) { *out = sp_fmt_style_cyan; return SP_OK; }
-  if (sp_str_equal_cstr(name, "white")) { *out = sp_fmt_style_white; return SP_OK; }
-  if (sp_str_equal_cstr(name, "gray")) { *out = sp_fmt_style_gray; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_black")) { *out = sp_fmt_style_gray; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_red")) { *out = sp_fmt_style_br_red; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_green")) { *out = sp_fmt_style_br_green; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_yellow")) { *out = sp_fmt_style_br_yellow; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_blue")) { *out = sp_fmt_style_br_blue; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_magenta")) { *out = sp_fmt_style_br_magenta; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_cyan")) { *out = sp_fmt_style_br_cyan; return SP_OK; }
-  if (sp_str_equal_cstr(name, "br_white")) { *out = sp_fmt_style_br_white; return SP_OK; }
-  if (sp_str_equal_cstr(name, "bold")) { *out = sp_fmt_style_bold; return SP_OK; }
-  if (sp_str_equal_cstr(name, "italic")) { *out = sp_fmt_style_italic; return SP_OK; }
-  if (sp_str_equal_cstr(name, "hyperlink")) { *out = sp_fmt_style_hyperlink; return SP_OK; }
-  if (sp_str_equal_cstr(name, "quote")) { *out = sp_fmt_style_quote; return SP_OK; }
-  return SP_ERR_FMT_UNKNOWN_DIRECTIVE;
+const void* sp_ht_image_get(const sp_ht_image_t* image, const void* key) {
+  const sp_ht_image_header_t* h = image->header;
+  if (!h || h->key_kind != SP_HT_IMAGE_KEY_BYTES) return SP_NULLPTR;
+  return sp_ht_image_find(image, sp_hash_fast(key, h->key_size, h->seed), key, h->key_size);
 }
 
-sp_fmt_style_t sp_fmt_style_from_attr(sp_fmt_style_attr_t attr) {
-  switch (attr) {
-    case SP_FMT_STYLE_ATTR_NONE:      return sp_fmt_style_none;
-    case SP_FMT_STYLE_ATTR_BOLD:      return sp_fmt_style_bold;
-    case SP_FMT_STYLE_ATTR_ITALIC:    return sp_fmt_style_italic;
-    case SP_FMT_STYLE_ATTR_HYPERLINK: return sp_fmt_style_hyperlink;
-  }
-  SP_UNREACHABLE_RETURN(sp_fmt_style_none);
+const void* sp_ht_image_get_str(const sp_ht_image_t* image, sp_str_t key) {
+  const sp_ht_image_header_t* h = image->header;
+  if (!h || h->key_kind != SP_HT_IMAGE_KEY_STR) return SP_NULLPTR;
+  return sp_ht_image_find(image, sp_hash_fast(key.data, key.len, h->seed), key.data, key.len);
 }
 
-static const c8* sp_fmt_style_ansi(sp_fmt_style_t style) {
-  switch (style) {
-    case sp_fmt_style_black:      return SP_ANSI_FG_BLACK;
-    case sp_fmt_style_red:        return SP_ANSI_FG_RED;
-    case sp_fmt_style_green:      return SP_ANSI_FG_GREEN;
-    case sp_fmt_style_yellow:     return SP_ANSI_FG_YELLOW;
-    case sp_fmt_style_blue:       return SP_ANSI_FG_BLUE;
-    case sp_fmt_style_magenta:    return SP_ANSI_FG_MAGENTA;
-    case sp_fmt_style_cyan:       return SP_ANSI_FG_CYAN;
-    case sp_fmt_style_white:      return SP_ANSI_FG_WHITE;
-    case sp_fmt_style_gray:       return SP_ANSI_FG_BRIGHT_BLACK;
-    case sp_fmt_style_br_red:     return SP_ANSI_FG_BRIGHT_RED;
-    case sp_fmt_style_br_green:   return SP_ANSI_FG_BRIGHT_GREEN;
-    case sp_fmt_style_br_yellow:  return SP_ANSI_FG_BRIGHT_YELLOW;
-    case sp_fmt_style_br_blue:    return SP_ANSI_FG_BRIGHT_BLUE;
-    case sp_fmt_style_br_magenta: return SP_ANSI_FG_BRIGHT_MAGENTA;
-    case sp_fmt_style_br_cyan:    return SP_ANSI_FG_BRIGHT_CYAN;
-    case sp_fmt_style_br_white:   return SP_ANSI_FG_BRIGHT_WHITE;
-    case sp_fmt_style_bold:       return "\033[1m";
-    case sp_fmt_style_italic:     return "\033[3m";
-    case sp_fmt_style_none:
-    case sp_fmt_style_unset:
-    case sp_fmt_style_hyperlink:
-    case sp_fmt_style_quote:      return SP_NULLPTR;
-  }
-  return SP_NULLPTR;
+// @index_map @im
+void* sp_im_resize_array(sp_mem_t mem, void* ptr, u64 old_size, u64 size) {
+  return ptr ? sp_realloc(mem, ptr, old_size, size) : sp_alloc(mem, size);
 }
 
-static void sp_fmt_style_open(sp_io_writer_t* io, sp_fmt_style_t style, sp_fmt_arg_t* arg) {
-  const c8* ansi = sp_fmt_style_ansi(style);
-  if (ansi) {
-    sp_io_write_cstr(io, ansi, SP_NULLPTR);
-  }
-  else if (style == sp_fmt_style_hyperlink) {
-    sp_io_write_cstr(io, "\033]8;;", SP_NULLPTR);
-    if (arg->id == sp_fmt_id_str) sp_io_write_str(io, arg->value.s, SP_NULLPTR);
-    sp_io_write_cstr(io, "\033\\", SP_NULLPTR);
-  }
-  else if (style == sp_fmt_style_quote) {
-    sp_io_write_c8(io, '"');
+void sp_im_rebuild_slots(sp_im_header_t* im, u64 num_slots) {
+  sp_mem_t mem = im->info.allocator;
+  if (im->slots) sp_free(mem, im->slots, im->num_slots * sizeof(u32));
+  im->slots = (u32*)sp_alloc(mem, num_slots * sizeof(u32));
+  im->num_slots = num_slots;
+  sp_mem_fill_u8(im->slots, num_slots * sizeof(u32), 0xFF);
+
+  u64 mask = num_slots - 1;
+  for (u64 i = 0; i < im->size; i++) {
+    u64 slot = sp_ht_home(im->hashes[i], num_slots);
+    while (im->slots[slot] != SP_HT_INVALID_INDEX) slot = (slot + 1) & mask;
+    im->slots[slot] = (u32)i;
   }
 }
 
-static void sp_fmt_style_close(sp_io_writer_t* io, sp_fmt_style_t style) {
-  if (style == sp_fmt_style_quote) {
-    sp_io_write_c8(io, '"');
-  }
-  else if (style != sp_fmt_style_none && style != sp_fmt_style_unset) {
-    sp_io_write_cstr(io, SP_ANSI_RESET, SP_NULLPTR);
+u64 sp_im_find_slot(sp_im_header_t* im, void* key, sp_hash_t hash) {
+  if (!im->num_slots) return SP_HT_INVALID_INDEX;
+
+  u64 mask = im->num_slots - 1;
+  u64 slot = sp_ht_home(hash, im->num_slots);
+  while (im->slots[slot] != SP_HT_INVALID_INDEX) {
+    u32 idx = im->slots[slot];
+    if (im->hashes[idx] == hash) {
+      u8* candidate = (u8*)im->keys + idx * im->info.size.key;
+      if (im->info.fn.compare(candidate, key, im->info.size.key)) return slot;
+    }
+    slot = (slot + 1) & mask;
   }
+  return SP_HT_INVALID_INDEX;
 }
 
-bool sp_parse_u64_ex(sp_str_t str, u64* out) {
-  if (str.len == 0) return false;
+// Shift the rest of the probe run back into the hole, so the slot table never needs
+// tombstones; an entry moves back only if the hole isn't before its home slot.
+void sp_im_remove_slot(sp_im_header_t* im, u64 hole) {
+  u64 mask = im->num_slots - 1;
+  u64 next = (hole + 1) & mask;
+  while (im->slots[next] != SP_HT_INVALID_INDEX) {
+    u64 home = sp_ht_home(im->hashes[im->slots[next]], im->num_slots);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      im->slots[hole] = im->slots[next];
+      hole = next;
+    }
+    next = (next + 1) & mask;
+  }
+  im->slots[hole] = SP_HT_INVALID_INDEX;
+}
 
-  u64 result = 0;
-  for (u32 i = 0; i < str.len; i++) {
-    c8 ch = str.data[i];
-    if (ch < '0' || ch > '9') return false;
+void sp_im_reserve_impl(sp_im_header_t* im, u64 n) {
+  SP_ASSERT(n < SP_HT_INVALID_INDEX);
+  sp_mem_t mem = im->info.allocator;
 
-    u64 digit = ch - '0';
-    if (result > (UINT64_MAX - digit) / 10) return false; // overflow check
-    result = result * 10 + digit;
+  if (n > im->capacity) {
+    u64 capacity = sp_max(n, 8);
+    u64 ks = im->info.size.key;
+    u64 vs = im->info.size.value;
+    im->keys = sp_im_resize_array(mem, im->keys, im->capacity * ks, capacity * ks);
+    im->values = sp_im_resize_array(mem, im->values, im->capacity * vs, capacity * vs);
+    im->hashes = (sp_hash_t*)sp_im_resize_array(mem, im->hashes, im->capacity * sizeof(sp_hash_t), capacity * sizeof(sp_hash_t));
+    im->capacity = capacity;
   }
 
-  *out = result;
-  return true;
+  u64 num_slots = sp_max(im->num_slots, 8);
+  while (n * 4 > num_slots * 3) num_slots *= 2;
+  if (num_slots != im->num_slots) sp_im_rebuild_slots(im, num_slots);
 }
 
-bool sp_parse_s64_ex(sp_str_t str, s64* out) {
-  if (str.len == 0) return false;
+u64 sp_im_find_impl(sp_im_header_t* im, void* key) {
+  sp_hash_t hash = im->info.fn.hash(key, im->info.size.key);
+  u64 slot = sp_im_find_slot(im, key, hash);
+  return slot == SP_HT_INVALID_INDEX ? SP_HT_INVALID_INDEX : im->slots[slot];
+}
 
-  bool negative = false;
-  u32 start = 0;
+u64 sp_im_insert_impl(sp_im_header_t* im, void* key, void* value) {
+  u64 ks = im->info.size.key;
+  u64 vs = im->info.size.value;
+  sp_hash_t hash = im->info.fn.hash(key, ks);
 
-  if (str.data[0] == '-') {
-    negative = true;
-    start = 1;
-  } else if (str.data[0] == '+') {
-    start = 1;
+  u64 slot = sp_im_find_slot(im, key, hash);
+  u64 idx;
+  if (slot != SP_HT_INVALID_INDEX) {
+    idx = im->slots[slot];
   }
+  else {
+    // Reserving sizes the slot table for the whole capacity, so it only grows along with it
+    if (im->size == im->capacity) {
+      sp_im_reserve_impl(im, sp_max(im->capacity * 2, 8));
+    }
 
-  if (start >= str.len) return false;
+    idx = im->size++;
+    sp_mem_copy((u8*)im->keys + idx * ks, key, ks);
+    im->hashes[idx] = hash;
 
-  sp_str_t num_str = sp_str(str.data + start, str.len - start);
-  u64 abs_value;
-  if (!sp_parse_u64_ex(num_str, &abs_value)) return false;
+    u64 mask = im->num_slots - 1;
+    slot = sp_ht_home(hash, im->num_slots);
+    while (im->slots[slot] != SP_HT_INVALID_INDEX) slot = (slot + 1) & mask;
+    im->slots[slot] = (u32)idx;
+  }
 
-  if (negative) {
-    if (abs_value > (u64)INT64_MAX + 1) return false;
-    *out = (s64)(~abs_value + 1);
-  } else {
-    if (abs_value > INT64_MAX) return false; // overflow
-    *out = (s64)abs_value;
+  sp_mem_copy((u8*)im->values + idx * vs, value, vs);
+  return idx;
+}
+
+bool sp_im_erase_impl(sp_im_header_t* im, void* key) {
+  u64 ks = im->info.size.key;
+  u64 vs = im->info.size.value;
+  sp_hash_t hash = im->info.fn.hash(key, ks);
+
+  u64 slot = sp_im_find_slot(im, key, hash);
+  if (slot == SP_HT_INVALID_INDEX) return false;
+
+  u64 idx = im->slots[slot];
+  sp_im_remove_slot(im, slot);
+
+  // Swap-remove: point the last entry's slot at the hole, then move the entry into it
+  u64 last = im->size - 1;
+  if (idx != last) {
+    u64 mask = im->num_slots - 1;
+    u64 moved = sp_ht_home(im->hashes[last], im->num_slots);
+    while (im->slots[moved] != last) moved = (moved + 1) & mask;
+    im->slots[moved] = (u32)idx;
+
+    sp_mem_copy((u8*)im->keys + idx * ks, (u8*)im->keys + last * ks, ks);
+    sp_mem_copy((u8*)im->values + idx * vs, (u8*)im->values + last * vs, vs);
+    im->hashes[idx] = im->hashes[last];
   }
 
+  im->size--;
   return true;
 }
 
-bool sp_parse_u32_ex(sp_str_t str, u32* out) {
-  u64 val;
-  if (!sp_parse_u64_ex(str, &val)) return false;
-  if (val > UINT32_MAX) return false;
-  *out = (u32)val;
-  return true;
+void sp_im_clear_impl(sp_im_header_t* im, bool release) {
+  if (!release) {
+    im->size = 0;
+    if (im->slots) sp_mem_fill_u8(im->slots, im->num_slots * sizeof(u32), 0xFF);
+    return;
+  }
+
+  sp_mem_t mem = im->info.allocator;
+  if (im->keys) sp_free(mem, im->keys, im->capacity * im->info.size.key);
+  if (im->values) sp_free(mem, im->values, im->capacity * im->info.size.value);
+  if (im->hashes) sp_free(mem, im->hashes, im->capacity * sizeof(sp_hash_t));
+  if (im->slots) sp_free(mem, im->slots, im->num_slots * sizeof(u32));
+  im->keys = im->values = SP_NULLPTR;
+  im->hashes = SP_NULLPTR;
+  im->slots = SP_NULLPTR;
+  im->size = im->capacity = im->num_slots = 0;
+}
+
+// @hash_set @hs
+u64 sp_hs_find_slot(sp_hs_header_t* hs, void* key, sp_hash_t hash) {
+  if (!hs->capacity) return SP_HT_INVALID_INDEX;
+
+  u64 mask = hs->capacity - 1;
+  u8 tag = (u8)(hash & 0x7F);
+  u64 slot = sp_ht_home(hash, hs->capacity);
+  while (hs->ctrl[slot] != SP_HT_CTRL_EMPTY) {
+    if (hs->ctrl[slot] == tag) {
+      u8* candidate = (u8*)hs->keys + slot * hs->info.key_size;
+      if (hs->info.fn.compare(candidate, key, hs->info.key_size)) return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return SP_HT_INVALID_INDEX;
 }
 
-bool sp_parse_s32_ex(sp_str_t str, s32* out) {
-  s64 val;
-  if (!sp_parse_s64_ex(str, &val)) return false;
-  if (val < INT32_MIN || val > INT32_MAX) return false;
-  *out = (s32)val;
-  return true;
+// Place a key known not to be in the set into the first free slot of its probe run
+void sp_hs_place(sp_hs_header_t* hs, void* key, sp_hash_t hash) {
+  u64 mask = hs->capacity - 1;
+  u64 slot = sp_ht_home(hash, hs->capacity);
+  while (!(hs->ctrl[slot] & 0x80)) slot = (slot + 1) & mask;
+
+  if (hs->ctrl[slot] == SP_HT_CTRL_DELETED) hs->tombstones--;
+  hs->ctrl[slot] = (u8)(hash & 0x7F);
+  sp_mem_copy((u8*)hs->keys + slot * hs->info.key_size, key, hs->info.key_size);
+  hs->size++;
 }
 
-bool sp_parse_u16_ex(sp_str_t str, u16* out) {
-  u64 val;
-  if (!sp_parse_u64_ex(str, &val)) return false;
-  if (val > UINT16_MAX) return false;
-  *out = (u16)val;
-  return true;
+void sp_hs_rebuild(sp_hs_header_t* hs, u64 capacity) {
+  sp_mem_t mem = hs->info.allocator;
+  u64 ks = hs->info.key_size;
+  u8* keys = (u8*)hs->keys;
+  u8* ctrl = hs->ctrl;
+  u64 old_capacity = hs->capacity;
+
+  hs->keys = sp_alloc(mem, capacity * ks);
+  hs->ctrl = (u8*)sp_alloc(mem, capacity);
+  sp_mem_fill_u8(hs->ctrl, capacity, SP_HT_CTRL_EMPTY);
+  hs->capacity = capacity;
+  hs->size = 0;
+  hs->tombstones = 0;
+
+  for (u64 i = 0; i < old_capacity; i++) {
+    if (ctrl[i] & 0x80) continue;
+    void* key = keys + i * ks;
+    sp_hs_place(hs, key, hs->info.fn.hash(key, ks));
+  }
+
+  if (keys) sp_free(mem, keys, old_capacity * ks);
+  if (ctrl) sp_free(mem, ctrl, old_capacity);
 }
 
-bool sp_parse_s16_ex(sp_str_t str, s16* out) {
-  s64 val;
-  if (!sp_parse_s64_ex(str, &val)) return false;
-  if (val < INT16_MIN || val > INT16_MAX) return false;
-  *out = (s16)val;
-  return true;
+// An erased slot only needs a tombstone if a probe run continues past it
+void sp_hs_erase_slot(sp_hs_header_t* hs, u64 slot) {
+  u64 next = (slot + 1) & (hs->capacity - 1);
+  if (hs->ctrl[next] == SP_HT_CTRL_EMPTY) {
+    hs->ctrl[slot] = SP_HT_CTRL_EMPTY;
+  }
+  else {
+    hs->ctrl[slot] = SP_HT_CTRL_DELETED;
+    hs->tombstones++;
+  }
+  hs->size--;
 }
 
-bool sp_parse_u8_ex(sp_str_t str, u8* out) {
-  u64 val;
-  if (!sp_parse_u64_ex(str, &val)) return false;
-  if (val > UINT8_MAX) return false;
-  *out = (u8)val;
-  return true;
+u64 sp_hs_find_impl(sp_hs_header_t* hs, void* key) {
+  return sp_hs_find_slot(hs, key, hs->info.fn.hash(key, hs->info.key_size));
 }
 
-bool sp_parse_s8_ex(sp_str_t str, s8* out) {
-  s64 val;
-  if (!sp_parse_s64_ex(str, &val)) return false;
-  if (val < INT8_MIN || val > INT8_MAX) return false;
-  *out = (s8)val;
+bool sp_hs_insert_impl(sp_hs_header_t* hs, void* key) {
+  sp_hash_t hash = hs->info.fn.hash(key, hs->info.key_size);
+  if (sp_hs_find_slot(hs, key, hash) != SP_HT_INVALID_INDEX) return false;
+
+  // Rebuilding at the same capacity is enough when it's tombstones that filled the table
+  if ((hs->size + hs->tombstones + 1) * 4 > hs->capacity * 3) {
+    u64 capacity = sp_max(hs->capacity, 8);
+    while ((hs->size + 1) * 2 > capacity) capacity *= 2;
+    sp_hs_rebuild(hs, capacity);
+  }
+
+  sp_hs_place(hs, key, hash);
   return true;
 }
 
-bool sp_parse_is_digit(c8 c) {
-  return c >= '0' && c <= '9';
+bool sp_hs_erase_impl(sp_hs_header_t* hs, void* key) {
+  u64 slot = sp_hs_find_impl(hs, key);
+  if (slot == SP_HT_INVALID_INDEX) return false;
+  sp_hs_erase_slot(hs, slot);
+  return true;
 }
 
-bool sp_parse_f32_ex(sp_str_t str, f32* out) {
-  size_t i = 0;
-  int sign = 1;
-  f32 value = 0.0f;
-  f32 scale = 1.0f;
-  int exponent = 0;
-  int exp_sign = 1;
-  bool has_digits = false;
+void sp_hs_reserve_impl(sp_hs_header_t* hs, u64 n) {
+  if (n * 4 <= hs->capacity * 3) return;
 
-  if (i < str.len && (str.data[i] == '-' || str.data[i] == '+')) {
-    if (str.data[i] == '-') sign = -1;
-    i++;
+  u64 capacity = sp_max(hs->capacity, 8);
+  while (n * 4 > capacity * 3) capacity *= 2;
+  sp_hs_rebuild(hs, capacity);
+}
+
+void sp_hs_clear_impl(sp_hs_header_t* hs, bool release) {
+  if (!release) {
+    if (hs->ctrl) sp_mem_fill_u8(hs->ctrl, hs->capacity, SP_HT_CTRL_EMPTY);
+    hs->size = 0;
+    hs->tombstones = 0;
+    return;
   }
 
-  while (i < str.len && sp_parse_is_digit(str.data[i])) {
-    has_digits = true;
-    value = value * 10.0f + (f32)(str.data[i] - '0');
-    i++;
+  sp_mem_t mem = hs->info.allocator;
+  if (hs->keys) sp_free(mem, hs->keys, hs->capacity * hs->info.key_size);
+  if (hs->ctrl) sp_free(mem, hs->ctrl, hs->capacity);
+  hs->keys = SP_NULLPTR;
+  hs->ctrl = SP_NULLPTR;
+  hs->size = hs->capacity = hs->tombstones = 0;
+}
+
+u64 sp_hs_it_next_impl(sp_hs_header_t* hs, u64 it) {
+  while (it < hs->capacity && (hs->ctrl[it] & 0x80)) it++;
+  return it;
+}
+
+void sp_hs_union_impl(sp_hs_header_t* a, sp_hs_header_t* b) {
+  SP_ASSERT(a->info.key_size == b->info.key_size);
+  for (u64 i = sp_hs_it_next_impl(b, 0); i < b->capacity; i = sp_hs_it_next_impl(b, i + 1)) {
+    sp_hs_insert_impl(a, (u8*)b->keys + i * b->info.key_size);
   }
+}
 
-  if (i < str.len && str.data[i] == '.') {
-    i++;
-    while (i < str.len && sp_parse_is_digit(str.data[i])) {
-      has_digits = true;
-      scale /= 10.0f;
-      value += (f32)(str.data[i] - '0') * scale;
-      i++;
+void sp_hs_intersect_impl(sp_hs_header_t* a, sp_hs_header_t* b) {
+  SP_ASSERT(a->info.key_size == b->info.key_size);
+  for (u64 i = sp_hs_it_next_impl(a, 0); i < a->capacity; i = sp_hs_it_next_impl(a, i + 1)) {
+    if (sp_hs_find_impl(b, (u8*)a->keys + i * a->info.key_size) == SP_HT_INVALID_INDEX) {
+      sp_hs_erase_slot(a, i);
     }
   }
+}
 
-  if (i < str.len && (str.data[i] == 'e' || str.data[i] == 'E')) {
-    i++;
-    if (i < str.len && (str.data[i] == '-' || str.data[i] == '+')) {
-      if (str.data[i] == '-') exp_sign = -1;
-      i++;
+// Walk whichever set is smaller
+void sp_hs_difference_impl(sp_hs_header_t* a, sp_hs_header_t* b) {
+  SP_ASSERT(a->info.key_size == b->info.key_size);
+  if (b->size < a->size) {
+    for (u64 i = sp_hs_it_next_impl(b, 0); i < b->capacity; i = sp_hs_it_next_impl(b, i + 1)) {
+      sp_hs_erase_impl(a, (u8*)b->keys + i * b->info.key_size);
     }
-    if (i >= str.len || !sp_parse_is_digit(str.data[i])) {
-      return false;
-    }
-    while (i < str.len && sp_parse_is_digit(str.data[i])) {
-      exponent = exponent * 10 + (str.data[i] - '0');
-      i++;
+  }
+  else {
+    for (u64 i = sp_hs_it_next_impl(a, 0); i < a->capacity; i = sp_hs_it_next_impl(a, i + 1)) {
+      if (sp_hs_find_impl(b, (u8*)a->keys + i * a->info.key_size) != SP_HT_INVALID_INDEX) {
+        sp_hs_erase_slot(a, i);
+      }
     }
-    exponent *= exp_sign;
   }
+}
 
-  if (i != str.len || !has_digits) {
-    return false;
+// @mph
+u32 sp_mph_reduce(u64 x, u32 n) {
+  return (u32)(((x & 0xFFFFFFFFull) * n) >> 32);
+}
+
+u32 sp_mph_slot(u64 hash, u32 pilot, u32 n) {
+  return sp_mph_reduce(sp_hash_mix(hash, ((u64)pilot + 1) * 0x9E3779B97F4A7C15ull), n);
+}
+
+sp_err_t sp_mph_build_hashed(sp_mem_t mem, sp_mph_t* mph, u64* hashes, u32 n, u64 seed) {
+  u32 num_buckets = sp_max((n + SP_MPH_KEYS_PER_BUCKET - 1) / SP_MPH_KEYS_PER_BUCKET, 1);
+  u32* pilots = sp_alloc_n(mem, u32, num_buckets);
+  u32* starts = sp_alloc_n(mem, u32, num_buckets + 1);
+  u64* sorted = sp_alloc_n(mem, u64, sp_max(n, 1));
+  u64* taken = sp_alloc_n(mem, u64, (n + 63) / 64 + 1);
+  sp_err_t err = SP_OK;
+
+  // Counting sort the hashes by bucket
+  sp_for(i, n) {
+    starts[sp_mph_reduce(hashes[i] >> 32, num_buckets) + 1]++;
+  }
+  u32 max_bucket = 0;
+  sp_for(b, num_buckets) {
+    max_bucket = sp_max(max_bucket, starts[b + 1]);
+    starts[b + 1] += starts[b];
+  }
+  u32* cursor = sp_alloc_n(mem, u32, num_buckets);
+  sp_mem_copy(cursor, starts, num_buckets * sizeof(u32));
+  sp_for(i, n) {
+    sorted[cursor[sp_mph_reduce(hashes[i] >> 32, num_buckets)]++] = hashes[i];
   }
 
-  if (exponent > 0) {
-    for (int j = 0; j < exponent; j++) {
-      value *= 10.0f;
+  // ...and the buckets by size, largest first, since they're the hardest to place
+  u32* order = cursor;
+  u32* by_size = sp_alloc_n(mem, u32, max_bucket + 2);
+  sp_for(b, num_buckets) {
+    by_size[max_bucket - (starts[b + 1] - starts[b]) + 1]++;
+  }
+  sp_for(i, max_bucket + 1) {
+    by_size[i + 1] += by_size[i];
+  }
+  sp_for(b, num_buckets) {
+    order[by_size[max_bucket - (starts[b + 1] - starts[b])]++] = (u32)b;
+  }
+
+  u32* slots = sp_alloc_n(mem, u32, max_bucket + 1);
+  sp_for(it, num_buckets) {
+    u32 b = order[it];
+    u32 size = starts[b + 1] - starts[b];
+    if (!size) break;
+
+    const u64* bucket = sorted + starts[b];
+    sp_for(i, size) {
+      sp_for(j, i) {
+        if (bucket[i] == bucket[j]) {
+          err = SP_ERR;
+          goto done;
+        }
+      }
     }
-  } else if (exponent < 0) {
-    for (int j = 0; j < -exponent; j++) {
-      value /= 10.0f;
+
+    // Every key in the bucket has to land in a free slot, and not on another key in the bucket
+    for (u32 pilot = 0;; pilot++) {
+      if (pilot == UINT32_MAX) {
+        err = SP_ERR;
+        goto done;
+      }
+
+      u32 placed = 0;
+      for (; placed < size; placed++) {
+        u32 slot = sp_mph_slot(bucket[placed], pilot, n);
+        if (taken[slot / 64] & (1ull << (slot % 64))) break;
+        taken[slot / 64] |= 1ull << (slot % 64);
+        slots[placed] = slot;
+      }
+      if (placed == size) {
+        pilots[b] = pilot;
+        break;
+      }
+
+      sp_for(i, placed) {
+        taken[slots[i] / 64] &= ~(1ull << (slots[i] % 64));
+      }
     }
   }
 
-  *out = sign * value;
-  return true;
+done:
+  sp_free(mem, slots, (max_bucket + 1) * sizeof(u32));
+  sp_free(mem, by_size, (max_bucket + 2) * sizeof(u32));
+  sp_free(mem, cursor, num_buckets * sizeof(u32));
+  sp_free(mem, taken, ((n + 63) / 64 + 1) * sizeof(u64));
+  sp_free(mem, sorted, sp_max(n, 1) * sizeof(u64));
+  sp_free(mem, starts, (num_buckets + 1) * sizeof(u32));
+  if (err) {
+    sp_free(mem, pilots, num_buckets * sizeof(u32));
+    return err;
+  }
+
+  mph->seed = seed;
+  mph->num_keys = n;
+  mph->num_buckets = num_buckets;
+  mph->pilots = pilots;
+  mph->mem = mem;
+  return SP_OK;
 }
 
-bool sp_parse_f64_ex(sp_str_t str, f64* out) {
-  f32 hack = 0.0f;
-  bool result = sp_parse_f32_ex(str, &hack);
-  *out = hack;
-  return result;
+sp_err_t sp_mph_build(sp_mem_t mem, sp_mph_t* mph, const void* keys, u32 key_size, u32 n) {
+  *mph = sp_zero_s(sp_mph_t);
+  u64* hashes = sp_alloc_n(mem, u64, sp_max(n, 1));
+  sp_for(i, n) {
+    hashes[i] = sp_hash_fast((const u8*)keys + (u64)i * key_size, key_size, SP_HT_HASH_SEED);
+  }
+  sp_err_t err = sp_mph_build_hashed(mem, mph, hashes, n, SP_HT_HASH_SEED);
+  sp_free(mem, hashes, sp_max(n, 1) * sizeof(u64));
+  return err;
 }
 
-bool sp_parse_ptr_ex(sp_str_t str, void** out) {
-  u64 addr;
-  if (!sp_parse_hex_ex(str, &addr)) return false;
-  *out = (void*)(uintptr_t)addr;
-  return true;
+sp_err_t sp_mph_build_str(sp_mem_t mem, sp_mph_t* mph, const sp_str_t* keys, u32 n) {
+  *mph = sp_zero_s(sp_mph_t);
+  u64* hashes = sp_alloc_n(mem, u64, sp_max(n, 1));
+  sp_for(i, n) {
+    hashes[i] = sp_hash_fast(keys[i].data, keys[i].len, SP_HT_HASH_SEED);
+  }
+  sp_err_t err = sp_mph_build_hashed(mem, mph, hashes, n, SP_HT_HASH_SEED);
+  sp_free(mem, hashes, sp_max(n, 1) * sizeof(u64));
+  return err;
 }
 
-bool sp_parse_c8_ex(sp_str_t str, c8* out) {
-  // handle 'a' format
-  if (str.len == 3 && str.data[0] == '\'' && str.data[2] == '\'') {
-    *out = str.data[1];
-    return true;
-  }
-  // handle plain character
-  if (str.len == 1) {
-    *out = str.data[0];
-    return true;
+// Views from sp_mph_from_mem() have no allocator, since the caller owns their bytes
+void sp_mph_free(sp_mph_t* mph) {
+  if (mph->pilots && mph->mem.on_alloc) {
+    sp_free(mph->mem, (void*)mph->pilots, mph->num_buckets * sizeof(u32));
   }
-  return false;
+  *mph = sp_zero_s(sp_mph_t);
 }
 
-bool sp_parse_c16_ex(sp_str_t str, u16* out) {
-  // handle 'a' format
-  if (str.len == 3 && str.data[0] == '\'' && str.data[2] == '\'') {
-    *out = (u16)str.data[1];
-    return true;
+u32 sp_mph_index(const sp_mph_t* mph, const void* key, u64 size) {
+  if (!mph->num_keys) return 0;
+  u64 hash = sp_hash_fast(key, size, mph->seed);
+  u32 pilot = mph->pilots[sp_mph_reduce(hash >> 32, mph->num_buckets)];
+  return sp_mph_slot(hash, pilot, mph->num_keys);
+}
+
+u32 sp_mph_index_str(const sp_mph_t* mph, sp_str_t key) {
+  return sp_mph_index(mph, key.data, key.len);
+}
+
+u64 sp_mph_size(const sp_mph_t* mph) {
+  return mph->num_keys;
+}
+
+sp_err_t sp_mph_write(const sp_mph_t* mph, sp_io_writer_t* io) {
+  sp_mph_header_t header = {
+    .magic = SP_MPH_MAGIC,
+    .version = SP_MPH_VERSION,
+    .num_keys = mph->num_keys,
+    .num_buckets = mph->num_buckets,
+    .seed = mph->seed,
+  };
+  sp_try(sp_io_write_all(io, &header, sizeof(header), SP_NULLPTR));
+  sp_try(sp_io_write_all(io, mph->pilots, mph->num_buckets * sizeof(u32), SP_NULLPTR));
+  return sp_io_flush(io);
+}
+
+sp_err_t sp_mph_from_mem(sp_mph_t* mph, const void* data, u64 size) {
+  *mph = sp_zero_s(sp_mph_t);
+  if (!data || size < sizeof(sp_mph_header_t)) return SP_ERR;
+  if (sp_uptr(data) & (sizeof(u64) - 1)) return SP_ERR;
+
+  const sp_mph_header_t* h = (const sp_mph_header_t*)data;
+  if (h->magic != SP_MPH_MAGIC || h->version != SP_MPH_VERSION) return SP_ERR;
+  if (!h->num_buckets) return SP_ERR;
+  if (h->num_buckets > (size - sizeof(sp_mph_header_t)) / sizeof(u32)) return SP_ERR;
+
+  mph->seed = h->seed;
+  mph->num_keys = h->num_keys;
+  mph->num_buckets = h->num_buckets;
+  mph->pilots = (const u32*)(h + 1);
+  return SP_OK;
+}
+
+// @bloom
+static const u32 sp_bloom_salt [SP_BLOOM_BLOCK_WORDS] = {
+  0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+// e^-x for x >= 0, without libm: halve x until the Taylor series converges, then square back up
+f64 sp_bloom_exp_neg(f64 x) {
+  u32 squarings = 0;
+  while (x > 1.0 / 64) {
+    x /= 2;
+    squarings++;
   }
-  // handle 'U+XXXX' format
-  if (str.len >= 8 && str.data[0] == '\'' && str.data[1] == 'U' &&
-      str.data[2] == '+' && str.data[str.len-1] == '\'') {
-    sp_str_t hex_str = sp_str(str.data + 3, str.len - 4);
-    u64 val;
-    if (sp_parse_hex_ex(hex_str, &val) && val <= UINT16_MAX) {
-      *out = (u16)val;
-      return true;
-    }
+  f64 result = 1 - x + x * x / 2 - x * x * x / 6 + x * x * x * x / 24;
+  sp_for(i, squarings) {
+    result *= result;
   }
-  return false;
+  return result;
 }
 
-bool sp_parse_hex_ex(sp_str_t str, u64* out) {
-  if (str.len == 0) return false;
-
-  u32 start = 0;
+f64 sp_bloom_fp_rate(u64 num_blocks, u64 num_keys) {
+  if (!num_blocks) return 1.0;
 
-  // skip 0x prefix if present
-  if (str.len >= 2 && str.data[0] == '0' && (str.data[1] == 'x' || str.data[1] == 'X')) {
-    start = 2;
+  // The keys in a block are Poisson distributed; a block holding j keys has each bit of a
+  // word set with probability 1 - (31/32)^j, and a false positive needs all eight set
+  f64 lambda = (f64)num_keys / (f64)num_blocks;
+  f64 p = sp_bloom_exp_neg(lambda);
+  f64 clear = 1;
+  f64 rate = 0;
+  for (u64 j = 0; j < (u64)(lambda * 4) + 64; j++) {
+    if (j) {
+      p *= lambda / (f64)j;
+      clear *= 31.0 / 32.0;
+    }
+    f64 set = 1 - clear;
+    set *= set;
+    set *= set;
+    rate += p * set * set;
   }
+  return rate;
+}
 
-  if (start >= str.len) return false;
+void sp_bloom_init(sp_mem_t mem, sp_bloom_t* bloom, u64 num_keys, f64 fp_rate) {
+  *bloom = sp_zero_s(sp_bloom_t);
+  bloom->mem = mem;
+  bloom->seed = SP_HT_HASH_SEED;
 
-  u64 result = 0;
-  for (u32 i = start; i < str.len; i++) {
-    c8 ch = str.data[i];
-    u8 digit;
+  // Rates below the floor (or a NaN) would take the sizing loop to billions of blocks; a rate at
+  // or above one is met by any size, and gets the smallest filter
+  if (!(fp_rate >= SP_BLOOM_MIN_FP_RATE)) fp_rate = SP_BLOOM_MIN_FP_RATE;
 
-    if (ch >= '0' && ch <= '9') {
-      digit = ch - '0';
-    } else if (ch >= 'a' && ch <= 'f') {
-      digit = ch - 'a' + 10;
-    } else if (ch >= 'A' && ch <= 'F') {
-      digit = ch - 'A' + 10;
-    } else {
-      return false;
-    }
+  // Start around two bits a key and grow by a thirty-second until the rate is met
+  u64 num_blocks = sp_max(num_keys / 128, 1);
+  while (sp_bloom_fp_rate(num_blocks, num_keys) > fp_rate && num_blocks < (1ull << 32) - 1) {
+    num_blocks = sp_min(num_blocks + num_blocks / 32 + 1, (1ull << 32) - 1);
+  }
 
-    if (result > (UINT64_MAX >> 4)) return false; // overflow check
-    result = (result << 4) | digit;
+  // Each block is half a cache line; keep them from straddling two
+  u64 block_size = SP_BLOOM_BLOCK_WORDS * sizeof(u32);
+  bloom->num_blocks = num_blocks;
+  bloom->storage = sp_alloc(mem, num_blocks * block_size + block_size);
+  if (!bloom->storage) return;
+  bloom->blocks = (u32*)(uintptr_t)sp_align_offset(sp_uptr(bloom->storage), block_size);
+}
+
+void sp_bloom_free(sp_bloom_t* bloom) {
+  if (bloom->storage) {
+    u64 block_size = SP_BLOOM_BLOCK_WORDS * sizeof(u32);
+    sp_free(bloom->mem, bloom->storage, bloom->num_blocks * block_size + block_size);
   }
+  *bloom = sp_zero_s(sp_bloom_t);
+}
 
-  *out = result;
-  return true;
+void sp_bloom_clear(sp_bloom_t* bloom) {
+  SP_ASSERT(bloom->storage);
+  sp_mem_zero(bloom->blocks, bloom->num_blocks * SP_BLOOM_BLOCK_WORDS * sizeof(u32));
 }
 
-bool sp_parse_hash_ex(sp_str_t str, sp_hash_t* out) {
-  return sp_parse_hex_ex(str, out);
+u32* sp_bloom_block(const sp_bloom_t* bloom, sp_hash_t hash) {
+  u64 index = ((hash >> 32) * bloom->num_blocks) >> 32;
+  return bloom->blocks + index * SP_BLOOM_BLOCK_WORDS;
 }
 
-bool sp_parse_bool_ex(sp_str_t str, bool* out) {
-  if (sp_str_equal(str, sp_str_lit("true")) || sp_str_equal(str, sp_str_lit("1"))) {
-    *out = true;
-    return true;
+void sp_bloom_insert_hash(sp_bloom_t* bloom, sp_hash_t hash) {
+  SP_ASSERT(bloom->storage);
+  u32* block = sp_bloom_block(bloom, hash);
+  u32 x = (u32)hash;
+  sp_for(i, SP_BLOOM_BLOCK_WORDS) {
+    block[i] |= 1u << ((x * sp_bloom_salt[i]) >> 27);
   }
-  if (sp_str_equal(str, sp_str_lit("false")) || sp_str_equal(str, sp_str_lit("0"))) {
-    *out = false;
-    return true;
+}
+
+bool sp_bloom_contains_hash(const sp_bloom_t* bloom, sp_hash_t hash) {
+  const u32* block = sp_bloom_block(bloom, hash);
+  u32 x = (u32)hash;
+  u32 missing = 0;
+  sp_for(i, SP_BLOOM_BLOCK_WORDS) {
+    u32 bit = 1u << ((x * sp_bloom_salt[i]) >> 27);
+    missing |= bit & ~block[i];
   }
-  return false;
+  return !missing;
 }
 
-u8 sp_parse_u8(sp_str_t str) {
-  u8 value = sp_zero;
-  sp_parse_u8_ex(str, &value);
-  return value;
+void sp_bloom_insert(sp_bloom_t* bloom, const void* key, u64 size) {
+  sp_bloom_insert_hash(bloom, sp_hash_fast(key, size, bloom->seed));
 }
 
-u16 sp_parse_u16(sp_str_t str) {
-  u16 value = sp_zero;
-  sp_parse_u16_ex(str, &value);
-  return value;
+void sp_bloom_insert_str(sp_bloom_t* bloom, sp_str_t key) {
+  sp_bloom_insert_hash(bloom, sp_hash_fast(key.data, key.len, bloom->seed));
 }
 
-u32 sp_parse_u32(sp_str_t str) {
-  u32 value = sp_zero;
-  sp_parse_u32_ex(str, &value);
-  return value;
+bool sp_bloom_contains(const sp_bloom_t* bloom, const void* key, u64 size) {
+  return sp_bloom_contains_hash(bloom, sp_hash_fast(key, size, bloom->seed));
 }
 
-u64 sp_parse_u64(sp_str_t str) {
-  u64 value = sp_zero;
-  sp_parse_u64_ex(str, &value);
-  return value;
+bool sp_bloom_contains_str(const sp_bloom_t* bloom, sp_str_t key) {
+  return sp_bloom_contains_hash(bloom, sp_hash_fast(key.data, key.len, bloom->seed));
 }
 
-s8 sp_parse_s8(sp_str_t str) {
-  s8 value = sp_zero;
-  sp_parse_s8_ex(str, &value);
-  return value;
+sp_err_t sp_bloom_merge(sp_bloom_t* bloom, const sp_bloom_t* other) {
+  SP_ASSERT(bloom->storage);
+  if (bloom->num_blocks != other->num_blocks || bloom->seed != other->seed) return SP_ERR;
+
+  u64 num_words = bloom->num_blocks * SP_BLOOM_BLOCK_WORDS;
+  sp_for(i, num_words) {
+    bloom->blocks[i] |= other->blocks[i];
+  }
+  return SP_OK;
 }
 
-s16 sp_parse_s16(sp_str_t str) {
-  s16 value = sp_zero;
-  sp_parse_s16_ex(str, &value);
-  return value;
+sp_err_t sp_bloom_write(const sp_bloom_t* bloom, sp_io_writer_t* io) {
+  sp_bloom_header_t header = {
+    .magic = SP_BLOOM_MAGIC,
+    .version = SP_BLOOM_VERSION,
+    .num_blocks = bloom->num_blocks,
+    .seed = bloom->seed,
+  };
+  sp_try(sp_io_write_all(io, &header, sizeof(header), SP_NULLPTR));
+  sp_try(sp_io_write_all(io, bloom->blocks, bloom->num_blocks * SP_BLOOM_BLOCK_WORDS * sizeof(u32), SP_NULLPTR));
+  return sp_io_flush(io);
 }
 
-s32 sp_parse_s32(sp_str_t str) {
-  s32 value = sp_zero;
-  sp_parse_s32_ex(str, &value);
-  return value;
+sp_err_t sp_bloom_from_mem(sp_bloom_t* bloom, const void* data, u64 size) {
+  *bloom = sp_zero_s(sp_bloom_t);
+  if (!data || size < sizeof(sp_bloom_header_t)) return SP_ERR;
+  if (sp_uptr(data) & (sizeof(u64) - 1)) return SP_ERR;
+
+  const sp_bloom_header_t* h = (const sp_bloom_header_t*)data;
+  if (h->magic != SP_BLOOM_MAGIC || h->version != SP_BLOOM_VERSION) return SP_ERR;
+  if (!h->num_blocks || h->num_blocks >= (1ull << 32)) return SP_ERR;
+  if (h->num_blocks > (size - sizeof(sp_bloom_header_t)) / (SP_BLOOM_BLOCK_WORDS * sizeof(u32))) return SP_ERR;
+
+  bloom->blocks = (u32*)(h + 1);
+  bloom->num_blocks = h->num_blocks;
+  bloom->seed = h->seed;
+  return SP_OK;
 }
 
-s64 sp_parse_s64(sp_str_t str) {
-  s64 value = sp_zero;
-  sp_parse_s64_ex(str, &value);
-  return value;
+
+//  ██████████   █████ █████ ██████   █████      █████████   ███████████   ███████████     █████████   █████ █████
+// ░░███░░░░███ ░░███ ░░███ ░░██████ ░░███      ███░░░░░███ ░░███░░░░░███ ░░███░░░░░███   ███░░░░░███ ░░███ ░░███
+//  ░███   ░░███ ░░███ ███   ░███░███ ░███     ░███    ░███  ░███    ░███  ░███    ░███  ░███    ░███  ░░███ ███
+//  ░███    ░███  ░░█████    ░███░░███░███     ░███████████  ░██████████   ░██████████   ░███████████   ░░█████
+//  ░███    ░███   ░░███     ░███ ░░██████     ░███░░░░░███  ░███░░░░░███  ░███░░░░░███  ░███░░░░░███    ░░███
+//  ░███    ███     ░███     ░███  ░░█████     ░███    ░███  ░███    ░███  ░███    ░███  ░███    ░███     ░███
+//  ██████████      █████    █████  ░░█████    █████   █████ █████   █████ █████   █████ █████   █████    █████
+// ░░░░░░░░░░      ░░░░░    ░░░░░    ░░░░░    ░░░░░   ░░░░░ ░░░░░   ░░░░░ ░░░░░   ░░░░░ ░░░░░   ░░░░░    ░░░░░
+// @array @dyn_array @da
+void* sp_da_resize(void* arr, u32 stride, u64 cap) {
+  sp_assert(arr);
+
+  cap = sp_max(cap, 4);
+  sp_da_header_t* header = sp_da_head(arr);
+  u64 old_size = header->capacity * stride + sizeof(sp_da_header_t);
+  header = sp_cast(sp_da_header_t*, sp_realloc(header->allocator, header, old_size, cap * stride + sizeof(sp_da_header_t)));
+
+  if (!header) return SP_NULLPTR;
+
+  header->capacity = cap;
+  return header + 1;
 }
 
-f32 sp_parse_f32(sp_str_t str) {
-  f32 value = sp_zero;
-  sp_parse_f32_ex(str, &value);
-  return value;
+void* sp_da_grow_ex(void* arr, u32 stride, u64 n) {
+  sp_assert(arr);
+
+  u64 required = sp_da_size(arr) + n;
+  if (required <= sp_da_capacity(arr)) return arr;
+
+  u64 cap = sp_da_capacity(arr) * 2;
+  cap = sp_max(cap, required);
+  return sp_da_resize(arr, stride, cap);
 }
 
-f64 sp_parse_f64(sp_str_t str) {
-  f64 value = sp_zero;
-  sp_parse_f64_ex(str, &value);
-  return value;
+void sp_da_push_ex(void** arr, void* val, u32 stride) {
+  *arr = sp_da_grow_ex(*arr, stride, 1);
+  if (*arr) {
+    sp_mem_copy(((u8*)(*arr)) + sp_da_size(*arr) * stride, val, stride);
+    sp_da_head(*arr)->size++;
+  }
 }
 
-c8 sp_parse_c8(sp_str_t str) {
-  c8 value = sp_zero;
-  sp_parse_c8_ex(str, &value);
-  return value;
+void* sp_da_push_n_ex(void* arr, const void* vals, u32 stride, u64 n) {
+  return sp_da_insert_n_ex(arr, sp_da_size(arr), vals, stride, n);
 }
 
-u16 sp_parse_c16(sp_str_t str) {
-  u16 value = sp_zero;
-  sp_parse_c16_ex(str, &value);
-  return value;
+void* sp_da_insert_n_ex(void* arr, u64 at, const void* vals, u32 stride, u64 n) {
+  sp_assert(arr);
+  sp_assert(at <= sp_da_size(arr));
+  if (!n) return arr;
+
+  // Values from inside the array are found again by offset, since growing may move it
+  u64 bytes = n * stride;
+  u64 used = sp_da_size(arr) * stride;
+  u64 offset = (u8*)vals - (u8*)arr;
+  bool aliased = vals && (u8*)vals >= (u8*)arr && offset < used;
+
+  // sp_da_resize goes through SP_ALLOCATOR_MODE_RESIZE, so allocators that can extend
+  // in place (e.g. an arena whose top allocation is this array) never copy here
+  arr = sp_da_grow_ex(arr, stride, n);
+  if (!arr) return SP_NULLPTR;
+
+  sp_da_header_t* header = sp_da_head(arr);
+  u8* base = (u8*)arr;
+  u8* dst = base + at * stride;
+  sp_mem_move(dst + bytes, dst, (header->size - at) * stride);
+  if (aliased) {
+    // Values before the insertion point stayed put, the rest moved up past the gap
+    u64 split = at * stride;
+    u64 below = offset < split ? sp_min(split - offset, bytes) : 0;
+    sp_mem_copy(dst, base + offset, below);
+    sp_mem_copy(dst + below, base + offset + below + bytes, bytes - below);
+  }
+  else if (vals) {
+    sp_mem_copy(dst, vals, bytes);
+  }
+  else {
+    sp_mem_zero(dst, bytes);
+  }
+
+  header->size += n;
+  return arr;
 }
 
-u64 sp_parse_hex(sp_str_t str) {
-  u64 value = sp_zero;
-  sp_parse_hex_ex(str, &value);
-  return value;
+void sp_da_insert_back_ex(void* arr, u64 at, u32 stride) {
+  sp_assert(arr);
+  sp_da_header_t* header = sp_da_head(arr);
+  sp_assert(at <= header->size && header->size < header->capacity);
+
+  u8 buffer [64];
+  sp_mem_arena_marker_t scratch = sp_zero_s(sp_mem_arena_marker_t);
+  u8* tmp = buffer;
+  if (stride > sizeof(buffer)) {
+    scratch = sp_mem_begin_scratch();
+    tmp = sp_alloc_n(scratch.mem, u8, stride);
+  }
+
+  u8* dst = (u8*)arr + at * stride;
+  sp_mem_copy(tmp, (u8*)arr + header->size * stride, stride);
+  sp_mem_move(dst + stride, dst, (header->size - at) * stride);
+  sp_mem_copy(dst, tmp, stride);
+  header->size++;
+
+  if (tmp != buffer) sp_mem_end_scratch(scratch);
 }
 
-void* sp_parse_ptr(sp_str_t str) {
-  void* value = sp_zero;
-  sp_parse_ptr_ex(str, &value);
-  return value;
+void sp_da_erase_range_ex(void* arr, u64 at, u64 n, u32 stride) {
+  if (!arr || !n) return;
+
+  sp_da_header_t* header = sp_da_head(arr);
+  sp_assert(at <= header->size && n <= header->size - at);
+
+  u8* dst = (u8*)arr + at * stride;
+  sp_mem_move(dst, dst + n * stride, (header->size - at - n) * stride);
+  header->size -= n;
 }
 
-bool sp_parse_bool(sp_str_t str) {
-  bool value = sp_zero;
-  sp_parse_bool_ex(str, &value);
-  return value;
+void* sp_da_init_ex(sp_mem_t mem, u32 stride) {
+  u32 cap = 4;
+  sp_da_header_t* head = (sp_da_header_t*)sp_alloc(mem, cap * stride + sizeof(sp_da_header_t));
+  *head = (sp_da_header_t) {
+    .size = 0,
+    .capacity = cap,
+    .allocator = mem,
+  };
+
+  return head + 1;
 }
 
-sp_hash_t sp_parse_hash(sp_str_t str) {
-  sp_hash_t value = sp_zero;
-  sp_parse_hash_ex(str, &value);
-  return value;
+bool sp_sa_grow_ex(sp_sa_header_t* sa, void* items, u32 inline_capacity, u32 stride, u32 n) {
+  u64 required = (u64)sa->size + n;
+  u64 capacity = sa->heap ? sa->capacity : inline_capacity;
+  if (required <= capacity) return true;
+
+  sp_assert(sa->mem.on_alloc);
+  sp_assert(required <= 0xFFFFFFFF);
+
+  u64 cap = sp_min(sp_max(capacity * 2, required), 0xFFFFFFFF);
+  void* heap = SP_NULLPTR;
+  if (sa->heap) {
+    heap = sp_realloc(sa->mem, sa->heap, capacity * stride, cap * stride);
+  }
+  else {
+    heap = sp_alloc(sa->mem, cap * stride);
+    if (heap) sp_mem_copy(heap, items, (u64)sa->size * stride);
+  }
+
+  if (!heap) return false;
+  sa->heap = heap;
+  sa->capacity = (u32)cap;
+  return true;
 }
 
+void sp_sa_free_ex(sp_sa_header_t* sa, u32 stride) {
+  if (sa->heap) {
+    sp_mem_allocator_free(sa->mem, sa->heap, (u64)sa->capacity * stride);
+  }
 
-//  █████          ███████      █████████
-// ░░███         ███░░░░░███   ███░░░░░███
-//  ░███        ███     ░░███ ███     ░░░
-//  ░███       ░███      ░███░███
-//  ░███       ░███      ░███░███    █████
-//  ░███      █░░███     ███ ░░███  ░░███
-//  ███████████ ░░░███████░   ░░█████████
-// ░░░░░░░░░░░    ░░░░░░░      ░░░░░░░░░
-// @log
+  sa->heap = SP_NULLPTR;
+  sa->capacity = 0;
+  sa->size = 0;
+}
 
+void* sp_chunk_array_init_ex(sp_mem_t mem, u32 stride, u32 chunk_len) {
+  if (!chunk_len) chunk_len = sp_max(SP_CHUNK_ARRAY_CHUNK_BYTES / stride, 1);
 
-//  ██████╗ ██████╗ ███╗   ██╗████████╗███████╗██╗  ██╗████████╗
-// ██╔════╝██╔═══██╗████╗  ██║╚══██╔══╝██╔════╝╚██╗██╔╝╚══██╔══╝
-// ██║     ██║   ██║██╔██╗ ██║   ██║   █████╗   ╚███╔╝    ██║
-// ██║     ██║   ██║██║╚██╗██║   ██║   ██╔══╝   ██╔██╗    ██║
-// ╚██████╗╚██████╔╝██║ ╚████║   ██║   ███████╗██╔╝ ██╗   ██║
-//  ╚═════╝ ╚═════╝ ╚═╝  ╚═══╝   ╚═╝   ╚══════╝╚═╝  ═╝   ╚═╝
-//  @context
-SP_PRIVATE void sp_tls_rt_deinit(void *data);
-SP_PRIVATE void sp_rt_init();
+  u32 shift = 0;
+  while (((u64)2 << shift) <= chunk_len) shift++;
 
-sp_mem_arena_t* sp_tls_rt_get_scratch_arena(sp_tls_rt_t* tls) {
-  return tls->scratch[0];
+  u32 capacity = 4;
+  sp_chunk_array_header_t* head = (sp_chunk_array_header_t*)sp_alloc(mem, sizeof(sp_chunk_array_header_t) + capacity * sizeof(void*));
+  *head = (sp_chunk_array_header_t) {
+    .size = 0,
+    .num_chunks = 0,
+    .capacity = capacity,
+    .shift = shift,
+    .stride = stride,
+    .allocator = mem,
+  };
+
+  return head + 1;
 }
 
-sp_mem_arena_t* sp_tls_rt_get_scratch_arena_for(sp_tls_rt_t* tls, sp_mem_t mem) {
-  sp_carr_for(tls->scratch, it) {
-    sp_mem_t arena = sp_mem_arena_as_allocator(tls->scratch[it]);
-    if (arena.on_alloc != mem.on_alloc || arena.user_data != mem.user_data) {
-      return tls->scratch[it];
-    }
+bool sp_chunk_array_grow_ex(void** arr, u64 n) {
+  sp_assert(arr && *arr);
+
+  sp_chunk_array_header_t* head = sp_chunk_array_head(*arr);
+  u64 chunk_len = (u64)1 << head->shift;
+  u64 required = (head->size + n + chunk_len - 1) >> head->shift;
+  if (required <= head->num_chunks) return true;
+
+  // Only the directory of chunk pointers is ever reallocated; the elements stay put. The
+  // handle is updated as soon as the directory moves, so a failure after that leaves it valid.
+  if (required > head->capacity) {
+    u64 capacity = sp_max((u64)head->capacity * 2, required);
+    sp_assert(capacity <= 0xFFFFFFFF);
+    u64 old_size = sizeof(sp_chunk_array_header_t) + head->capacity * sizeof(void*);
+    u64 new_size = sizeof(sp_chunk_array_header_t) + capacity * sizeof(void*);
+    sp_chunk_array_header_t* grown = (sp_chunk_array_header_t*)sp_realloc(head->allocator, head, old_size, new_size);
+    if (!grown) return false;
+
+    head = grown;
+    head->capacity = (u32)capacity;
+    *arr = head + 1;
   }
 
-  sp_unreachable_return(SP_NULLPTR);
+  void** chunks = (void**)*arr;
+  while (head->num_chunks < required) {
+    void* chunk = sp_alloc(head->allocator, chunk_len * head->stride);
+    if (!chunk) return false;
+    chunks[head->num_chunks++] = chunk;
+  }
+
+  return true;
 }
 
+void sp_chunk_array_free_ex(void* arr) {
+  if (!arr) return;
 
-void sp_rt_init() {
-  sp_tls_new(&sp_rt.tls.key, sp_tls_rt_deinit);
-  sp_mutex_init(&sp_rt.mutex, SP_MUTEX_PLAIN);
-#if defined(SP_WIN32)
-  sp_nt_load();
-#endif
+  sp_chunk_array_header_t* head = sp_chunk_array_head(arr);
+  u64 chunk_bytes = ((u64)1 << head->shift) * head->stride;
+  void** chunks = (void**)arr;
+  sp_for(it, head->num_chunks) {
+    sp_mem_allocator_free(head->allocator, chunks[it], chunk_bytes);
+  }
+
+  sp_mem_allocator_free(head->allocator, head, sizeof(sp_chunk_array_header_t) + head->capacity * sizeof(void*));
 }
 
-void sp_tls_rt_deinit(void* ptr) {
-  if (!ptr) return;
-  sp_tls_rt_t* tls = (sp_tls_rt_t*)ptr;
-  if (tls->std.out) sp_mem_allocator_free(tls->mem.heap, tls->std.out, sizeof(sp_io_stream_writer_t));
-  if (tls->std.err) sp_mem_allocator_free(tls->mem.heap, tls->std.err, sizeof(sp_io_stream_writer_t));
-  sp_carr_for(tls->scratch, it) {
-    sp_mem_arena_destroy(tls->scratch[it]);
+void sp_soa_init_ex(sp_mem_t mem, sp_soa_t* soa, const u32* strides, u32 num_columns) {
+  *soa = (sp_soa_t) {
+    .size = 0,
+    .capacity = 0,
+    .mem = mem,
+    .strides = strides,
+    .num_columns = num_columns,
+  };
+}
+
+void sp_soa_free_ex(sp_soa_t* soa, void** columns) {
+  sp_for(c, soa->num_columns) {
+    if (columns[c]) {
+      sp_mem_allocator_free(soa->mem, columns[c], soa->capacity * soa->strides[c]);
+    }
+    columns[c] = SP_NULLPTR;
   }
-  sp_mem_heap_destroy(tls->allocators.heap);
-  sp_sys_free(tls, sizeof(sp_tls_rt_t));
+
+  soa->size = 0;
+  soa->capacity = 0;
 }
 
-sp_tls_rt_t* sp_tls_rt_get() {
-  sp_tls_once(&sp_rt.tls.once, sp_rt_init);
+bool sp_soa_reserve_ex(sp_soa_t* soa, void** columns, u64 capacity) {
+  if (capacity <= soa->capacity) return true;
 
-  sp_tls_rt_t* tls = (sp_tls_rt_t*)sp_tls_get(sp_rt.tls.key);
-  if (!tls) {
-    // It's important that you bootstrap the allocator and set the TLS key
-    // before doing anything else so you can call functions that allocate
-    // while initializing the other TLS stuff.
-    tls = sp_sys_alloc_type(sp_tls_rt_t);
-    tls->allocators.heap = sp_mem_heap_new();
-    tls->mem.heap = sp_mem_heap_as_allocator(tls->allocators.heap);
-    tls->mem.page = sp_mem_os_new();
-    sp_tls_set(sp_rt.tls.key, tls);
+  // Each column is its own allocation, so every one can be resized in place. If one fails,
+  // undo the ones already grown so they all agree with soa->capacity again: columns that
+  // were empty are freed, and the rest are shrunk back. A failed shrink keeps the grown
+  // block, which still holds every row.
+  sp_for(c, soa->num_columns) {
+    u32 stride = soa->strides[c];
+    void* column = columns[c] ?
+      sp_realloc(soa->mem, columns[c], soa->capacity * stride, capacity * stride) :
+      sp_alloc(soa->mem, capacity * stride);
 
-    sp_carr_for(tls->scratch, it) {
-      tls->scratch[it] = sp_mem_arena_new(tls->mem.page);
+    if (!column) {
+      sp_for(undo, c) {
+        u32 undo_stride = soa->strides[undo];
+        if (!soa->capacity) {
+          sp_free(soa->mem, columns[undo], capacity * undo_stride);
+          columns[undo] = SP_NULLPTR;
+          continue;
+        }
+
+        void* shrunk = sp_realloc(soa->mem, columns[undo], capacity * undo_stride, soa->capacity * undo_stride);
+        if (shrunk) columns[undo] = shrunk;
+      }
+      return false;
     }
-    // std.out/std.err are wired lazily (see sp_tls_std_out/_err). Wiring them here
-    // would take the address of sp_io_stream_writer_write in code that sp_main always
-    // reaches, which on WASM forces a fd_write import even for programs that never write.
-    sp_sys_tls_init(tls);
+
+    columns[c] = column;
   }
-  return tls;
+
+  soa->capacity = capacity;
+  return true;
 }
 
-sp_io_writer_t* sp_tls_std_out(sp_tls_rt_t* tls) {
-  if (!tls->std.out) {
-    tls->std.out = sp_alloc_type(tls->mem.heap, sp_io_stream_writer_t);
-    sp_io_stream_writer_from_fd(tls->std.out, sp_sys_stdout, SP_IO_CLOSE_MODE_NONE);
+u64 sp_soa_push_n_ex(sp_soa_t* soa, void** columns, u64 n) {
+  u64 required = soa->size + n;
+  if (required > soa->capacity) {
+    u64 capacity = sp_max(sp_max(soa->capacity * 2, required), 4);
+    if (!sp_soa_reserve_ex(soa, columns, capacity)) return SP_SOA_INVALID_INDEX;
   }
-  return &tls->std.out->base;
-}
 
-sp_io_writer_t* sp_tls_std_err(sp_tls_rt_t* tls) {
-  if (!tls->std.err) {
-    tls->std.err = sp_alloc_type(tls->mem.heap, sp_io_stream_writer_t);
-    sp_io_stream_writer_from_fd(tls->std.err, sp_sys_stderr, SP_IO_CLOSE_MODE_NONE);
+  u64 it = soa->size;
+  sp_for(c, soa->num_columns) {
+    sp_mem_zero((u8*)columns[c] + it * soa->strides[c], n * soa->strides[c]);
   }
-  return &tls->std.err->base;
+
+  soa->size = required;
+  return it;
 }
 
-#if defined(SP_FREESTANDING)
-void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
+void sp_soa_erase_range_ex(sp_soa_t* soa, void** columns, u64 at, u64 n) {
+  if (!n) return;
+  sp_assert(at <= soa->size && n <= soa->size - at);
 
-}
+  u64 tail = soa->size - at - n;
+  sp_for(c, soa->num_columns) {
+    u32 stride = soa->strides[c];
+    u8* dst = (u8*)columns[c] + at * stride;
+    sp_mem_move(dst, dst + n * stride, tail * stride);
+  }
 
-void* sp_tls_get(sp_tls_key_t key) {
-  sp_tls_block_t* tb = (sp_tls_block_t*)sp_sys_get_tp();
-  return tb ? tb->data : 0;
+  soa->size -= n;
 }
 
-void sp_tls_set(sp_tls_key_t key, void* data) {
-  sp_tls_block_t* tb = (sp_tls_block_t*)sp_sys_get_tp();
-  if (tb) tb->data = data;
-}
+void sp_soa_swap_remove_ex(sp_soa_t* soa, void** columns, u64 it) {
+  sp_assert(it < soa->size);
 
-void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
+  u64 last = soa->size - 1;
+  if (it != last) {
+    sp_for(c, soa->num_columns) {
+      u32 stride = soa->strides[c];
+      u8* column = (u8*)columns[c];
+      sp_mem_copy(column + it * stride, column + last * stride, stride);
+    }
+  }
 
+  soa->size = last;
 }
 
-#elif defined(SP_WASM)
-void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
-  (void)key; (void)on_deinit;
+void sp_soa_swap_ex(sp_soa_t* soa, void** columns, u64 a, u64 b) {
+  sp_assert(a < soa->size && b < soa->size);
+  if (a == b) return;
+
+  u8 scratch [64];
+  sp_for(c, soa->num_columns) {
+    u32 stride = soa->strides[c];
+    u8* pa = (u8*)columns[c] + a * stride;
+    u8* pb = (u8*)columns[c] + b * stride;
+    for (u32 offset = 0; offset < stride; offset += sizeof(scratch)) {
+      u32 len = sp_min(stride - offset, (u32)sizeof(scratch));
+      sp_mem_copy(scratch, pa + offset, len);
+      sp_mem_copy(pa + offset, pb + offset, len);
+      sp_mem_copy(pb + offset, scratch, len);
+    }
+  }
 }
 
-void* sp_tls_get(sp_tls_key_t key) {
-  sp_unused(key);
-  return sp_tls_block.data;
+u32 sp_sort_log2(u64 n) {
+  u32 log = 0;
+  while (n >>= 1) log++;
+  return log;
 }
 
-void sp_tls_set(sp_tls_key_t key, void* data) {
-  sp_unused(key);
-  sp_tls_block.data = data;
+bool sp_sort_less(sp_sort_t* sort, u64 i, u64 j) {
+  return sort->cmp(sort->data + i * sort->stride, sort->data + j * sort->stride) < 0;
 }
 
-void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
-  if (*once) return;
-  fn();
-  *once = 1;
-}
+// Elements are usually a handful of bytes, where three memcpy calls cost more than the swap
+void sp_sort_swap(sp_sort_t* sort, u64 i, u64 j) {
+  u8* a = sort->data + i * sort->stride;
+  u8* b = sort->data + j * sort->stride;
+  if (sort->stride > 16) {
+    sp_mem_copy(sort->tmp, a, sort->stride);
+    sp_mem_copy(a, b, sort->stride);
+    sp_mem_copy(b, sort->tmp, sort->stride);
+    return;
+  }
 
-#elif defined(SP_WIN32)
-void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
-  SP_UNUSED(on_deinit);
-  *key = TlsAlloc();
+  sp_for(it, sort->stride) {
+    u8 byte = a[it];
+    a[it] = b[it];
+    b[it] = byte;
+  }
 }
 
-void* sp_tls_get(sp_tls_key_t key) {
-  return TlsGetValue(key);
+void sp_sort_sort3(sp_sort_t* sort, u64 i, u64 j, u64 k) {
+  if (sp_sort_less(sort, j, i)) sp_sort_swap(sort, i, j);
+  if (sp_sort_less(sort, k, j)) sp_sort_swap(sort, j, k);
+  if (sp_sort_less(sort, j, i)) sp_sort_swap(sort, i, j);
 }
 
-void sp_tls_set(sp_tls_key_t key, void* data) {
-  TlsSetValue(key, data);
+// Moves the element at `from` down to `to`, shifting everything in between up by one
+void sp_sort_rotate(sp_sort_t* sort, u64 to, u64 from) {
+  u64 stride = sort->stride;
+  sp_mem_copy(sort->tmp, sort->data + from * stride, stride);
+  sp_mem_move(sort->data + (to + 1) * stride, sort->data + to * stride, (from - to) * stride);
+  sp_mem_copy(sort->data + to * stride, sort->tmp, stride);
 }
 
-SP_PRIVATE BOOL CALLBACK sp_tls_once_trampoline(PINIT_ONCE once, PVOID param, PVOID* ctx) {
-  SP_UNUSED(once);
-  SP_UNUSED(ctx);
-  sp_tls_once_fn_t fn = *(sp_tls_once_fn_t*)param;
-  fn();
-  return TRUE;
+// Unless the range is leftmost, the element before it is no greater than anything in it, so
+// the scan can run without a bounds check
+void sp_sort_insertion(sp_sort_t* sort, u64 begin, u64 end, bool leftmost) {
+  for (u64 cur = begin + 1; cur < end; cur++) {
+    u64 sift = cur;
+    while ((!leftmost || sift > begin) && sp_sort_less(sort, cur, sift - 1)) sift--;
+    if (sift != cur) sp_sort_rotate(sort, sift, cur);
+  }
 }
 
-void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
-  sp_tls_once_fn_t callback = fn;
-  InitOnceExecuteOnce(once, sp_tls_once_trampoline, &callback, SP_NULLPTR);
-}
+// Insertion sort that gives up after a handful of moves; returns whether the range is sorted
+bool sp_sort_partial_insertion(sp_sort_t* sort, u64 begin, u64 end) {
+  u64 moved = 0;
+  for (u64 cur = begin + 1; cur < end; cur++) {
+    if (moved > SP_SORT_PARTIAL_INSERTION_LIMIT) return false;
 
-#elif defined(SP_POSIX)
-void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
-  pthread_key_create(key, on_deinit);
-}
+    u64 sift = cur;
+    while (sift > begin && sp_sort_less(sort, cur, sift - 1)) sift--;
+    if (sift == cur) continue;
 
-void* sp_tls_get(sp_tls_key_t key) {
-  return pthread_getspecific(key);
-}
+    sp_sort_rotate(sort, sift, cur);
+    moved += cur - sift;
+  }
 
-void sp_tls_set(sp_tls_key_t key, void* data) {
-  pthread_setspecific(key, data);
+  return true;
 }
 
-void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
-  pthread_once(once, fn);
-}
+// Partitions around the pivot at begin into [< pivot] pivot [>= pivot] and returns where
+// the pivot ended up. The median selection guarantees an element >= pivot past begin, so
+// the first scan needs no bounds check.
+u64 sp_sort_partition_right(sp_sort_t* sort, u64 begin, u64 end, bool* already_partitioned) {
+  u64 first = begin;
+  u64 last = end;
 
-#else
-void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
-  SP_UNIMPLEMENTED();
-}
+  while (sp_sort_less(sort, ++first, begin));
+  if (first - 1 == begin) {
+    while (first < last && !sp_sort_less(sort, --last, begin));
+  }
+  else {
+    while (!sp_sort_less(sort, --last, begin));
+  }
 
-void* sp_tls_get(sp_tls_key_t key) {
-  SP_UNIMPLEMENTED();
-  return SP_NULLPTR;
-}
+  *already_partitioned = first >= last;
+  while (first < last) {
+    sp_sort_swap(sort, first, last);
+    while (sp_sort_less(sort, ++first, begin));
+    while (!sp_sort_less(sort, --last, begin));
+  }
 
-void sp_tls_set(sp_tls_key_t key, void* data) {
-  SP_UNIMPLEMENTED();
+  u64 pivot = first - 1;
+  if (pivot != begin) sp_sort_swap(sort, begin, pivot);
+  return pivot;
 }
 
-void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
-  SP_UNIMPLEMENTED();
-}
-#endif
+// The mirror image: [<= pivot] pivot [> pivot]. Used when the pivot equals the element
+// before the range, i.e. the range is full of copies of it; those all land on the left
+// and never need sorting again.
+u64 sp_sort_partition_left(sp_sort_t* sort, u64 begin, u64 end) {
+  u64 first = begin;
+  u64 last = end;
 
+  while (sp_sort_less(sort, begin, --last));
+  if (last + 1 == end) {
+    while (first < last && !sp_sort_less(sort, begin, ++first));
+  }
+  else {
+    while (!sp_sort_less(sort, begin, ++first));
+  }
 
-//  ██████   ██████ ██████████ ██████   ██████    ███████    ███████████   █████ █████
-// ░░██████ ██████ ░░███░░░░░█░░██████ ██████   ███░░░░░███ ░░███░░░░░███ ░░███ ░░███
-//  ░███░█████░███  ░███  █ ░  ░███░█████░███  ███     ░░███ ░███    ░███  ░░███ ███
-//  ░███░░███ ░███  ░██████    ░███░░███ ░███ ░███      ░███ ░██████████    ░░█████
-//  ░███ ░░░  ░███  ░███░░█    ░███ ░░░  ░███ ░███      ░███ ░███░░░░░███    ░░███
-//  ░███      ░███  ░███ ░   █ ░███      ░███ ░░███     ███  ░███    ░███     ░███
-//  █████     █████ ██████████ █████     █████ ░░░███████░   █████   █████    █████
-// ░░░░░     ░░░░░ ░░░░░░░░░░ ░░░░░     ░░░░░    ░░░░░░░    ░░░░░   ░░░░░    ░░░░░
-// @memory
+  while (first < last) {
+    sp_sort_swap(sort, first, last);
+    while (sp_sort_less(sort, begin, --last));
+    while (!sp_sort_less(sort, begin, ++first));
+  }
 
-void* sp_mem_allocator_alloc(sp_mem_t allocator, u64 size) {
-  return allocator.on_alloc(allocator.user_data, SP_ALLOCATOR_MODE_ALLOC, size, NULL, 0);
+  if (last != begin) sp_sort_swap(sort, begin, last);
+  return last;
 }
 
-void* sp_mem_allocator_realloc(sp_mem_t allocator, void* memory, u64 old_size, u64 size) {
-  return allocator.on_alloc(allocator.user_data, SP_ALLOCATOR_MODE_RESIZE, size, memory, old_size);
-}
+void sp_sort_heap(sp_sort_t* sort, u64 begin, u64 end) {
+  u64 n = end - begin;
+  for (u64 step = n / 2 + n - 1; step-- > 0; ) {
+    u64 root = 0;
+    u64 size = n;
+    if (step >= n - 1) {
+      root = step - (n - 1);
+    }
+    else {
+      size = step + 1;
+      sp_sort_swap(sort, begin, begin + size);
+    }
 
-void sp_mem_allocator_free(sp_mem_t allocator, void* buffer, u64 size) {
-  allocator.on_alloc(allocator.user_data, SP_ALLOCATOR_MODE_FREE, 0, buffer, size);
+    for (;;) {
+      u64 child = 2 * root + 1;
+      if (child >= size) break;
+      if (child + 1 < size && sp_sort_less(sort, begin + child, begin + child + 1)) child++;
+      if (!sp_sort_less(sort, begin + root, begin + child)) break;
+      sp_sort_swap(sort, begin + root, begin + child);
+      root = child;
+    }
+  }
 }
 
-u8* sp_mem_arena_block_buffer(sp_mem_arena_block_t* block) {
-  return (u8*)(block + 1);
-}
+void sp_sort_loop(sp_sort_t* sort, u64 begin, u64 end, u32 bad_allowed, bool leftmost) {
+  for (;;) {
+    u64 size = end - begin;
+    if (size < SP_SORT_INSERTION_THRESHOLD) {
+      sp_sort_insertion(sort, begin, end, leftmost);
+      return;
+    }
 
-sp_mem_arena_block_t* sp_mem_arena_block_new(sp_mem_arena_t* arena, u64 block_size) {
-  sp_mem_arena_block_t* block = (sp_mem_arena_block_t*)sp_mem_allocator_alloc(arena->allocator, block_size);
-  if (!block) return SP_NULLPTR;
-  block->next = SP_NULLPTR;
-  block->capacity = block_size - sizeof(sp_mem_arena_block_t);
-  block->bytes_used = 0;
-  return block;
-}
+    u64 half = size / 2;
+    if (size > SP_SORT_NINTHER_THRESHOLD) {
+      sp_sort_sort3(sort, begin, begin + half, end - 1);
+      sp_sort_sort3(sort, begin + 1, begin + half - 1, end - 2);
+      sp_sort_sort3(sort, begin + 2, begin + half + 1, end - 3);
+      sp_sort_sort3(sort, begin + half - 1, begin + half, begin + half + 1);
+      sp_sort_swap(sort, begin, begin + half);
+    }
+    else {
+      sp_sort_sort3(sort, begin + half, begin, end - 1);
+    }
 
-sp_mem_arena_t* sp_mem_arena_new(sp_mem_t mem) {
-  return sp_mem_arena_new_ex(mem, 4096, SP_MEM_ALIGNMENT);
-}
+    if (!leftmost && !sp_sort_less(sort, begin - 1, begin)) {
+      begin = sp_sort_partition_left(sort, begin, end) + 1;
+      continue;
+    }
 
-sp_mem_arena_t* sp_mem_arena_new_ex(sp_mem_t mem, u64 block_size, u8 alignment) {
-  sp_mem_arena_t* arena = (sp_mem_arena_t*)sp_mem_allocator_alloc(mem, sizeof(sp_mem_arena_t));
-  if (!arena) return SP_NULLPTR;
-  arena->allocator = mem;
-  arena->alignment = alignment == 0 ? SP_MEM_ALIGNMENT : alignment;
-  sp_assert((arena->alignment & (arena->alignment - 1)) == 0);
-  arena->block_size = sp_max(block_size, sizeof(sp_mem_arena_block_t) + arena->alignment);
+    bool already_partitioned = false;
+    u64 pivot = sp_sort_partition_right(sort, begin, end, &already_partitioned);
+    u64 l = pivot - begin;
+    u64 r = end - pivot - 1;
+
+    // A lopsided split means the pivots are being chosen badly (or adversarially); scramble
+    // both sides a little to break the pattern, and fall back to heapsort if it keeps up.
+    if (l < size / 8 || r < size / 8) {
+      if (--bad_allowed == 0) {
+        sp_sort_heap(sort, begin, end);
+        return;
+      }
 
-  sp_mem_arena_block_t* block = sp_mem_arena_block_new(arena, arena->block_size);
-  if (!block) {
-    sp_mem_allocator_free(mem, arena, sizeof(sp_mem_arena_t));
-    return SP_NULLPTR;
+      if (l >= SP_SORT_INSERTION_THRESHOLD) {
+        sp_sort_swap(sort, begin, begin + l / 4);
+        sp_sort_swap(sort, pivot - 1, pivot - l / 4);
+        if (l > SP_SORT_NINTHER_THRESHOLD) {
+          sp_sort_swap(sort, begin + 1, begin + (l / 4 + 1));
+          sp_sort_swap(sort, begin + 2, begin + (l / 4 + 2));
+          sp_sort_swap(sort, pivot - 2, pivot - (l / 4 + 1));
+          sp_sort_swap(sort, pivot - 3, pivot - (l / 4 + 2));
+        }
+      }
+
+      if (r >= SP_SORT_INSERTION_THRESHOLD) {
+        sp_sort_swap(sort, pivot + 1, pivot + (1 + r / 4));
+        sp_sort_swap(sort, end - 1, end - r / 4);
+        if (r > SP_SORT_NINTHER_THRESHOLD) {
+          sp_sort_swap(sort, pivot + 2, pivot + (2 + r / 4));
+          sp_sort_swap(sort, pivot + 3, pivot + (3 + r / 4));
+          sp_sort_swap(sort, end - 2, end - (1 + r / 4));
+          sp_sort_swap(sort, end - 3, end - (2 + r / 4));
+        }
+      }
+    }
+    // A split that needed no swaps suggests the input is (nearly) sorted already
+    else if (already_partitioned) {
+      if (sp_sort_partial_insertion(sort, begin, pivot) && sp_sort_partial_insertion(sort, pivot + 1, end)) {
+        return;
+      }
+    }
+
+    sp_sort_loop(sort, begin, pivot, bad_allowed, leftmost);
+    begin = pivot + 1;
+    leftmost = false;
   }
-  arena->head = block;
-  arena->current = block;
-  return arena;
 }
 
-sp_mem_t sp_mem_arena_as_allocator(sp_mem_arena_t* a) {
-  return (sp_mem_t) {
-    .on_alloc = sp_mem_arena_on_alloc,
-    .user_data = a
-  };
-}
+void sp_sort(void* arr, u64 len, u64 stride, sp_qsort_fn_t cmp) {
+  if (len < 2 || !stride) return;
 
-void sp_mem_arena_clear(sp_mem_arena_t* arena) {
-  arena->head->bytes_used = 0;
-  arena->current = arena->head;
-}
+  u8 buffer [64];
+  sp_sort_t sort = {
+    .data = (u8*)arr,
+    .stride = stride,
+    .cmp = cmp,
+    .tmp = buffer,
+  };
 
-void sp_mem_arena_destroy(sp_mem_arena_t* arena) {
-  sp_mem_arena_block_t* block = arena->head;
-  while (block) {
-    sp_mem_arena_block_t* next = block->next;
-    sp_mem_allocator_free(arena->allocator, block, sizeof(sp_mem_arena_block_t) + block->capacity);
-    block = next;
+  if (stride <= sizeof(buffer)) {
+    sp_sort_loop(&sort, 0, len, sp_sort_log2(len), true);
+    return;
   }
 
-  arena->head = SP_NULLPTR;
-  arena->current = SP_NULLPTR;
-  sp_mem_allocator_free(arena->allocator, arena, sizeof(sp_mem_arena_t));
+  sp_mem_arena_marker_t scratch = sp_mem_begin_scratch();
+  sort.tmp = sp_alloc_n(scratch.mem, u8, stride);
+  sp_sort_loop(&sort, 0, len, sp_sort_log2(len), true);
+  sp_mem_end_scratch(scratch);
 }
 
-u64 sp_mem_arena_capacity(sp_mem_arena_t* arena) {
-  u64 total = 0;
-  for (sp_mem_arena_block_t* block = arena->head; block; block = block->next) {
-    total += block->capacity;
-  }
-  return total;
-}
+// Maps each key type onto a u64 whose unsigned order is the key's order: flip the sign bit
+// of signed integers, and for floats flip the sign bit of positives and every bit of negatives
+u64 sp_radix_key(const u8* record, sp_radix_key_t key) {
+  // Records may be packed, so the key is copied out rather than loaded in place
+  u32 narrow = 0;
+  u64 wide = 0;
+  if (key >= SP_RADIX_KEY_U64) sp_mem_copy(&wide, record, sizeof(wide));
+  else                         sp_mem_copy(&narrow, record, sizeof(narrow));
 
-u64 sp_mem_arena_bytes_used(sp_mem_arena_t* arena) {
-  u64 total = 0;
-  for (sp_mem_arena_block_t* block = arena->head; ; block = block->next) {
-    total += block->bytes_used;
-    if (block == arena->current) break;
+  switch (key) {
+    case SP_RADIX_KEY_U32: return narrow;
+    case SP_RADIX_KEY_S32: return narrow ^ 0x80000000u;
+    case SP_RADIX_KEY_F32: return (narrow & 0x80000000u) ? (u32)~narrow : (narrow | 0x80000000u);
+    case SP_RADIX_KEY_U64: return wide;
+    case SP_RADIX_KEY_S64: return wide ^ 0x8000000000000000ull;
+    case SP_RADIX_KEY_F64: return (wide & 0x8000000000000000ull) ? ~wide : (wide | 0x8000000000000000ull);
   }
-  return total;
-}
 
-u64 sp_mem_arena_block_align(sp_mem_arena_block_t* block, u8 alignment) {
-  u8* buffer = sp_mem_arena_block_buffer(block);
-  u8* ptr = (u8*)sp_align_up(buffer + block->bytes_used, alignment);
-  return (u64)(ptr - buffer);
+  SP_UNREACHABLE_RETURN(0);
 }
 
-bool sp_mem_arena_block_fits(sp_mem_arena_block_t* block, u64 offset, u64 size) {
-  return offset <= block->capacity && size <= block->capacity - offset;
-}
+sp_err_t sp_radix_sort_ex(sp_mem_t mem, void* arr, u64 len, u64 stride, u64 key_offset, sp_radix_key_t key) {
+  if (len < 2) return SP_OK;
 
-sp_mem_arena_block_t* sp_mem_arena_get_block(sp_mem_arena_t* arena, u64 size) {
-  sp_mem_arena_block_t* block = arena->current;
-  u64 offset = sp_mem_arena_block_align(block, arena->alignment);
-  if (sp_mem_arena_block_fits(block, offset, size)) {
-    block->bytes_used = offset;
-    return block;
-  }
+  u8* buffer = (u8*)sp_alloc(mem, len * stride);
+  if (!buffer) return SP_ERR;
 
-  if (block->next) {
-    sp_mem_arena_block_t* next = block->next;
-    next->bytes_used = 0;
-    u64 next_offset = sp_mem_arena_block_align(next, arena->alignment);
-    if (sp_mem_arena_block_fits(next, next_offset, size)) {
-      next->bytes_used = next_offset;
-      arena->current = next;
-      return next;
+  u32 digits = key >= SP_RADIX_KEY_U64 ? sizeof(u64) : sizeof(u32);
+  u64 counts [8][256];
+  sp_mem_zero(counts, sizeof(counts));
+
+  // One pass builds the histogram for every digit
+  u8* data = (u8*)arr;
+  for (u64 it = 0; it < len; it++) {
+    u64 k = sp_radix_key(data + it * stride + key_offset, key);
+    sp_for(d, digits) {
+      counts[d][(k >> (d * 8)) & 0xFF]++;
     }
   }
 
-  if (arena->block_size < SP_MEM_ARENA_MAX_BLOCK_SIZE) {
-    arena->block_size = sp_min(arena->block_size * 2, (u64)SP_MEM_ARENA_MAX_BLOCK_SIZE);
+  u8* src = data;
+  u8* dst = buffer;
+  sp_for(d, digits) {
+    u64* count = counts[d];
+    u32 shift = d * 8;
+
+    // Every key has the same byte here, so this pass wouldn't move anything
+    u64 first = (sp_radix_key(src + key_offset, key) >> shift) & 0xFF;
+    if (count[first] == len) continue;
+
+    u64 offset = 0;
+    sp_for(bucket, 256) {
+      u64 n = count[bucket];
+      count[bucket] = offset;
+      offset += n;
+    }
+
+    for (u64 it = 0; it < len; it++) {
+      const u8* record = src + it * stride;
+      u64 bucket = (sp_radix_key(record + key_offset, key) >> shift) & 0xFF;
+      sp_mem_copy(dst + count[bucket]++ * stride, record, stride);
+    }
+
+    u8* swap = src;
+    src = dst;
+    dst = swap;
   }
-  u64 required = sizeof(sp_mem_arena_block_t) + arena->alignment + size;
-  sp_mem_arena_block_t* new_block = sp_mem_arena_block_new(arena, sp_max(arena->block_size, required));
-  if (!new_block) return SP_NULLPTR;
-  new_block->next = block->next;
-  block->next = new_block;
-  new_block->bytes_used = sp_mem_arena_block_align(new_block, arena->alignment);
-  arena->current = new_block;
-  return new_block;
+
+  if (src != data) sp_mem_copy(data, src, len * stride);
+  sp_free(mem, buffer, len * stride);
+  return SP_OK;
 }
 
-void* sp_mem_arena_alloc_size(sp_mem_arena_t* arena, u64 size) {
-  if (size > ((u64)-1) - SP_MEM_ARENA_MAX_BLOCK_SIZE) return SP_NULLPTR;
 
-  sp_mem_arena_block_t* block = sp_mem_arena_get_block(arena, size);
-  if (!block) return SP_NULLPTR;
 
-  void* ptr = sp_mem_arena_block_buffer(block) + block->bytes_used;
-  block->bytes_used += size;
-  sp_mem_zero(ptr, size);
-  return ptr;
+//  ███████████   █████ ██████   █████   █████████     ███████████  █████  █████ ███████████ ███████████ ██████████ ███████████
+// ░░███░░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███   ░░███░░░░░███░░███  ░░███ ░░███░░░░░░█░░███░░░░░░█░░███░░░░░█░░███░░░░░███
+//  ░███    ░███  ░███  ░███░███ ░███  ███     ░░░     ░███    ░███ ░███   ░███  ░███   █ ░  ░███   █ ░  ░███  █ ░  ░███    ░███
+//  ░██████████   ░███  ░███░░███░███ ░███             ░██████████  ░███   ░███  ░███████    ░███████    ░██████    ░██████████
+//  ░███░░░░░███  ░███  ░███ ░░██████ ░███    █████    ░███░░░░░███ ░███   ░███  ░███░░░█    ░███░░░█    ░███░░█    ░███░░░░░███
+//  ░███    ░███  ░███  ░███  ░░█████ ░░███  ░░███     ░███    ░███ ░███   ░███  ░███  ░     ░███  ░     ░███ ░   █ ░███    ░███
+//  █████   █████ █████ █████  ░░█████ ░░█████████     ███████████  ░░████████   █████       █████       ██████████ █████   █████
+// ░░░░░   ░░░░░ ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░     ░░░░░░░░░░░    ░░░░░░░░   ░░░░░       ░░░░░       ░░░░░░░░░░ ░░░░░   ░░░░░
+// @ring_buffer @rb
+u32 sp_rb_storage(u32 capacity) {
+  u32 storage = 1;
+  while (storage < capacity) storage *= 2;
+  return storage;
 }
 
-bool sp_mem_arena_is_top(sp_mem_arena_t* arena, void* ptr, u64 size) {
-  sp_mem_arena_block_t* block = arena->current;
-  u8* buffer = sp_mem_arena_block_buffer(block);
-  return (u8*)ptr >= buffer && (u8*)ptr + size == buffer + block->bytes_used;
+void sp_rb_init_ex(sp_mem_t mem, void** arr, u32 stride, u32 capacity) {
+  u32 storage = sp_rb_storage(capacity);
+  sp_ring_buffer_t* rb = (sp_ring_buffer_t*)sp_alloc(mem, storage * stride + sizeof(sp_ring_buffer_t));
+  rb->head = 0;
+  rb->size = 0;
+  rb->capacity = capacity;
+  rb->mask = storage - 1;
+  rb->mode = SP_RQ_MODE_GROW;
+  rb->allocator = mem;
+  *arr = (u8*)(rb + 1);
 }
 
-void* sp_mem_arena_on_alloc(void* user_data, sp_mem_alloc_mode_t mode, u64 size, void* old_memory, u64 old_size) {
-  sp_mem_arena_t* arena = (sp_mem_arena_t*)user_data;
+void* sp_rb_grow_ex(void* arr, u32 stride, u32 capacity) {
+  sp_assert(arr);
+  sp_ring_buffer_t* old = sp_rb_head(arr);
+  sp_mem_t mem = old->allocator;
+  u32 storage = sp_rb_storage(capacity);
+  sp_ring_buffer_t* rb = (sp_ring_buffer_t*)sp_alloc(mem, storage * stride + sizeof(sp_ring_buffer_t));
+  if (!rb) return SP_NULLPTR;
 
-  switch (mode) {
-    case SP_ALLOCATOR_MODE_ALLOC: {
-      return sp_mem_arena_alloc_size(arena, size);
-    }
-    case SP_ALLOCATOR_MODE_RESIZE: {
-      if (!old_memory) return sp_mem_arena_alloc_size(arena, size);
+  rb->head = 0;
+  rb->size = old->size;
+  rb->capacity = capacity;
+  rb->mask = storage - 1;
+  rb->mode = old->mode;
+  rb->allocator = mem;
 
-      sp_mem_arena_block_t* block = arena->current;
-      if (sp_mem_arena_is_top(arena, old_memory, old_size)) {
-        if (size <= old_size) {
-          block->bytes_used -= old_size - size;
-          return old_memory;
-        }
-        u64 grow = size - old_size;
-        if (grow <= block->capacity - block->bytes_used) {
-          sp_mem_zero(sp_mem_arena_block_buffer(block) + block->bytes_used, grow);
-          block->bytes_used += grow;
-          return old_memory;
-        }
-      }
+  u32 old_size = old->size;
+  u32 old_cap = old->mask + 1;
+  u32 old_head = old->head;
 
-      if (size <= old_size) return old_memory;
+  u8* new_arr = (u8*)rb + sizeof(sp_ring_buffer_t);
+  u8* old_arr = (u8*)arr;
 
-      void* fresh = sp_mem_arena_alloc_size(arena, size);
-      if (!fresh) return SP_NULLPTR;
-      sp_mem_move(fresh, old_memory, old_size);
-      return fresh;
-    }
-    case SP_ALLOCATOR_MODE_FREE: {
-      if (old_memory && sp_mem_arena_is_top(arena, old_memory, old_size)) {
-        arena->current->bytes_used -= old_size;
-      }
-      return SP_NULLPTR;
-    }
-  }
+  u32 first_chunk = old_cap - old_head;
+  if (first_chunk > old_size) first_chunk = old_size;
+  sp_mem_copy(new_arr, old_arr + old_head * stride, first_chunk * stride);
 
-  SP_UNREACHABLE_RETURN(SP_NULLPTR);
-}
+  u32 second_chunk = old_size - first_chunk;
+  if (second_chunk > 0) {
+    sp_mem_copy(new_arr + first_chunk * stride, old_arr, second_chunk * stride);
+  }
 
-void* sp_mem_arena_alloc(sp_mem_arena_t* arena, u64 size) {
-  return sp_mem_arena_on_alloc(arena, SP_ALLOCATOR_MODE_ALLOC, size, SP_NULLPTR, 0);
-}
+  sp_mem_allocator_free(mem, old, old_cap * stride + sizeof(sp_ring_buffer_t));
 
-void* sp_mem_arena_realloc(sp_mem_arena_t* arena, void* ptr, u64 old_size, u64 size) {
-  return sp_mem_arena_on_alloc(arena, SP_ALLOCATOR_MODE_RESIZE, size, ptr, old_size);
+  return (u8*)(rb + 1);
 }
 
-void sp_mem_arena_free(sp_mem_arena_t* arena, void* ptr, u64 size) {
-  sp_mem_arena_on_alloc(arena, SP_ALLOCATOR_MODE_FREE, 0, ptr, size);
-}
 
-sp_mem_fixed_t sp_mem_fixed(void* buffer, u64 capacity) {
-  return sp_mem_fixed_ex(buffer, capacity, SP_MEM_ALIGNMENT);
+//  ███████████    ███████    ███████████   ██████   ██████   █████████   ███████████
+// ░░███░░░░░░█  ███░░░░░███ ░░███░░░░░███ ░░██████ ██████   ███░░░░░███ ░█░░░███░░░█
+//  ░███   █ ░  ███     ░░███ ░███    ░███  ░███░█████░███  ░███    ░███ ░   ░███  ░
+//  ░███████   ░███      ░███ ░██████████   ░███░░███ ░███  ░███████████     ░███
+//  ░███░░░█   ░███      ░███ ░███░░░░░███  ░███ ░░░  ░███  ░███░░░░░███     ░███
+//  ░███  ░    ░░███     ███  ░███    ░███  ░███      ░███  ░███    ░███     ░███
+//  █████       ░░░███████░   █████   █████ █████     █████ █████   █████    █████
+// ░░░░░          ░░░░░░░    ░░░░░   ░░░░░ ░░░░░     ░░░░░ ░░░░░   ░░░░░    ░░░░░
+// @format
+static u8 sp_fmt_peek(sp_fmt_parser_t* p, u32 offset) {
+  u32 idx = p->i + offset;
+  if (idx >= p->str.len) return 0;
+  return (u8)p->str.data[idx];
 }
 
-sp_mem_fixed_t sp_mem_fixed_ex(void* buffer, u64 capacity, u8 alignment) {
-  return (sp_mem_fixed_t) {
-    .buffer = (u8*)buffer,
-    .capacity = capacity,
-    .bytes_used = 0,
-    .alignment = sp_cast(u8, alignment == 0 ? SP_MEM_ALIGNMENT : alignment),
-  };
-}
+typedef struct {
+  u8 first;
+  u8 second;
+} sp_fmt_peek_t;
 
-sp_mem_t sp_mem_fixed_as_allocator(sp_mem_fixed_t* fixed) {
-  return (sp_mem_t) {
-    .on_alloc = sp_mem_fixed_on_alloc,
-    .user_data = fixed,
+static sp_fmt_peek_t sp_fmt_peek2(sp_fmt_parser_t* p) {
+  return (sp_fmt_peek_t){
+    .first  = sp_fmt_peek(p, 0),
+    .second = sp_fmt_peek(p, 1),
   };
 }
 
-void sp_mem_fixed_clear(sp_mem_fixed_t* fixed) {
-  fixed->bytes_used = 0;
+static u8 sp_fmt_advance(sp_fmt_parser_t* p) {
+  if (p->i >= p->str.len) return 0;
+  return (u8)p->str.data[p->i++];
 }
 
-u64 sp_mem_fixed_bytes_used(sp_mem_fixed_t* fixed) {
-  return fixed->bytes_used;
+static bool sp_fmt_match(sp_fmt_parser_t* p, c8 c) {
+  if (sp_fmt_peek(p, 0) != (u8)c) return false;
+  p->i++;
+  return true;
 }
 
-void* sp_mem_fixed_on_alloc(void* user_data, sp_mem_alloc_mode_t mode, u64 size, void* old_memory, u64 old_size) {
-  sp_mem_fixed_t* fixed = (sp_mem_fixed_t*)user_data;
-
-  switch (mode) {
-    case SP_ALLOCATOR_MODE_ALLOC: {
-      u8* ptr = (u8*)sp_align_up(fixed->buffer + fixed->bytes_used, fixed->alignment);
-      u64 offset = (u64)(ptr - fixed->buffer);
-      if (offset > fixed->capacity || size > fixed->capacity - offset) return SP_NULLPTR;
-      fixed->bytes_used = offset + size;
-      sp_mem_zero(ptr, size);
-      return ptr;
-    }
-    case SP_ALLOCATOR_MODE_RESIZE: {
-      if (!old_memory) return sp_mem_fixed_on_alloc(user_data, SP_ALLOCATOR_MODE_ALLOC, size, SP_NULLPTR, 0);
-
-      bool is_top = (u8*)old_memory + old_size == fixed->buffer + fixed->bytes_used;
-      if (is_top) {
-        u64 offset = (u64)((u8*)old_memory - fixed->buffer);
-        if (size <= fixed->capacity - offset) {
-          if (size > old_size) sp_mem_zero((u8*)old_memory + old_size, size - old_size);
-          fixed->bytes_used = offset + size;
-          return old_memory;
-        }
-      }
-
-      if (size <= old_size) return old_memory;
-
-      void* fresh = sp_mem_fixed_on_alloc(user_data, SP_ALLOCATOR_MODE_ALLOC, size, SP_NULLPTR, 0);
-      if (!fresh) return SP_NULLPTR;
-      sp_mem_move(fresh, old_memory, old_size);
-      return fresh;
-    }
-    case SP_ALLOCATOR_MODE_FREE: {
-      if (old_memory && (u8*)old_memory + old_size == fixed->buffer + fixed->bytes_used) {
-        fixed->bytes_used -= old_size;
-      }
-      return SP_NULLPTR;
-    }
-  }
-
-  SP_UNREACHABLE_RETURN(SP_NULLPTR);
+static bool sp_fmt_is_whitespace(u8 c) {
+  return c == ' ' || c == '\t';
 }
 
-sp_mem_arena_marker_t sp_mem_arena_mark(sp_mem_arena_t* arena) {
-  return (sp_mem_arena_marker_t) {
-    .arena = arena,
-    .block = arena->current,
-    .mark = arena->current->bytes_used,
-    .mem = sp_mem_arena_as_allocator(arena),
-  };
+static bool sp_fmt_is_digit(u8 c) {
+  return c >= '0' && c <= '9';
 }
 
-void sp_mem_arena_pop(sp_mem_arena_marker_t marker) {
-  marker.block->bytes_used = marker.mark;
-  marker.arena->current = marker.block;
+static bool sp_fmt_is_alpha(u8 c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 }
 
-sp_mem_t sp_mem_get_scratch() {
-  sp_tls_rt_t* tls = sp_tls_rt_get();
-  return sp_mem_arena_as_allocator(sp_tls_rt_get_scratch_arena(tls));
+static bool sp_fmt_is_directive_id(u8 c) {
+  return sp_fmt_is_alpha(c) || (c >= '0' && c <= '9') || c == '-' || c == '_';
 }
 
-sp_mem_arena_t* sp_mem_get_scratch_arena() {
-  sp_tls_rt_t* tls = sp_tls_rt_get();
-  return sp_tls_rt_get_scratch_arena(tls);
+static bool sp_fmt_is_align(u8 c) {
+  return c == '<' || c == '^' || c == '>';
 }
 
-sp_mem_arena_marker_t sp_mem_begin_scratch() {
-  sp_tls_rt_t* tls = sp_tls_rt_get();
-  return sp_mem_arena_mark(sp_tls_rt_get_scratch_arena(tls));
+static bool sp_fmt_is_renderer(u8 c) {
+  return c == 'B' || c == 'b' || c == 'x' || c == 'X' || c == 'o' || c == 'c';
 }
 
-sp_mem_arena_marker_t sp_mem_begin_scratch_for(sp_mem_t mem) {
-  sp_tls_rt_t* tls = sp_tls_rt_get();
-  return sp_mem_arena_mark(sp_tls_rt_get_scratch_arena_for(tls, mem));
+static sp_str_t sp_fmt_sub(sp_fmt_parser_t* p) {
+  return (sp_str_t) {
+    .data = p->str.data + p->i,
+  };
 }
 
-void sp_mem_end_scratch(sp_mem_arena_marker_t marker) {
-  sp_mem_arena_pop(marker);
+static void sp_fmt_eat_whitespace(sp_fmt_parser_t* p) {
+  while (sp_fmt_is_whitespace(sp_fmt_peek(p, 0))) {
+    sp_fmt_advance(p);
+  }
 }
 
-bool sp_mem_is_equal(const void* a, const void* b, u64 len) {
-  if (!len) return true;
-  if (!a || !b) return false;
-  return !sp_sys_memcmp(a, b, len);
+static sp_str_t sp_fmt_directive_name(sp_fmt_parser_t* p) {
+  sp_str_t word = sp_fmt_sub(p);
+  if (!sp_fmt_is_alpha(sp_fmt_peek(p, 0))) return word;
+  while (sp_fmt_is_directive_id(sp_fmt_peek(p, 0))) {
+    sp_fmt_advance(p);
+    word.len++;
+  }
+  return word;
 }
 
-void sp_mem_copy(void* dest, const void* source, u64 num_bytes) {
-  if (!source) return;
-  if (!dest) return;
-  if (!num_bytes) return;
-  sp_sys_memcpy(dest, source, num_bytes);
+static bool sp_fmt_at_directive_boundary(sp_fmt_parser_t* p) {
+  c8 c = sp_fmt_peek(p, 0);
+  return c == 0 || c == '}' || sp_fmt_is_whitespace(c);
 }
 
-void sp_mem_move(void* dest, const void* source, u64 num_bytes) {
-  if (!source) return;
-  if (!dest) return;
-  sp_sys_memmove(dest, source, num_bytes);
+static sp_fmt_align_t sp_fmt_align_from_char(u8 c) {
+  if (c == '<') return SP_FMT_ALIGN_LEFT;
+  if (c == '^') return SP_FMT_ALIGN_CENTER;
+  if (c == '>') return SP_FMT_ALIGN_RIGHT;
+  return SP_FMT_ALIGN_NONE;
 }
 
-void sp_mem_fill(void* buffer, u64 buffer_size, void* fill, u64 fill_size) {
-  u8* current_byte = (u8*)buffer;
-
-  u64 i = 0;
-  while (true) {
-    if (i + fill_size > buffer_size) return;
-    sp_mem_copy(current_byte + i, (u8*)fill, fill_size);
-    i += fill_size;
+static sp_err_t sp_fmt_parse_number(sp_fmt_parser_t* p, u32* out) {
+  u32 acc = 0;
+  sp_err_t err = SP_ERR;
+  while (sp_fmt_is_digit(sp_fmt_peek(p, 0))) {
+    acc = acc * 10 + (u32)(sp_fmt_advance(p) - '0');
+    err = SP_OK;
   }
+  if (!err) *out = acc;
+  return err;
 }
 
-void sp_mem_fill_u8(void* buffer, u64 buffer_size, u8 fill) {
-  sp_mem_fill(buffer, buffer_size, &fill, sizeof(u8));
-}
-
-void sp_mem_zero(void* buffer, u64 buffer_size) {
-  sp_mem_fill_u8(buffer, buffer_size, 0);
-}
+// Parses the spec body that follows the `:` introducer:
+// [fill_align] [width] [.precision] [renderer]
+static sp_err_t sp_fmt_parse_spec_body(sp_fmt_parser_t* p, sp_fmt_spec_t* spec) {
+  sp_fmt_peek_t peek = sp_fmt_peek2(p);
+  if (sp_fmt_is_align(peek.second)) {
+    if (peek.first == '$') spec->dynamic |= SP_FMT_DYNAMIC_FILL;
+    else                   spec->fill = peek.first;
+    spec->align = sp_fmt_align_from_char(peek.second);
+    sp_fmt_advance(p);
+    sp_fmt_advance(p);
+  }
+  else if (sp_fmt_is_align(peek.first)) {
+    spec->align = sp_fmt_align_from_char(peek.first);
+    sp_fmt_advance(p);
+  }
 
-void* sp_mem_os_alloc(u64 size) {
-  return sp_sys_alloc(size);
-}
+  c8 c = sp_fmt_peek(p, 0);
+  if (c == '$') {
+    sp_fmt_advance(p);
+    spec->dynamic |= SP_FMT_DYNAMIC_WIDTH;
+  }
+  else if (sp_fmt_is_digit(c)) {
+    sp_fmt_parse_number(p, &spec->width);
+    if (spec->width > SP_FMT_WIDTH_MAX) spec->width = SP_FMT_WIDTH_MAX;
+  }
 
-void sp_mem_os_free(void* ptr, u64 size) {
-  if (!ptr) return;
-  sp_sys_free(ptr, size);
-}
-
-void* sp_mem_os_realloc(void* ptr, u64 old_size, u64 size) {
-  if (!ptr) return sp_mem_os_alloc(size);
-  if (!size) {
-    sp_mem_os_free(ptr, old_size);
-    return SP_NULLPTR;
+  if (sp_fmt_peek(p, 0) == '.') {
+    sp_fmt_advance(p);
+    if (sp_fmt_peek(p, 0) == '$') {
+      sp_fmt_advance(p);
+      spec->dynamic |= SP_FMT_DYNAMIC_PRECISION;
+    }
+    else {
+      u32 prec = 0;
+      sp_try_as(sp_fmt_parse_number(p, &prec), SP_ERR_FMT_BAD_PRECISION);
+      sp_opt_set(spec->precision, (u8)prec);
+    }
   }
-  if (size == old_size) return ptr;
 
-  void* mem = sp_mem_os_alloc(size);
-  if (!mem) return SP_NULLPTR;
-  sp_mem_copy(mem, ptr, sp_min(old_size, size));
-  sp_mem_os_free(ptr, old_size);
-  return mem;
+  if (sp_fmt_is_renderer(sp_fmt_peek(p, 0))) spec->renderer = sp_fmt_advance(p);
+  return SP_OK;
 }
 
-sp_mem_slice_t sp_mem_slice(u8* ptr, u64 len) {
-  return (sp_mem_slice_t) { .data = ptr, .len = len };
-}
+// Parses a single directive that follows the `.` introducer: just a name. On
+// success, leaves the cursor on a directive boundary (whitespace, `}`, or EOF).
+// The trailing whitespace — if any — is left for the top-level loop to consume:
+// it separates this directive from the next one.
+static sp_err_t sp_fmt_parse_directive(sp_fmt_parser_t* p, sp_fmt_spec_t* spec) {
+  if (spec->directive.num >= SP_FMT_MAX_DIRECTIVES) {
+    return SP_ERR_FMT_TOO_MANY_DIRECTIVES;
+  }
 
-sp_mem_slice_t sp_mem_slice_sub(sp_mem_slice_t slice, u64 start, u64 len) {
-  if (start >= slice.len) {
-    return sp_mem_slice(SP_NULLPTR, 0);
+  if (sp_fmt_match(p, '$')) {
+    u32 index = spec->directive.num++;
+    spec->dynamic |= sp_fmt_dynamic_directive(index);
+    if (!sp_fmt_at_directive_boundary(p)) return SP_ERR_FMT_BAD_PLACEHOLDER;
+    return SP_OK;
   }
-  u64 actual_len = sp_min(len, slice.len - start);
-  return sp_mem_slice(slice.data + start, actual_len);
-}
 
-sp_mem_slice_t sp_mem_slice_prefix(sp_mem_slice_t slice, u64 len) {
-  return sp_mem_slice_sub(slice, 0, len);
-}
+  sp_str_t name = sp_fmt_directive_name(p);
+  if (!name.len) return SP_ERR_FMT_BAD_DIRECTIVE;
 
-sp_mem_slice_t sp_mem_slice_suffix(sp_mem_slice_t slice, u64 len) {
-  if (len >= slice.len) return slice;
-  return sp_mem_slice(slice.data + slice.len - len, len);
-}
+  u32 index = spec->directive.num++;
+  spec->directive.names[index] = name;
 
-bool sp_mem_slice_empty(sp_mem_slice_t slice) {
-  return slice.len == 0 || slice.data == SP_NULLPTR;
+  if (!sp_fmt_at_directive_boundary(p)) return SP_ERR_FMT_BAD_PLACEHOLDER;
+  return SP_OK;
 }
 
-u8 sp_mem_slice_at(sp_mem_slice_t slice, u64 index) {
-  SP_ASSERT(index < slice.len);
-  return slice.data[index];
-}
+sp_err_t sp_fmt_parse_specifier(sp_fmt_parser_t* p, sp_fmt_spec_t* spec) {
+  if (!sp_fmt_match(p, '{')) return SP_ERR_FMT_BAD_PLACEHOLDER;
 
-sp_mem_slice_it_t sp_mem_slice_it(sp_mem_slice_t slice) {
-  return (sp_mem_slice_it_t) {
-    .slice = slice,
-    .index = 0,
-    .byte = (u8)(slice.len ? slice.data[0] : 0)
-  };
-}
+  if (sp_fmt_match(p, ':')) {
+    sp_try(sp_fmt_parse_spec_body(p, spec));
+  }
 
-bool sp_mem_slice_it_valid(sp_mem_slice_it_t* it) {
-  return it->index < it->slice.len;
-}
+  sp_fmt_eat_whitespace(p);
+  while (sp_fmt_match(p, '.')) {
+    sp_try(sp_fmt_parse_directive(p, spec));
+    sp_fmt_eat_whitespace(p);
+  }
 
-void sp_mem_slice_it_next(sp_mem_slice_it_t* it) {
-  it->index++;
-  it->byte = sp_mem_slice_it_valid(it) ? it->slice.data[it->index] : 0;
+  if (!sp_fmt_match(p, '}')) {
+    if (sp_fmt_peek(p, 0) == 0) return SP_ERR_FMT_UNTERMINATED_PLACEHOLDER;
+    return SP_ERR_FMT_BAD_PLACEHOLDER;
+  }
+  return SP_OK;
 }
 
-sp_str_t sp_mem_buffer_as_str(sp_mem_buffer_t* buffer) {
-  return (sp_str_t) {
-    .data = (c8*)buffer->data,
-    .len = (u32)buffer->len
-  };
-}
 
-c8* sp_mem_buffer_as_cstr(sp_mem_buffer_t* buffer) {
-  return (c8*)buffer->data;
+static sp_err_t sp_fmt_pull_specifier_arg(sp_fmt_argv_t a, s64* out) {
+  if (a.id != sp_fmt_id_u64 && a.id != sp_fmt_id_s64) {
+    return SP_ERR;
+  }
+  *out = (a.id == sp_fmt_id_s64) ? a.value.i : (s64)a.value.u;
+  return SP_OK;
 }
 
-
-//   █████████  ███████████ ███████████   █████ ██████   █████   █████████
-//  ███░░░░░███░█░░░███░░░█░░███░░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███
-// ░███    ░░░ ░   ░███  ░  ░███    ░███  ░███  ░███░███ ░███  ███     ░░░
-// ░░█████████     ░███     ░██████████   ░███  ░███░░███░███ ░███
-//  ░░░░░░░░███    ░███     ░███░░░░░███  ░███  ░███ ░░██████ ░███    █████
-//  ███    ░███    ░███     ░███    ░███  ░███  ░███  ░░█████ ░░███  ░░███
-// ░░█████████     █████    █████   █████ █████ █████  ░░█████ ░░█████████
-//  ░░░░░░░░░     ░░░░░    ░░░░░   ░░░░░ ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░
-// @string
-c8* sp_cstr_copy_n(sp_mem_t mem, const c8* str, u32 len) {
-  u32 capacity = len + 1;
-  c8* copy = sp_alloc_n(mem, c8, capacity);
-  copy[0] = 0;
-  sp_cstr_copy_to_n(str, len, copy, capacity);
-  return copy;
+sp_err_t sp_fmt_style_from_name(sp_str_t name, sp_fmt_style_t* out) {
+  if (sp_str_equal_cstr(name, "black")) { *out = sp_fmt_style_black; return SP_OK; }
+  if (sp_str_equal_cstr(name, "red")) { *out = sp_fmt_style_red; return SP_OK; }
+  if (sp_str_equal_cstr(name, "green")) { *out = sp_fmt_style_green; return SP_OK; }
+  if (sp_str_equal_cstr(name, "yellow")) { *out = sp_fmt_style_yellow; return SP_OK; }
+  if (sp_str_equal_cstr(name, "blue")) { *out = sp_fmt_style_blue; return SP_OK; }
+  if (sp_str_equal_cstr(name, "magenta")) { *out = sp_fmt_style_magenta; return SP_OK; }
+  if (sp_str_equal_cstr(name, "cyan")) { *out = sp_fmt_style_cyan; return SP_OK; }
+  if (sp_str_equal_cstr(name, "white")) { *out = sp_fmt_style_white; return SP_OK; }
+  if (sp_str_equal_cstr(name, "gray")) { *out = sp_fmt_style_gray; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_black")) { *out = sp_fmt_style_gray; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_red")) { *out = sp_fmt_style_br_red; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_green")) { *out = sp_fmt_style_br_green; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_yellow")) { *out = sp_fmt_style_br_yellow; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_blue")) { *out = sp_fmt_style_br_blue; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_magenta")) { *out = sp_fmt_style_br_magenta; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_cyan")) { *out = sp_fmt_style_br_cyan; return SP_OK; }
+  if (sp_str_equal_cstr(name, "br_white")) { *out = sp_fmt_style_br_white; return SP_OK; }
+  if (sp_str_equal_cstr(name, "bold")) { *out = sp_fmt_style_bold; return SP_OK; }
+  if (sp_str_equal_cstr(name, "italic")) { *out = sp_fmt_style_italic; return SP_OK; }
+  if (sp_str_equal_cstr(name, "hyperlink")) { *out = sp_fmt_style_hyperlink; return SP_OK; }
+  if (sp_str_equal_cstr(name, "quote")) { *out = sp_fmt_style_quote; return SP_OK; }
+  return SP_ERR_FMT_UNKNOWN_DIRECTIVE;
 }
 
-c8* sp_cstr_copy(sp_mem_t mem, const c8* str) {
-  return sp_cstr_copy_n(mem, str, sp_cstr_len(str));
+sp_fmt_style_t sp_fmt_style_from_attr(sp_fmt_style_attr_t attr) {
+  switch (attr) {
+    case SP_FMT_STYLE_ATTR_NONE:      return sp_fmt_style_none;
+    case SP_FMT_STYLE_ATTR_BOLD:      return sp_fmt_style_bold;
+    case SP_FMT_STYLE_ATTR_ITALIC:    return sp_fmt_style_italic;
+    case SP_FMT_STYLE_ATTR_HYPERLINK: return sp_fmt_style_hyperlink;
+  }
+  SP_UNREACHABLE_RETURN(sp_fmt_style_none);
 }
 
-void sp_cstr_copy_to(const c8* str, c8* buffer, u32 buffer_length) {
-  sp_cstr_copy_to_n(str, sp_cstr_len(str), buffer, buffer_length);
+static const c8* sp_fmt_style_ansi(sp_fmt_style_t style) {
+  switch (style) {
+    case sp_fmt_style_black:      return SP_ANSI_FG_BLACK;
+    case sp_fmt_style_red:        return SP_ANSI_FG_RED;
+    case sp_fmt_style_green:      return SP_ANSI_FG_GREEN;
+    case sp_fmt_style_yellow:     return SP_ANSI_FG_YELLOW;
+    case sp_fmt_style_blue:       return SP_ANSI_FG_BLUE;
+    case sp_fmt_style_magenta:    return SP_ANSI_FG_MAGENTA;
+    case sp_fmt_style_cyan:       return SP_ANSI_FG_CYAN;
+    case sp_fmt_style_white:      return SP_ANSI_FG_WHITE;
+    case sp_fmt_style_gray:       return SP_ANSI_FG_BRIGHT_BLACK;
+    case sp_fmt_style_br_red:     return SP_ANSI_FG_BRIGHT_RED;
+    case sp_fmt_style_br_green:   return SP_ANSI_FG_BRIGHT_GREEN;
+    case sp_fmt_style_br_yellow:  return SP_ANSI_FG_BRIGHT_YELLOW;
+    case sp_fmt_style_br_blue:    return SP_ANSI_FG_BRIGHT_BLUE;
+    case sp_fmt_style_br_magenta: return SP_ANSI_FG_BRIGHT_MAGENTA;
+    case sp_fmt_style_br_cyan:    return SP_ANSI_FG_BRIGHT_CYAN;
+    case sp_fmt_style_br_white:   return SP_ANSI_FG_BRIGHT_WHITE;
+    case sp_fmt_style_bold:       return "\033[1m";
+    case sp_fmt_style_italic:     return "\033[3m";
+    case sp_fmt_style_none:
+    case sp_fmt_style_unset:
+    case sp_fmt_style_hyperlink:
+    case sp_fmt_style_quote:      return SP_NULLPTR;
+  }
+  return SP_NULLPTR;
 }
 
-void sp_cstr_copy_to_n(const c8* str, u32 len, c8* buffer, u32 capacity) {
-  if (!(str && buffer && capacity)) return;
-
-  u32 n = sp_min(len, capacity - 1);
-  memcpy(buffer, str, n);
-  buffer[n] = 0;
+static void sp_fmt_style_open(sp_io_writer_t* io, sp_fmt_style_t style, sp_fmt_arg_t* arg) {
+  const c8* ansi = sp_fmt_style_ansi(style);
+  if (ansi) {
+    sp_io_write_cstr(io, ansi, SP_NULLPTR);
+  }
+  else if (style == sp_fmt_style_hyperlink) {
+    sp_io_write_cstr(io, "\033]8;;", SP_NULLPTR);
+    if (arg->id == sp_fmt_id_str) sp_io_write_str(io, arg->value.s, SP_NULLPTR);
+    sp_io_write_cstr(io, "\033\\", SP_NULLPTR);
+  }
+  else if (style == sp_fmt_style_quote) {
+    sp_io_write_c8(io, '"');
+  }
 }
 
-bool sp_cstr_equal(const c8* a, const c8* b) {
-  u32 la = sp_cstr_len(a);
-  u32 lb = sp_cstr_len(b);
-  if (la != lb) return false;
-
-  return sp_mem_is_equal(a, b, la);
+static void sp_fmt_style_close(sp_io_writer_t* io, sp_fmt_style_t style) {
+  if (style == sp_fmt_style_quote) {
+    sp_io_write_c8(io, '"');
+  }
+  else if (style != sp_fmt_style_none && style != sp_fmt_style_unset) {
+    sp_io_write_cstr(io, SP_ANSI_RESET, SP_NULLPTR);
+  }
 }
 
-u32 sp_cstr_len(const c8* str) {
-  if (!str) return 0;
+bool sp_parse_u64_ex(sp_str_t str, u64* out) {
+  if (str.len == 0) return false;
 
-  u32 len = 0;
-  while (str[len]) len++;
-  return len;
-}
+  u64 result = 0;
+  for (u32 i = 0; i < str.len; i++) {
+    c8 ch = str.data[i];
+    if (ch < '0' || ch > '9') return false;
 
-u32 sp_cstr_len_n(const c8* str, u32 n) {
-  if (!str) return 0;
+    u64 digit = ch - '0';
+    if (result > (UINT64_MAX - digit) / 10) return false; // overflow check
+    result = result * 10 + digit;
+  }
 
-  u32 len = 0;
-  while (len < n && str[len]) len++;
-  return len;
+  *out = result;
+  return true;
 }
 
-sp_str_t sp_cstr_as_str(const c8* str) {
-  return (sp_str_t) {
-    .data = str,
-    .len = sp_cstr_len(str)
-  };
-}
+bool sp_parse_s64_ex(sp_str_t str, s64* out) {
+  if (str.len == 0) return false;
 
-c8 sp_c8_to_lower(c8 c) {
-  return (c >= 'A' && c <= 'Z') ? (c + 32) : (c);
-}
+  bool negative = false;
+  u32 start = 0;
 
-c8 sp_c8_to_upper(c8 c) {
-  return (c >= 'a' && c <= 'z') ? (c - 32) : (c);
-}
+  if (str.data[0] == '-') {
+    negative = true;
+    start = 1;
+  } else if (str.data[0] == '+') {
+    start = 1;
+  }
 
-u8 sp_utf8_num_bytes_from_byte(u8 byte) {
-  if (byte < SP_UTF8_2_BYTE_MIN) return 1;
-  if ((byte & 0xE0) == 0xC0) return 2;
-  if ((byte & 0xF0) == 0xE0) return 3;
-  if ((byte & 0xF8) == 0xF0) return 4;
-  return 0;
-}
+  if (start >= str.len) return false;
 
-u8 sp_utf8_num_bytes_from_ptr(const u8* ptr) {
-  if (!ptr) return 0;
-  return sp_utf8_num_bytes_from_byte(*ptr);
-}
+  sp_str_t num_str = sp_str(str.data + start, str.len - start);
+  u64 abs_value;
+  if (!sp_parse_u64_ex(num_str, &abs_value)) return false;
 
-u8 sp_utf8_num_bytes_from_codepoint(u32 codepoint) {
-  if (codepoint < SP_UTF8_2_BYTE_MIN) return 1;
-  if (codepoint < SP_UTF8_3_BYTE_MIN) return 2;
-  if (codepoint < SP_UTF8_4_BYTE_MIN) return 3;
-  if (codepoint <= SP_UTF8_MAX)       return 4;
-  return 0;
-}
+  if (negative) {
+    if (abs_value > (u64)INT64_MAX + 1) return false;
+    *out = (s64)(~abs_value + 1);
+  } else {
+    if (abs_value > INT64_MAX) return false; // overflow
+    *out = (s64)abs_value;
+  }
 
-bool sp_utf8_is_cont(u8 b) {
-  return (b & 0xC0) == 0x80;
+  return true;
 }
 
-bool sp_utf8_is_surrogate(u32 codepoint) {
-  return (codepoint >= SP_UTF8_SURROGATE_MIN) && (codepoint <= SP_UTF8_SURROGATE_MAX);
+bool sp_parse_u32_ex(sp_str_t str, u32* out) {
+  u64 val;
+  if (!sp_parse_u64_ex(str, &val)) return false;
+  if (val > UINT32_MAX) return false;
+  *out = (u32)val;
+  return true;
 }
 
-bool sp_utf8_is_bounds_ok(u32 codepoint, u8 len) {
-  if (codepoint > SP_UTF8_MAX) return false;
-  switch (len) {
-    case 2: { return (codepoint >= SP_UTF8_2_BYTE_MIN); }
-    case 3: { return (codepoint >= SP_UTF8_3_BYTE_MIN); }
-    case 4: { return (codepoint >= SP_UTF8_4_BYTE_MIN); }
-  }
-
+bool sp_parse_s32_ex(sp_str_t str, s32* out) {
+  s64 val;
+  if (!sp_parse_s64_ex(str, &val)) return false;
+  if (val < INT32_MIN || val > INT32_MAX) return false;
+  *out = (s32)val;
   return true;
 }
 
-bool sp_utf8_is_byte_ascii(u8 b) {
-  return b < SP_UTF8_ASCII_MAX;
+bool sp_parse_u16_ex(sp_str_t str, u16* out) {
+  u64 val;
+  if (!sp_parse_u64_ex(str, &val)) return false;
+  if (val > UINT16_MAX) return false;
+  *out = (u16)val;
+  return true;
 }
 
-bool sp_utf8_is_codepoint_ascii(u32 codepoint) {
-  return codepoint < SP_UTF8_ASCII_MAX;
+bool sp_parse_s16_ex(sp_str_t str, s16* out) {
+  s64 val;
+  if (!sp_parse_s64_ex(str, &val)) return false;
+  if (val < INT16_MIN || val > INT16_MAX) return false;
+  *out = (s16)val;
+  return true;
 }
 
-u32 sp_utf8_to_lower(u32 codepoint) {
-  if (!sp_utf8_is_codepoint_ascii(codepoint)) return codepoint;
-  return sp_c8_to_lower((c8)codepoint);
+bool sp_parse_u8_ex(sp_str_t str, u8* out) {
+  u64 val;
+  if (!sp_parse_u64_ex(str, &val)) return false;
+  if (val > UINT8_MAX) return false;
+  *out = (u8)val;
+  return true;
 }
 
-u32 sp_utf8_to_upper(u32 codepoint) {
-  if (!sp_utf8_is_codepoint_ascii(codepoint)) return codepoint;
-  return sp_c8_to_upper((c8)codepoint);
+bool sp_parse_s8_ex(sp_str_t str, s8* out) {
+  s64 val;
+  if (!sp_parse_s64_ex(str, &val)) return false;
+  if (val < INT8_MIN || val > INT8_MAX) return false;
+  *out = (s8)val;
+  return true;
 }
 
-
-u32 sp_utf8_mask(u8 byte, u8 mask, u8 shift) {
-  return (u32)((byte & mask) << shift);
+bool sp_parse_is_digit(c8 c) {
+  return c >= '0' && c <= '9';
 }
 
-u32 sp_utf8_decode(const c8* ptr) {
-  if (!ptr) return SP_UTF8_REPLACEMENT;
-  if (sp_utf8_is_byte_ascii(ptr[0])) return ptr[0];
+bool sp_parse_f32_ex(sp_str_t str, f32* out) {
+  size_t i = 0;
+  int sign = 1;
+  f32 value = 0.0f;
+  f32 scale = 1.0f;
+  int exponent = 0;
+  int exp_sign = 1;
+  bool has_digits = false;
 
-  switch (sp_utf8_num_bytes_from_byte(ptr[0])) {
-    case 2: return sp_utf8_mask(ptr[0], 0x1F, 6)  | sp_utf8_mask(ptr[1], 0x3F, 0);
-    case 3: return sp_utf8_mask(ptr[0], 0x0F, 12) | sp_utf8_mask(ptr[1], 0x3F, 6)  | sp_utf8_mask(ptr[2], 0x3F, 0);
-    case 4: return sp_utf8_mask(ptr[0], 0x07, 18) | sp_utf8_mask(ptr[1], 0x3F, 12) | sp_utf8_mask(ptr[2], 0x3F, 6) | sp_utf8_mask(ptr[3], 0x3f, 0);
-    default: return SP_UTF8_REPLACEMENT;
+  if (i < str.len && (str.data[i] == '-' || str.data[i] == '+')) {
+    if (str.data[i] == '-') sign = -1;
+    i++;
   }
-}
 
-u8 sp_utf8_encode(u32 cp, c8* out) {
-  if (!out) return 0;
+  while (i < str.len && sp_parse_is_digit(str.data[i])) {
+    has_digits = true;
+    value = value * 10.0f + (f32)(str.data[i] - '0');
+    i++;
+  }
 
-  u8 len = sp_utf8_num_bytes_from_codepoint(cp);
-  switch (len) {
-    case 1: { out[0] = (u8)cp; break; }
-    case 2: { out[0] = (u8)(0xC0 | (cp >> 6)); out[1] = (u8)(0x80 | (cp & 0x3F)); break; }
-    case 3: { out[0] = (u8)(0xE0 | (cp >> 12)); out[1] = (u8)(0x80 | ((cp >> 6) & 0x3F)); out[2] = (u8)(0x80 | (cp & 0x3F)); break; }
-    case 4: { out[0] = (u8)(0xF0 | (cp >> 18)); out[1] = (u8)(0x80 | ((cp >> 12) & 0x3F)); out[2] = (u8)(0x80 | ((cp >> 6) & 0x3F)); out[3] = (u8)(0x80 | (cp & 0x3F)); break; }
+  if (i < str.len && str.data[i] == '.') {
+    i++;
+    while (i < str.len && sp_parse_is_digit(str.data[i])) {
+      has_digits = true;
+      scale /= 10.0f;
+      value += (f32)(str.data[i] - '0') * scale;
+      i++;
+    }
   }
-  return len;
-}
 
-sp_utf8_it_t sp_utf8_it(sp_str_t str) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_utf8_it_t);
+  if (i < str.len && (str.data[i] == 'e' || str.data[i] == 'E')) {
+    i++;
+    if (i < str.len && (str.data[i] == '-' || str.data[i] == '+')) {
+      if (str.data[i] == '-') exp_sign = -1;
+      i++;
+    }
+    if (i >= str.len || !sp_parse_is_digit(str.data[i])) {
+      return false;
+    }
+    while (i < str.len && sp_parse_is_digit(str.data[i])) {
+      exponent = exponent * 10 + (str.data[i] - '0');
+      i++;
+    }
+    exponent *= exp_sign;
+  }
 
-  return (sp_utf8_it_t) {
-    .str = str,
-    .index = 0,
-    .codepoint = sp_utf8_decode(str.data),
-    .codepoint_len = sp_utf8_num_bytes_from_byte((u8)str.data[0]),
-  };
-}
+  if (i != str.len || !has_digits) {
+    return false;
+  }
 
-sp_utf8_it_t sp_utf8_rit(sp_str_t str) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_utf8_it_t);
+  if (exponent > 0) {
+    for (int j = 0; j < exponent; j++) {
+      value *= 10.0f;
+    }
+  } else if (exponent < 0) {
+    for (int j = 0; j < -exponent; j++) {
+      value /= 10.0f;
+    }
+  }
 
-  // @spader
-  // the cast is objectively wrong here. i just use s32 in the iterator to give me a sentinel when reverse
-  // iterating. which in and of itself is stupid. double down.
-  sp_utf8_it_t it = {
-    .str = str,
-    .index = (s32)str.len
-  };
-  sp_utf8_it_prev(&it);
-  return it;
+  *out = sign * value;
+  return true;
 }
 
-bool sp_utf8_it_valid(sp_utf8_it_t* it) {
-  if (!it) return false;
-  return (it->index < (s32)it->str.len) && (it->index >= 0) && (it->codepoint_len);
+bool sp_parse_f64_ex(sp_str_t str, f64* out) {
+  f32 hack = 0.0f;
+  bool result = sp_parse_f32_ex(str, &hack);
+  *out = hack;
+  return result;
 }
 
-void sp_utf8_it_next(sp_utf8_it_t* it) {
-  if (!it) return;
+bool sp_parse_ptr_ex(sp_str_t str, void** out) {
+  u64 addr;
+  if (!sp_parse_hex_ex(str, &addr)) return false;
+  *out = (void*)(uintptr_t)addr;
+  return true;
+}
 
-  it->index += it->codepoint_len;
-  if (it->index >= (s32)it->str.len) {
-    return;
+bool sp_parse_c8_ex(sp_str_t str, c8* out) {
+  // handle 'a' format
+  if (str.len == 3 && str.data[0] == '\'' && str.data[2] == '\'') {
+    *out = str.data[1];
+    return true;
+  }
+  // handle plain character
+  if (str.len == 1) {
+    *out = str.data[0];
+    return true;
   }
+  return false;
+}
 
-  it->codepoint = sp_utf8_decode(it->str.data + it->index);
-  it->codepoint_len = sp_utf8_num_bytes_from_byte(it->str.data[it->index]);
+bool sp_parse_c16_ex(sp_str_t str, u16* out) {
+  // handle 'a' format
+  if (str.len == 3 && str.data[0] == '\'' && str.data[2] == '\'') {
+    *out = (u16)str.data[1];
+    return true;
+  }
+  // handle 'U+XXXX' format
+  if (str.len >= 8 && str.data[0] == '\'' && str.data[1] == 'U' &&
+      str.data[2] == '+' && str.data[str.len-1] == '\'') {
+    sp_str_t hex_str = sp_str(str.data + 3, str.len - 4);
+    u64 val;
+    if (sp_parse_hex_ex(hex_str, &val) && val <= UINT16_MAX) {
+      *out = (u16)val;
+      return true;
+    }
+  }
+  return false;
 }
 
-void sp_utf8_it_prev(sp_utf8_it_t* it) {
-  if (!it) return;
+bool sp_parse_hex_ex(sp_str_t str, u64* out) {
+  if (str.len == 0) return false;
 
-  while (true) {
-    it->index--;
-    if (it->index < 0) return;
-    if (!sp_utf8_is_cont(it->str.data[it->index])) break;
+  u32 start = 0;
+
+  // skip 0x prefix if present
+  if (str.len >= 2 && str.data[0] == '0' && (str.data[1] == 'x' || str.data[1] == 'X')) {
+    start = 2;
   }
 
-  it->codepoint = sp_utf8_decode(it->str.data + it->index);
-  it->codepoint_len = sp_utf8_num_bytes_from_byte(it->str.data[it->index]);
-}
-
-bool sp_utf8_validate(sp_str_t str) {
-  const c8* ptr = str.data;
-  u32 it = 0;
+  if (start >= str.len) return false;
 
-  while (it < str.len) {
-    u8 len = sp_utf8_num_bytes_from_byte(ptr[it]);
-    if (!len) return false;
-    if (it + len > str.len) return false;
+  u64 result = 0;
+  for (u32 i = start; i < str.len; i++) {
+    c8 ch = str.data[i];
+    u8 digit;
 
-    sp_for_range(j, 1, len) {
-      if (!sp_utf8_is_cont(ptr[it + j])) {
-        return false;
-      }
+    if (ch >= '0' && ch <= '9') {
+      digit = ch - '0';
+    } else if (ch >= 'a' && ch <= 'f') {
+      digit = ch - 'a' + 10;
+    } else if (ch >= 'A' && ch <= 'F') {
+      digit = ch - 'A' + 10;
+    } else {
+      return false;
     }
 
-    u32 codepoint = sp_utf8_decode(&ptr[it]);
-    if (sp_utf8_is_surrogate(codepoint)) return false;
-    if (!sp_utf8_is_bounds_ok(codepoint, len)) return false;
-
-    it += len;
+    if (result > (UINT64_MAX >> 4)) return false; // overflow check
+    result = (result << 4) | digit;
   }
-  return true;
-}
 
-u32 sp_utf8_num_codepoints(sp_str_t str) {
-  u32 count = 0;
-  sp_str_for_utf8(str, it) {
-    count++;
-  }
-  return count;
+  *out = result;
+  return true;
 }
 
-sp_wide_str_t sp_wide_str(const u16* str, u32 len) {
-  return (sp_wide_str_t) {
-    .data = str,
-    .len = len,
-  };
+bool sp_parse_hash_ex(sp_str_t str, sp_hash_t* out) {
+  return sp_parse_hex_ex(str, out);
 }
 
-bool sp_wtf8_validate(sp_str_t str) {
-  const c8* ptr = str.data;
-  u32 it = 0;
-
-  while (it < str.len) {
-    u8 len = sp_utf8_num_bytes_from_byte(ptr[it]);
-    if (!len) return false;
-    if (it + len > str.len) return false;
-
-    sp_for_range(j, 1, len) {
-      if (!sp_utf8_is_cont(ptr[it + j])) return false;
-    }
-
-    u32 cp = sp_utf8_decode(&ptr[it]);
-    if (!sp_utf8_is_bounds_ok(cp, len)) return false;
-
-    it += len;
+bool sp_parse_bool_ex(sp_str_t str, bool* out) {
+  if (sp_str_equal(str, sp_str_lit("true")) || sp_str_equal(str, sp_str_lit("1"))) {
+    *out = true;
+    return true;
   }
-  return true;
-}
-
-sp_wide_str_t sp_wtf8_to_wtf16(sp_mem_t mem, sp_str_t wtf8) {
-  sp_wide_str_t result = sp_zero_s(sp_wide_str_t);
-  if (sp_str_empty(wtf8)) return result;
-
-  u16* buf = sp_alloc_n(mem, u16, wtf8.len + 1);
-  const c8* ptr = wtf8.data;
-  u32 i = 0;
-  u32 n = 0;
-
-  while (i < wtf8.len) {
-    u8 len = sp_utf8_num_bytes_from_byte(ptr[i]);
-    if (!len) goto error;
-    if (i + len > wtf8.len) goto error;
-    sp_for_range(j, 1, len) {
-      if (!sp_utf8_is_cont(ptr[i + j])) goto error;
-    }
-
-    u32 cp = sp_utf8_decode(&ptr[i]);
-    if (!sp_utf8_is_bounds_ok(cp, len)) goto error;
-
-    if (cp < 0x10000) {
-      buf[n++] = (u16)cp;
-    }
-    else {
-      u32 v = cp - 0x10000;
-      buf[n++] = (u16)(0xD800 | (v >> 10));
-      buf[n++] = (u16)(0xDC00 | (v & 0x3FF));
-    }
-
-    i += len;
+  if (sp_str_equal(str, sp_str_lit("false")) || sp_str_equal(str, sp_str_lit("0"))) {
+    *out = false;
+    return true;
   }
-
-  buf[n] = 0;
-  return (sp_wide_str_t) { .data = buf, .len = n };
-
-error:
-  sp_free(mem, buf, (wtf8.len + 1) * sizeof(u16));
-  return result;
+  return false;
 }
 
-sp_str_t sp_wtf16_to_wtf8(sp_mem_t mem, sp_wide_str_t wtf16) {
-  c8* buf = sp_alloc_n(mem, c8, wtf16.len * 3 + 1);
-  u32 offset = 0;
-  sp_for(i, wtf16.len) {
-    u16 u = wtf16.data[i];
-    u32 cp;
-    if (u >= 0xD800 && u <= 0xDBFF && i + 1 < wtf16.len && wtf16.data[i + 1] >= 0xDC00 && wtf16.data[i + 1] <= 0xDFFF) {
-      cp = 0x10000 + (((u32)(u - 0xD800) << 10) | (u32)(wtf16.data[i + 1] - 0xDC00));
-      i++;
-    }
-    else {
-      cp = u;
-    }
-    offset += sp_utf8_encode(cp, buf + offset);
-  }
-  buf[offset] = 0;
-
-  return (sp_str_t) { .data = buf, .len = offset };
+u8 sp_parse_u8(sp_str_t str) {
+  u8 value = sp_zero;
+  sp_parse_u8_ex(str, &value);
+  return value;
 }
 
-sp_str_t sp_str(const c8* str, u32 len) {
-  return (sp_str_t) {
-    .data = str,
-    .len = len
-  };
+u16 sp_parse_u16(sp_str_t str) {
+  u16 value = sp_zero;
+  sp_parse_u16_ex(str, &value);
+  return value;
 }
 
-sp_str_t sp_str_copy(sp_mem_t mem, sp_str_t str) {
-  if (!str.data || !str.len) return sp_zero_s(sp_str_t);
-  c8* buffer = sp_alloc_n(mem, c8, str.len);
-  sp_mem_copy(buffer, str.data, str.len);
-  return sp_str(buffer, str.len);
+u32 sp_parse_u32(sp_str_t str) {
+  u32 value = sp_zero;
+  sp_parse_u32_ex(str, &value);
+  return value;
 }
 
-c8* sp_str_to_cstr(sp_mem_t mem, sp_str_t str) {
-  return sp_cstr_copy_n(mem, str.data, str.len);
+u64 sp_parse_u64(sp_str_t str) {
+  u64 value = sp_zero;
+  sp_parse_u64_ex(str, &value);
+  return value;
 }
 
-sp_str_t sp_str_alloc(sp_mem_t mem, u32 capacity) {
-  if (!capacity) return sp_zero_s(sp_str_t);
-  return SP_RVAL(sp_str_t) {
-    .data = (c8*)sp_mem_allocator_alloc(mem, capacity),
-    .len = 0,
-  };
+s8 sp_parse_s8(sp_str_t str) {
+  s8 value = sp_zero;
+  sp_parse_s8_ex(str, &value);
+  return value;
 }
 
-sp_str_t sp_str_view(const c8* cstr) {
-  return (sp_str_t) {
-    .data = cstr,
-    .len = sp_cstr_len(cstr),
-  };
+s16 sp_parse_s16(sp_str_t str) {
+  s16 value = sp_zero;
+  sp_parse_s16_ex(str, &value);
+  return value;
 }
 
-bool sp_str_empty(sp_str_t str) {
-  return !str.len;
+s32 sp_parse_s32(sp_str_t str) {
+  s32 value = sp_zero;
+  sp_parse_s32_ex(str, &value);
+  return value;
 }
 
-bool sp_str_equal(sp_str_t a, sp_str_t b) {
-  if (a.len != b.len) return false;
-
-  return sp_mem_is_equal(a.data, b.data, a.len);
+s64 sp_parse_s64(sp_str_t str) {
+  s64 value = sp_zero;
+  sp_parse_s64_ex(str, &value);
+  return value;
 }
 
-bool sp_str_equal_cstr(sp_str_t a, const c8* b) {
-  u32 len = sp_cstr_len(b);
-  if (a.len != len) return false;
-
-  return sp_mem_is_equal(a.data, b, len);
+f32 sp_parse_f32(sp_str_t str) {
+  f32 value = sp_zero;
+  sp_parse_f32_ex(str, &value);
+  return value;
 }
 
-bool sp_str_starts_with(sp_str_t str, sp_str_t prefix) {
-  if (str.len < prefix.len) return false;
-
-  return sp_str_equal(sp_str_sub(str, 0, prefix.len), prefix);
+f64 sp_parse_f64(sp_str_t str) {
+  f64 value = sp_zero;
+  sp_parse_f64_ex(str, &value);
+  return value;
 }
 
-bool sp_str_ends_with(sp_str_t str, sp_str_t suffix) {
-  if (str.len < suffix.len) return false;
-
-  return sp_str_equal(sp_str_sub_reverse(str, 0, suffix.len), suffix);
+c8 sp_parse_c8(sp_str_t str) {
+  c8 value = sp_zero;
+  sp_parse_c8_ex(str, &value);
+  return value;
 }
 
-bool sp_str_contains(sp_str_t str, sp_str_t needle) {
-  return sp_str_find(str, needle) != SP_STR_NO_MATCH;
+u16 sp_parse_c16(sp_str_t str) {
+  u16 value = sp_zero;
+  sp_parse_c16_ex(str, &value);
+  return value;
 }
 
-s32 sp_str_find(sp_str_t str, sp_str_t needle) {
-  if (needle.len == 0) return 0;
-  if (str.len < needle.len) return SP_STR_NO_MATCH;
-
-  for (u32 i = 0; i <= str.len - needle.len; i++) {
-    if (sp_mem_is_equal(str.data + i, needle.data, needle.len)) {
-      return (s32)i;
-    }
-  }
-  return SP_STR_NO_MATCH;
+u64 sp_parse_hex(sp_str_t str) {
+  u64 value = sp_zero;
+  sp_parse_hex_ex(str, &value);
+  return value;
 }
 
-s32 sp_str_find_c8(sp_str_t str, c8 needle) {
-  sp_str_for(str, it) {
-    if (str.data[it] == needle) return it;
-  }
+void* sp_parse_ptr(sp_str_t str) {
+  void* value = sp_zero;
+  sp_parse_ptr_ex(str, &value);
+  return value;
+}
 
-  return SP_STR_NO_MATCH;
+bool sp_parse_bool(sp_str_t str) {
+  bool value = sp_zero;
+  sp_parse_bool_ex(str, &value);
+  return value;
 }
 
-s32 sp_str_find_c8_reverse(sp_str_t str, c8 needle) {
-  for (s32 i = str.len - 1; i >= 0; i--) {
-    if (str.data[i] == needle) return i;
-  }
-
-  return SP_STR_NO_MATCH;
+sp_hash_t sp_parse_hash(sp_str_t str) {
+  sp_hash_t value = sp_zero;
+  sp_parse_hash_ex(str, &value);
+  return value;
 }
 
-s32 sp_str_sort_kernel_alphabetical(const void* a, const void* b) {
-  return sp_str_compare_alphabetical(*(sp_str_t*)a, *(sp_str_t*)b);
-}
 
-s32 sp_str_compare_alphabetical(sp_str_t a, sp_str_t b) {
-  u32 i = 0;
-  while (true) {
-    if (i >= a.len && i >= b.len) return SP_QSORT_EQUAL;
-    if (i >= a.len)               return SP_QSORT_A_FIRST;
-    if (i >= b.len)               return SP_QSORT_B_FIRST;
+//  █████          ███████      █████████
+// ░░███         ███░░░░░███   ███░░░░░███
+//  ░███        ███     ░░███ ███     ░░░
+//  ░███       ░███      ░███░███
+//  ░███       ░███      ░███░███    █████
+//  ░███      █░░███     ███ ░░███  ░░███
+//  ███████████ ░░░███████░   ░░█████████
+// ░░░░░░░░░░░    ░░░░░░░      ░░░░░░░░░
+// @log
 
-    if (a.data[i] == b.data[i]) {
-      i++;
-      continue;
+
+//  ██████╗ ██████╗ ███╗   ██╗████████╗███████╗██╗  ██╗████████╗
+// ██╔════╝██╔═══██╗████╗  ██║╚══██╔══╝██╔════╝╚██╗██╔╝╚══██╔══╝
+// ██║     ██║   ██║██╔██╗ ██║   ██║   █████╗   ╚███╔╝    ██║
+// ██║     ██║   ██║██║╚██╗██║   ██║   ██╔══╝   ██╔██╗    ██║
+// ╚██████╗╚██████╔╝██║ ╚████║   ██║   ███████╗██╔╝ ██╗   ██║
+//  ╚═════╝ ╚═════╝ ╚═╝  ╚═══╝   ╚═╝   ╚══════╝╚═╝  ═╝   ╚═╝
+//  @context
+SP_PRIVATE void sp_tls_rt_deinit(void *data);
+SP_PRIVATE void sp_rt_init();
+
+sp_mem_arena_t* sp_tls_rt_get_scratch_arena(sp_tls_rt_t* tls) {
+  return tls->scratch[0];
+}
+
+sp_mem_arena_t* sp_tls_rt_get_scratch_arena_for(sp_tls_rt_t* tls, sp_mem_t mem) {
+  sp_carr_for(tls->scratch, it) {
+    sp_mem_t arena = sp_mem_arena_as_allocator(tls->scratch[it]);
+    if (arena.on_alloc != mem.on_alloc || arena.user_data != mem.user_data) {
+      return tls->scratch[it];
     }
-    if (a.data[i] > b.data[i]) return SP_QSORT_B_FIRST;
-    if (b.data[i] > a.data[i]) return SP_QSORT_A_FIRST;
   }
 
+  sp_unreachable_return(SP_NULLPTR);
 }
 
-bool sp_str_valid(sp_str_t str) {
-  return str.data != NULL;
+
+void sp_rt_init() {
+  sp_tls_new(&sp_rt.tls.key, sp_tls_rt_deinit);
+  sp_mutex_init(&sp_rt.mutex, SP_MUTEX_PLAIN);
+#if defined(SP_WIN32)
+  sp_nt_load();
+#endif
 }
 
-c8 sp_str_at(sp_str_t str, s32 index) {
-  if (index < 0) {
-    index = str.len + index;
+void sp_tls_rt_deinit(void* ptr) {
+  if (!ptr) return;
+  sp_tls_rt_t* tls = (sp_tls_rt_t*)ptr;
+  if (tls->std.out) sp_mem_allocator_free(tls->mem.heap, tls->std.out, sizeof(sp_io_stream_writer_t));
+  if (tls->std.err) sp_mem_allocator_free(tls->mem.heap, tls->std.err, sizeof(sp_io_stream_writer_t));
+  sp_carr_for(tls->scratch, it) {
+    sp_mem_arena_destroy(tls->scratch[it]);
   }
-  return str.data[index];
+  sp_mem_heap_destroy(tls->allocators.heap);
+  sp_sys_free(tls, sizeof(sp_tls_rt_t));
 }
 
-c8 sp_str_at_reverse(sp_str_t str, s32 index) {
-  if (index < 0) {
-    index = str.len + index;
+sp_tls_rt_t* sp_tls_rt_get() {
+  sp_tls_once(&sp_rt.tls.once, sp_rt_init);
+
+  sp_tls_rt_t* tls = (sp_tls_rt_t*)sp_tls_get(sp_rt.tls.key);
+  if (!tls) {
+    // It's important that you bootstrap the allocator and set the TLS key
+    // before doing anything else so you can call functions that allocate
+    // while initializing the other TLS stuff.
+    tls = sp_sys_alloc_type(sp_tls_rt_t);
+    tls->allocators.heap = sp_mem_heap_new();
+    tls->mem.heap = sp_mem_heap_as_allocator(tls->allocators.heap);
+    tls->mem.page = sp_mem_os_new();
+    sp_tls_set(sp_rt.tls.key, tls);
+
+    sp_carr_for(tls->scratch, it) {
+      tls->scratch[it] = sp_mem_arena_new(tls->mem.page);
+    }
+    // std.out/std.err are wired lazily (see sp_tls_std_out/_err). Wiring them here
+    // would take the address of sp_io_stream_writer_write in code that sp_main always
+    // reaches, which on WASM forces a fd_write import even for programs that never write.
+    sp_sys_tls_init(tls);
   }
-  return str.data[str.len - index - 1];
+  return tls;
 }
 
-c8 sp_str_back(sp_str_t str) {
-  return str.len ? str.data[str.len - 1] : 0;
+sp_io_writer_t* sp_tls_std_out(sp_tls_rt_t* tls) {
+  if (!tls->std.out) {
+    tls->std.out = sp_alloc_type(tls->mem.heap, sp_io_stream_writer_t);
+    sp_io_stream_writer_from_fd(tls->std.out, sp_sys_stdout, SP_IO_CLOSE_MODE_NONE);
+  }
+  return &tls->std.out->base;
 }
 
-
-sp_str_t sp_str_prefix(sp_str_t str, s32 len) {
-  return sp_str_sub(str, 0, len);
+sp_io_writer_t* sp_tls_std_err(sp_tls_rt_t* tls) {
+  if (!tls->std.err) {
+    tls->std.err = sp_alloc_type(tls->mem.heap, sp_io_stream_writer_t);
+    sp_io_stream_writer_from_fd(tls->std.err, sp_sys_stderr, SP_IO_CLOSE_MODE_NONE);
+  }
+  return &tls->std.err->base;
 }
 
-sp_str_t sp_str_suffix(sp_str_t str, s32 len) {
-  return sp_str_sub(str, str.len - len, len);
-}
+#if defined(SP_FREESTANDING)
+void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
 
-sp_str_t sp_str_sub(sp_str_t str, s32 index, s32 len) {
-  SP_ASSERT(index + len <= (s32)str.len);
-  if (!len) return sp_zero_s(sp_str_t);
-  return sp_str(str.data + index, (u32)len);
 }
 
-sp_str_t sp_str_sub_reverse(sp_str_t str, s32 index, s32 len) {
-  if (!len) return sp_zero_s(sp_str_t);
-  return (sp_str_t) {
-    .data = str.data + str.len + index - len,
-    .len = (u32)len,
-  };
+void* sp_tls_get(sp_tls_key_t key) {
+  sp_tls_block_t* tb = (sp_tls_block_t*)sp_sys_get_tp();
+  return tb ? tb->data : 0;
 }
 
-c8* sp_cstr_from_str(sp_mem_t mem, sp_str_t str) {
-  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, str.len + 1);
-  if (str.len) sp_mem_copy(buffer, str.data, str.len);
-  buffer[str.len] = '\0';
-  return buffer;
+void sp_tls_set(sp_tls_key_t key, void* data) {
+  sp_tls_block_t* tb = (sp_tls_block_t*)sp_sys_get_tp();
+  if (tb) tb->data = data;
 }
 
-sp_str_t sp_str_from_cstr_n(sp_mem_t mem, const c8* str, u32 length) {
-  if (!str || !length) return sp_zero_s(sp_str_t);
-  u32 len = sp_min(sp_cstr_len(str), length);
-  if (!len) return sp_zero_s(sp_str_t);
-  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, length);
-  sp_mem_copy(buffer, str, len);
+void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
 
-  return sp_str(buffer, len);
 }
 
-sp_str_t sp_str_from_cstr(sp_mem_t mem, const c8* str) {
-  if (!str) return sp_zero_s(sp_str_t);
-  u32 len = sp_cstr_len(str);
-  if (!len) return sp_zero_s(sp_str_t);
-  c8* buffer = sp_alloc_n(mem, c8, len + 1);
-  sp_mem_copy(buffer, str, len);
-
-  return sp_str(buffer, len);
+#elif defined(SP_WASM)
+void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
+  (void)key; (void)on_deinit;
 }
 
-void sp_str_copy_to(sp_str_t str, c8* buffer, u32 capacity) {
-  if (!str.data) return;
-  sp_mem_copy(buffer, str.data, sp_min(str.len, capacity));
+void* sp_tls_get(sp_tls_key_t key) {
+  sp_unused(key);
+  return sp_tls_block.data;
 }
 
-sp_str_it_t sp_str_it(sp_str_t str) {
-  return (sp_str_it_t) {
-    .str = str,
-    .index = 0,
-    .c = str.len ? str.data[0] : '\0'
-  };
+void sp_tls_set(sp_tls_key_t key, void* data) {
+  sp_unused(key);
+  sp_tls_block.data = data;
 }
 
-bool sp_str_it_valid(sp_str_it_t* it) {
-  return it->index < it->str.len;
+void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
+  if (*once) return;
+  fn();
+  *once = 1;
 }
 
-void sp_str_it_next(sp_str_it_t* it) {
-  it->index++;
-  it->c = sp_str_it_valid(it) ? it->str.data[it->index] : 0;
+#elif defined(SP_WIN32)
+void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
+  SP_UNUSED(on_deinit);
+  *key = TlsAlloc();
 }
 
-sp_str_t sp_str_concat(sp_mem_t mem, sp_str_t a, sp_str_t b) {
-  u32 len = a.len + b.len;
-  if (!len) return sp_zero_s(sp_str_t);
-  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, len);
-  if (a.len) sp_mem_copy(buffer, a.data,         a.len);
-  if (b.len) sp_mem_copy(buffer + a.len, b.data, b.len);
-  return sp_str(buffer, len);
+void* sp_tls_get(sp_tls_key_t key) {
+  return TlsGetValue(key);
 }
 
-sp_str_t sp_str_join(sp_mem_t mem, sp_str_t a, sp_str_t b, sp_str_t join) {
-  u32 len = a.len + join.len + b.len;
-  if (!len) return sp_zero_s(sp_str_t);
-  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, len);
-  c8* p = buffer;
-  if (a.len)    { sp_mem_copy(p,    a.data, a.len);    p += a.len; }
-  if (join.len) { sp_mem_copy(p, join.data, join.len); p += join.len; }
-  if (b.len)    { sp_mem_copy(p,    b.data, b.len); }
-  return sp_str(buffer, len);
+void sp_tls_set(sp_tls_key_t key, void* data) {
+  TlsSetValue(key, data);
 }
 
-sp_str_t sp_str_join_cstr_n(sp_mem_t mem, const c8** strings, u32 num_strings, sp_str_t join) {
-  if (!strings) num_strings = 0;
-  sp_io_dyn_mem_writer_t builder = sp_zero;
-  sp_io_dyn_mem_writer_init(mem, &builder);
-  for (u32 index = 0; index < num_strings; index++) {
-    sp_io_write_cstr(&builder.base, strings[index], SP_NULLPTR);
+SP_PRIVATE BOOL CALLBACK sp_tls_once_trampoline(PINIT_ONCE once, PVOID param, PVOID* ctx) {
+  SP_UNUSED(once);
+  SP_UNUSED(ctx);
+  sp_tls_once_fn_t fn = *(sp_tls_once_fn_t*)param;
+  fn();
+  return TRUE;
+}
 
-    if (index != (num_strings - 1)) {
-      sp_io_write_str(&builder.base, join, SP_NULLPTR);
-    }
-  }
+void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
+  sp_tls_once_fn_t callback = fn;
+  InitOnceExecuteOnce(once, sp_tls_once_trampoline, &callback, SP_NULLPTR);
+}
 
-  return sp_io_dyn_mem_writer_as_str(&builder);
+#elif defined(SP_POSIX)
+void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
+  pthread_key_create(key, on_deinit);
 }
 
-sp_str_t sp_str_pad(sp_mem_t mem, sp_str_t str, u32 n) {
-  s32 delta = (s32)n - (s32)str.len;
-  if (delta <= 0) return sp_str_copy(mem, str);
+void* sp_tls_get(sp_tls_key_t key) {
+  return pthread_getspecific(key);
+}
 
-  sp_mem_buffer_t buffer = {
-    .data = sp_alloc_n(mem, u8, n),
-    .len = n,
-    .capacity = n,
-  };
-  sp_sys_memcpy(buffer.data, str.data, str.len);
-  sp_sys_memset(buffer.data + str.len, ' ', (u8)delta);
+void sp_tls_set(sp_tls_key_t key, void* data) {
+  pthread_setspecific(key, data);
+}
 
-  return sp_mem_buffer_as_str(&buffer);
+void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
+  pthread_once(once, fn);
 }
 
-sp_str_t sp_str_replace_c8(sp_mem_t mem, sp_str_t str, c8 from, c8 to) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
-  sp_mem_buffer_t buffer = {
-    .data = sp_alloc_n(mem, u8, str.len),
-    .len = str.len,
-    .capacity = str.len,
-  };
-
-  for (u32 i = 0; i < str.len; i++) {
-    c8 c = str.data[i];
-    buffer.data[i] = (u8)(c == from ? to : c);
-  }
-
-  return sp_mem_buffer_as_str(&buffer);
+#else
+void sp_tls_new(sp_tls_key_t* key, sp_tls_deinit_fn_t on_deinit) {
+  SP_UNIMPLEMENTED();
 }
 
-sp_da(sp_str_t) sp_str_split_c8(sp_mem_t mem, sp_str_t str, c8 delimiter) {
-  if (sp_str_empty(str)) return SP_NULLPTR;
-
-  sp_da(sp_str_t) result = sp_da_new(mem, sp_str_t);
-
-  u32 i = 0, j = 0;
-  for (; j < str.len; j++) {
-    if (sp_str_at(str, j) == delimiter) {
-      sp_da_push(result, sp_str_sub(str, i, j - i));
-      i = j + 1;
-    }
-  }
-
-  sp_da_push(result, sp_str_sub(str, i, j - i));
-
-  return result;
+void* sp_tls_get(sp_tls_key_t key) {
+  SP_UNIMPLEMENTED();
+  return SP_NULLPTR;
 }
-sp_str_pair_t sp_str_cleave_c8(sp_str_t str, c8 delimiter) {
-  sp_str_pair_t result = sp_zero_s(sp_str_pair_t);
 
-  for (u32 i = 0; i < str.len; i++) {
-    if (sp_str_at(str, i) == delimiter) {
-      result.first = sp_str_sub(str, 0, i);
-      result.second = sp_str_sub(str, i + 1, str.len - i - 1);
-      return result;
-    }
-  }
+void sp_tls_set(sp_tls_key_t key, void* data) {
+  SP_UNIMPLEMENTED();
+}
 
-  result.first = sp_str_empty(str) ? sp_zero_s(sp_str_t) : str;
-  result.second = sp_zero_s(sp_str_t);
-  return result;
+void sp_tls_once(sp_tls_once_t* once, sp_tls_once_fn_t fn) {
+  SP_UNIMPLEMENTED();
 }
+#endif
 
-sp_str_t sp_str_trim_right(sp_str_t str) {
-  while (str.len) {
-    c8 c = sp_str_back(str);
 
-    switch (c) {
-      case ' ':
-      case '\t':
-      case '\r':
-      case '\n': {
-        str.len--;
-        break;
-      }
-      default: {
-        return str;
-      }
-    }
-  }
+//  ██████   ██████ ██████████ ██████   ██████    ███████    ███████████   █████ █████
+// ░░██████ ██████ ░░███░░░░░█░░██████ ██████   ███░░░░░███ ░░███░░░░░███ ░░███ ░░███
+//  ░███░█████░███  ░███  █ ░  ░███░█████░███  ███     ░░███ ░███    ░███  ░░███ ███
+//  ░███░░███ ░███  ░██████    ░███░░███ ░███ ░███      ░███ ░██████████    ░░█████
+//  ░███ ░░░  ░███  ░███░░█    ░███ ░░░  ░███ ░███      ░███ ░███░░░░░███    ░░███
+//  ░███      ░███  ░███ ░   █ ░███      ░███ ░░███     ███  ░███    ░███     ░███
+//  █████     █████ ██████████ █████     █████ ░░░███████░   █████   █████    █████
+// ░░░░░     ░░░░░ ░░░░░░░░░░ ░░░░░     ░░░░░    ░░░░░░░    ░░░░░   ░░░░░    ░░░░░
+// @memory
 
-  return sp_zero_s(sp_str_t);
+void* sp_mem_allocator_alloc(sp_mem_t allocator, u64 size) {
+  return allocator.on_alloc(allocator.user_data, SP_ALLOCATOR_MODE_ALLOC, size, NULL, 0);
 }
 
-sp_str_t sp_str_trim_left(sp_str_t str) {
-  sp_str_t trimmed = str;
-
-  sp_str_for_it(str, it) {
-    switch (it.c) {
-      case ' ':
-      case '\t':
-      case '\r':
-      case '\n': {
-        trimmed.data++; trimmed.len--;
-        break;
-      }
-      default: {
-        return trimmed;
-      }
-    }
-  }
-
-  return sp_zero_s(sp_str_t);
+void* sp_mem_allocator_realloc(sp_mem_t allocator, void* memory, u64 old_size, u64 size) {
+  return allocator.on_alloc(allocator.user_data, SP_ALLOCATOR_MODE_RESIZE, size, memory, old_size);
 }
 
-sp_str_t sp_str_trim(sp_str_t str) {
-  sp_str_t trimmed = str;
-  trimmed = sp_str_trim_left(trimmed);
-  trimmed = sp_str_trim_right(trimmed);
-  return trimmed;
+void sp_mem_allocator_free(sp_mem_t allocator, void* buffer, u64 size) {
+  allocator.on_alloc(allocator.user_data, SP_ALLOCATOR_MODE_FREE, 0, buffer, size);
 }
 
-sp_str_t sp_str_strip_left(sp_str_t str, sp_str_t strip) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
-  if (!sp_str_starts_with(str, strip)) return str;
-  return sp_str_suffix(str, str.len - strip.len);
+u8* sp_mem_arena_block_buffer(sp_mem_arena_block_t* block) {
+  return (u8*)(block + 1);
 }
 
-sp_str_t sp_str_strip_right(sp_str_t str, sp_str_t strip) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
-  if (!sp_str_ends_with(str, strip)) return str;
-  return sp_str_prefix(str, str.len - strip.len);
+sp_mem_arena_block_t* sp_mem_arena_block_new(sp_mem_arena_t* arena, u64 block_size) {
+  sp_mem_arena_block_t* block = (sp_mem_arena_block_t*)sp_mem_allocator_alloc(arena->allocator, block_size);
+  if (!block) return SP_NULLPTR;
+  block->next = SP_NULLPTR;
+  block->capacity = block_size - sizeof(sp_mem_arena_block_t);
+  block->bytes_used = 0;
+  return block;
 }
 
-sp_str_t sp_str_strip(sp_str_t str, sp_str_t strip) {
-  sp_str_t result = sp_str_strip_left(str, strip);
-  return sp_str_strip_right(result, strip);
+sp_mem_arena_t* sp_mem_arena_new(sp_mem_t mem) {
+  return sp_mem_arena_new_ex(mem, 4096, SP_MEM_ALIGNMENT);
 }
 
-sp_str_t sp_str_to_upper(sp_mem_t mem, sp_str_t str) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
-  sp_mem_buffer_t buffer = {
-    .data = sp_alloc_n(mem, u8, str.len),
-    .capacity = str.len,
-  };
+sp_mem_arena_t* sp_mem_arena_new_ex(sp_mem_t mem, u64 block_size, u8 alignment) {
+  sp_mem_arena_t* arena = (sp_mem_arena_t*)sp_mem_allocator_alloc(mem, sizeof(sp_mem_arena_t));
+  if (!arena) return SP_NULLPTR;
+  arena->allocator = mem;
+  arena->alignment = alignment == 0 ? SP_MEM_ALIGNMENT : alignment;
+  sp_assert((arena->alignment & (arena->alignment - 1)) == 0);
+  arena->block_size = sp_max(block_size, sizeof(sp_mem_arena_block_t) + arena->alignment);
 
-  sp_str_for_utf8(str, it) {
-    buffer.len += sp_utf8_encode(sp_utf8_to_upper(it.codepoint), (c8*)buffer.data + buffer.len);
+  sp_mem_arena_block_t* block = sp_mem_arena_block_new(arena, arena->block_size);
+  if (!block) {
+    sp_mem_allocator_free(mem, arena, sizeof(sp_mem_arena_t));
+    return SP_NULLPTR;
   }
-
-  return sp_mem_buffer_as_str(&buffer);
+  arena->head = block;
+  arena->current = block;
+  return arena;
 }
 
-sp_str_t sp_str_to_lower(sp_mem_t mem, sp_str_t str) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
-  sp_mem_buffer_t buffer = {
-    .data = sp_alloc_n(mem, u8, str.len),
-    .capacity = str.len,
+sp_mem_t sp_mem_arena_as_allocator(sp_mem_arena_t* a) {
+  return (sp_mem_t) {
+    .on_alloc = sp_mem_arena_on_alloc,
+    .user_data = a
   };
-
-  sp_str_for_utf8(str, it) {
-    buffer.len += sp_utf8_encode(sp_utf8_to_lower(it.codepoint), (c8*)buffer.data + buffer.len);
-  }
-
-  return sp_mem_buffer_as_str(&buffer);
 }
 
-sp_str_t sp_str_to_pascal_case(sp_mem_t mem, sp_str_t str) {
-  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
-  sp_mem_buffer_t buffer = {
-    .data = sp_alloc_n(mem, u8, str.len),
-    .capacity = str.len,
-  };
-  bool word = true;
+void sp_mem_arena_clear(sp_mem_arena_t* arena) {
+  arena->head->bytes_used = 0;
+  arena->current = arena->head;
+}
 
-  sp_str_for_utf8(str, it) {
-    u32 cp;
-    switch (it.codepoint) {
-      case ' ':
-      case '\t':
-      case '\n':
-      case '\r': {
-        cp = it.codepoint;
-        word = true;
-        break;
-      }
-      default: {
-        cp = word ? sp_utf8_to_upper(it.codepoint) : sp_utf8_to_lower(it.codepoint);
-        word = false;
-        break;
-      }
-    }
-    buffer.len += sp_utf8_encode(cp, (c8*)buffer.data + buffer.len);
+void sp_mem_arena_destroy(sp_mem_arena_t* arena) {
+  sp_mem_arena_block_t* block = arena->head;
+  while (block) {
+    sp_mem_arena_block_t* next = block->next;
+    sp_mem_allocator_free(arena->allocator, block, sizeof(sp_mem_arena_block_t) + block->capacity);
+    block = next;
   }
 
-  return sp_mem_buffer_as_str(&buffer);
+  arena->head = SP_NULLPTR;
+  arena->current = SP_NULLPTR;
+  sp_mem_allocator_free(arena->allocator, arena, sizeof(sp_mem_arena_t));
 }
 
-sp_str_t sp_str_truncate(sp_mem_t mem, sp_str_t str, u32 max_len, sp_str_t trailer) {
-  if (!max_len) return sp_str_copy(mem, str);
-  if (str.len <= max_len) return sp_str_copy(mem, str);
-  if (trailer.len > max_len) return sp_str_copy(mem, str);
-
-  return sp_str_concat(mem, sp_str_prefix(str, max_len - trailer.len), trailer);
+u64 sp_mem_arena_capacity(sp_mem_arena_t* arena) {
+  u64 total = 0;
+  for (sp_mem_arena_block_t* block = arena->head; block; block = block->next) {
+    total += block->capacity;
+  }
+  return total;
 }
 
-sp_da(sp_str_t) sp_str_map(sp_mem_t mem, sp_str_t* strs, u32 num_strs, void* user_data, sp_str_map_fn_t fn) {
-  sp_da(sp_str_t) results = sp_da_new(mem, sp_str_t);
-
-  sp_for(it, num_strs) {
-    sp_str_map_context_t context = {
-      .mem = mem,
-      .str = strs[it],
-      .user_data = user_data
-    };
-    sp_str_t result = fn(&context);
-    sp_da_push(results, result);
+u64 sp_mem_arena_bytes_used(sp_mem_arena_t* arena) {
+  u64 total = 0;
+  for (sp_mem_arena_block_t* block = arena->head; ; block = block->next) {
+    total += block->bytes_used;
+    if (block == arena->current) break;
   }
-
-  return results;
+  return total;
 }
 
-sp_str_t sp_str_map_kernel_prepend(sp_str_map_context_t* context) {
-  sp_str_t prefix = *(sp_str_t*)context->user_data;
-  return sp_str_concat(context->mem, prefix, context->str);
+u64 sp_mem_arena_block_align(sp_mem_arena_block_t* block, u8 alignment) {
+  u8* buffer = sp_mem_arena_block_buffer(block);
+  u8* ptr = (u8*)sp_align_up(buffer + block->bytes_used, alignment);
+  return (u64)(ptr - buffer);
 }
 
-sp_str_t sp_str_map_kernel_append(sp_str_map_context_t* context) {
-  sp_str_t suffix = *(sp_str_t*)context->user_data;
-  return sp_str_concat(context->mem, context->str, suffix);
+bool sp_mem_arena_block_fits(sp_mem_arena_block_t* block, u64 offset, u64 size) {
+  return offset <= block->capacity && size <= block->capacity - offset;
 }
 
-sp_str_t sp_str_map_kernel_prefix(sp_str_map_context_t* context) {
-  u32 len;
-  sp_mem_copy(&len, context->user_data, sizeof(len));
-  return sp_str_sub(context->str, 0, len);
-}
+sp_mem_arena_block_t* sp_mem_arena_get_block(sp_mem_arena_t* arena, u64 size) {
+  sp_mem_arena_block_t* block = arena->current;
+  u64 offset = sp_mem_arena_block_align(block, arena->alignment);
+  if (sp_mem_arena_block_fits(block, offset, size)) {
+    block->bytes_used = offset;
+    return block;
+  }
 
-sp_str_t sp_str_map_kernel_pad(sp_str_map_context_t* context) {
-  u32 len;
-  sp_mem_copy(&len, context->user_data, sizeof(len));
-  return sp_str_pad(context->mem, context->str, len);
-}
+  if (block->next) {
+    sp_mem_arena_block_t* next = block->next;
+    next->bytes_used = 0;
+    u64 next_offset = sp_mem_arena_block_align(next, arena->alignment);
+    if (sp_mem_arena_block_fits(next, next_offset, size)) {
+      next->bytes_used = next_offset;
+      arena->current = next;
+      return next;
+    }
+  }
 
-sp_str_t sp_str_map_kernel_trim(sp_str_map_context_t* context) {
-  return sp_str_trim(context->str);
+  if (arena->block_size < SP_MEM_ARENA_MAX_BLOCK_SIZE) {
+    arena->block_size = sp_min(arena->block_size * 2, (u64)SP_MEM_ARENA_MAX_BLOCK_SIZE);
+  }
+  u64 required = sizeof(sp_mem_arena_block_t) + arena->alignment + size;
+  sp_mem_arena_block_t* new_block = sp_mem_arena_block_new(arena, sp_max(arena->block_size, required));
+  if (!new_block) return SP_NULLPTR;
+  new_block->next = block->next;
+  block->next = new_block;
+  new_block->bytes_used = sp_mem_arena_block_align(new_block, arena->alignment);
+  arena->current = new_block;
+  return new_block;
 }
 
-sp_str_t sp_str_map_kernel_to_upper(sp_str_map_context_t* context) {
-  return sp_str_to_upper(context->mem, context->str);
-}
+void* sp_mem_arena_alloc_size(sp_mem_arena_t* arena, u64 size) {
+  if (size > ((u64)-1) - SP_MEM_ARENA_MAX_BLOCK_SIZE) return SP_NULLPTR;
 
-sp_str_t sp_str_map_kernel_to_lower(sp_str_map_context_t* context) {
-  return sp_str_to_lower(context->mem, context->str);
-}
+  sp_mem_arena_block_t* block = sp_mem_arena_get_block(arena, size);
+  if (!block) return SP_NULLPTR;
 
-sp_str_t sp_str_map_kernel_pascal_case(sp_str_map_context_t* context) {
-  return sp_str_to_pascal_case(context->mem, context->str);
+  void* ptr = sp_mem_arena_block_buffer(block) + block->bytes_used;
+  block->bytes_used += size;
+  sp_mem_zero(ptr, size);
+  return ptr;
 }
 
-sp_da(sp_str_t) sp_str_pad_to_longest(sp_mem_t mem, sp_str_t* strs, u32 n) {
-  u32 max_len = 0;
-  sp_for(i, n) {
-    if (strs[i].len > max_len) max_len = strs[i].len;
-  }
-  return sp_str_map(mem, strs, n, &max_len, sp_str_map_kernel_pad);
+bool sp_mem_arena_is_top(sp_mem_arena_t* arena, void* ptr, u64 size) {
+  sp_mem_arena_block_t* block = arena->current;
+  u8* buffer = sp_mem_arena_block_buffer(block);
+  return (u8*)ptr >= buffer && (u8*)ptr + size == buffer + block->bytes_used;
 }
 
+void* sp_mem_arena_on_alloc(void* user_data, sp_mem_alloc_mode_t mode, u64 size, void* old_memory, u64 old_size) {
+  sp_mem_arena_t* arena = (sp_mem_arena_t*)user_data;
 
-// ███████████ █████ █████       ██████████  █████████  █████ █████  █████████  ███████████ ██████████ ██████   ██████
-// ░░███░░░░░░█░░███ ░░███       ░░███░░░░░█ ███░░░░░███░░███ ░░███  ███░░░░░███░█░░░███░░░█░░███░░░░░█░░██████ ██████
-//  ░███   █ ░  ░███  ░███        ░███  █ ░ ░███    ░░░  ░░███ ███  ░███    ░░░ ░   ░███  ░  ░███  █ ░  ░███░█████░███
-//  ░███████    ░███  ░███        ░██████   ░░█████████   ░░█████   ░░█████████     ░███     ░██████    ░███░░███ ░███
-//  ░███░░░█    ░███  ░███        ░███░░█    ░░░░░░░░███   ░░███     ░░░░░░░░███    ░███     ░███░░█    ░███ ░░░  ░███
-//  ░███  ░     ░███  ░███      █ ░███ ░   █ ███    ░███    ░███     ███    ░███    ░███     ░███ ░   █ ░███      ░███
-//  █████       █████ ███████████ ██████████░░█████████     █████   ░░█████████     █████    ██████████ █████     █████
-// ░░░░░       ░░░░░ ░░░░░░░░░░░ ░░░░░░░░░░  ░░░░░░░░░     ░░░░░     ░░░░░░░░░     ░░░░░    ░░░░░░░░░░ ░░░░░     ░░░░░
-// @fs @filesystem
+  switch (mode) {
+    case SP_ALLOCATOR_MODE_ALLOC: {
+      return sp_mem_arena_alloc_size(arena, size);
+    }
+    case SP_ALLOCATOR_MODE_RESIZE: {
+      if (!old_memory) return sp_mem_arena_alloc_size(arena, size);
 
-//////////////
-// ITERATOR //
-//////////////
-SP_PRIVATE bool sp_sys_diriter_is_dot(const c8* name) {
-  return name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0));
-}
+      sp_mem_arena_block_t* block = arena->current;
+      if (sp_mem_arena_is_top(arena, old_memory, old_size)) {
+        if (size <= old_size) {
+          block->bytes_used -= old_size - size;
+          return old_memory;
+        }
+        u64 grow = size - old_size;
+        if (grow <= block->capacity - block->bytes_used) {
+          sp_mem_zero(sp_mem_arena_block_buffer(block) + block->bytes_used, grow);
+          block->bytes_used += grow;
+          return old_memory;
+        }
+      }
 
-s32 sp_sys_fs_it_open_s(sp_sys_fd_t fd, sp_sys_fs_it_t* it, sp_str_t path, sp_mem_slice_t buf) {
-  return sp_sys_fs_it_open(fd, it, path.data, path.len, buf.data, buf.len);
-}
+      if (size <= old_size) return old_memory;
 
-#if defined(SP_WIN32)
-SP_PRIVATE sp_fs_kind_t sp_sys_diriter_win32_attrs(sp_win32_dword_t attrs) {
-  if (attrs & FILE_ATTRIBUTE_REPARSE_POINT) return SP_FS_KIND_SYMLINK;
-  if (attrs & FILE_ATTRIBUTE_DIRECTORY) return SP_FS_KIND_DIR;
-  return SP_FS_KIND_FILE;
-}
+      void* fresh = sp_mem_arena_alloc_size(arena, size);
+      if (!fresh) return SP_NULLPTR;
+      sp_mem_move(fresh, old_memory, old_size);
+      return fresh;
+    }
+    case SP_ALLOCATOR_MODE_FREE: {
+      if (old_memory && sp_mem_arena_is_top(arena, old_memory, old_size)) {
+        arena->current->bytes_used -= old_size;
+      }
+      return SP_NULLPTR;
+    }
+  }
 
-SP_PRIVATE bool sp_sys_diriter_win32_is_dot(const u16* name) {
-  if (name[0] == '.' && name[1] == 0) return true;
-  if (name[0] == '.' && name[1] == '.' && name[2] == 0) return true;
-  return false;
+  SP_UNREACHABLE_RETURN(SP_NULLPTR);
 }
 
-SP_PRIVATE u32 sp_sys_diriter_win32_name_len(const u16* name) {
-  u32 n = 0;
-  while (name[n]) n++;
-  return n;
+void* sp_mem_arena_alloc(sp_mem_arena_t* arena, u64 size) {
+  return sp_mem_arena_on_alloc(arena, SP_ALLOCATOR_MODE_ALLOC, size, SP_NULLPTR, 0);
 }
 
-s32 sp_sys_fs_it_open(sp_sys_fd_t fd, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
-  (void)fd;
-  *it = sp_zero_s(sp_sys_fs_it_t);
-  if (cap < sizeof(sp_win32_find_data_t) + (MAX_PATH * 3 + 1)) return -1;
+void* sp_mem_arena_realloc(sp_mem_arena_t* arena, void* ptr, u64 old_size, u64 size) {
+  return sp_mem_arena_on_alloc(arena, SP_ALLOCATOR_MODE_RESIZE, size, ptr, old_size);
+}
 
-  SP_ALIGNED u8 pattern_storage [SP_PATH_MAX];
-  sp_mem_fixed_t pattern_fixed = sp_mem_fixed(pattern_storage, sizeof(pattern_storage));
-  sp_mem_t pattern_mem = sp_mem_fixed_as_allocator(&pattern_fixed);
-  sp_str_t pattern = sp_fs_join_path(pattern_mem, sp_str(path, path_len), sp_str_lit("*"));
+void sp_mem_arena_free(sp_mem_arena_t* arena, void* ptr, u64 size) {
+  sp_mem_arena_on_alloc(arena, SP_ALLOCATOR_MODE_FREE, 0, ptr, size);
+}
 
-  sp_sys_nt_path_t nt = sp_zero;
-  if (!SP_NT_SUCCESS(sp_sys_nt_path(pattern, &nt))) {
-    return -1;
-  }
+sp_mem_fixed_t sp_mem_fixed(void* buffer, u64 capacity) {
+  return sp_mem_fixed_ex(buffer, capacity, SP_MEM_ALIGNMENT);
+}
 
-  u32 w_off = 0;
-  if (nt.name.Length >= 8 && nt.name.Buffer[0] == '\\' && nt.name.Buffer[1] == '?' && nt.name.Buffer[2] == '?' && nt.name.Buffer[3] == '\\') {
-    w_off = 4;
-  }
-  u32 prefixed_len = 4 + (nt.name.Length / sizeof(u16)) - w_off;
-  u16 wpat [SP_PATH_MAX + 8];
-  wpat[0] = '\\'; wpat[1] = '\\'; wpat[2] = '?'; wpat[3] = '\\';
-  sp_mem_copy(wpat + 4, nt.name.Buffer + w_off, nt.name.Length - w_off * sizeof(u16));
-  wpat[prefixed_len] = 0;
-  sp_sys_nt_path_free(&nt);
+sp_mem_fixed_t sp_mem_fixed_ex(void* buffer, u64 capacity, u8 alignment) {
+  return (sp_mem_fixed_t) {
+    .buffer = (u8*)buffer,
+    .capacity = capacity,
+    .bytes_used = 0,
+    .alignment = sp_cast(u8, alignment == 0 ? SP_MEM_ALIGNMENT : alignment),
+  };
+}
 
-  sp_win32_find_data_t* find = (sp_win32_find_data_t*)buf;
-  HANDLE h = FindFirstFileW((LPCWSTR)wpat, find);
-  if (h == INVALID_HANDLE_VALUE) return -1;
+sp_mem_t sp_mem_fixed_as_allocator(sp_mem_fixed_t* fixed) {
+  return (sp_mem_t) {
+    .on_alloc = sp_mem_fixed_on_alloc,
+    .user_data = fixed,
+  };
+}
 
-  it->handle = (s64)(intptr_t)h;
-  it->buf.data = (u8*)buf;
-  it->buf.capacity = cap;
-  it->buf.len = sizeof(sp_win32_find_data_t);
-  it->cursor = 0;
-  return 0;
+void sp_mem_fixed_clear(sp_mem_fixed_t* fixed) {
+  fixed->bytes_used = 0;
 }
 
-void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
-  FindClose((HANDLE)(intptr_t)it->handle);
+u64 sp_mem_fixed_bytes_used(sp_mem_fixed_t* fixed) {
+  return fixed->bytes_used;
 }
 
-s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
-  sp_win32_find_data_t* fd = (sp_win32_find_data_t*)it->buf.data;
-  while (true) {
-    if (it->buf.len == 0) {
-      if (!FindNextFileW((HANDLE)(intptr_t)it->handle, fd)) {
-        return -1;
-      }
-    }
-    it->buf.len = 0;
+void* sp_mem_fixed_on_alloc(void* user_data, sp_mem_alloc_mode_t mode, u64 size, void* old_memory, u64 old_size) {
+  sp_mem_fixed_t* fixed = (sp_mem_fixed_t*)user_data;
 
-    u16* name = (u16*)fd->cFileName;
-    if (sp_sys_diriter_win32_is_dot(name)) {
-      continue;
+  switch (mode) {
+    case SP_ALLOCATOR_MODE_ALLOC: {
+      u8* ptr = (u8*)sp_align_up(fixed->buffer + fixed->bytes_used, fixed->alignment);
+      u64 offset = (u64)(ptr - fixed->buffer);
+      if (offset > fixed->capacity || size > fixed->capacity - offset) return SP_NULLPTR;
+      fixed->bytes_used = offset + size;
+      sp_mem_zero(ptr, size);
+      return ptr;
     }
+    case SP_ALLOCATOR_MODE_RESIZE: {
+      if (!old_memory) return sp_mem_fixed_on_alloc(user_data, SP_ALLOCATOR_MODE_ALLOC, size, SP_NULLPTR, 0);
 
-    u8* scratch_data = it->buf.data + sizeof(sp_win32_find_data_t);
-    u64 scratch_cap = it->buf.capacity - sizeof(sp_win32_find_data_t);
-    sp_mem_fixed_t allocator = sp_mem_fixed(scratch_data, scratch_cap);
-    sp_mem_t mem = sp_mem_fixed_as_allocator(&allocator);
+      bool is_top = (u8*)old_memory + old_size == fixed->buffer + fixed->bytes_used;
+      if (is_top) {
+        u64 offset = (u64)((u8*)old_memory - fixed->buffer);
+        if (size <= fixed->capacity - offset) {
+          if (size > old_size) sp_mem_zero((u8*)old_memory + old_size, size - old_size);
+          fixed->bytes_used = offset + size;
+          return old_memory;
+        }
+      }
 
-    u32 wlen = sp_sys_diriter_win32_name_len(name);
-    sp_str_t utf8 = sp_wtf16_to_wtf8(mem, sp_wide_str(name, wlen));
-    out->kind = sp_sys_diriter_win32_attrs(fd->dwFileAttributes);
-    out->name = utf8.data;
-    out->len = utf8.len;
-    return SP_OK;
-  }
-}
+      if (size <= old_size) return old_memory;
 
-#elif defined(SP_LINUX)
-SP_PRIVATE sp_fs_kind_t sp_sys_diriter_dtype_to_kind(u8 d_type) {
-  switch (d_type) {
-    case SP_DT_REG: { return SP_FS_KIND_FILE; }
-    case SP_DT_DIR: { return SP_FS_KIND_DIR; }
-    case SP_DT_LNK: { return SP_FS_KIND_SYMLINK; }
+      void* fresh = sp_mem_fixed_on_alloc(user_data, SP_ALLOCATOR_MODE_ALLOC, size, SP_NULLPTR, 0);
+      if (!fresh) return SP_NULLPTR;
+      sp_mem_move(fresh, old_memory, old_size);
+      return fresh;
+    }
+    case SP_ALLOCATOR_MODE_FREE: {
+      if (old_memory && (u8*)old_memory + old_size == fixed->buffer + fixed->bytes_used) {
+        fixed->bytes_used -= old_size;
+      }
+      return SP_NULLPTR;
+    }
   }
-  return SP_FS_KIND_NONE;
-}
 
-s32 sp_sys_fs_it_open(sp_sys_fd_t root, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
-  *it = sp_zero_s(sp_sys_fs_it_t);
-  sp_sys_fd_t fd = sp_sys_open(root, path, path_len, SP_O_RDONLY | SP_O_DIRECTORY, 0);
-  if (fd < 0) return -1;
-  it->handle = (s64)fd;
-  it->buf.data = (u8*)buf;
-  it->buf.capacity = cap;
-  it->buf.len = 0;
-  it->cursor = 0;
-  return 0;
+  SP_UNREACHABLE_RETURN(SP_NULLPTR);
 }
 
-void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
-  sp_sys_close((sp_sys_fd_t)it->handle);
+sp_mem_arena_marker_t sp_mem_arena_mark(sp_mem_arena_t* arena) {
+  return (sp_mem_arena_marker_t) {
+    .arena = arena,
+    .block = arena->current,
+    .mark = arena->current->bytes_used,
+    .mem = sp_mem_arena_as_allocator(arena),
+  };
 }
 
-s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
-  while (true) {
-    // Pull another chunk from the kernel and advance the cursor
-    if (it->cursor >= it->buf.len) {
-      s64 n = sp_lx_getdents64((sp_sys_fd_t)it->handle, it->buf.data, it->buf.capacity);
-      if (n <= 0) return -1;
-      it->cursor = 0;
-      it->buf.len = (u64)n;
-    }
-
-    sp_sys_dirent64_t* d = sp_ptr_cast(sp_sys_dirent64_t*, it->buf.data + it->cursor);
-    it->cursor += d->d_reclen;
-
-    // If it's an absolute path, that's the one
-    if (!sp_sys_diriter_is_dot(d->d_name)) {
-      out->kind = sp_sys_diriter_dtype_to_kind(d->d_type);
-      out->name = d->d_name;
-      out->len = sp_cstr_len(d->d_name);
-      return SP_OK;
-    }
-  }
+void sp_mem_arena_pop(sp_mem_arena_marker_t marker) {
+  marker.block->bytes_used = marker.mark;
+  marker.arena->current = marker.block;
 }
 
-#elif defined(SP_MACOS) || defined(SP_COSMO)
-SP_PRIVATE sp_fs_kind_t sp_sys_diriter_dtype_to_kind(u8 d_type) {
-  switch (d_type) {
-    case SP_DT_REG: { return SP_FS_KIND_FILE; }
-    case SP_DT_DIR: { return SP_FS_KIND_DIR; }
-    case SP_DT_LNK: { return SP_FS_KIND_SYMLINK; }
-  }
-  return SP_FS_KIND_NONE;
+sp_mem_t sp_mem_get_scratch() {
+  sp_tls_rt_t* tls = sp_tls_rt_get();
+  return sp_mem_arena_as_allocator(sp_tls_rt_get_scratch_arena(tls));
 }
 
-s32 sp_sys_fs_it_open(sp_sys_fd_t fd, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
-  (void)fd;
-  *it = sp_zero_s(sp_sys_fs_it_t);
-  c8 cstr [SP_PATH_MAX] = sp_zero;
-  sp_cstr_copy_to_n(path, path_len, cstr, SP_PATH_MAX);
-  DIR* dir = opendir(cstr);
-  if (!dir) return -1;
-  it->handle = (s64)(intptr_t)dir;
-  it->buf.data = (u8*)buf;
-  it->buf.capacity = cap;
-  it->buf.len = 0;
-  it->cursor = 0;
-  return 0;
+sp_mem_arena_t* sp_mem_get_scratch_arena() {
+  sp_tls_rt_t* tls = sp_tls_rt_get();
+  return sp_tls_rt_get_scratch_arena(tls);
 }
 
-void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
-  closedir((DIR*)(intptr_t)it->handle);
+sp_mem_arena_marker_t sp_mem_begin_scratch() {
+  sp_tls_rt_t* tls = sp_tls_rt_get();
+  return sp_mem_arena_mark(sp_tls_rt_get_scratch_arena(tls));
 }
 
-s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
-  while (true) {
-    struct dirent* d = readdir((DIR*)(intptr_t)it->handle);
-    if (!d) return -1;
-    if (sp_sys_diriter_is_dot(d->d_name)) continue;
-    out->name = d->d_name;
-    out->len = sp_cstr_len(d->d_name);
-    out->kind = sp_sys_diriter_dtype_to_kind(d->d_type);
-    return 0;
-  }
+sp_mem_arena_marker_t sp_mem_begin_scratch_for(sp_mem_t mem) {
+  sp_tls_rt_t* tls = sp_tls_rt_get();
+  return sp_mem_arena_mark(sp_tls_rt_get_scratch_arena_for(tls, mem));
 }
 
-#elif defined(SP_WASM)
-s32 sp_sys_fs_it_open(sp_sys_fd_t fd, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
-  sp_unreachable_return(-1);
+void sp_mem_end_scratch(sp_mem_arena_marker_t marker) {
+  sp_mem_arena_pop(marker);
 }
 
-void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
-  sp_unreachable();
+bool sp_mem_is_equal(const void* a, const void* b, u64 len) {
+  if (!len) return true;
+  if (!a || !b) return false;
+  return !sp_sys_memcmp(a, b, len);
 }
 
-s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
-  sp_unreachable_return(-1);
+void sp_mem_copy(void* dest, const void* source, u64 num_bytes) {
+  if (!source) return;
+  if (!dest) return;
+  if (!num_bytes) return;
+  sp_sys_memcpy(dest, source, num_bytes);
 }
 
-#else
-#error "sp_sys_fs_it_open"
-#error "sp_sys_fs_it_close"
-#error "sp_sys_fs_it_next"
-#endif
-
-
-//     ███████     █████████
-//   ███░░░░░███  ███░░░░░███
-//  ███     ░░███░███    ░░░
-// ░███      ░███░░█████████
-// ░███      ░███ ░░░░░░░░███
-// ░░███     ███  ███    ░███
-//  ░░░███████░  ░░█████████
-//    ░░░░░░░     ░░░░░░░░░
-// @os
-////////////
-// ASSERT //
-////////////
-void sp_assert_f(sp_str_t file, sp_str_t line, sp_str_t func, sp_str_t expr, bool cond) {
-  if (cond) return;
+void sp_mem_move(void* dest, const void* source, u64 num_bytes) {
+  if (!source) return;
+  if (!dest) return;
+  sp_sys_memmove(dest, source, num_bytes);
+}
 
-#if SP_ASSERT_ENABLED(SP_ASSERT_LOG)
-  sp_io_stream_writer_t io = sp_io_get_std_err();
-  sp_fmt_io(
-    &io.base,
-    "{.red} {}:{.gray}:{.yellow}{.yellow} {}",
-    sp_fmt_cstr("assert"),
-    sp_fmt_str(file),
-    sp_fmt_str(line),
-    sp_fmt_str(func),
-    sp_fmt_cstr("()"),
-    sp_fmt_str(expr)
-  );
-  sp_io_write_cstr(&io.base, "\n", SP_NULLPTR);
-#endif
+void sp_mem_fill(void* buffer, u64 buffer_size, void* fill, u64 fill_size) {
+  u8* current_byte = (u8*)buffer;
 
-#if SP_ASSERT_ENABLED(SP_ASSERT_TRAP)
-  sp_sys_assert(cond);
-#endif
+  u64 i = 0;
+  while (true) {
+    if (i + fill_size > buffer_size) return;
+    sp_mem_copy(current_byte + i, (u8*)fill, fill_size);
+    i += fill_size;
+  }
 }
 
-///////////
-// SLEEP //
-///////////
-void sp_os_sleep_ns(u64 ns) {
-  sp_sys_timespec_t req = {
-    .tv_sec  = (s64)(ns / 1000000000ULL),
-    .tv_nsec = (s64)(ns % 1000000000ULL),
-  };
-  sp_sys_timespec_t rem = sp_zero;
-  sp_sys_nanosleep(&req, &rem);
-  // while (sp_sys_nanosleep(&req, &rem) == -1 && errno == SP_EINTR) {
-  //   req = rem;
-  // }
+void sp_mem_fill_u8(void* buffer, u64 buffer_size, u8 fill) {
+  sp_mem_fill(buffer, buffer_size, &fill, sizeof(u8));
 }
 
-void sp_os_sleep_ms(f64 ms) {
-  sp_os_sleep_ns((u64)sp_tm_ms_to_ns_f(ms));
+void sp_mem_zero(void* buffer, u64 buffer_size) {
+  sp_mem_fill_u8(buffer, buffer_size, 0);
 }
 
-void sp_sleep_ns(u64 target) {
-  const u64 coarse = sp_tm_ms_to_ns(1);
-  u64 fine = coarse;
-
-  u64 elapsed = 0;
-  sp_tm_timer_t timer = sp_tm_start_timer();
+void* sp_mem_os_alloc(u64 size) {
+  return sp_sys_alloc(size);
+}
 
-  // coarse sleep until we get pretty close
-  while (elapsed + fine < target) {
-    u64 before = sp_tm_read_timer(&timer);
-    sp_os_sleep_ns(coarse);
-    elapsed = sp_tm_read_timer(&timer);
-    fine = sp_max(fine, elapsed - before);
-  }
+void sp_mem_os_free(void* ptr, u64 size) {
+  if (!ptr) return;
+  sp_sys_free(ptr, size);
+}
 
-  // fine sleep until we get really close
-  // guard against elapsed > target (can happen with debugger pauses or OS overshoots)
-  if (elapsed < target) {
-    u64 margin = fine - coarse;
-    u64 remaining = target - elapsed;
-    if (remaining > margin) {
-      sp_os_sleep_ns(remaining - margin);
-      elapsed = sp_tm_read_timer(&timer);
-    }
+void* sp_mem_os_realloc(void* ptr, u64 old_size, u64 size) {
+  if (!ptr) return sp_mem_os_alloc(size);
+  if (!size) {
+    sp_mem_os_free(ptr, old_size);
+    return SP_NULLPTR;
   }
+  if (size == old_size) return ptr;
 
-  // spin until we get so god damn close we can taste it
-  while (elapsed < target) {
-    sp_spin_pause();
-    elapsed = sp_tm_read_timer(&timer);
-  }
+  void* mem = sp_mem_os_alloc(size);
+  if (!mem) return SP_NULLPTR;
+  sp_mem_copy(mem, ptr, sp_min(old_size, size));
+  sp_mem_os_free(ptr, old_size);
+  return mem;
 }
 
-void sp_sleep_ms(f64 ms) {
-  sp_sleep_ns((u64)sp_tm_ms_to_ns_f(ms));
+sp_mem_slice_t sp_mem_slice(u8* ptr, u64 len) {
+  return (sp_mem_slice_t) { .data = ptr, .len = len };
 }
 
-
-//////////////////
-// SP_OS_PRINT //
-/////////////////
-#if defined(SP_WIN32)
-SP_PRIVATE void sp_os_win32_write(DWORD handle_id, sp_str_t message) {
-  HANDLE handle = GetStdHandle(handle_id);
-  DWORD written;
-  DWORD mode;
-  if (GetConsoleMode(handle, &mode)) {
-    WriteConsoleA(handle, message.data, message.len, &written, NULL);
-  } else {
-    WriteFile(handle, message.data, message.len, &written, NULL);
+sp_mem_slice_t sp_mem_slice_sub(sp_mem_slice_t slice, u64 start, u64 len) {
+  if (start >= slice.len) {
+    return sp_mem_slice(SP_NULLPTR, 0);
   }
+  u64 actual_len = sp_min(len, slice.len - start);
+  return sp_mem_slice(slice.data + start, actual_len);
 }
 
-void sp_os_print(sp_str_t message) {
-  sp_os_win32_write(STD_OUTPUT_HANDLE, message);
+sp_mem_slice_t sp_mem_slice_prefix(sp_mem_slice_t slice, u64 len) {
+  return sp_mem_slice_sub(slice, 0, len);
 }
 
-void sp_os_print_err(sp_str_t message) {
-  sp_os_win32_write(STD_ERROR_HANDLE, message);
+sp_mem_slice_t sp_mem_slice_suffix(sp_mem_slice_t slice, u64 len) {
+  if (len >= slice.len) return slice;
+  return sp_mem_slice(slice.data + slice.len - len, len);
 }
 
-#else
-void sp_os_print(sp_str_t message) {
-  sp_sys_write(sp_sys_stdout, message.data, message.len);
+bool sp_mem_slice_empty(sp_mem_slice_t slice) {
+  return slice.len == 0 || slice.data == SP_NULLPTR;
+}
+
+u8 sp_mem_slice_at(sp_mem_slice_t slice, u64 index) {
+  SP_ASSERT(index < slice.len);
+  return slice.data[index];
+}
+
+sp_mem_slice_it_t sp_mem_slice_it(sp_mem_slice_t slice) {
+  return (sp_mem_slice_it_t) {
+    .slice = slice,
+    .index = 0,
+    .byte = (u8)(slice.len ? slice.data[0] : 0)
+  };
+}
+
+bool sp_mem_slice_it_valid(sp_mem_slice_it_t* it) {
+  return it->index < it->slice.len;
+}
+
+void sp_mem_slice_it_next(sp_mem_slice_it_t* it) {
+  it->index++;
+  it->byte = sp_mem_slice_it_valid(it) ? it->slice.data[it->index] : 0;
+}
+
+sp_str_t sp_mem_buffer_as_str(sp_mem_buffer_t* buffer) {
+  return (sp_str_t) {
+    .data = (c8*)buffer->data,
+    .len = (u32)buffer->len
+  };
+}
+
+c8* sp_mem_buffer_as_cstr(sp_mem_buffer_t* buffer) {
+  return (c8*)buffer->data;
+}
+
+
+//   █████████  ███████████ ███████████   █████ ██████   █████   █████████
+//  ███░░░░░███░█░░░███░░░█░░███░░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███
+// ░███    ░░░ ░   ░███  ░  ░███    ░███  ░███  ░███░███ ░███  ███     ░░░
+// ░░█████████     ░███     ░██████████   ░███  ░███░░███░███ ░███
+//  ░░░░░░░░███    ░███     ░███░░░░░███  ░███  ░███ ░░██████ ░███    █████
+//  ███    ░███    ░███     ░███    ░███  ░███  ░███  ░░█████ ░░███  ░░███
+// ░░█████████     █████    █████   █████ █████ █████  ░░█████ ░░█████████
+//  ░░░░░░░░░     ░░░░░    ░░░░░   ░░░░░ ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░
+// @string
+c8* sp_cstr_copy_n(sp_mem_t mem, const c8* str, u32 len) {
+  u32 capacity = len + 1;
+  c8* copy = sp_alloc_n(mem, c8, capacity);
+  copy[0] = 0;
+  sp_cstr_copy_to_n(str, len, copy, capacity);
+  return copy;
+}
+
+c8* sp_cstr_copy(sp_mem_t mem, const c8* str) {
+  return sp_cstr_copy_n(mem, str, sp_cstr_len(str));
+}
+
+void sp_cstr_copy_to(const c8* str, c8* buffer, u32 buffer_length) {
+  sp_cstr_copy_to_n(str, sp_cstr_len(str), buffer, buffer_length);
+}
+
+void sp_cstr_copy_to_n(const c8* str, u32 len, c8* buffer, u32 capacity) {
+  if (!(str && buffer && capacity)) return;
+
+  u32 n = sp_min(len, capacity - 1);
+  memcpy(buffer, str, n);
+  buffer[n] = 0;
+}
+
+bool sp_cstr_equal(const c8* a, const c8* b) {
+  u32 la = sp_cstr_len(a);
+  u32 lb = sp_cstr_len(b);
+  if (la != lb) return false;
+
+  return sp_mem_is_equal(a, b, la);
+}
+
+u32 sp_cstr_len(const c8* str) {
+  if (!str) return 0;
+
+  u32 len = 0;
+  while (str[len]) len++;
+  return len;
+}
+
+u32 sp_cstr_len_n(const c8* str, u32 n) {
+  if (!str) return 0;
+
+  u32 len = 0;
+  while (len < n && str[len]) len++;
+  return len;
+}
+
+sp_str_t sp_cstr_as_str(const c8* str) {
+  return (sp_str_t) {
+    .data = str,
+    .len = sp_cstr_len(str)
+  };
+}
+
+c8 sp_c8_to_lower(c8 c) {
+  return (c >= 'A' && c <= 'Z') ? (c + 32) : (c);
+}
+
+c8 sp_c8_to_upper(c8 c) {
+  return (c >= 'a' && c <= 'z') ? (c - 32) : (c);
+}
+
+u8 sp_utf8_num_bytes_from_byte(u8 byte) {
+  if (byte < SP_UTF8_2_BYTE_MIN) return 1;
+  if ((byte & 0xE0) == 0xC0) return 2;
+  if ((byte & 0xF0) == 0xE0) return 3;
+  if ((byte & 0xF8) == 0xF0) return 4;
+  return 0;
+}
+
+u8 sp_utf8_num_bytes_from_ptr(const u8* ptr) {
+  if (!ptr) return 0;
+  return sp_utf8_num_bytes_from_byte(*ptr);
+}
+
+u8 sp_utf8_num_bytes_from_codepoint(u32 codepoint) {
+  if (codepoint < SP_UTF8_2_BYTE_MIN) return 1;
+  if (codepoint < SP_UTF8_3_BYTE_MIN) return 2;
+  if (codepoint < SP_UTF8_4_BYTE_MIN) return 3;
+  if (codepoint <= SP_UTF8_MAX)       return 4;
+  return 0;
+}
+
+bool sp_utf8_is_cont(u8 b) {
+  return (b & 0xC0) == 0x80;
+}
+
+bool sp_utf8_is_surrogate(u32 codepoint) {
+  return (codepoint >= SP_UTF8_SURROGATE_MIN) && (codepoint <= SP_UTF8_SURROGATE_MAX);
+}
+
+bool sp_utf8_is_bounds_ok(u32 codepoint, u8 len) {
+  if (codepoint > SP_UTF8_MAX) return false;
+  switch (len) {
+    case 2: { return (codepoint >= SP_UTF8_2_BYTE_MIN); }
+    case 3: { return (codepoint >= SP_UTF8_3_BYTE_MIN); }
+    case 4: { return (codepoint >= SP_UTF8_4_BYTE_MIN); }
+  }
+
+  return true;
+}
+
+bool sp_utf8_is_byte_ascii(u8 b) {
+  return b < SP_UTF8_ASCII_MAX;
+}
+
+bool sp_utf8_is_codepoint_ascii(u32 codepoint) {
+  return codepoint < SP_UTF8_ASCII_MAX;
+}
+
+u32 sp_utf8_to_lower(u32 codepoint) {
+  if (!sp_utf8_is_codepoint_ascii(codepoint)) return codepoint;
+  return sp_c8_to_lower((c8)codepoint);
+}
+
+u32 sp_utf8_to_upper(u32 codepoint) {
+  if (!sp_utf8_is_codepoint_ascii(codepoint)) return codepoint;
+  return sp_c8_to_upper((c8)codepoint);
+}
+
+
+u32 sp_utf8_mask(u8 byte, u8 mask, u8 shift) {
+  return (u32)((byte & mask) << shift);
+}
+
+u32 sp_utf8_decode(const c8* ptr) {
+  if (!ptr) return SP_UTF8_REPLACEMENT;
+  if (sp_utf8_is_byte_ascii(ptr[0])) return ptr[0];
+
+  switch (sp_utf8_num_bytes_from_byte(ptr[0])) {
+    case 2: return sp_utf8_mask(ptr[0], 0x1F, 6)  | sp_utf8_mask(ptr[1], 0x3F, 0);
+    case 3: return sp_utf8_mask(ptr[0], 0x0F, 12) | sp_utf8_mask(ptr[1], 0x3F, 6)  | sp_utf8_mask(ptr[2], 0x3F, 0);
+    case 4: return sp_utf8_mask(ptr[0], 0x07, 18) | sp_utf8_mask(ptr[1], 0x3F, 12) | sp_utf8_mask(ptr[2], 0x3F, 6) | sp_utf8_mask(ptr[3], 0x3f, 0);
+    default: return SP_UTF8_REPLACEMENT;
+  }
+}
+
+u8 sp_utf8_encode(u32 cp, c8* out) {
+  if (!out) return 0;
+
+  u8 len = sp_utf8_num_bytes_from_codepoint(cp);
+  switch (len) {
+    case 1: { out[0] = (u8)cp; break; }
+    case 2: { out[0] = (u8)(0xC0 | (cp >> 6)); out[1] = (u8)(0x80 | (cp & 0x3F)); break; }
+    case 3: { out[0] = (u8)(0xE0 | (cp >> 12)); out[1] = (u8)(0x80 | ((cp >> 6) & 0x3F)); out[2] = (u8)(0x80 | (cp & 0x3F)); break; }
+    case 4: { out[0] = (u8)(0xF0 | (cp >> 18)); out[1] = (u8)(0x80 | ((cp >> 12) & 0x3F)); out[2] = (u8)(0x80 | ((cp >> 6) & 0x3F)); out[3] = (u8)(0x80 | (cp & 0x3F)); break; }
+  }
+  return len;
+}
+
+sp_utf8_it_t sp_utf8_it(sp_str_t str) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_utf8_it_t);
+
+  return (sp_utf8_it_t) {
+    .str = str,
+    .index = 0,
+    .codepoint = sp_utf8_decode(str.data),
+    .codepoint_len = sp_utf8_num_bytes_from_byte((u8)str.data[0]),
+  };
+}
+
+sp_utf8_it_t sp_utf8_rit(sp_str_t str) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_utf8_it_t);
+
+  // @spader
+  // the cast is objectively wrong here. i just use s32 in the iterator to give me a sentinel when reverse
+  // iterating. which in and of itself is stupid. double down.
+  sp_utf8_it_t it = {
+    .str = str,
+    .index = (s32)str.len
+  };
+  sp_utf8_it_prev(&it);
+  return it;
+}
+
+bool sp_utf8_it_valid(sp_utf8_it_t* it) {
+  if (!it) return false;
+  return (it->index < (s32)it->str.len) && (it->index >= 0) && (it->codepoint_len);
+}
+
+void sp_utf8_it_next(sp_utf8_it_t* it) {
+  if (!it) return;
+
+  it->index += it->codepoint_len;
+  if (it->index >= (s32)it->str.len) {
+    return;
+  }
+
+  it->codepoint = sp_utf8_decode(it->str.data + it->index);
+  it->codepoint_len = sp_utf8_num_bytes_from_byte(it->str.data[it->index]);
+}
+
+void sp_utf8_it_prev(sp_utf8_it_t* it) {
+  if (!it) return;
+
+  while (true) {
+    it->index--;
+    if (it->index < 0) return;
+    if (!sp_utf8_is_cont(it->str.data[it->index])) break;
+  }
+
+  it->codepoint = sp_utf8_decode(it->str.data + it->index);
+  it->codepoint_len = sp_utf8_num_bytes_from_byte(it->str.data[it->index]);
+}
+
+bool sp_utf8_validate(sp_str_t str) {
+  const c8* ptr = str.data;
+  u32 it = 0;
+
+  while (it < str.len) {
+    u8 len = sp_utf8_num_bytes_from_byte(ptr[it]);
+    if (!len) return false;
+    if (it + len > str.len) return false;
+
+    sp_for_range(j, 1, len) {
+      if (!sp_utf8_is_cont(ptr[it + j])) {
+        return false;
+      }
+    }
+
+    u32 codepoint = sp_utf8_decode(&ptr[it]);
+    if (sp_utf8_is_surrogate(codepoint)) return false;
+    if (!sp_utf8_is_bounds_ok(codepoint, len)) return false;
+
+    it += len;
+  }
+  return true;
+}
+
+u32 sp_utf8_num_codepoints(sp_str_t str) {
+  u32 count = 0;
+  sp_str_for_utf8(str, it) {
+    count++;
+  }
+  return count;
+}
+
+sp_wide_str_t sp_wide_str(const u16* str, u32 len) {
+  return (sp_wide_str_t) {
+    .data = str,
+    .len = len,
+  };
+}
+
+bool sp_wtf8_validate(sp_str_t str) {
+  const c8* ptr = str.data;
+  u32 it = 0;
+
+  while (it < str.len) {
+    u8 len = sp_utf8_num_bytes_from_byte(ptr[it]);
+    if (!len) return false;
+    if (it + len > str.len) return false;
+
+    sp_for_range(j, 1, len) {
+      if (!sp_utf8_is_cont(ptr[it + j])) return false;
+    }
+
+    u32 cp = sp_utf8_decode(&ptr[it]);
+    if (!sp_utf8_is_bounds_ok(cp, len)) return false;
+
+    it += len;
+  }
+  return true;
+}
+
+sp_wide_str_t sp_wtf8_to_wtf16(sp_mem_t mem, sp_str_t wtf8) {
+  sp_wide_str_t result = sp_zero_s(sp_wide_str_t);
+  if (sp_str_empty(wtf8)) return result;
+
+  u16* buf = sp_alloc_n(mem, u16, wtf8.len + 1);
+  const c8* ptr = wtf8.data;
+  u32 i = 0;
+  u32 n = 0;
+
+  while (i < wtf8.len) {
+    u8 len = sp_utf8_num_bytes_from_byte(ptr[i]);
+    if (!len) goto error;
+    if (i + len > wtf8.len) goto error;
+    sp_for_range(j, 1, len) {
+      if (!sp_utf8_is_cont(ptr[i + j])) goto error;
+    }
+
+    u32 cp = sp_utf8_decode(&ptr[i]);
+    if (!sp_utf8_is_bounds_ok(cp, len)) goto error;
+
+    if (cp < 0x10000) {
+      buf[n++] = (u16)cp;
+    }
+    else {
+      u32 v = cp - 0x10000;
+      buf[n++] = (u16)(0xD800 | (v >> 10));
+      buf[n++] = (u16)(0xDC00 | (v & 0x3FF));
+    }
+
+    i += len;
+  }
+
+  buf[n] = 0;
+  return (sp_wide_str_t) { .data = buf, .len = n };
+
+error:
+  sp_free(mem, buf, (wtf8.len + 1) * sizeof(u16));
+  return result;
+}
+
+sp_str_t sp_wtf16_to_wtf8(sp_mem_t mem, sp_wide_str_t wtf16) {
+  c8* buf = sp_alloc_n(mem, c8, wtf16.len * 3 + 1);
+  u32 offset = 0;
+  sp_for(i, wtf16.len) {
+    u16 u = wtf16.data[i];
+    u32 cp;
+    if (u >= 0xD800 && u <= 0xDBFF && i + 1 < wtf16.len && wtf16.data[i + 1] >= 0xDC00 && wtf16.data[i + 1] <= 0xDFFF) {
+      cp = 0x10000 + (((u32)(u - 0xD800) << 10) | (u32)(wtf16.data[i + 1] - 0xDC00));
+      i++;
+    }
+    else {
+      cp = u;
+    }
+    offset += sp_utf8_encode(cp, buf + offset);
+  }
+  buf[offset] = 0;
+
+  return (sp_str_t) { .data = buf, .len = offset };
+}
+
+sp_str_t sp_str(const c8* str, u32 len) {
+  return (sp_str_t) {
+    .data = str,
+    .len = len
+  };
+}
+
+sp_str_t sp_str_copy(sp_mem_t mem, sp_str_t str) {
+  if (!str.data || !str.len) return sp_zero_s(sp_str_t);
+  c8* buffer = sp_alloc_n(mem, c8, str.len);
+  sp_mem_copy(buffer, str.data, str.len);
+  return sp_str(buffer, str.len);
+}
+
+c8* sp_str_to_cstr(sp_mem_t mem, sp_str_t str) {
+  return sp_cstr_copy_n(mem, str.data, str.len);
+}
+
+sp_str_t sp_str_alloc(sp_mem_t mem, u32 capacity) {
+  if (!capacity) return sp_zero_s(sp_str_t);
+  return SP_RVAL(sp_str_t) {
+    .data = (c8*)sp_mem_allocator_alloc(mem, capacity),
+    .len = 0,
+  };
+}
+
+sp_str_t sp_str_view(const c8* cstr) {
+  return (sp_str_t) {
+    .data = cstr,
+    .len = sp_cstr_len(cstr),
+  };
+}
+
+bool sp_str_empty(sp_str_t str) {
+  return !str.len;
+}
+
+bool sp_str_equal(sp_str_t a, sp_str_t b) {
+  if (a.len != b.len) return false;
+
+  return sp_mem_is_equal(a.data, b.data, a.len);
+}
+
+bool sp_str_equal_cstr(sp_str_t a, const c8* b) {
+  u32 len = sp_cstr_len(b);
+  if (a.len != len) return false;
+
+  return sp_mem_is_equal(a.data, b, len);
+}
+
+bool sp_str_starts_with(sp_str_t str, sp_str_t prefix) {
+  if (str.len < prefix.len) return false;
+
+  return sp_str_equal(sp_str_sub(str, 0, prefix.len), prefix);
+}
+
+bool sp_str_ends_with(sp_str_t str, sp_str_t suffix) {
+  if (str.len < suffix.len) return false;
+
+  return sp_str_equal(sp_str_sub_reverse(str, 0, suffix.len), suffix);
+}
+
+bool sp_str_contains(sp_str_t str, sp_str_t needle) {
+  return sp_str_find(str, needle) != SP_STR_NO_MATCH;
+}
+
+s32 sp_str_find(sp_str_t str, sp_str_t needle) {
+  if (needle.len == 0) return 0;
+  if (str.len < needle.len) return SP_STR_NO_MATCH;
+
+  for (u32 i = 0; i <= str.len - needle.len; i++) {
+    if (sp_mem_is_equal(str.data + i, needle.data, needle.len)) {
+      return (s32)i;
+    }
+  }
+  return SP_STR_NO_MATCH;
+}
+
+s32 sp_str_find_c8(sp_str_t str, c8 needle) {
+  sp_str_for(str, it) {
+    if (str.data[it] == needle) return it;
+  }
+
+  return SP_STR_NO_MATCH;
+}
+
+s32 sp_str_find_c8_reverse(sp_str_t str, c8 needle) {
+  for (s32 i = str.len - 1; i >= 0; i--) {
+    if (str.data[i] == needle) return i;
+  }
+
+  return SP_STR_NO_MATCH;
+}
+
+s32 sp_str_sort_kernel_alphabetical(const void* a, const void* b) {
+  return sp_str_compare_alphabetical(*(sp_str_t*)a, *(sp_str_t*)b);
+}
+
+s32 sp_str_compare_alphabetical(sp_str_t a, sp_str_t b) {
+  u32 i = 0;
+  while (true) {
+    if (i >= a.len && i >= b.len) return SP_QSORT_EQUAL;
+    if (i >= a.len)               return SP_QSORT_A_FIRST;
+    if (i >= b.len)               return SP_QSORT_B_FIRST;
+
+    if (a.data[i] == b.data[i]) {
+      i++;
+      continue;
+    }
+    if (a.data[i] > b.data[i]) return SP_QSORT_B_FIRST;
+    if (b.data[i] > a.data[i]) return SP_QSORT_A_FIRST;
+  }
+
+}
+
+bool sp_str_valid(sp_str_t str) {
+  return str.data != NULL;
+}
+
+c8 sp_str_at(sp_str_t str, s32 index) {
+  if (index < 0) {
+    index = str.len + index;
+  }
+  return str.data[index];
+}
+
+c8 sp_str_at_reverse(sp_str_t str, s32 index) {
+  if (index < 0) {
+    index = str.len + index;
+  }
+  return str.data[str.len - index - 1];
+}
+
+c8 sp_str_back(sp_str_t str) {
+  return str.len ? str.data[str.len - 1] : 0;
+}
+
+
+sp_str_t sp_str_prefix(sp_str_t str, s32 len) {
+  return sp_str_sub(str, 0, len);
+}
+
+sp_str_t sp_str_suffix(sp_str_t str, s32 len) {
+  return sp_str_sub(str, str.len - len, len);
+}
+
+sp_str_t sp_str_sub(sp_str_t str, s32 index, s32 len) {
+  SP_ASSERT(index + len <= (s32)str.len);
+  if (!len) return sp_zero_s(sp_str_t);
+  return sp_str(str.data + index, (u32)len);
+}
+
+sp_str_t sp_str_sub_reverse(sp_str_t str, s32 index, s32 len) {
+  if (!len) return sp_zero_s(sp_str_t);
+  return (sp_str_t) {
+    .data = str.data + str.len + index - len,
+    .len = (u32)len,
+  };
+}
+
+c8* sp_cstr_from_str(sp_mem_t mem, sp_str_t str) {
+  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, str.len + 1);
+  if (str.len) sp_mem_copy(buffer, str.data, str.len);
+  buffer[str.len] = '\0';
+  return buffer;
+}
+
+sp_str_t sp_str_from_cstr_n(sp_mem_t mem, const c8* str, u32 length) {
+  if (!str || !length) return sp_zero_s(sp_str_t);
+  u32 len = sp_min(sp_cstr_len(str), length);
+  if (!len) return sp_zero_s(sp_str_t);
+  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, length);
+  sp_mem_copy(buffer, str, len);
+
+  return sp_str(buffer, len);
+}
+
+sp_str_t sp_str_from_cstr(sp_mem_t mem, const c8* str) {
+  if (!str) return sp_zero_s(sp_str_t);
+  u32 len = sp_cstr_len(str);
+  if (!len) return sp_zero_s(sp_str_t);
+  c8* buffer = sp_alloc_n(mem, c8, len + 1);
+  sp_mem_copy(buffer, str, len);
+
+  return sp_str(buffer, len);
+}
+
+void sp_str_copy_to(sp_str_t str, c8* buffer, u32 capacity) {
+  if (!str.data) return;
+  sp_mem_copy(buffer, str.data, sp_min(str.len, capacity));
+}
+
+sp_str_it_t sp_str_it(sp_str_t str) {
+  return (sp_str_it_t) {
+    .str = str,
+    .index = 0,
+    .c = str.len ? str.data[0] : '\0'
+  };
+}
+
+bool sp_str_it_valid(sp_str_it_t* it) {
+  return it->index < it->str.len;
+}
+
+void sp_str_it_next(sp_str_it_t* it) {
+  it->index++;
+  it->c = sp_str_it_valid(it) ? it->str.data[it->index] : 0;
+}
+
+sp_str_t sp_str_concat(sp_mem_t mem, sp_str_t a, sp_str_t b) {
+  u32 len = a.len + b.len;
+  if (!len) return sp_zero_s(sp_str_t);
+  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, len);
+  if (a.len) sp_mem_copy(buffer, a.data,         a.len);
+  if (b.len) sp_mem_copy(buffer + a.len, b.data, b.len);
+  return sp_str(buffer, len);
+}
+
+sp_str_t sp_str_join(sp_mem_t mem, sp_str_t a, sp_str_t b, sp_str_t join) {
+  u32 len = a.len + join.len + b.len;
+  if (!len) return sp_zero_s(sp_str_t);
+  c8* buffer = (c8*)sp_mem_allocator_alloc(mem, len);
+  c8* p = buffer;
+  if (a.len)    { sp_mem_copy(p,    a.data, a.len);    p += a.len; }
+  if (join.len) { sp_mem_copy(p, join.data, join.len); p += join.len; }
+  if (b.len)    { sp_mem_copy(p,    b.data, b.len); }
+  return sp_str(buffer, len);
+}
+
+sp_str_t sp_str_join_cstr_n(sp_mem_t mem, const c8** strings, u32 num_strings, sp_str_t join) {
+  if (!strings) num_strings = 0;
+  sp_io_dyn_mem_writer_t builder = sp_zero;
+  sp_io_dyn_mem_writer_init(mem, &builder);
+  for (u32 index = 0; index < num_strings; index++) {
+    sp_io_write_cstr(&builder.base, strings[index], SP_NULLPTR);
+
+    if (index != (num_strings - 1)) {
+      sp_io_write_str(&builder.base, join, SP_NULLPTR);
+    }
+  }
+
+  return sp_io_dyn_mem_writer_as_str(&builder);
+}
+
+sp_str_t sp_str_pad(sp_mem_t mem, sp_str_t str, u32 n) {
+  s32 delta = (s32)n - (s32)str.len;
+  if (delta <= 0) return sp_str_copy(mem, str);
+
+  sp_mem_buffer_t buffer = {
+    .data = sp_alloc_n(mem, u8, n),
+    .len = n,
+    .capacity = n,
+  };
+  sp_sys_memcpy(buffer.data, str.data, str.len);
+  sp_sys_memset(buffer.data + str.len, ' ', (u8)delta);
+
+  return sp_mem_buffer_as_str(&buffer);
+}
+
+sp_str_t sp_str_replace_c8(sp_mem_t mem, sp_str_t str, c8 from, c8 to) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
+  sp_mem_buffer_t buffer = {
+    .data = sp_alloc_n(mem, u8, str.len),
+    .len = str.len,
+    .capacity = str.len,
+  };
+
+  for (u32 i = 0; i < str.len; i++) {
+    c8 c = str.data[i];
+    buffer.data[i] = (u8)(c == from ? to : c);
+  }
+
+  return sp_mem_buffer_as_str(&buffer);
+}
+
+sp_da(sp_str_t) sp_str_split_c8(sp_mem_t mem, sp_str_t str, c8 delimiter) {
+  if (sp_str_empty(str)) return SP_NULLPTR;
+
+  sp_da(sp_str_t) result = sp_da_new(mem, sp_str_t);
+
+  u32 i = 0, j = 0;
+  for (; j < str.len; j++) {
+    if (sp_str_at(str, j) == delimiter) {
+      sp_da_push(result, sp_str_sub(str, i, j - i));
+      i = j + 1;
+    }
+  }
+
+  sp_da_push(result, sp_str_sub(str, i, j - i));
+
+  return result;
+}
+sp_str_pair_t sp_str_cleave_c8(sp_str_t str, c8 delimiter) {
+  sp_str_pair_t result = sp_zero_s(sp_str_pair_t);
+
+  for (u32 i = 0; i < str.len; i++) {
+    if (sp_str_at(str, i) == delimiter) {
+      result.first = sp_str_sub(str, 0, i);
+      result.second = sp_str_sub(str, i + 1, str.len - i - 1);
+      return result;
+    }
+  }
+
+  result.first = sp_str_empty(str) ? sp_zero_s(sp_str_t) : str;
+  result.second = sp_zero_s(sp_str_t);
+  return result;
+}
+
+sp_str_t sp_str_trim_right(sp_str_t str) {
+  while (str.len) {
+    c8 c = sp_str_back(str);
+
+    switch (c) {
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n': {
+        str.len--;
+        break;
+      }
+      default: {
+        return str;
+      }
+    }
+  }
+
+  return sp_zero_s(sp_str_t);
+}
+
+sp_str_t sp_str_trim_left(sp_str_t str) {
+  sp_str_t trimmed = str;
+
+  sp_str_for_it(str, it) {
+    switch (it.c) {
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n': {
+        trimmed.data++; trimmed.len--;
+        break;
+      }
+      default: {
+        return trimmed;
+      }
+    }
+  }
+
+  return sp_zero_s(sp_str_t);
+}
+
+sp_str_t sp_str_trim(sp_str_t str) {
+  sp_str_t trimmed = str;
+  trimmed = sp_str_trim_left(trimmed);
+  trimmed = sp_str_trim_right(trimmed);
+  return trimmed;
+}
+
+sp_str_t sp_str_strip_left(sp_str_t str, sp_str_t strip) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
+  if (!sp_str_starts_with(str, strip)) return str;
+  return sp_str_suffix(str, str.len - strip.len);
+}
+
+sp_str_t sp_str_strip_right(sp_str_t str, sp_str_t strip) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
+  if (!sp_str_ends_with(str, strip)) return str;
+  return sp_str_prefix(str, str.len - strip.len);
+}
+
+sp_str_t sp_str_strip(sp_str_t str, sp_str_t strip) {
+  sp_str_t result = sp_str_strip_left(str, strip);
+  return sp_str_strip_right(result, strip);
+}
+
+sp_str_t sp_str_to_upper(sp_mem_t mem, sp_str_t str) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
+  sp_mem_buffer_t buffer = {
+    .data = sp_alloc_n(mem, u8, str.len),
+    .capacity = str.len,
+  };
+
+  sp_str_for_utf8(str, it) {
+    buffer.len += sp_utf8_encode(sp_utf8_to_upper(it.codepoint), (c8*)buffer.data + buffer.len);
+  }
+
+  return sp_mem_buffer_as_str(&buffer);
+}
+
+sp_str_t sp_str_to_lower(sp_mem_t mem, sp_str_t str) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
+  sp_mem_buffer_t buffer = {
+    .data = sp_alloc_n(mem, u8, str.len),
+    .capacity = str.len,
+  };
+
+  sp_str_for_utf8(str, it) {
+    buffer.len += sp_utf8_encode(sp_utf8_to_lower(it.codepoint), (c8*)buffer.data + buffer.len);
+  }
+
+  return sp_mem_buffer_as_str(&buffer);
+}
+
+sp_str_t sp_str_to_pascal_case(sp_mem_t mem, sp_str_t str) {
+  if (sp_str_empty(str)) return sp_zero_s(sp_str_t);
+  sp_mem_buffer_t buffer = {
+    .data = sp_alloc_n(mem, u8, str.len),
+    .capacity = str.len,
+  };
+  bool word = true;
+
+  sp_str_for_utf8(str, it) {
+    u32 cp;
+    switch (it.codepoint) {
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r': {
+        cp = it.codepoint;
+        word = true;
+        break;
+      }
+      default: {
+        cp = word ? sp_utf8_to_upper(it.codepoint) : sp_utf8_to_lower(it.codepoint);
+        word = false;
+        break;
+      }
+    }
+    buffer.len += sp_utf8_encode(cp, (c8*)buffer.data + buffer.len);
+  }
+
+  return sp_mem_buffer_as_str(&buffer);
+}
+
+sp_str_t sp_str_truncate(sp_mem_t mem, sp_str_t str, u32 max_len, sp_str_t trailer) {
+  if (!max_len) return sp_str_copy(mem, str);
+  if (str.len <= max_len) return sp_str_copy(mem, str);
+  if (trailer.len > max_len) return sp_str_copy(mem, str);
+
+  return sp_str_concat(mem, sp_str_prefix(str, max_len - trailer.len), trailer);
+}
+
+sp_da(sp_str_t) sp_str_map(sp_mem_t mem, sp_str_t* strs, u32 num_strs, void* user_data, sp_str_map_fn_t fn) {
+  sp_da(sp_str_t) results = sp_da_new(mem, sp_str_t);
+
+  sp_for(it, num_strs) {
+    sp_str_map_context_t context = {
+      .mem = mem,
+      .str = strs[it],
+      .user_data = user_data
+    };
+    sp_str_t result = fn(&context);
+    sp_da_push(results, result);
+  }
+
+  return results;
+}
+
+sp_str_t sp_str_map_kernel_prepend(sp_str_map_context_t* context) {
+  sp_str_t prefix = *(sp_str_t*)context->user_data;
+  return sp_str_concat(context->mem, prefix, context->str);
+}
+
+sp_str_t sp_str_map_kernel_append(sp_str_map_context_t* context) {
+  sp_str_t suffix = *(sp_str_t*)context->user_data;
+  return sp_str_concat(context->mem, context->str, suffix);
+}
+
+sp_str_t sp_str_map_kernel_prefix(sp_str_map_context_t* context) {
+  u32 len;
+  sp_mem_copy(&len, context->user_data, sizeof(len));
+  return sp_str_sub(context->str, 0, len);
+}
+
+sp_str_t sp_str_map_kernel_pad(sp_str_map_context_t* context) {
+  u32 len;
+  sp_mem_copy(&len, context->user_data, sizeof(len));
+  return sp_str_pad(context->mem, context->str, len);
+}
+
+sp_str_t sp_str_map_kernel_trim(sp_str_map_context_t* context) {
+  return sp_str_trim(context->str);
+}
+
+sp_str_t sp_str_map_kernel_to_upper(sp_str_map_context_t* context) {
+  return sp_str_to_upper(context->mem, context->str);
+}
+
+sp_str_t sp_str_map_kernel_to_lower(sp_str_map_context_t* context) {
+  return sp_str_to_lower(context->mem, context->str);
+}
+
+sp_str_t sp_str_map_kernel_pascal_case(sp_str_map_context_t* context) {
+  return sp_str_to_pascal_case(context->mem, context->str);
+}
+
+sp_da(sp_str_t) sp_str_pad_to_longest(sp_mem_t mem, sp_str_t* strs, u32 n) {
+  u32 max_len = 0;
+  sp_for(i, n) {
+    if (strs[i].len > max_len) max_len = strs[i].len;
+  }
+  return sp_str_map(mem, strs, n, &max_len, sp_str_map_kernel_pad);
+}
+
+
+// ███████████ █████ █████       ██████████  █████████  █████ █████  █████████  ███████████ ██████████ ██████   ██████
+// ░░███░░░░░░█░░███ ░░███       ░░███░░░░░█ ███░░░░░███░░███ ░░███  ███░░░░░███░█░░░███░░░█░░███░░░░░█░░██████ ██████
+//  ░███   █ ░  ░███  ░███        ░███  █ ░ ░███    ░░░  ░░███ ███  ░███    ░░░ ░   ░███  ░  ░███  █ ░  ░███░█████░███
+//  ░███████    ░███  ░███        ░██████   ░░█████████   ░░█████   ░░█████████     ░███     ░██████    ░███░░███ ░███
+//  ░███░░░█    ░███  ░███        ░███░░█    ░░░░░░░░███   ░░███     ░░░░░░░░███    ░███     ░███░░█    ░███ ░░░  ░███
+//  ░███  ░     ░███  ░███      █ ░███ ░   █ ███    ░███    ░███     ███    ░███    ░███     ░███ ░   █ ░███      ░███
+//  █████       █████ ███████████ ██████████░░█████████     █████   ░░█████████     █████    ██████████ █████     █████
+// ░░░░░       ░░░░░ ░░░░░░░░░░░ ░░░░░░░░░░  ░░░░░░░░░     ░░░░░     ░░░░░░░░░     ░░░░░    ░░░░░░░░░░ ░░░░░     ░░░░░
+// @fs @filesystem
+
+//////////////
+// ITERATOR //
+//////////////
+SP_PRIVATE bool sp_sys_diriter_is_dot(const c8* name) {
+  return name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0));
+}
+
+s32 sp_sys_fs_it_open_s(sp_sys_fd_t fd, sp_sys_fs_it_t* it, sp_str_t path, sp_mem_slice_t buf) {
+  return sp_sys_fs_it_open(fd, it, path.data, path.len, buf.data, buf.len);
+}
+
+#if defined(SP_WIN32)
+SP_PRIVATE sp_fs_kind_t sp_sys_diriter_win32_attrs(sp_win32_dword_t attrs) {
+  if (attrs & FILE_ATTRIBUTE_REPARSE_POINT) return SP_FS_KIND_SYMLINK;
+  if (attrs & FILE_ATTRIBUTE_DIRECTORY) return SP_FS_KIND_DIR;
+  return SP_FS_KIND_FILE;
+}
+
+SP_PRIVATE bool sp_sys_diriter_win32_is_dot(const u16* name) {
+  if (name[0] == '.' && name[1] == 0) return true;
+  if (name[0] == '.' && name[1] == '.' && name[2] == 0) return true;
+  return false;
+}
+
+SP_PRIVATE u32 sp_sys_diriter_win32_name_len(const u16* name) {
+  u32 n = 0;
+  while (name[n]) n++;
+  return n;
+}
+
+s32 sp_sys_fs_it_open(sp_sys_fd_t fd, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
+  (void)fd;
+  *it = sp_zero_s(sp_sys_fs_it_t);
+  if (cap < sizeof(sp_win32_find_data_t) + (MAX_PATH * 3 + 1)) return -1;
+
+  SP_ALIGNED u8 pattern_storage [SP_PATH_MAX];
+  sp_mem_fixed_t pattern_fixed = sp_mem_fixed(pattern_storage, sizeof(pattern_storage));
+  sp_mem_t pattern_mem = sp_mem_fixed_as_allocator(&pattern_fixed);
+  sp_str_t pattern = sp_fs_join_path(pattern_mem, sp_str(path, path_len), sp_str_lit("*"));
+
+  sp_sys_nt_path_t nt = sp_zero;
+  if (!SP_NT_SUCCESS(sp_sys_nt_path(pattern, &nt))) {
+    return -1;
+  }
+
+  u32 w_off = 0;
+  if (nt.name.Length >= 8 && nt.name.Buffer[0] == '\\' && nt.name.Buffer[1] == '?' && nt.name.Buffer[2] == '?' && nt.name.Buffer[3] == '\\') {
+    w_off = 4;
+  }
+  u32 prefixed_len = 4 + (nt.name.Length / sizeof(u16)) - w_off;
+  u16 wpat [SP_PATH_MAX + 8];
+  wpat[0] = '\\'; wpat[1] = '\\'; wpat[2] = '?'; wpat[3] = '\\';
+  sp_mem_copy(wpat + 4, nt.name.Buffer + w_off, nt.name.Length - w_off * sizeof(u16));
+  wpat[prefixed_len] = 0;
+  sp_sys_nt_path_free(&nt);
+
+  sp_win32_find_data_t* find = (sp_win32_find_data_t*)buf;
+  HANDLE h = FindFirstFileW((LPCWSTR)wpat, find);
+  if (h == INVALID_HANDLE_VALUE) return -1;
+
+  it->handle = (s64)(intptr_t)h;
+  it->buf.data = (u8*)buf;
+  it->buf.capacity = cap;
+  it->buf.len = sizeof(sp_win32_find_data_t);
+  it->cursor = 0;
+  return 0;
+}
+
+void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
+  FindClose((HANDLE)(intptr_t)it->handle);
+}
+
+s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
+  sp_win32_find_data_t* fd = (sp_win32_find_data_t*)it->buf.data;
+  while (true) {
+    if (it->buf.len == 0) {
+      if (!FindNextFileW((HANDLE)(intptr_t)it->handle, fd)) {
+        return -1;
+      }
+    }
+    it->buf.len = 0;
+
+    u16* name = (u16*)fd->cFileName;
+    if (sp_sys_diriter_win32_is_dot(name)) {
+      continue;
+    }
+
+    u8* scratch_data = it->buf.data + sizeof(sp_win32_find_data_t);
+    u64 scratch_cap = it->buf.capacity - sizeof(sp_win32_find_data_t);
+    sp_mem_fixed_t allocator = sp_mem_fixed(scratch_data, scratch_cap);
+    sp_mem_t mem = sp_mem_fixed_as_allocator(&allocator);
+
+    u32 wlen = sp_sys_diriter_win32_name_len(name);
+    sp_str_t utf8 = sp_wtf16_to_wtf8(mem, sp_wide_str(name, wlen));
+    out->kind = sp_sys_diriter_win32_attrs(fd->dwFileAttributes);
+    out->name = utf8.data;
+    out->len = utf8.len;
+    return SP_OK;
+  }
+}
+
+#elif defined(SP_LINUX)
+SP_PRIVATE sp_fs_kind_t sp_sys_diriter_dtype_to_kind(u8 d_type) {
+  switch (d_type) {
+    case SP_DT_REG: { return SP_FS_KIND_FILE; }
+    case SP_DT_DIR: { return SP_FS_KIND_DIR; }
+    case SP_DT_LNK: { return SP_FS_KIND_SYMLINK; }
+  }
+  return SP_FS_KIND_NONE;
+}
+
+s32 sp_sys_fs_it_open(sp_sys_fd_t root, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
+  *it = sp_zero_s(sp_sys_fs_it_t);
+  sp_sys_fd_t fd = sp_sys_open(root, path, path_len, SP_O_RDONLY | SP_O_DIRECTORY, 0);
+  if (fd < 0) return -1;
+  it->handle = (s64)fd;
+  it->buf.data = (u8*)buf;
+  it->buf.capacity = cap;
+  it->buf.len = 0;
+  it->cursor = 0;
+  return 0;
+}
+
+void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
+  sp_sys_close((sp_sys_fd_t)it->handle);
+}
+
+s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
+  while (true) {
+    // Pull another chunk from the kernel and advance the cursor
+    if (it->cursor >= it->buf.len) {
+      s64 n = sp_lx_getdents64((sp_sys_fd_t)it->handle, it->buf.data, it->buf.capacity);
+      if (n <= 0) return -1;
+      it->cursor = 0;
+      it->buf.len = (u64)n;
+    }
+
+    sp_sys_dirent64_t* d = sp_ptr_cast(sp_sys_dirent64_t*, it->buf.data + it->cursor);
+    it->cursor += d->d_reclen;
+
+    // If it's an absolute path, that's the one
+    if (!sp_sys_diriter_is_dot(d->d_name)) {
+      out->kind = sp_sys_diriter_dtype_to_kind(d->d_type);
+      out->name = d->d_name;
+      out->len = sp_cstr_len(d->d_name);
+      return SP_OK;
+    }
+  }
+}
+
+#elif defined(SP_MACOS) || defined(SP_COSMO)
+SP_PRIVATE sp_fs_kind_t sp_sys_diriter_dtype_to_kind(u8 d_type) {
+  switch (d_type) {
+    case SP_DT_REG: { return SP_FS_KIND_FILE; }
+    case SP_DT_DIR: { return SP_FS_KIND_DIR; }
+    case SP_DT_LNK: { return SP_FS_KIND_SYMLINK; }
+  }
+  return SP_FS_KIND_NONE;
+}
+
+s32 sp_sys_fs_it_open(sp_sys_fd_t fd, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
+  (void)fd;
+  *it = sp_zero_s(sp_sys_fs_it_t);
+  c8 cstr [SP_PATH_MAX] = sp_zero;
+  sp_cstr_copy_to_n(path, path_len, cstr, SP_PATH_MAX);
+  DIR* dir = opendir(cstr);
+  if (!dir) return -1;
+  it->handle = (s64)(intptr_t)dir;
+  it->buf.data = (u8*)buf;
+  it->buf.capacity = cap;
+  it->buf.len = 0;
+  it->cursor = 0;
+  return 0;
+}
+
+void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
+  closedir((DIR*)(intptr_t)it->handle);
+}
+
+s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
+  while (true) {
+    struct dirent* d = readdir((DIR*)(intptr_t)it->handle);
+    if (!d) return -1;
+    if (sp_sys_diriter_is_dot(d->d_name)) continue;
+    out->name = d->d_name;
+    out->len = sp_cstr_len(d->d_name);
+    out->kind = sp_sys_diriter_dtype_to_kind(d->d_type);
+    return 0;
+  }
+}
+
+#elif defined(SP_WASM)
+s32 sp_sys_fs_it_open(sp_sys_fd_t fd, sp_sys_fs_it_t* it, const c8* path, u32 path_len, void* buf, u64 cap) {
+  sp_unreachable_return(-1);
+}
+
+void sp_sys_fs_it_close(sp_sys_fs_it_t* it) {
+  sp_unreachable();
+}
+
+s32 sp_sys_fs_it_next(sp_sys_fs_it_t* it, sp_sys_fs_entry_t* out) {
+  sp_unreachable_return(-1);
+}
+
+#else
+#error "sp_sys_fs_it_open"
+#error "sp_sys_fs_it_close"
+#error "sp_sys_fs_it_next"
+#endif
+
+
+//     ███████     █████████
+//   ███░░░░░███  ███░░░░░███
+//  ███     ░░███░███    ░░░
+// ░███      ░███░░█████████
+// ░███      ░███ ░░░░░░░░███
+// ░░███     ███  ███    ░███
+//  ░░░███████░  ░░█████████
+//    ░░░░░░░     ░░░░░░░░░
+// @os
+////////////
+// ASSERT //
+////////////
+void sp_assert_f(sp_str_t file, sp_str_t line, sp_str_t func, sp_str_t expr, bool cond) {
+  if (cond) return;
+
+#if SP_ASSERT_ENABLED(SP_ASSERT_LOG)
+  sp_io_stream_writer_t io = sp_io_get_std_err();
+  sp_fmt_io(
+    &io.base,
+    "{.red} {}:{.gray}:{.yellow}{.yellow} {}",
+    sp_fmt_cstr("assert"),
+    sp_fmt_str(file),
+    sp_fmt_str(line),
+    sp_fmt_str(func),
+    sp_fmt_cstr("()"),
+    sp_fmt_str(expr)
+  );
+  sp_io_write_cstr(&io.base, "\n", SP_NULLPTR);
+#endif
+
+#if SP_ASSERT_ENABLED(SP_ASSERT_TRAP)
+  sp_sys_assert(cond);
+#endif
+}
+
+///////////
+// SLEEP //
+///////////
+void sp_os_sleep_ns(u64 ns) {
+  sp_sys_timespec_t req = {
+    .tv_sec  = (s64)(ns / 1000000000ULL),
+    .tv_nsec = (s64)(ns % 1000000000ULL),
+  };
+  sp_sys_timespec_t rem = sp_zero;
+  sp_sys_nanosleep(&req, &rem);
+  // while (sp_sys_nanosleep(&req, &rem) == -1 && errno == SP_EINTR) {
+  //   req = rem;
+  // }
+}
+
+void sp_os_sleep_ms(f64 ms) {
+  sp_os_sleep_ns((u64)sp_tm_ms_to_ns_f(ms));
+}
+
+void sp_sleep_ns(u64 target) {
+  const u64 coarse = sp_tm_ms_to_ns(1);
+  u64 fine = coarse;
+
+  u64 elapsed = 0;
+  sp_tm_timer_t timer = sp_tm_start_timer();
+
+  // coarse sleep until we get pretty close
+  while (elapsed + fine < target) {
+    u64 before = sp_tm_read_timer(&timer);
+    sp_os_sleep_ns(coarse);
+    elapsed = sp_tm_read_timer(&timer);
+    fine = sp_max(fine, elapsed - before);
+  }
+
+  // fine sleep until we get really close
+  // guard against elapsed > target (can happen with debugger pauses or OS overshoots)
+  if (elapsed < target) {
+    u64 margin = fine - coarse;
+    u64 remaining = target - elapsed;
+    if (remaining > margin) {
+      sp_os_sleep_ns(remaining - margin);
+      elapsed = sp_tm_read_timer(&timer);
+    }
+  }
+
+  // spin until we get so god damn close we can taste it
+  while (elapsed < target) {
+    sp_spin_pause();
+    elapsed = sp_tm_read_timer(&timer);
+  }
+}
+
+void sp_sleep_ms(f64 ms) {
+  sp_sleep_ns((u64)sp_tm_ms_to_ns_f(ms));
+}
+
+
+//////////////////
+// SP_OS_PRINT //
+/////////////////
+#if defined(SP_WIN32)
+SP_PRIVATE void sp_os_win32_write(DWORD handle_id, sp_str_t message) {
+  HANDLE handle = GetStdHandle(handle_id);
+  DWORD written;
+  DWORD mode;
+  if (GetConsoleMode(handle, &mode)) {
+    WriteConsoleA(handle, message.data, message.len, &written, NULL);
+  } else {
+    WriteFile(handle, message.data, message.len, &written, NULL);
+  }
+}
+
+void sp_os_print(sp_str_t message) {
+  sp_os_win32_write(STD_OUTPUT_HANDLE, message);
+}
+
+void sp_os_print_err(sp_str_t message) {
+  sp_os_win32_write(STD_ERROR_HANDLE, message);
+}
+
+#else
+void sp_os_print(sp_str_t message) {
+  sp_sys_write(sp_sys_stdout, message.data, message.len);
+}
+
+void sp_os_print_err(sp_str_t message) {
+  sp_sys_write(sp_sys_stderr, message.data, message.len);
+}
+#endif
+
+
+/////////
+// TTY //
+/////////
+#if defined(SP_WIN32)
+bool sp_os_is_tty(sp_sys_fd_t fd) {
+  HANDLE handle = (HANDLE)fd;
+  if (handle == INVALID_HANDLE_VALUE || handle == SP_NULLPTR) return false;
+  DWORD mode;
+  return GetConsoleMode(handle, &mode) != 0;
+}
+
+void sp_os_tty_size(sp_sys_fd_t fd, u32* cols, u32* rows) {
+  if (cols) *cols = 0;
+  if (rows) *rows = 0;
+  HANDLE handle = (HANDLE)fd;
+  if (handle == INVALID_HANDLE_VALUE || handle == SP_NULLPTR) return;
+  CONSOLE_SCREEN_BUFFER_INFO csbi;
+  if (!GetConsoleScreenBufferInfo(handle, &csbi)) return;
+  if (cols) *cols = (u32)(csbi.srWindow.Right - csbi.srWindow.Left + 1);
+  if (rows) *rows = (u32)(csbi.srWindow.Bottom - csbi.srWindow.Top + 1);
+}
+
+s32 sp_os_tty_enter_raw(sp_sys_fd_t fd, sp_tty_mode_t* saved) {
+  HANDLE hin = GetStdHandle(STD_INPUT_HANDLE);
+  HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
+  (void)fd;
+  if (!GetConsoleMode(hin, &saved->input_mode)) return -1;
+  if (!GetConsoleMode(hout, &saved->output_mode)) return -1;
+  SetConsoleOutputCP(CP_UTF8);
+  DWORD raw_in = ENABLE_VIRTUAL_TERMINAL_INPUT;
+  DWORD raw_out = saved->output_mode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+  if (!SetConsoleMode(hin, raw_in)) return -1;
+  if (!SetConsoleMode(hout, raw_out)) return -1;
+  return 0;
+}
+
+s32 sp_os_tty_restore(sp_sys_fd_t fd, const sp_tty_mode_t* saved) {
+  (void)fd;
+  if (!SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), saved->input_mode)) return -1;
+  if (!SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), saved->output_mode)) return -1;
+  return 0;
+}
+
+#elif defined(SP_MACOS) || defined(SP_COSMO) || defined(SP_LINUX)
+#if defined(SP_LINUX)
+  typedef sp_sys_termios_t sp_termios_t;
+  typedef sp_sys_winsize_t sp_winsize_t;
+  #define sp_tcgetattr(f, t) sp_sys_tcgetattr(f, t)
+  #define sp_tcsetattr(f, o, t) sp_sys_tcsetattr(f, o, t)
+  #define sp_ioctl(f, r, a) sp_sys_ioctl(f, r, a)
+
+  s32 sp_sys_ioctl(s32 fd, u64 request, void* argp) {
+    return (s32)sp_syscall(SP_SYSCALL_NUM_IOCTL, fd, request, argp);
+  }
+
+  s32 sp_sys_tcgetattr(s32 fd, sp_sys_termios_t* termios) {
+    s32 result = sp_sys_ioctl(fd, SP_TCGETS, termios);
+    return result < 0 ? -1 : result;
+  }
+
+  s32 sp_sys_tcsetattr(s32 fd, s32 opt, const sp_sys_termios_t* termios) {
+    s32 result = sp_sys_ioctl(fd, SP_TCSETS + (u64)opt, (void*)termios);
+    return result < 0 ? -1 : result;
+  }
+#else
+  typedef struct termios sp_termios_t;
+  typedef struct winsize sp_winsize_t;
+  #define sp_tcgetattr(f, t) tcgetattr(f, t)
+  #define sp_tcsetattr(f, o, t) tcsetattr(f, o, t)
+  #define sp_ioctl(f, r, a) ioctl(f, r, a)
+#endif
+
+bool sp_os_is_tty(sp_sys_fd_t fd) {
+  sp_termios_t t = sp_zero;
+  return sp_tcgetattr(fd, &t) == 0;
+}
+
+void sp_os_tty_size(sp_sys_fd_t fd, u32* cols, u32* rows) {
+  if (cols) *cols = 0;
+  if (rows) *rows = 0;
+  sp_winsize_t ws = sp_zero;
+  if (sp_ioctl(fd, SP_TIOCGWINSZ, &ws) < 0) return;
+  if (cols) *cols = (u32)ws.ws_col;
+  if (rows) *rows = (u32)ws.ws_row;
+}
+
+s32 sp_os_tty_enter_raw(sp_sys_fd_t fd, sp_tty_mode_t* saved) {
+  if (sp_tcgetattr(fd, saved) == -1) return -1;
+  sp_termios_t raw = *saved;
+  raw.c_iflag &= (u32)~(SP_BRKINT | SP_ICRNL | SP_INPCK | SP_ISTRIP | SP_IXON);
+  raw.c_oflag &= (u32)~(SP_OPOST);
+  raw.c_cflag |= (u32)SP_CS8;
+  raw.c_lflag &= (u32)~(SP_ECHO | SP_ICANON | SP_IEXTEN | SP_ISIG);
+  raw.c_cc[SP_VMIN] = 1;
+  raw.c_cc[SP_VTIME] = 0;
+  return sp_tcsetattr(fd, SP_TCSAFLUSH, &raw);
+}
+
+s32 sp_os_tty_restore(sp_sys_fd_t fd, const sp_tty_mode_t* saved) {
+  return sp_tcsetattr(fd, SP_TCSAFLUSH, saved);
+}
+
+#elif defined(SP_WASM)
+bool sp_os_is_tty(sp_sys_fd_t fd)                                  { return false; }
+void sp_os_tty_size(sp_sys_fd_t fd, u32* cols, u32* rows)          { *cols = 0; *rows = 0; }
+s32  sp_os_tty_enter_raw(sp_sys_fd_t fd, sp_tty_mode_t* saved)     { return 0; }
+s32  sp_os_tty_restore(sp_sys_fd_t fd, const sp_tty_mode_t* saved) { return 0; }
+
+#else
+#error "sp_os_is_tty"
+#error "sp_os_tty_size"
+#error "sp_os_tty_enter_raw"
+#error "sp_os_tty_restore"
+#endif
+
+
+///////////
+// ENUMS //
+///////////
+#if defined(SP_WIN32)
+sp_os_kind_t sp_os_get_kind() {
+  return SP_OS_WIN32;
+}
+
+sp_fs_path_kind_t sp_os_get_path_kind() {
+  return SP_FS_PATH_WINDOWS;
+}
+
+sp_str_t sp_os_get_executable_ext() {
+  return sp_str_lit("exe");
+}
+
+sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
+  switch (kind) {
+    case SP_OS_LIB_SHARED: return sp_str_lit("dll");
+    case SP_OS_LIB_STATIC: return sp_str_lit("lib");
+  }
+
+  SP_UNREACHABLE_RETURN(sp_str_lit(""));
+}
+
+sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
+  return sp_fmt(mem, "{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
+}
+#endif
+
+#if defined(SP_MACOS)
+sp_os_kind_t sp_os_get_kind() {
+  return SP_OS_MACOS;
+}
+
+sp_fs_path_kind_t sp_os_get_path_kind() {
+  return SP_FS_PATH_POSIX;
+}
+
+sp_str_t sp_os_get_executable_ext() {
+  return sp_str_lit("");
+}
+
+sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
+  switch (kind) {
+    case SP_OS_LIB_SHARED: return sp_str_lit("dylib");
+    case SP_OS_LIB_STATIC: return sp_str_lit("a");
+  }
+
+  SP_UNREACHABLE();
+}
+
+sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
+  return sp_fmt(mem, "lib{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
+}
+#endif
+
+#if defined(SP_LINUX)
+sp_os_kind_t sp_os_get_kind() {
+  return SP_OS_LINUX;
+}
+
+sp_fs_path_kind_t sp_os_get_path_kind() {
+  return SP_FS_PATH_POSIX;
+}
+
+sp_str_t sp_os_get_executable_ext() {
+  return sp_str_lit("");
+}
+
+sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
+  switch (kind) {
+    case SP_OS_LIB_SHARED: return sp_str_lit("so");
+    case SP_OS_LIB_STATIC: return sp_str_lit("a");
+  }
+
+  SP_UNREACHABLE_RETURN(sp_str_lit(""));
+}
+
+sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
+  return sp_fmt(mem, "lib{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
+}
+#endif
+
+#if defined(SP_COSMO)
+sp_os_kind_t sp_os_get_kind() {
+  if (IsLinux()) {
+    return SP_OS_LINUX;
+  }
+  else if (IsWindows()) {
+    return SP_OS_WIN32;
+  }
+  else if (IsXnu()) {
+    return SP_OS_MACOS;
+  }
+
+  SP_UNREACHABLE_RETURN(SP_OS_LINUX);
+}
+
+sp_fs_path_kind_t sp_os_get_path_kind() {
+  switch (sp_os_get_kind()) {
+  case SP_OS_LINUX: return SP_FS_PATH_POSIX;
+  case SP_OS_MACOS: return SP_FS_PATH_POSIX;
+  case SP_OS_WIN32: return SP_FS_PATH_WINDOWS;
+  }
+
+  SP_UNREACHABLE_RETURN(SP_FS_PATH_POSIX);
+}
+
+sp_str_t sp_os_get_executable_ext() {
+  switch (sp_os_get_kind()) {
+  case SP_OS_LINUX: return sp_str_lit("");
+  case SP_OS_WIN32: return sp_str_lit("exe");
+  case SP_OS_MACOS: return sp_str_lit("");
+  }
+
+  SP_UNREACHABLE_RETURN(sp_str_lit(""));
+}
+
+sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
+  switch (kind) {
+    case SP_OS_LIB_SHARED: return sp_str_lit("so");
+    case SP_OS_LIB_STATIC: return sp_str_lit("a");
+  }
+
+  SP_UNREACHABLE_RETURN(sp_str_lit(""));
+}
+
+sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
+  return sp_fmt(mem, "lib{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
+}
+#endif
+
+#if defined(SP_WASM)
+sp_fs_path_kind_t sp_os_get_path_kind() {
+  return SP_FS_PATH_POSIX;
+}
+#endif
+
+////////////
+// SIGNAL //
+////////////
+#if defined(SP_WIN32)
+  #define SP_SYS_SIGNAL_INTERRUPT 2
+  #define SP_SYS_SIGNAL_TERMINATE 15
+  #define SP_SYS_SIGNAL_ABORT 22
+#else
+  #define SP_SYS_SIGNAL_INTERRUPT 2
+  #define SP_SYS_SIGNAL_TERMINATE 15
+  #define SP_SYS_SIGNAL_ABORT 6
+#endif
+
+SP_PRIVATE void sp_os_signal_from_native(s32 sig) {
+  sp_os_signal_t s;
+  switch (sig) {
+    case SP_SYS_SIGNAL_INTERRUPT: s = SP_OS_SIGNAL_INTERRUPT; break;
+    case SP_SYS_SIGNAL_TERMINATE: s = SP_OS_SIGNAL_TERMINATE; break;
+    case SP_SYS_SIGNAL_ABORT:     s = SP_OS_SIGNAL_ABORT;     break;
+    default: return;
+  }
+  if (sp_rt.signal_handlers[s]) {
+    sp_rt.signal_handlers[s](s, sp_rt.signal_userdata[s]);
+  }
+}
+
+SP_PRIVATE s32 sp_os_signal_to_native(sp_os_signal_t signal) {
+  switch (signal) {
+    case SP_OS_SIGNAL_INTERRUPT: return SP_SYS_SIGNAL_INTERRUPT;
+    case SP_OS_SIGNAL_TERMINATE: return SP_SYS_SIGNAL_TERMINATE;
+    case SP_OS_SIGNAL_ABORT:     return SP_SYS_SIGNAL_ABORT;
+  }
+  return -1;
+}
+
+#if defined(SP_WIN32)
+SP_PRIVATE BOOL WINAPI sp_os_signal_console_ctrl(DWORD type) {
+  switch (type) {
+    case CTRL_C_EVENT:     sp_os_signal_from_native(SP_SYS_SIGNAL_INTERRUPT); return TRUE;
+    case CTRL_CLOSE_EVENT: sp_os_signal_from_native(SP_SYS_SIGNAL_TERMINATE); return TRUE;
+    default: return FALSE;
+  }
+}
+
+void sp_os_register_signal_handler(sp_os_signal_t sig, sp_os_signal_handler_t handler, void* userdata) {
+  sp_rt.signal_handlers[sig] = handler;
+  sp_rt.signal_userdata[sig] = userdata;
+  if (sig == SP_OS_SIGNAL_ABORT) {
+    signal(sp_os_signal_to_native(sig), sp_os_signal_from_native);
+  } else {
+    SetConsoleCtrlHandler(sp_os_signal_console_ctrl, TRUE);
+  }
+}
+
+#elif defined(SP_FREESTANDING)
+__attribute__((naked)) SP_PRIVATE void sp_os_signal_restorer(void) {
+#if defined(SP_AMD64)
+  __asm__ __volatile__ (
+    "mov $15, %%rax\n"  /* __NR_rt_sigreturn */
+    "syscall"
+    ::: "rcx", "r11", "memory"
+  );
+#elif defined(SP_ARM64)
+  __asm__ __volatile__ (
+    "mov x8, #139\n"  /* __NR_rt_sigreturn */
+    "svc #0"
+    ::: "memory"
+  );
+#endif
+}
+
+void sp_os_register_signal_handler(sp_os_signal_t signal, sp_os_signal_handler_t handler, void* userdata) {
+  sp_rt.signal_handlers[signal] = handler;
+  sp_rt.signal_userdata[signal] = userdata;
+  s32 sig = sp_os_signal_to_native(signal);
+  /* kernel_sigaction for x86_64 */
+  struct {
+    void (*handler)(int);
+    u64   flags;
+    void (*restorer)(void);
+    u64   mask;
+  } sa;
+  sp_mem_zero(&sa, sizeof(sa));
+  sa.handler  = sp_os_signal_from_native;
+  sa.flags    = 0x04000000; /* SA_RESTORER */
+  sa.restorer = sp_os_signal_restorer;
+  sp_syscall(SP_SYSCALL_NUM_SIGACTION, sig, &sa, 0, 8);
+}
+
+#elif defined(SP_POSIX)
+void sp_os_register_signal_handler(sp_os_signal_t signal, sp_os_signal_handler_t handler, void* userdata) {
+  sp_rt.signal_handlers[signal] = handler;
+  sp_rt.signal_userdata[signal] = userdata;
+  struct sigaction sa;
+  sa.sa_handler = sp_os_signal_from_native;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = 0;
+  sigaction(sp_os_signal_to_native(signal), &sa, SP_NULLPTR);
+}
+
+#else
+void sp_os_register_signal_handler(sp_os_signal_t signal, sp_os_signal_handler_t handler, void* userdata) {
+  (void)signal;
+  (void)handler;
+  (void)userdata;
+}
+
+#endif
+
+#if defined(SP_LINUX) || defined(SP_WASM)
+void sp_os_qsort(void *arr, u64 len, u64 stride, sp_qsort_fn_t cmp) {
+  sp_sort(arr, len, stride, cmp);
 }
+#else
+void sp_os_qsort(void *arr, u64 len, u64 stride, sp_qsort_fn_t cmp) {
+  qsort(arr, len, stride, cmp);
+}
+
+#endif
+
+
+//  ██████████ ██████   █████ █████   █████
+// ░░███░░░░░█░░██████ ░░███ ░░███   ░░███
+//  ░███  █ ░  ░███░███ ░███  ░███    ░███
+//  ░██████    ░███░░███░███  ░███    ░███
+//  ░███░░█    ░███ ░░██████  ░░███   ███
+//  ░███ ░   █ ░███  ░░█████   ░░░█████░
+//  ██████████ █████  ░░█████    ░░███
+// ░░░░░░░░░░ ░░░░░    ░░░░░      ░░░
+// @env
+#if defined(SP_WIN32)
+typedef struct {
+  u8* base;
+  struct {
+    u8* base;
+    u16* env;
+  } params;
+} sp_win32_peb_t;
+
+SP_PRIVATE sp_win32_peb_t sp_win32_get_peb() {
+  sp_win32_peb_t peb = sp_zero;
+
+  #if defined(_MSC_VER)
+    static const s32 tpidr_el0 = 0x5E82;
+    static const u32 peb_offset = 0x60;
+
+    #if defined(_M_X64)
+      peb.base = (u8*)__readgsqword(peb_offset);
+    #elif defined(_M_ARM64)
+      peb.base = *(u8**)(_ReadStatusReg(tpidr_el0) + peb_offset);
+    #else
+      #error "unsupported architecture"
+    #endif
+  #else
+    #if defined(__x86_64__)
+      __asm__ volatile ("movq %%gs:0x60, %0" : "=r"(peb.base));
+    #elif defined(__i386__)
+      __asm__ volatile ("movl %%fs:0x30, %0" : "=r"(peb.base));
+    #elif defined(__aarch64__)
+      __asm__ volatile ("ldr %0, [x18, #0x60]" : "=r"(peb.base));
+    #else
+      #error "unsupported architecture"
+    #endif
+  #endif
 
-void sp_os_print_err(sp_str_t message) {
-  sp_sys_write(sp_sys_stderr, message.data, message.len);
-}
-#endif
+  // PEB->ProcessParameters
+  peb.params.base = *(u8**)(peb.base + 0x20);
 
+  // RTL_USER_PROCESS_PARAMETERS->Environment
+  peb.params.env = *(u16**)(peb.params.base + 0x80);
 
-/////////
-// TTY //
-/////////
-#if defined(SP_WIN32)
-bool sp_os_is_tty(sp_sys_fd_t fd) {
-  HANDLE handle = (HANDLE)fd;
-  if (handle == INVALID_HANDLE_VALUE || handle == SP_NULLPTR) return false;
-  DWORD mode;
-  return GetConsoleMode(handle, &mode) != 0;
+  return peb;
 }
 
-void sp_os_tty_size(sp_sys_fd_t fd, u32* cols, u32* rows) {
-  if (cols) *cols = 0;
-  if (rows) *rows = 0;
-  HANDLE handle = (HANDLE)fd;
-  if (handle == INVALID_HANDLE_VALUE || handle == SP_NULLPTR) return;
-  CONSOLE_SCREEN_BUFFER_INFO csbi;
-  if (!GetConsoleScreenBufferInfo(handle, &csbi)) return;
-  if (cols) *cols = (u32)(csbi.srWindow.Right - csbi.srWindow.Left + 1);
-  if (rows) *rows = (u32)(csbi.srWindow.Bottom - csbi.srWindow.Top + 1);
+SP_PRIVATE sp_str_t sp_win32_utf16_to_utf8(const u16* utf16, s32 len) {
+  s32 num_bytes = WideCharToMultiByte(CP_UTF8, 0, (LPCWSTR)utf16, len, NULL, 0, NULL, NULL);
+  c8* utf8 = (c8*)sp_mem_os_alloc(((u64)num_bytes + 1) * sizeof(c8));
+  WideCharToMultiByte(CP_UTF8, 0, (LPCWSTR)utf16, len, utf8, num_bytes, NULL, NULL);
+  utf8[num_bytes] = '\0';
+  return SP_RVAL(sp_str_t) {
+    .data = utf8,
+    .len = (u32)num_bytes
+  };
 }
 
-s32 sp_os_tty_enter_raw(sp_sys_fd_t fd, sp_tty_mode_t* saved) {
-  HANDLE hin = GetStdHandle(STD_INPUT_HANDLE);
-  HANDLE hout = GetStdHandle(STD_OUTPUT_HANDLE);
-  (void)fd;
-  if (!GetConsoleMode(hin, &saved->input_mode)) return -1;
-  if (!GetConsoleMode(hout, &saved->output_mode)) return -1;
-  SetConsoleOutputCP(CP_UTF8);
-  DWORD raw_in = ENABLE_VIRTUAL_TERMINAL_INPUT;
-  DWORD raw_out = saved->output_mode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-  if (!SetConsoleMode(hin, raw_in)) return -1;
-  if (!SetConsoleMode(hout, raw_out)) return -1;
-  return 0;
+SP_PRIVATE u32 sp_win32_utf16_len(const u16* str) {
+  u32 len = 0;
+  while (str[len]) len++;
+  return len;
 }
 
-s32 sp_os_tty_restore(sp_sys_fd_t fd, const sp_tty_mode_t* saved) {
-  (void)fd;
-  if (!SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), saved->input_mode)) return -1;
-  if (!SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), saved->output_mode)) return -1;
-  return 0;
+SP_PRIVATE bool sp_win32_utf16_equals_cstr(const u16* a, u32 a_len, const c8* b, u32 b_len) {
+  if (a_len != b_len) return false;
+  for (u32 i = 0; i < a_len; i++) {
+    u16 wa = a[i];
+    u16 wb = (u16)(u8)b[i];
+    if (wa >= 'A' && wa <= 'Z') wa += 32;
+    if (wb >= 'A' && wb <= 'Z') wb += 32;
+    if (wa != wb) return false;
+  }
+  return true;
 }
 
-#elif defined(SP_MACOS) || defined(SP_COSMO) || defined(SP_LINUX)
-#if defined(SP_LINUX)
-  typedef sp_sys_termios_t sp_termios_t;
-  typedef sp_sys_winsize_t sp_winsize_t;
-  #define sp_tcgetattr(f, t) sp_sys_tcgetattr(f, t)
-  #define sp_tcsetattr(f, o, t) sp_sys_tcsetattr(f, o, t)
-  #define sp_ioctl(f, r, a) sp_sys_ioctl(f, r, a)
+sp_str_t sp_os_env_get(sp_str_t key) {
+  sp_win32_peb_t peb = sp_win32_get_peb();
 
-  s32 sp_sys_ioctl(s32 fd, u64 request, void* argp) {
-    return (s32)sp_syscall(SP_SYSCALL_NUM_IOCTL, fd, request, argp);
-  }
+  u16* p = peb.params.env;
+  while (*p) {
+    u32 eq = (*p == L'=') ? 1 : 0;
+    while (p[eq] && p[eq] != L'=') eq++;
 
-  s32 sp_sys_tcgetattr(s32 fd, sp_sys_termios_t* termios) {
-    s32 result = sp_sys_ioctl(fd, SP_TCGETS, termios);
-    return result < 0 ? -1 : result;
-  }
+    if (sp_win32_utf16_equals_cstr(p, eq, key.data, key.len)) {
+      u16* value = p + eq + 1;
+      u32 len = sp_win32_utf16_len(value);
+      return sp_win32_utf16_to_utf8(value, len);
+    }
 
-  s32 sp_sys_tcsetattr(s32 fd, s32 opt, const sp_sys_termios_t* termios) {
-    s32 result = sp_sys_ioctl(fd, SP_TCSETS + (u64)opt, (void*)termios);
-    return result < 0 ? -1 : result;
+    p += sp_win32_utf16_len(p) + 1;
   }
-#else
-  typedef struct termios sp_termios_t;
-  typedef struct winsize sp_winsize_t;
-  #define sp_tcgetattr(f, t) tcgetattr(f, t)
-  #define sp_tcsetattr(f, o, t) tcsetattr(f, o, t)
-  #define sp_ioctl(f, r, a) ioctl(f, r, a)
-#endif
 
-bool sp_os_is_tty(sp_sys_fd_t fd) {
-  sp_termios_t t = sp_zero;
-  return sp_tcgetattr(fd, &t) == 0;
+  return sp_zero_s(sp_str_t);
 }
 
-void sp_os_tty_size(sp_sys_fd_t fd, u32* cols, u32* rows) {
-  if (cols) *cols = 0;
-  if (rows) *rows = 0;
-  sp_winsize_t ws = sp_zero;
-  if (sp_ioctl(fd, SP_TIOCGWINSZ, &ws) < 0) return;
-  if (cols) *cols = (u32)ws.ws_col;
-  if (rows) *rows = (u32)ws.ws_row;
-}
+SP_PRIVATE sp_env_var_t sp_os_env_parse_var(sp_str_t entry) {
+  if (sp_str_empty(entry)) return sp_zero_s(sp_env_var_t);
 
-s32 sp_os_tty_enter_raw(sp_sys_fd_t fd, sp_tty_mode_t* saved) {
-  if (sp_tcgetattr(fd, saved) == -1) return -1;
-  sp_termios_t raw = *saved;
-  raw.c_iflag &= (u32)~(SP_BRKINT | SP_ICRNL | SP_INPCK | SP_ISTRIP | SP_IXON);
-  raw.c_oflag &= (u32)~(SP_OPOST);
-  raw.c_cflag |= (u32)SP_CS8;
-  raw.c_lflag &= (u32)~(SP_ECHO | SP_ICANON | SP_IEXTEN | SP_ISIG);
-  raw.c_cc[SP_VMIN] = 1;
-  raw.c_cc[SP_VTIME] = 0;
-  return sp_tcsetattr(fd, SP_TCSAFLUSH, &raw);
-}
+  sp_env_var_t result = { .key = entry };
+  u32 start = entry.data[0] == '=' ? 1 : 0;
 
-s32 sp_os_tty_restore(sp_sys_fd_t fd, const sp_tty_mode_t* saved) {
-  return sp_tcsetattr(fd, SP_TCSAFLUSH, saved);
-}
+  sp_for_range(i, start, entry.len) {
+    if (entry.data[i] == '=') {
+      result.key = sp_str_sub(entry, 0, i);
+      result.value = sp_str_sub(entry, i + 1, entry.len - i - 1);
+      break;
+    }
+  }
 
-#elif defined(SP_WASM)
-bool sp_os_is_tty(sp_sys_fd_t fd)                                  { return false; }
-void sp_os_tty_size(sp_sys_fd_t fd, u32* cols, u32* rows)          { *cols = 0; *rows = 0; }
-s32  sp_os_tty_enter_raw(sp_sys_fd_t fd, sp_tty_mode_t* saved)     { return 0; }
-s32  sp_os_tty_restore(sp_sys_fd_t fd, const sp_tty_mode_t* saved) { return 0; }
+  return result;
+}
 
-#else
-#error "sp_os_is_tty"
-#error "sp_os_tty_size"
-#error "sp_os_tty_enter_raw"
-#error "sp_os_tty_restore"
-#endif
+typedef struct {
+  u16* block;
+  u16* cursor;
+  sp_str_t entry;
+} sp_win32_env_it_t;
 
+SP_PRIVATE void sp_win32_env_it_set_current(sp_os_env_it_t* it) {
+  sp_win32_env_it_t* state = (sp_win32_env_it_t*)it->os;
+  state->entry = sp_win32_utf16_to_utf8(state->cursor, sp_win32_utf16_len(state->cursor));
 
-///////////
-// ENUMS //
-///////////
-#if defined(SP_WIN32)
-sp_os_kind_t sp_os_get_kind() {
-  return SP_OS_WIN32;
+  sp_env_var_t var = sp_os_env_parse_var(state->entry);
+  it->key = var.key;
+  it->value = var.value;
 }
 
-sp_fs_path_kind_t sp_os_get_path_kind() {
-  return SP_FS_PATH_WINDOWS;
+sp_os_env_it_t sp_os_env_it_begin() {
+  sp_os_env_it_t it = sp_zero;
+  sp_win32_env_it_t* state = (sp_win32_env_it_t*)sp_mem_os_alloc(sizeof(sp_win32_env_it_t));
+  state->block = sp_win32_get_peb().params.env;
+  state->cursor = state->block;
+  it.os = state;
+
+  if (state->block && state->cursor[0] != L'\0') {
+    sp_win32_env_it_set_current(&it);
+  }
+  return it;
 }
 
-sp_str_t sp_os_get_executable_ext() {
-  return sp_str_lit("exe");
+bool sp_os_env_it_valid(sp_os_env_it_t* it) {
+  sp_win32_env_it_t* state = (sp_win32_env_it_t*)it->os;
+  return state && state->cursor && state->cursor[0] != L'\0';
 }
 
-sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
-  switch (kind) {
-    case SP_OS_LIB_SHARED: return sp_str_lit("dll");
-    case SP_OS_LIB_STATIC: return sp_str_lit("lib");
+void sp_os_env_it_next(sp_os_env_it_t* it) {
+  sp_win32_env_it_t* state = (sp_win32_env_it_t*)it->os;
+  state->cursor += wcslen(sp_ptr_cast(const wchar_t*, state->cursor)) + 1;
+  if (state->cursor[0] != L'\0') {
+    sp_win32_env_it_set_current(it);
+  } else {
+    sp_mem_os_free(state, sizeof(sp_win32_env_it_t));
+    *it = sp_zero_s(sp_os_env_it_t);
   }
-
-  SP_UNREACHABLE_RETURN(sp_str_lit(""));
 }
 
-sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
-  return sp_fmt(mem, "{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
-}
-#endif
+#elif defined(SP_FREESTANDING)
+typedef struct {
+  sp_env_t env;
+  sp_ht_it_t it;
+} sp_linux_env_it_t;
 
-#if defined(SP_MACOS)
-sp_os_kind_t sp_os_get_kind() {
-  return SP_OS_MACOS;
+SP_PRIVATE void sp_linux_env_it_set_current(sp_os_env_it_t* it) {
+  sp_linux_env_it_t* state = (sp_linux_env_it_t*)it->os;
+  it->key = *sp_str_ht_it_getkp(state->env.vars, state->it);
+  it->value = *sp_str_ht_it_getp(state->env.vars, state->it);
 }
 
-sp_fs_path_kind_t sp_os_get_path_kind() {
-  return SP_FS_PATH_POSIX;
+sp_str_t sp_os_env_get(sp_str_t key) {
+  for (c8** p = environ; *p; p++) {
+    sp_str_pair_t pair = sp_str_cleave_c8(sp_cstr_as_str(*p), '=');
+    if (sp_str_equal(key, pair.first)) {
+      return pair.second;
+    }
+  }
+  return sp_zero_s(sp_str_t);
 }
 
-sp_str_t sp_os_get_executable_ext() {
-  return sp_str_lit("");
-}
+sp_os_env_it_t sp_os_env_it_begin() {
+  sp_linux_env_it_t* os = (sp_linux_env_it_t*)sp_mem_os_alloc(sizeof(sp_linux_env_it_t));
+  *os = sp_zero_s(sp_linux_env_it_t);
 
-sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
-  switch (kind) {
-    case SP_OS_LIB_SHARED: return sp_str_lit("dylib");
-    case SP_OS_LIB_STATIC: return sp_str_lit("a");
+  sp_mem_t mem = sp_mem_os_new();
+  sp_env_init(mem, &os->env);
+  for (c8** p = environ; *p; p++) {
+    sp_str_pair_t pair = sp_str_cleave_c8(sp_str_view(*p), '=');
+    sp_str_ht_insert(os->env.vars, pair.first, pair.second);
   }
 
-  SP_UNREACHABLE();
-}
+  os->it = sp_str_ht_it_init(os->env.vars);
 
-sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
-  return sp_fmt(mem, "lib{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
-}
-#endif
+  if (!sp_str_ht_it_valid(os->env.vars, os->it)) {
+    sp_mem_os_free(os, sizeof(sp_linux_env_it_t));
+    return sp_zero_s(sp_os_env_it_t);
+  }
 
-#if defined(SP_LINUX)
-sp_os_kind_t sp_os_get_kind() {
-  return SP_OS_LINUX;
+  sp_os_env_it_t it = sp_zero;
+  it.os = os;
+  sp_linux_env_it_set_current(&it);
+  return it;
 }
 
-sp_fs_path_kind_t sp_os_get_path_kind() {
-  return SP_FS_PATH_POSIX;
+bool sp_os_env_it_valid(sp_os_env_it_t* it) {
+  sp_linux_env_it_t* state = (sp_linux_env_it_t*)it->os;
+  return state && sp_str_ht_it_valid(state->env.vars, state->it);
 }
 
-sp_str_t sp_os_get_executable_ext() {
-  return sp_str_lit("");
-}
+void sp_os_env_it_next(sp_os_env_it_t* it) {
+  sp_linux_env_it_t* state = (sp_linux_env_it_t*)it->os;
+  sp_str_ht_it_advance(state->env.vars, state->it);
 
-sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
-  switch (kind) {
-    case SP_OS_LIB_SHARED: return sp_str_lit("so");
-    case SP_OS_LIB_STATIC: return sp_str_lit("a");
+  if (sp_str_ht_it_valid(state->env.vars, state->it)) {
+    sp_linux_env_it_set_current(it);
+  } else {
+    it->key = sp_zero_s(sp_str_t);
+    it->value = sp_zero_s(sp_str_t);
+    sp_mem_os_free(state, sizeof(sp_linux_env_it_t));
+    it->os = SP_NULLPTR;
   }
-
-  SP_UNREACHABLE_RETURN(sp_str_lit(""));
 }
 
-sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
-  return sp_fmt(mem, "lib{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
-}
-#endif
+#elif defined(SP_MACOS) || defined(SP_COSMO) || defined(SP_LINUX) || defined(SP_WASM)
+extern c8** environ;
 
+SP_PRIVATE bool sp_os_env_key_equal(sp_str_t a, sp_str_t b) {
 #if defined(SP_COSMO)
-sp_os_kind_t sp_os_get_kind() {
-  if (IsLinux()) {
-    return SP_OS_LINUX;
-  }
-  else if (IsWindows()) {
-    return SP_OS_WIN32;
-  }
-  else if (IsXnu()) {
-    return SP_OS_MACOS;
+  if (IsWindows()) {
+    if (a.len != b.len) return false;
+    for (u32 i = 0; i < a.len; i++) {
+      c8 ca = a.data[i];
+      c8 cb = b.data[i];
+      if (ca >= 'A' && ca <= 'Z') ca += 32;
+      if (cb >= 'A' && cb <= 'Z') cb += 32;
+      if (ca != cb) return false;
+    }
+    return true;
   }
-
-  SP_UNREACHABLE_RETURN(SP_OS_LINUX);
+#endif
+  return sp_str_equal(a, b);
 }
 
-sp_fs_path_kind_t sp_os_get_path_kind() {
-  switch (sp_os_get_kind()) {
-  case SP_OS_LINUX: return SP_FS_PATH_POSIX;
-  case SP_OS_MACOS: return SP_FS_PATH_POSIX;
-  case SP_OS_WIN32: return SP_FS_PATH_WINDOWS;
+sp_str_t sp_os_env_get(sp_str_t key) {
+  for (c8** envp = environ; envp && *envp; envp++) {
+    sp_str_pair_t pair = sp_str_cleave_c8(sp_str_view(*envp), '=');
+    if (sp_os_env_key_equal(pair.first, key)) {
+      return pair.second;
+    }
   }
-
-  SP_UNREACHABLE_RETURN(SP_FS_PATH_POSIX);
+  return sp_zero_s(sp_str_t);
 }
 
-sp_str_t sp_os_get_executable_ext() {
-  switch (sp_os_get_kind()) {
-  case SP_OS_LINUX: return sp_str_lit("");
-  case SP_OS_WIN32: return sp_str_lit("exe");
-  case SP_OS_MACOS: return sp_str_lit("");
-  }
-
-  SP_UNREACHABLE_RETURN(sp_str_lit(""));
+SP_PRIVATE void sp_os_env_it_set(sp_os_env_it_t* it) {
+  c8** envp = (c8**)it->os;
+  sp_str_t entry = sp_str_view(*envp);
+  u32 offset = (entry.len > 0 && entry.data[0] == '=') ? 1 : 0;
+  sp_str_t scan = { .data = entry.data + offset, .len = entry.len - offset };
+  sp_str_pair_t pair = sp_str_cleave_c8(scan, '=');
+  it->key = (sp_str_t) { .data = entry.data, .len = pair.first.len + offset };
+  it->value = pair.second;
 }
 
-sp_str_t sp_os_lib_kind_to_extension(sp_os_lib_kind_t kind) {
-  switch (kind) {
-    case SP_OS_LIB_SHARED: return sp_str_lit("so");
-    case SP_OS_LIB_STATIC: return sp_str_lit("a");
+sp_os_env_it_t sp_os_env_it_begin() {
+  sp_os_env_it_t it = sp_zero;
+  it.os = environ;
+
+  if (sp_os_env_it_valid(&it)) {
+    sp_os_env_it_set(&it);
   }
 
-  SP_UNREACHABLE_RETURN(sp_str_lit(""));
+  return it;
 }
 
-sp_str_t sp_os_lib_to_file_name(sp_mem_t mem, sp_str_t lib_name, sp_os_lib_kind_t kind) {
-  return sp_fmt(mem, "lib{}.{}", sp_fmt_str(lib_name), sp_fmt_str(sp_os_lib_kind_to_extension(kind))).value;
+bool sp_os_env_it_valid(sp_os_env_it_t* it) {
+  c8** envp = (c8**)it->os;
+  return envp && *envp;
 }
-#endif
 
-#if defined(SP_WASM)
-sp_fs_path_kind_t sp_os_get_path_kind() {
-  return SP_FS_PATH_POSIX;
+void sp_os_env_it_next(sp_os_env_it_t* it) {
+  c8** envp = (c8**)it->os;
+  envp++;
+
+  if (envp && *envp) {
+    it->os = envp;
+    sp_os_env_it_set(it);
+  } else {
+    it->key = sp_zero_s(sp_str_t);
+    it->value = sp_zero_s(sp_str_t);
+    it->os = SP_NULLPTR;
+  }
 }
+
+#else
+#error "sp_os_env_it_begin"
+#error "sp_os_env_it_valid"
+#error "sp_os_env_it_next"
 #endif
 
-////////////
-// SIGNAL //
-////////////
+void sp_sys_env(const c8** env, u32* len) {
 #if defined(SP_WIN32)
-  #define SP_SYS_SIGNAL_INTERRUPT 2
-  #define SP_SYS_SIGNAL_TERMINATE 15
-  #define SP_SYS_SIGNAL_ABORT 22
+#elif defined(SP_FREESTANDING)
+#elif defined(SP_MACOS) || defined(SP_COSMO) || defined(SP_LINUX) || defined(SP_WASM)
 #else
-  #define SP_SYS_SIGNAL_INTERRUPT 2
-  #define SP_SYS_SIGNAL_TERMINATE 15
-  #define SP_SYS_SIGNAL_ABORT 6
+  sp_unused(env);
+  sp_unused(len);
 #endif
-
-SP_PRIVATE void sp_os_signal_from_native(s32 sig) {
-  sp_os_signal_t s;
-  switch (sig) {
-    case SP_SYS_SIGNAL_INTERRUPT: s = SP_OS_SIGNAL_INTERRUPT; break;
-    case SP_SYS_SIGNAL_TERMINATE: s = SP_OS_SIGNAL_TERMINATE; break;
-    case SP_SYS_SIGNAL_ABORT:     s = SP_OS_SIGNAL_ABORT;     break;
-    default: return;
-  }
-  if (sp_rt.signal_handlers[s]) {
-    sp_rt.signal_handlers[s](s, sp_rt.signal_userdata[s]);
-  }
 }
 
-SP_PRIVATE s32 sp_os_signal_to_native(sp_os_signal_t signal) {
-  switch (signal) {
-    case SP_OS_SIGNAL_INTERRUPT: return SP_SYS_SIGNAL_INTERRUPT;
-    case SP_OS_SIGNAL_TERMINATE: return SP_SYS_SIGNAL_TERMINATE;
-    case SP_OS_SIGNAL_ABORT:     return SP_SYS_SIGNAL_ABORT;
-  }
-  return -1;
+
+void sp_env_init(sp_mem_t mem, sp_env_t* env) {
+  *env = sp_zero_s(sp_env_t);
+  env->mem = mem;
+  env->arena = sp_mem_arena_new_ex(mem, 4096, SP_MEM_ALIGNMENT);
+  sp_str_ht_init(mem, env->vars);
 }
 
-#if defined(SP_WIN32)
-SP_PRIVATE BOOL WINAPI sp_os_signal_console_ctrl(DWORD type) {
-  switch (type) {
-    case CTRL_C_EVENT:     sp_os_signal_from_native(SP_SYS_SIGNAL_INTERRUPT); return TRUE;
-    case CTRL_CLOSE_EVENT: sp_os_signal_from_native(SP_SYS_SIGNAL_TERMINATE); return TRUE;
-    default: return FALSE;
+sp_env_t sp_env_capture(sp_mem_t mem) {
+  sp_env_t env = sp_zero;
+  sp_env_init(mem, &env);
+
+  for (sp_os_env_it_t it = sp_os_env_it_begin(); sp_os_env_it_valid(&it); sp_os_env_it_next(&it)) {
+    sp_env_insert(&env, it.key, it.value);
   }
+  return env;
 }
 
-void sp_os_register_signal_handler(sp_os_signal_t sig, sp_os_signal_handler_t handler, void* userdata) {
-  sp_rt.signal_handlers[sig] = handler;
-  sp_rt.signal_userdata[sig] = userdata;
-  if (sig == SP_OS_SIGNAL_ABORT) {
-    signal(sp_os_signal_to_native(sig), sp_os_signal_from_native);
-  } else {
-    SetConsoleCtrlHandler(sp_os_signal_console_ctrl, TRUE);
+sp_env_t sp_env_copy(sp_mem_t mem, sp_env_t* env) {
+  sp_env_t copy = sp_zero;
+  sp_env_init(mem, &copy);
+
+  sp_str_ht_for(env->vars, it) {
+    sp_str_t key = *sp_str_ht_it_getkp(env->vars, it);
+    sp_str_t val = *sp_str_ht_it_getp(env->vars, it);
+    sp_env_insert(&copy, key, val);
   }
-}
 
-#elif defined(SP_FREESTANDING)
-__attribute__((naked)) SP_PRIVATE void sp_os_signal_restorer(void) {
-#if defined(SP_AMD64)
-  __asm__ __volatile__ (
-    "mov $15, %%rax\n"  /* __NR_rt_sigreturn */
-    "syscall"
-    ::: "rcx", "r11", "memory"
-  );
-#elif defined(SP_ARM64)
-  __asm__ __volatile__ (
-    "mov x8, #139\n"  /* __NR_rt_sigreturn */
-    "svc #0"
-    ::: "memory"
-  );
-#endif
+  return copy;
 }
 
-void sp_os_register_signal_handler(sp_os_signal_t signal, sp_os_signal_handler_t handler, void* userdata) {
-  sp_rt.signal_handlers[signal] = handler;
-  sp_rt.signal_userdata[signal] = userdata;
-  s32 sig = sp_os_signal_to_native(signal);
-  /* kernel_sigaction for x86_64 */
-  struct {
-    void (*handler)(int);
-    u64   flags;
-    void (*restorer)(void);
-    u64   mask;
-  } sa;
-  sp_mem_zero(&sa, sizeof(sa));
-  sa.handler  = sp_os_signal_from_native;
-  sa.flags    = 0x04000000; /* SA_RESTORER */
-  sa.restorer = sp_os_signal_restorer;
-  sp_syscall(SP_SYSCALL_NUM_SIGACTION, sig, &sa, 0, 8);
+u32 sp_env_count(sp_env_t* env) {
+  return (u32)sp_str_ht_size(env->vars);
 }
 
-#elif defined(SP_POSIX)
-void sp_os_register_signal_handler(sp_os_signal_t signal, sp_os_signal_handler_t handler, void* userdata) {
-  sp_rt.signal_handlers[signal] = handler;
-  sp_rt.signal_userdata[signal] = userdata;
-  struct sigaction sa;
-  sa.sa_handler = sp_os_signal_from_native;
-  sigemptyset(&sa.sa_mask);
-  sa.sa_flags = 0;
-  sigaction(sp_os_signal_to_native(signal), &sa, SP_NULLPTR);
+sp_str_t sp_env_get(sp_env_t* env, sp_str_t name) {
+  sp_str_t* val = sp_str_ht_get(env->vars, name);
+  return val ? *val : sp_zero_s(sp_str_t);
 }
 
-#else
-void sp_os_register_signal_handler(sp_os_signal_t signal, sp_os_signal_handler_t handler, void* userdata) {
-  (void)signal;
-  (void)handler;
-  (void)userdata;
+sp_str_t sp_env_get_c(sp_env_t* env, const c8* name) {
+  return sp_env_get(env, sp_cstr_as_str(name));
 }
 
-#endif
-
-#if defined(SP_LINUX) || defined(SP_WASM)
-void sp_os_qsort(void *arr, u64 len, u64 stride, sp_qsort_fn_t cmp) {
-  u8 *a = sp_void_cast(a, arr);
-  u64 gap, i, j;
-  sp_mem_arena_marker_t s = sp_mem_begin_scratch();
-  u8* tmp = sp_alloc_n(s.mem, u8, stride);
+bool sp_env_contains(sp_env_t* env, sp_str_t name) {
+  return sp_str_ht_get(env->vars, name);
+}
 
-  for (gap = len / 3; gap > 0; gap /= 3 + 1) {
-    for (i = gap; i < len; i++) {
-      sp_sys_memcpy(tmp, a + i * stride, stride);
-      for (j = i; j >= gap && cmp(a + (j - gap) * stride, tmp) > 0; j -= gap) {
-        sp_sys_memcpy(a + j * stride, a + (j - gap) * stride, stride);
-      }
-      sp_sys_memcpy(a + j * stride, tmp, stride);
-    }
-  }
+bool sp_env_contains_c(sp_env_t* env, const c8* name) {
+  return sp_env_contains(env, sp_cstr_as_str(name));
+}
 
-  sp_mem_end_scratch(s);
+void sp_env_insert(sp_env_t* env, sp_str_t name, sp_str_t value) {
+  sp_mem_t arena = sp_mem_arena_as_allocator(env->arena);
+  sp_str_ht_insert(env->vars, sp_str_copy(arena, name), sp_str_copy(arena, value));
 }
-#else
-void sp_os_qsort(void *arr, u64 len, u64 stride, sp_qsort_fn_t cmp) {
-  qsort(arr, len, stride, cmp);
+
+void sp_env_insert_c(sp_env_t* env, const c8* name, const c8* value) {
+  sp_env_insert(env, sp_cstr_as_str(name), sp_cstr_as_str(value));
 }
 
-#endif
+void sp_env_erase(sp_env_t* env, sp_str_t name) {
+  sp_str_ht_erase(env->vars, name);
+}
 
+void sp_env_erase_c(sp_env_t* env, const c8* name) {
+  sp_env_erase(env, sp_cstr_as_str(name));
+}
 
-//  ██████████ ██████   █████ █████   █████
-// ░░███░░░░░█░░██████ ░░███ ░░███   ░░███
-//  ░███  █ ░  ░███░███ ░███  ░███    ░███
-//  ░██████    ░███░░███░███  ░███    ░███
-//  ░███░░█    ░███ ░░██████  ░░███   ███
-//  ░███ ░   █ ░███  ░░█████   ░░░█████░
-//  ██████████ █████  ░░█████    ░░███
-// ░░░░░░░░░░ ░░░░░    ░░░░░      ░░░
-// @env
-#if defined(SP_WIN32)
-typedef struct {
-  u8* base;
-  struct {
-    u8* base;
-    u16* env;
-  } params;
-} sp_win32_peb_t;
+void sp_env_destroy(sp_env_t* env) {
+  sp_str_ht_free(env->vars);
+  if (env->arena) sp_mem_arena_destroy(env->arena);
+  *env = sp_zero_s(sp_env_t);
+}
 
-SP_PRIVATE sp_win32_peb_t sp_win32_get_peb() {
-  sp_win32_peb_t peb = sp_zero;
 
-  #if defined(_MSC_VER)
-    static const s32 tpidr_el0 = 0x5E82;
-    static const u32 peb_offset = 0x60;
 
-    #if defined(_M_X64)
-      peb.base = (u8*)__readgsqword(peb_offset);
-    #elif defined(_M_ARM64)
-      peb.base = *(u8**)(_ReadStatusReg(tpidr_el0) + peb_offset);
-    #else
-      #error "unsupported architecture"
-    #endif
-  #else
-    #if defined(__x86_64__)
-      __asm__ volatile ("movq %%gs:0x60, %0" : "=r"(peb.base));
-    #elif defined(__i386__)
-      __asm__ volatile ("movl %%fs:0x30, %0" : "=r"(peb.base));
-    #elif defined(__aarch64__)
-      __asm__ volatile ("ldr %0, [x18, #0x60]" : "=r"(peb.base));
-    #else
-      #error "unsupported architecture"
-    #endif
-  #endif
 
-  // PEB->ProcessParameters
-  peb.params.base = *(u8**)(peb.base + 0x20);
+// ████████╗██╗███╗   ███╗███████╗
+// ╚══██╔══╝██║████╗ ████║██╔════╝
+//    ██║   ██║██╔████╔██║█████╗
+//    ██║   ██║██║╚██╔╝██║██╔══╝
+//    ██║   ██║██║ ╚═╝ ██║███████╗
+//    ╚═╝   ╚═╝╚═╝     ╚═╝╚══════╝
+// @time
+sp_tm_point_t sp_tm_now_point() {
+  sp_sys_timespec_t ts;
+  sp_sys_clock_gettime(SP_CLOCK_MONOTONIC, &ts);
+  return (sp_tm_point_t)((u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec);
+}
 
-  // RTL_USER_PROCESS_PARAMETERS->Environment
-  peb.params.env = *(u16**)(peb.params.base + 0x80);
+sp_tm_epoch_t sp_tm_now_epoch() {
+  sp_sys_timespec_t ts;
+  sp_sys_clock_gettime(SP_CLOCK_REALTIME, &ts);
+  return SP_RVAL(sp_tm_epoch_t) {
+    .s  = (u64)ts.tv_sec,
+    .ns = (u32)ts.tv_nsec,
+  };
+}
 
-  return peb;
+u64 sp_tm_point_diff(sp_tm_point_t newer, sp_tm_point_t older) {
+  return newer - older;
 }
 
-SP_PRIVATE sp_str_t sp_win32_utf16_to_utf8(const u16* utf16, s32 len) {
-  s32 num_bytes = WideCharToMultiByte(CP_UTF8, 0, (LPCWSTR)utf16, len, NULL, 0, NULL, NULL);
-  c8* utf8 = (c8*)sp_mem_os_alloc(((u64)num_bytes + 1) * sizeof(c8));
-  WideCharToMultiByte(CP_UTF8, 0, (LPCWSTR)utf16, len, utf8, num_bytes, NULL, NULL);
-  utf8[num_bytes] = '\0';
-  return SP_RVAL(sp_str_t) {
-    .data = utf8,
-    .len = (u32)num_bytes
+sp_tm_timer_t sp_tm_start_timer() {
+  sp_tm_point_t now = sp_tm_now_point();
+  return SP_RVAL(sp_tm_timer_t) {
+    .start = now,
+    .previous = now
   };
 }
 
-SP_PRIVATE u32 sp_win32_utf16_len(const u16* str) {
-  u32 len = 0;
-  while (str[len]) len++;
-  return len;
+u64 sp_tm_read_timer(sp_tm_timer_t* timer) {
+  sp_tm_point_t current = sp_tm_now_point();
+  if (current < timer->previous) {
+    timer->previous = current;
+  }
+  return sp_tm_point_diff(current, timer->start);
 }
 
-SP_PRIVATE bool sp_win32_utf16_equals_cstr(const u16* a, u32 a_len, const c8* b, u32 b_len) {
-  if (a_len != b_len) return false;
-  for (u32 i = 0; i < a_len; i++) {
-    u16 wa = a[i];
-    u16 wb = (u16)(u8)b[i];
-    if (wa >= 'A' && wa <= 'Z') wa += 32;
-    if (wb >= 'A' && wb <= 'Z') wb += 32;
-    if (wa != wb) return false;
+u64 sp_tm_lap_timer(sp_tm_timer_t* timer) {
+  sp_tm_point_t current = sp_tm_now_point();
+  if (current < timer->previous) {
+    timer->previous = current;
   }
-  return true;
+  u64 elapsed = sp_tm_point_diff(current, timer->previous);
+  timer->previous = current;
+  return elapsed;
 }
 
-sp_str_t sp_os_env_get(sp_str_t key) {
-  sp_win32_peb_t peb = sp_win32_get_peb();
+void sp_tm_reset_timer(sp_tm_timer_t* timer) {
+  sp_tm_point_t now = sp_tm_now_point();
+  timer->start = now;
+  timer->previous = now;
+}
 
-  u16* p = peb.params.env;
-  while (*p) {
-    u32 eq = (*p == L'=') ? 1 : 0;
-    while (p[eq] && p[eq] != L'=') eq++;
+sp_tm_date_time_t sp_tm_epoch_to_date_time(sp_tm_epoch_t time) {
+  u64 epoch = time.s;
+  u32 sec = (u32)(epoch % 60); epoch /= 60;
+  u32 min = (u32)(epoch % 60); epoch /= 60;
+  u32 hour = (u32)(epoch % 24); epoch /= 24;
 
-    if (sp_win32_utf16_equals_cstr(p, eq, key.data, key.len)) {
-      u16* value = p + eq + 1;
-      u32 len = sp_win32_utf16_len(value);
-      return sp_win32_utf16_to_utf8(value, len);
-    }
+  s64 days = (s64)epoch + 719468;
+  s64 era = (days >= 0 ? days : days - 146096) / 146097;
+  u32 doe = (u32)(days - era * 146097);
+  u32 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  s64 y = (s64)yoe + era * 400;
+  u32 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  u32 mp = (5 * doy + 2) / 153;
+  u32 d = doy - (153 * mp + 2) / 5 + 1;
+  u32 m = mp < 10 ? mp + 3 : mp - 9;
+  if (m <= 2) y += 1;
 
-    p += sp_win32_utf16_len(p) + 1;
-  }
+  return SP_RVAL(sp_tm_date_time_t) {
+    .year = (s32)y,
+    .month = (s32)m,
+    .day = (s32)d,
+    .hour = (s32)hour,
+    .minute = (s32)min,
+    .second = (s32)sec,
+    .millisecond = (s32)(time.ns / 1000000),
+  };
+}
 
-  return sp_zero_s(sp_str_t);
+#if defined(SP_FREESTANDING)
+sp_tm_date_time_t sp_tm_get_date_time() {
+  return sp_zero_s(sp_tm_date_time_t);
 }
+#else
+sp_tm_date_time_t sp_tm_get_date_time() {
+  return sp_tm_epoch_to_date_time(sp_tm_now_epoch());
+}
+#endif
 
-SP_PRIVATE sp_env_var_t sp_os_env_parse_var(sp_str_t entry) {
-  if (sp_str_empty(entry)) return sp_zero_s(sp_env_var_t);
+u64 sp_tm_s_to_ms(u64 s) {
+  SP_ASSERT(s <= SP_TM_S_TO_MS_MAX);
+  return s * SP_TM_S_TO_MS;
+}
 
-  sp_env_var_t result = { .key = entry };
-  u32 start = entry.data[0] == '=' ? 1 : 0;
+u64 sp_tm_s_to_us(u64 s) {
+  SP_ASSERT(s <= SP_TM_S_TO_US_MAX);
+  return s * SP_TM_S_TO_US;
+}
 
-  sp_for_range(i, start, entry.len) {
-    if (entry.data[i] == '=') {
-      result.key = sp_str_sub(entry, 0, i);
-      result.value = sp_str_sub(entry, i + 1, entry.len - i - 1);
-      break;
-    }
-  }
+u64 sp_tm_s_to_ns(u64 s) {
+  SP_ASSERT(s <= SP_TM_S_TO_NS_MAX);
+  return s * SP_TM_S_TO_NS;
+}
 
-  return result;
+u64 sp_tm_ms_to_s(u64 ms) {
+  return ms / SP_TM_S_TO_MS;
 }
 
-typedef struct {
-  u16* block;
-  u16* cursor;
-  sp_str_t entry;
-} sp_win32_env_it_t;
+u64 sp_tm_ms_to_us(u64 ms) {
+  SP_ASSERT(ms <= SP_TM_MS_TO_US_MAX);
+  return ms * SP_TM_MS_TO_US;
+}
 
-SP_PRIVATE void sp_win32_env_it_set_current(sp_os_env_it_t* it) {
-  sp_win32_env_it_t* state = (sp_win32_env_it_t*)it->os;
-  state->entry = sp_win32_utf16_to_utf8(state->cursor, sp_win32_utf16_len(state->cursor));
+u64 sp_tm_ms_to_ns(u64 ms) {
+  SP_ASSERT(ms <= SP_TM_MS_TO_NS_MAX);
+  return ms * SP_TM_MS_TO_NS;
+}
 
-  sp_env_var_t var = sp_os_env_parse_var(state->entry);
-  it->key = var.key;
-  it->value = var.value;
+u64 sp_tm_us_to_s(u64 us) {
+  return us / SP_TM_S_TO_US;
 }
 
-sp_os_env_it_t sp_os_env_it_begin() {
-  sp_os_env_it_t it = sp_zero;
-  sp_win32_env_it_t* state = (sp_win32_env_it_t*)sp_mem_os_alloc(sizeof(sp_win32_env_it_t));
-  state->block = sp_win32_get_peb().params.env;
-  state->cursor = state->block;
-  it.os = state;
+u64 sp_tm_us_to_ms(u64 us) {
+  return us / SP_TM_MS_TO_US;
+}
 
-  if (state->block && state->cursor[0] != L'\0') {
-    sp_win32_env_it_set_current(&it);
-  }
-  return it;
+u64 sp_tm_us_to_ns(u64 us) {
+  SP_ASSERT(us <= SP_TM_US_TO_NS_MAX);
+  return us * SP_TM_US_TO_NS;
 }
 
-bool sp_os_env_it_valid(sp_os_env_it_t* it) {
-  sp_win32_env_it_t* state = (sp_win32_env_it_t*)it->os;
-  return state && state->cursor && state->cursor[0] != L'\0';
+u64 sp_tm_ns_to_s(u64 ns) {
+  return ns / SP_TM_S_TO_NS;
 }
 
-void sp_os_env_it_next(sp_os_env_it_t* it) {
-  sp_win32_env_it_t* state = (sp_win32_env_it_t*)it->os;
-  state->cursor += wcslen(sp_ptr_cast(const wchar_t*, state->cursor)) + 1;
-  if (state->cursor[0] != L'\0') {
-    sp_win32_env_it_set_current(it);
-  } else {
-    sp_mem_os_free(state, sizeof(sp_win32_env_it_t));
-    *it = sp_zero_s(sp_os_env_it_t);
-  }
+u64 sp_tm_ns_to_ms(u64 ns) {
+  return ns / SP_TM_MS_TO_NS;
 }
 
-#elif defined(SP_FREESTANDING)
-typedef struct {
-  sp_env_t env;
-  sp_ht_it_t it;
-} sp_linux_env_it_t;
-
-SP_PRIVATE void sp_linux_env_it_set_current(sp_os_env_it_t* it) {
-  sp_linux_env_it_t* state = (sp_linux_env_it_t*)it->os;
-  it->key = *sp_str_ht_it_getkp(state->env.vars, state->it);
-  it->value = *sp_str_ht_it_getp(state->env.vars, state->it);
+u64 sp_tm_ns_to_us(u64 ns) {
+  return ns / SP_TM_US_TO_NS;
 }
 
-sp_str_t sp_os_env_get(sp_str_t key) {
-  for (c8** p = environ; *p; p++) {
-    sp_str_pair_t pair = sp_str_cleave_c8(sp_cstr_as_str(*p), '=');
-    if (sp_str_equal(key, pair.first)) {
-      return pair.second;
-    }
-  }
-  return sp_zero_s(sp_str_t);
+f64 sp_tm_s_to_ms_f(f64 s) {
+  return s * (f64)SP_TM_S_TO_MS;
 }
 
-sp_os_env_it_t sp_os_env_it_begin() {
-  sp_linux_env_it_t* os = (sp_linux_env_it_t*)sp_mem_os_alloc(sizeof(sp_linux_env_it_t));
-  *os = sp_zero_s(sp_linux_env_it_t);
+f64 sp_tm_s_to_us_f(f64 s) {
+  return s * (f64)SP_TM_S_TO_US;
+}
 
-  sp_mem_t mem = sp_mem_os_new();
-  sp_env_init(mem, &os->env);
-  for (c8** p = environ; *p; p++) {
-    sp_str_pair_t pair = sp_str_cleave_c8(sp_str_view(*p), '=');
-    sp_str_ht_insert(os->env.vars, pair.first, pair.second);
-  }
+f64 sp_tm_s_to_ns_f(f64 s) {
+  return s * (f64)SP_TM_S_TO_NS;
+}
 
-  os->it = sp_str_ht_it_init(os->env.vars);
+f64 sp_tm_ms_to_s_f(f64 ms) {
+  return ms / (f64)SP_TM_S_TO_MS;
+}
 
-  if (!sp_str_ht_it_valid(os->env.vars, os->it)) {
-    sp_mem_os_free(os, sizeof(sp_linux_env_it_t));
-    return sp_zero_s(sp_os_env_it_t);
-  }
+f64 sp_tm_ms_to_us_f(f64 ms) {
+  return ms * (f64)SP_TM_MS_TO_US;
+}
 
-  sp_os_env_it_t it = sp_zero;
-  it.os = os;
-  sp_linux_env_it_set_current(&it);
-  return it;
+f64 sp_tm_ms_to_ns_f(f64 ms) {
+  return ms * (f64)SP_TM_MS_TO_NS;
 }
 
-bool sp_os_env_it_valid(sp_os_env_it_t* it) {
-  sp_linux_env_it_t* state = (sp_linux_env_it_t*)it->os;
-  return state && sp_str_ht_it_valid(state->env.vars, state->it);
+f64 sp_tm_us_to_s_f(f64 us) {
+  return us / (f64)SP_TM_S_TO_US;
 }
 
-void sp_os_env_it_next(sp_os_env_it_t* it) {
-  sp_linux_env_it_t* state = (sp_linux_env_it_t*)it->os;
-  sp_str_ht_it_advance(state->env.vars, state->it);
+f64 sp_tm_us_to_ms_f(f64 us) {
+  return us / (f64)SP_TM_MS_TO_US;
+}
 
-  if (sp_str_ht_it_valid(state->env.vars, state->it)) {
-    sp_linux_env_it_set_current(it);
-  } else {
-    it->key = sp_zero_s(sp_str_t);
-    it->value = sp_zero_s(sp_str_t);
-    sp_mem_os_free(state, sizeof(sp_linux_env_it_t));
-    it->os = SP_NULLPTR;
-  }
+f64 sp_tm_us_to_ns_f(f64 us) {
+  return us * (f64)SP_TM_US_TO_NS;
 }
 
-#elif defined(SP_MACOS) || defined(SP_COSMO) || defined(SP_LINUX) || defined(SP_WASM)
-extern c8** environ;
+f64 sp_tm_ns_to_s_f(f64 ns) {
+  return ns / (f64)SP_TM_S_TO_NS;
+}
 
-SP_PRIVATE bool sp_os_env_key_equal(sp_str_t a, sp_str_t b) {
-#if defined(SP_COSMO)
-  if (IsWindows()) {
-    if (a.len != b.len) return false;
-    for (u32 i = 0; i < a.len; i++) {
-      c8 ca = a.data[i];
-      c8 cb = b.data[i];
-      if (ca >= 'A' && ca <= 'Z') ca += 32;
-      if (cb >= 'A' && cb <= 'Z') cb += 32;
-      if (ca != cb) return false;
-    }
-    return true;
-  }
-#endif
-  return sp_str_equal(a, b);
+f64 sp_tm_ns_to_ms_f(f64 ns) {
+  return ns / (f64)SP_TM_MS_TO_NS;
 }
 
-sp_str_t sp_os_env_get(sp_str_t key) {
-  for (c8** envp = environ; envp && *envp; envp++) {
-    sp_str_pair_t pair = sp_str_cleave_c8(sp_str_view(*envp), '=');
-    if (sp_os_env_key_equal(pair.first, key)) {
-      return pair.second;
-    }
-  }
-  return sp_zero_s(sp_str_t);
+f64 sp_tm_ns_to_us_f(f64 ns) {
+  return ns / (f64)SP_TM_US_TO_NS;
 }
 
-SP_PRIVATE void sp_os_env_it_set(sp_os_env_it_t* it) {
-  c8** envp = (c8**)it->os;
-  sp_str_t entry = sp_str_view(*envp);
-  u32 offset = (entry.len > 0 && entry.data[0] == '=') ? 1 : 0;
-  sp_str_t scan = { .data = entry.data + offset, .len = entry.len - offset };
-  sp_str_pair_t pair = sp_str_cleave_c8(scan, '=');
-  it->key = (sp_str_t) { .data = entry.data, .len = pair.first.len + offset };
-  it->value = pair.second;
+u64 sp_tm_fps_to_ns(u64 fps) {
+  f64 s = (1.0) / (f64)(fps);
+  f64 ns = sp_tm_s_to_ns_f(s);
+  return (u64)ns;
 }
 
-sp_os_env_it_t sp_os_env_it_begin() {
-  sp_os_env_it_t it = sp_zero;
-  it.os = environ;
 
-  if (sp_os_env_it_valid(&it)) {
-    sp_os_env_it_set(&it);
-  }
+//  ███████████ █████   █████ ███████████   ██████████   █████████   ██████████   █████ ██████   █████   █████████
+// ░█░░░███░░░█░░███   ░░███ ░░███░░░░░███ ░░███░░░░░█  ███░░░░░███ ░░███░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███
+// ░   ░███  ░  ░███    ░███  ░███    ░███  ░███  █ ░  ░███    ░███  ░███   ░░███ ░███  ░███░███ ░███  ███     ░░░
+//     ░███     ░███████████  ░██████████   ░██████    ░███████████  ░███    ░███ ░███  ░███░░███░███ ░███
+//     ░███     ░███░░░░░███  ░███░░░░░███  ░███░░█    ░███░░░░░███  ░███    ░███ ░███  ░███ ░░██████ ░███    █████
+//     ░███     ░███    ░███  ░███    ░███  ░███ ░   █ ░███    ░███  ░███    ███  ░███  ░███  ░░█████ ░░███  ░░███
+//     █████    █████   █████ █████   █████ ██████████ █████   █████ ██████████   █████ █████  ░░█████ ░░█████████
+//    ░░░░░    ░░░░░   ░░░░░ ░░░░░   ░░░░░ ░░░░░░░░░░ ░░░░░   ░░░░░ ░░░░░░░░░░   ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░
+// @threading @concurrency
+// @spin
+void sp_spin_pause() {
+  #if defined(SP_AMD64)
+    #if defined(SP_MSVC)
+      _mm_pause();
+    #elif defined(SP_TCC)
+      volatile int x = 0; (void)x;
+    #elif defined(SP_GNUC)
+      __asm__ __volatile__("pause");
+    #endif
 
-  return it;
+  #elif defined(SP_ARM64)
+    #if defined(SP_MSVC)
+      __yield();
+    #elif defined(SP_TCC)
+      volatile int x = 0; (void)x;
+    #elif defined(SP_GNUC)
+      __asm__ __volatile__("yield");
+    #endif
+  #endif
 }
 
-bool sp_os_env_it_valid(sp_os_env_it_t* it) {
-  c8** envp = (c8**)it->os;
-  return envp && *envp;
-}
+bool sp_spin_try_lock(sp_spin_lock_t* lock) {
+  #if defined(SP_GNUC)
+    return __sync_lock_test_and_set(lock, 1) == 0;
+  #elif defined(SP_MSVC)
+    return _InterlockedExchange((LONG*)lock, 1) == 0;
+  #else
+    sp_mutex_lock(&sp_rt.mutex);
 
-void sp_os_env_it_next(sp_os_env_it_t* it) {
-  c8** envp = (c8**)it->os;
-  envp++;
+    if (*lock == 0) {
+      *lock = 1;
+      sp_mutex_unlock(&sp_rt.mutex);
+      return true;
+    }
+    else {
+      sp_mutex_unlock(&sp_rt.mutex);
+      return false;
+    }
+  #endif
+}
 
-  if (envp && *envp) {
-    it->os = envp;
-    sp_os_env_it_set(it);
-  } else {
-    it->key = sp_zero_s(sp_str_t);
-    it->value = sp_zero_s(sp_str_t);
-    it->os = SP_NULLPTR;
+void sp_spin_lock(sp_spin_lock_t* lock) {
+  while (!sp_spin_try_lock(lock)) {
+    while (*lock) {
+      sp_spin_pause();
+    }
   }
 }
 
-#else
-#error "sp_os_env_it_begin"
-#error "sp_os_env_it_valid"
-#error "sp_os_env_it_next"
-#endif
+void sp_spin_unlock(sp_spin_lock_t* lock) {
+  #if defined(SP_GNUC)
+    __sync_lock_release(lock);
+  #elif defined(SP_MSVC)
+    _InterlockedExchange((LONG*)lock, 0);
+  #else
+    sp_mutex_lock(&sp_rt.mutex);
+    *lock = 0;
+    sp_mutex_unlock(&sp_rt.mutex);
+  #endif
+}
 
-void sp_sys_env(const c8** env, u32* len) {
-#if defined(SP_WIN32)
-#elif defined(SP_FREESTANDING)
-#elif defined(SP_MACOS) || defined(SP_COSMO) || defined(SP_LINUX) || defined(SP_WASM)
-#else
-  sp_unused(env);
-  sp_unused(len);
-#endif
+// @atomic
+bool sp_atomic_s32_cas(sp_atomic_s32_t* value, s32 current, s32 desired) {
+  #if defined(SP_MSVC)
+    return _InterlockedCompareExchange((long*)value, desired, current) == current;
+  #elif defined(SP_GNUC)
+    return __sync_bool_compare_and_swap(value, current, desired);
+  #else
+    bool result = false;
+    size_t index = ((((size_t)value) >> 3) & 0x1f);
+    sp_spin_lock(&sp_rt.locks[index]);
+    if (*value == current) {
+      *value = desired;
+      result = true;
+    }
+    sp_spin_unlock(&sp_rt.locks[index]);
+    return result;
+  #endif
+}
+
+s32 sp_atomic_s32_set(sp_atomic_s32_t* value, s32 desired) {
+  #if defined(SP_MSVC)
+    return _InterlockedExchange((long*)value, desired);
+  #elif defined(SP_GNUC)
+    return __sync_lock_test_and_set(value, desired);
+  #else
+    s32 old;
+    do {
+      old = *value;
+    } while (!sp_atomic_s32_cas(value, old, desired));
+    return old;
+  #endif
 }
 
-
-void sp_env_init(sp_mem_t mem, sp_env_t* env) {
-  *env = sp_zero_s(sp_env_t);
-  env->mem = mem;
-  env->arena = sp_mem_arena_new_ex(mem, 4096, SP_MEM_ALIGNMENT);
-  sp_str_ht_init(mem, env->vars);
+s32 sp_atomic_s32_add(sp_atomic_s32_t* value, s32 add) {
+  #if defined(SP_MSVC)
+    return _InterlockedExchangeAdd((long*)value, add);
+  #elif defined(SP_GNUC)
+    return __sync_fetch_and_add(value, add);
+  #else
+    s32 old;
+    do {
+      old = *value;
+    } while (!sp_atomic_s32_cas(value, old, old + add));
+    return old;
+  #endif
 }
 
-sp_env_t sp_env_capture(sp_mem_t mem) {
-  sp_env_t env = sp_zero;
-  sp_env_init(mem, &env);
-
-  for (sp_os_env_it_t it = sp_os_env_it_begin(); sp_os_env_it_valid(&it); sp_os_env_it_next(&it)) {
-    sp_env_insert(&env, it.key, it.value);
-  }
-  return env;
+s32 sp_atomic_s32_get(sp_atomic_s32_t* value) {
+  #if defined(SP_MSVC)
+    return _InterlockedOr((long*)value, 0);
+  #elif defined(SP_GNUC)
+    return __sync_or_and_fetch(value, 0);
+  #else
+    s32 old;
+    do {
+      old = *value;
+    } while (!sp_atomic_s32_cas(value, old, old));
+    return old;
+  #endif
 }
 
-sp_env_t sp_env_copy(sp_mem_t mem, sp_env_t* env) {
-  sp_env_t copy = sp_zero;
-  sp_env_init(mem, &copy);
-
-  sp_str_ht_for(env->vars, it) {
-    sp_str_t key = *sp_str_ht_it_getkp(env->vars, it);
-    sp_str_t val = *sp_str_ht_it_getp(env->vars, it);
-    sp_env_insert(&copy, key, val);
-  }
-
-  return copy;
+bool sp_atomic_ptr_cas(sp_atomic_ptr_t* value, void* current, void* desired) {
+  #if defined(SP_MSVC)
+    return _InterlockedCompareExchangePointer(value, desired, current) == current;
+  #elif defined(SP_GNUC)
+    return __sync_bool_compare_and_swap(value, current, desired);
+  #else
+    bool result = false;
+    size_t index = ((((size_t)value) >> 3) & 0x1f);
+    sp_spin_lock(&sp_rt.locks[index]);
+    if (*value == current) {
+      *value = desired;
+      result = true;
+    }
+    sp_spin_unlock(&sp_rt.locks[index]);
+    return result;
+  #endif
 }
 
-u32 sp_env_count(sp_env_t* env) {
-  return (u32)sp_str_ht_size(env->vars);
+void* sp_atomic_ptr_set(sp_atomic_ptr_t* value, void* desired) {
+  #if defined(SP_MSVC)
+    return _InterlockedExchangePointer(value, desired);
+  #elif defined(SP_GNUC)
+    void* old;
+    do {
+      old = *value;
+    } while (!__sync_bool_compare_and_swap(value, old, desired));
+    return old;
+  #else
+    void* old;
+    do {
+      old = *value;
+    } while (!sp_atomic_ptr_cas(value, old, desired));
+    return old;
+  #endif
 }
 
-sp_str_t sp_env_get(sp_env_t* env, sp_str_t name) {
-  sp_str_t* val = sp_str_ht_get(env->vars, name);
-  return val ? *val : sp_zero_s(sp_str_t);
+void* sp_atomic_ptr_get(sp_atomic_ptr_t* value) {
+  #if defined(SP_MSVC)
+    return _InterlockedCompareExchangePointer(value, SP_NULLPTR, SP_NULLPTR);
+  #elif defined(SP_GNUC)
+    return __sync_val_compare_and_swap(value, SP_NULLPTR, SP_NULLPTR);
+  #else
+    void* old;
+    do {
+      old = *value;
+    } while (!sp_atomic_ptr_cas(value, old, old));
+    return old;
+  #endif
 }
 
-sp_str_t sp_env_get_c(sp_env_t* env, const c8* name) {
-  return sp_env_get(env, sp_cstr_as_str(name));
+u32 sp_atomic_u32_load_acquire(sp_atomic_u32_t* value) {
+  #if defined(SP_MSVC)
+    return (u32)_InterlockedOr((long*)value, 0);
+  #elif defined(SP_GNUC)
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+  #else
+    return (u32)sp_atomic_s32_get((sp_atomic_s32_t*)value);
+  #endif
 }
 
-bool sp_env_contains(sp_env_t* env, sp_str_t name) {
-  return sp_str_ht_get(env->vars, name);
+bool sp_atomic_u32_cas(sp_atomic_u32_t* value, u32 current, u32 desired) {
+  return sp_atomic_s32_cas((sp_atomic_s32_t*)value, (s32)current, (s32)desired);
 }
 
-bool sp_env_contains_c(sp_env_t* env, const c8* name) {
-  return sp_env_contains(env, sp_cstr_as_str(name));
+void sp_atomic_u32_store_release(sp_atomic_u32_t* value, u32 desired) {
+  #if defined(SP_MSVC)
+    _InterlockedExchange((long*)value, (long)desired);
+  #elif defined(SP_GNUC)
+    __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+  #else
+    sp_atomic_s32_set((sp_atomic_s32_t*)value, (s32)desired);
+  #endif
 }
 
-void sp_env_insert(sp_env_t* env, sp_str_t name, sp_str_t value) {
-  sp_mem_t arena = sp_mem_arena_as_allocator(env->arena);
-  sp_str_ht_insert(env->vars, sp_str_copy(arena, name), sp_str_copy(arena, value));
+// @semaphore
+#if defined(SP_WIN32)
+void sp_semaphore_init(sp_semaphore_t* semaphore) {
+  *semaphore = CreateSemaphoreW(NULL, 0, 0x7FFFFFF, NULL);
 }
 
-void sp_env_insert_c(sp_env_t* env, const c8* name, const c8* value) {
-  sp_env_insert(env, sp_cstr_as_str(name), sp_cstr_as_str(value));
+void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
+  CloseHandle(*semaphore);
 }
 
-void sp_env_erase(sp_env_t* env, sp_str_t name) {
-  sp_str_ht_erase(env->vars, name);
+void sp_semaphore_wait(sp_semaphore_t* semaphore) {
+  WaitForSingleObject(*semaphore, INFINITE);
 }
 
-void sp_env_erase_c(sp_env_t* env, const c8* name) {
-  sp_env_erase(env, sp_cstr_as_str(name));
+bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
+  sp_win32_dword_t result = WaitForSingleObject(*semaphore, ms);
+  return result == WAIT_OBJECT_0;
 }
 
-void sp_env_destroy(sp_env_t* env) {
-  sp_str_ht_free(env->vars);
-  if (env->arena) sp_mem_arena_destroy(env->arena);
-  *env = sp_zero_s(sp_env_t);
+void sp_semaphore_signal(sp_semaphore_t* semaphore) {
+  ReleaseSemaphore(*semaphore, 1, NULL);
 }
-
-
-
-
-// ████████╗██╗███╗   ███╗███████╗
-// ╚══██╔══╝██║████╗ ████║██╔════╝
-//    ██║   ██║██╔████╔██║█████╗
-//    ██║   ██║██║╚██╔╝██║██╔══╝
-//    ██║   ██║██║ ╚═╝ ██║███████╗
-//    ╚═╝   ╚═╝╚═╝     ╚═╝╚══════╝
-// @time
-sp_tm_point_t sp_tm_now_point() {
-  sp_sys_timespec_t ts;
-  sp_sys_clock_gettime(SP_CLOCK_MONOTONIC, &ts);
-  return (sp_tm_point_t)((u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec);
+#elif defined(SP_MACOS)
+void sp_semaphore_init(sp_semaphore_t* semaphore) {
+    *semaphore = dispatch_semaphore_create(0);
 }
 
-sp_tm_epoch_t sp_tm_now_epoch() {
-  sp_sys_timespec_t ts;
-  sp_sys_clock_gettime(SP_CLOCK_REALTIME, &ts);
-  return SP_RVAL(sp_tm_epoch_t) {
-    .s  = (u64)ts.tv_sec,
-    .ns = (u32)ts.tv_nsec,
-  };
+void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
+  dispatch_release(*semaphore);
 }
 
-u64 sp_tm_point_diff(sp_tm_point_t newer, sp_tm_point_t older) {
-  return newer - older;
+void sp_semaphore_wait(sp_semaphore_t* semaphore) {
+    dispatch_semaphore_wait(*semaphore, DISPATCH_TIME_FOREVER);
 }
 
-sp_tm_timer_t sp_tm_start_timer() {
-  sp_tm_point_t now = sp_tm_now_point();
-  return SP_RVAL(sp_tm_timer_t) {
-    .start = now,
-    .previous = now
-  };
+bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
+    dispatch_time_t timeout = dispatch_time(DISPATCH_TIME_NOW, ms * NSEC_PER_MSEC);
+    return dispatch_semaphore_wait(*semaphore, timeout) == 0;
 }
 
-u64 sp_tm_read_timer(sp_tm_timer_t* timer) {
-  sp_tm_point_t current = sp_tm_now_point();
-  if (current < timer->previous) {
-    timer->previous = current;
-  }
-  return sp_tm_point_diff(current, timer->start);
+void sp_semaphore_signal(sp_semaphore_t* semaphore) {
+    dispatch_semaphore_signal(*semaphore);
 }
-
-u64 sp_tm_lap_timer(sp_tm_timer_t* timer) {
-  sp_tm_point_t current = sp_tm_now_point();
-  if (current < timer->previous) {
-    timer->previous = current;
-  }
-  u64 elapsed = sp_tm_point_diff(current, timer->previous);
-  timer->previous = current;
-  return elapsed;
+#elif defined(SP_POSIX)
+void sp_semaphore_init(sp_semaphore_t* semaphore) {
+  sem_init(semaphore, 0, 0);
 }
 
-void sp_tm_reset_timer(sp_tm_timer_t* timer) {
-  sp_tm_point_t now = sp_tm_now_point();
-  timer->start = now;
-  timer->previous = now;
+void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
+  sem_destroy(semaphore);
 }
 
-sp_tm_date_time_t sp_tm_epoch_to_date_time(sp_tm_epoch_t time) {
-  u64 epoch = time.s;
-  u32 sec = (u32)(epoch % 60); epoch /= 60;
-  u32 min = (u32)(epoch % 60); epoch /= 60;
-  u32 hour = (u32)(epoch % 24); epoch /= 24;
-
-  s64 days = (s64)epoch + 719468;
-  s64 era = (days >= 0 ? days : days - 146096) / 146097;
-  u32 doe = (u32)(days - era * 146097);
-  u32 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
-  s64 y = (s64)yoe + era * 400;
-  u32 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
-  u32 mp = (5 * doy + 2) / 153;
-  u32 d = doy - (153 * mp + 2) / 5 + 1;
-  u32 m = mp < 10 ? mp + 3 : mp - 9;
-  if (m <= 2) y += 1;
-
-  return SP_RVAL(sp_tm_date_time_t) {
-    .year = (s32)y,
-    .month = (s32)m,
-    .day = (s32)d,
-    .hour = (s32)hour,
-    .minute = (s32)min,
-    .second = (s32)sec,
-    .millisecond = (s32)(time.ns / 1000000),
-  };
+void sp_semaphore_wait(sp_semaphore_t* semaphore) {
+  sem_wait(semaphore);
 }
 
-#if defined(SP_FREESTANDING)
-sp_tm_date_time_t sp_tm_get_date_time() {
-  return sp_zero_s(sp_tm_date_time_t);
-}
-#else
-sp_tm_date_time_t sp_tm_get_date_time() {
-  return sp_tm_epoch_to_date_time(sp_tm_now_epoch());
+bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += ms / 1000;
+  ts.tv_nsec += (ms % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+  return sem_timedwait(semaphore, &ts) == 0;
 }
-#endif
-
-u64 sp_tm_s_to_ms(u64 s) {
-  SP_ASSERT(s <= SP_TM_S_TO_MS_MAX);
-  return s * SP_TM_S_TO_MS;
+
+void sp_semaphore_signal(sp_semaphore_t* semaphore) {
+  sem_post(semaphore);
 }
 
-u64 sp_tm_s_to_us(u64 s) {
-  SP_ASSERT(s <= SP_TM_S_TO_US_MAX);
-  return s * SP_TM_S_TO_US;
+#else
+void sp_semaphore_init(sp_semaphore_t* semaphore) {
+  SP_UNIMPLEMENTED();
 }
 
-u64 sp_tm_s_to_ns(u64 s) {
-  SP_ASSERT(s <= SP_TM_S_TO_NS_MAX);
-  return s * SP_TM_S_TO_NS;
+void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
+  SP_UNIMPLEMENTED();
 }
 
-u64 sp_tm_ms_to_s(u64 ms) {
-  return ms / SP_TM_S_TO_MS;
+void sp_semaphore_wait(sp_semaphore_t* semaphore) {
+  SP_UNIMPLEMENTED();
 }
 
-u64 sp_tm_ms_to_us(u64 ms) {
-  SP_ASSERT(ms <= SP_TM_MS_TO_US_MAX);
-  return ms * SP_TM_MS_TO_US;
+bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
+  SP_UNIMPLEMENTED();
+  return true;
 }
 
-u64 sp_tm_ms_to_ns(u64 ms) {
-  SP_ASSERT(ms <= SP_TM_MS_TO_NS_MAX);
-  return ms * SP_TM_MS_TO_NS;
+void sp_semaphore_signal(sp_semaphore_t* semaphore) {
+  SP_UNIMPLEMENTED();
 }
+#endif
 
-u64 sp_tm_us_to_s(u64 us) {
-  return us / SP_TM_S_TO_US;
+// @mutex
+#if defined(SP_WIN32)
+s32 sp_mutex_kind_to_c11(sp_mutex_kind_t kind) {
+  return kind;
 }
 
-u64 sp_tm_us_to_ms(u64 us) {
-  return us / SP_TM_MS_TO_US;
+void sp_mutex_init(sp_mutex_t* mutex, sp_mutex_kind_t kind) {
+  SP_UNUSED(kind);
+  InitializeCriticalSection(mutex);
 }
 
-u64 sp_tm_us_to_ns(u64 us) {
-  SP_ASSERT(us <= SP_TM_US_TO_NS_MAX);
-  return us * SP_TM_US_TO_NS;
+void sp_mutex_lock(sp_mutex_t* mutex) {
+  EnterCriticalSection(mutex);
 }
 
-u64 sp_tm_ns_to_s(u64 ns) {
-  return ns / SP_TM_S_TO_NS;
+void sp_mutex_unlock(sp_mutex_t* mutex) {
+  LeaveCriticalSection(mutex);
 }
 
-u64 sp_tm_ns_to_ms(u64 ns) {
-  return ns / SP_TM_MS_TO_NS;
+void sp_mutex_destroy(sp_mutex_t* mutex) {
+  DeleteCriticalSection(mutex);
 }
 
-u64 sp_tm_ns_to_us(u64 ns) {
-  return ns / SP_TM_US_TO_NS;
+#elif defined(SP_POSIX)
+void sp_mutex_init(sp_mutex_t* mutex, sp_mutex_kind_t kind) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+
+  if (kind & SP_MUTEX_RECURSIVE) {
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  }
+
+  pthread_mutex_init(mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
 }
 
-f64 sp_tm_s_to_ms_f(f64 s) {
-  return s * (f64)SP_TM_S_TO_MS;
+void sp_mutex_lock(sp_mutex_t* mutex) {
+  pthread_mutex_lock(mutex);
 }
 
-f64 sp_tm_s_to_us_f(f64 s) {
-  return s * (f64)SP_TM_S_TO_US;
+void sp_mutex_unlock(sp_mutex_t* mutex) {
+  pthread_mutex_unlock(mutex);
 }
 
-f64 sp_tm_s_to_ns_f(f64 s) {
-  return s * (f64)SP_TM_S_TO_NS;
+void sp_mutex_destroy(sp_mutex_t* mutex) {
+  pthread_mutex_destroy(mutex);
 }
 
-f64 sp_tm_ms_to_s_f(f64 ms) {
-  return ms / (f64)SP_TM_S_TO_MS;
+#else
+void sp_mutex_init(sp_mutex_t* mutex, sp_mutex_kind_t kind) {
+  sp_unused(mutex);
+  sp_unused(kind);
 }
 
-f64 sp_tm_ms_to_us_f(f64 ms) {
-  return ms * (f64)SP_TM_MS_TO_US;
+void sp_mutex_lock(sp_mutex_t* mutex) {
+  sp_unused(mutex);
 }
 
-f64 sp_tm_ms_to_ns_f(f64 ms) {
-  return ms * (f64)SP_TM_MS_TO_NS;
+void sp_mutex_unlock(sp_mutex_t* mutex) {
+  sp_unused(mutex);
 }
 
-f64 sp_tm_us_to_s_f(f64 us) {
-  return us / (f64)SP_TM_S_TO_US;
+void sp_mutex_destroy(sp_mutex_t* mutex) {
+  sp_unused(mutex);
 }
 
-f64 sp_tm_us_to_ms_f(f64 us) {
-  return us / (f64)SP_TM_MS_TO_US;
+#endif
+
+// @cv
+#if defined(SP_WIN32)
+void sp_cv_init(sp_cv_t* cond) {
+  InitializeConditionVariable(cond);
 }
 
-f64 sp_tm_us_to_ns_f(f64 us) {
-  return us * (f64)SP_TM_US_TO_NS;
+void sp_cv_destroy(sp_cv_t* cond) {
+  SP_UNUSED(cond);
 }
 
-f64 sp_tm_ns_to_s_f(f64 ns) {
-  return ns / (f64)SP_TM_S_TO_NS;
+void sp_cv_wait(sp_cv_t* cond, sp_mutex_t* mutex) {
+  SleepConditionVariableCS(cond, mutex, INFINITE);
 }
 
-f64 sp_tm_ns_to_ms_f(f64 ns) {
-  return ns / (f64)SP_TM_MS_TO_NS;
+bool sp_cv_wait_for(sp_cv_t* cond, sp_mutex_t* mutex, u32 ms) {
+  return SleepConditionVariableCS(cond, mutex, (DWORD)ms) != 0;
 }
 
-f64 sp_tm_ns_to_us_f(f64 ns) {
-  return ns / (f64)SP_TM_US_TO_NS;
+void sp_cv_notify_one(sp_cv_t* cond) {
+  WakeConditionVariable(cond);
 }
 
-u64 sp_tm_fps_to_ns(u64 fps) {
-  f64 s = (1.0) / (f64)(fps);
-  f64 ns = sp_tm_s_to_ns_f(s);
-  return (u64)ns;
+void sp_cv_notify_all(sp_cv_t* cond) {
+  WakeAllConditionVariable(cond);
 }
 
+#elif defined(SP_POSIX)
+void sp_cv_init(sp_cv_t* cond) {
+  pthread_cond_init(cond, NULL);
+}
 
-//  ███████████ █████   █████ ███████████   ██████████   █████████   ██████████   █████ ██████   █████   █████████
-// ░█░░░███░░░█░░███   ░░███ ░░███░░░░░███ ░░███░░░░░█  ███░░░░░███ ░░███░░░░███ ░░███ ░░██████ ░░███   ███░░░░░███
-// ░   ░███  ░  ░███    ░███  ░███    ░███  ░███  █ ░  ░███    ░███  ░███   ░░███ ░███  ░███░███ ░███  ███     ░░░
-//     ░███     ░███████████  ░██████████   ░██████    ░███████████  ░███    ░███ ░███  ░███░░███░███ ░███
-//     ░███     ░███░░░░░███  ░███░░░░░███  ░███░░█    ░███░░░░░███  ░███    ░███ ░███  ░███ ░░██████ ░███    █████
-//     ░███     ░███    ░███  ░███    ░███  ░███ ░   █ ░███    ░███  ░███    ███  ░███  ░███  ░░█████ ░░███  ░░███
-//     █████    █████   █████ █████   █████ ██████████ █████   █████ ██████████   █████ █████  ░░█████ ░░█████████
-//    ░░░░░    ░░░░░   ░░░░░ ░░░░░   ░░░░░ ░░░░░░░░░░ ░░░░░   ░░░░░ ░░░░░░░░░░   ░░░░░ ░░░░░    ░░░░░   ░░░░░░░░░
-// @threading @concurrency
-// @spin
-void sp_spin_pause() {
-  #if defined(SP_AMD64)
-    #if defined(SP_MSVC)
-      _mm_pause();
-    #elif defined(SP_TCC)
-      volatile int x = 0; (void)x;
-    #elif defined(SP_GNUC)
-      __asm__ __volatile__("pause");
-    #endif
+void sp_cv_destroy(sp_cv_t* cond) {
+  pthread_cond_destroy(cond);
+}
 
-  #elif defined(SP_ARM64)
-    #if defined(SP_MSVC)
-      __yield();
-    #elif defined(SP_TCC)
-      volatile int x = 0; (void)x;
-    #elif defined(SP_GNUC)
-      __asm__ __volatile__("yield");
-    #endif
-  #endif
+void sp_cv_wait(sp_cv_t* cond, sp_mutex_t* mutex) {
+  pthread_cond_wait(cond, mutex);
 }
 
-bool sp_spin_try_lock(sp_spin_lock_t* lock) {
-  #if defined(SP_GNUC)
-    return __sync_lock_test_and_set(lock, 1) == 0;
-  #elif defined(SP_MSVC)
-    return _InterlockedExchange((LONG*)lock, 1) == 0;
-  #else
-    sp_mutex_lock(&sp_rt.mutex);
+bool sp_cv_wait_for(sp_cv_t* cond, sp_mutex_t* mutex, u32 ms) {
+  sp_tm_epoch_t now = sp_tm_now_epoch();
 
-    if (*lock == 0) {
-      *lock = 1;
-      sp_mutex_unlock(&sp_rt.mutex);
-      return true;
-    }
-    else {
-      sp_mutex_unlock(&sp_rt.mutex);
-      return false;
-    }
-  #endif
-}
+  struct timespec ts = {
+    .tv_sec = (time_t)(now.s + (ms / 1000)),
+    .tv_nsec = now.ns + ((ms % 1000) * 1000000),
+  };
 
-void sp_spin_lock(sp_spin_lock_t* lock) {
-  while (!sp_spin_try_lock(lock)) {
-    while (*lock) {
-      sp_spin_pause();
-    }
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
   }
+
+  return pthread_cond_timedwait(cond, mutex, &ts) == 0;
 }
 
-void sp_spin_unlock(sp_spin_lock_t* lock) {
-  #if defined(SP_GNUC)
-    __sync_lock_release(lock);
-  #elif defined(SP_MSVC)
-    _InterlockedExchange((LONG*)lock, 0);
-  #else
-    sp_mutex_lock(&sp_rt.mutex);
-    *lock = 0;
-    sp_mutex_unlock(&sp_rt.mutex);
-  #endif
+void sp_cv_notify_one(sp_cv_t* cond) {
+  pthread_cond_signal(cond);
 }
 
-// @atomic
-bool sp_atomic_s32_cas(sp_atomic_s32_t* value, s32 current, s32 desired) {
-  #if defined(SP_MSVC)
-    return _InterlockedCompareExchange((long*)value, desired, current) == current;
-  #elif defined(SP_GNUC)
-    return __sync_bool_compare_and_swap(value, current, desired);
-  #else
-    bool result = false;
-    size_t index = ((((size_t)value) >> 3) & 0x1f);
-    sp_spin_lock(&sp_rt.locks[index]);
-    if (*value == current) {
-      *value = desired;
-      result = true;
-    }
-    sp_spin_unlock(&sp_rt.locks[index]);
-    return result;
-  #endif
+void sp_cv_notify_all(sp_cv_t* cond) {
+  pthread_cond_broadcast(cond);
 }
 
-s32 sp_atomic_s32_set(sp_atomic_s32_t* value, s32 desired) {
-  #if defined(SP_MSVC)
-    return _InterlockedExchange((long*)value, desired);
-  #elif defined(SP_GNUC)
-    return __sync_lock_test_and_set(value, desired);
-  #else
-    s32 old;
-    do {
-      old = *value;
-    } while (!sp_atomic_s32_cas(value, old, desired));
-    return old;
-  #endif
+#else
+void sp_cv_init(sp_cv_t* cond) {
+  SP_UNIMPLEMENTED();
 }
 
-s32 sp_atomic_s32_add(sp_atomic_s32_t* value, s32 add) {
-  #if defined(SP_MSVC)
-    return _InterlockedExchangeAdd((long*)value, add);
-  #elif defined(SP_GNUC)
-    return __sync_fetch_and_add(value, add);
-  #else
-    s32 old;
-    do {
-      old = *value;
-    } while (!sp_atomic_s32_cas(value, old, old + add));
-    return old;
-  #endif
+void sp_cv_destroy(sp_cv_t* cond) {
+  SP_UNIMPLEMENTED();
 }
 
-s32 sp_atomic_s32_get(sp_atomic_s32_t* value) {
-  #if defined(SP_MSVC)
-    return _InterlockedOr((long*)value, 0);
-  #elif defined(SP_GNUC)
-    return __sync_or_and_fetch(value, 0);
-  #else
-    s32 old;
-    do {
-      old = *value;
-    } while (!sp_atomic_s32_cas(value, old, old));
-    return old;
-  #endif
+void sp_cv_wait(sp_cv_t* cond, sp_mutex_t* mutex) {
+  SP_UNIMPLEMENTED();
 }
 
-bool sp_atomic_ptr_cas(sp_atomic_ptr_t* value, void* current, void* desired) {
-  #if defined(SP_MSVC)
-    return _InterlockedCompareExchangePointer(value, desired, current) == current;
-  #elif defined(SP_GNUC)
-    return __sync_bool_compare_and_swap(value, current, desired);
-  #else
-    bool result = false;
-    size_t index = ((((size_t)value) >> 3) & 0x1f);
-    sp_spin_lock(&sp_rt.locks[index]);
-    if (*value == current) {
-      *value = desired;
-      result = true;
-    }
-    sp_spin_unlock(&sp_rt.locks[index]);
-    return result;
-  #endif
+bool sp_cv_wait_for(sp_cv_t* cond, sp_mutex_t* mutex, u32 ms) {
+  SP_UNIMPLEMENTED();
+  return true;
 }
 
-void* sp_atomic_ptr_set(sp_atomic_ptr_t* value, void* desired) {
-  #if defined(SP_MSVC)
-    return _InterlockedExchangePointer(value, desired);
-  #elif defined(SP_GNUC)
-    void* old;
-    do {
-      old = *value;
-    } while (!__sync_bool_compare_and_swap(value, old, desired));
-    return old;
-  #else
-    void* old;
-    do {
-      old = *value;
-    } while (!sp_atomic_ptr_cas(value, old, desired));
-    return old;
-  #endif
+void sp_cv_notify_one(sp_cv_t* cond) {
+  SP_UNIMPLEMENTED();
 }
 
-void* sp_atomic_ptr_get(sp_atomic_ptr_t* value) {
-  #if defined(SP_MSVC)
-    return _InterlockedCompareExchangePointer(value, SP_NULLPTR, SP_NULLPTR);
-  #elif defined(SP_GNUC)
-    return __sync_val_compare_and_swap(value, SP_NULLPTR, SP_NULLPTR);
-  #else
-    void* old;
-    do {
-      old = *value;
-    } while (!sp_atomic_ptr_cas(value, old, old));
-    return old;
-  #endif
+void sp_cv_notify_all(sp_cv_t* cond) {
+  SP_UNIMPLEMENTED();
 }
 
-// @semaphore
+#endif
+
+// @thread
 #if defined(SP_WIN32)
-void sp_semaphore_init(sp_semaphore_t* semaphore) {
-  *semaphore = CreateSemaphoreW(NULL, 0, 0x7FFFFFF, NULL);
+DWORD WINAPI sp_win32_thread_launch(LPVOID args) {
+  s32 result = sp_thread_launch(args);
+  return (DWORD)result;
 }
 
-void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
-  CloseHandle(*semaphore);
+void sp_thread_init(sp_thread_t* thread, sp_thread_fn_t fn, void* userdata) {
+  sp_thread_launch_t* launch = (sp_thread_launch_t*)sp_mem_os_alloc(sizeof(sp_thread_launch_t));
+  *launch = SP_RVAL(sp_thread_launch_t) {
+    .fn = fn,
+    .userdata = userdata,
+    .semaphore = sp_zero_s(sp_semaphore_t)
+  };
+  sp_semaphore_init(&launch->semaphore);
+
+  *thread = CreateThread(SP_NULLPTR, 0, sp_win32_thread_launch, launch, 0, SP_NULLPTR);
+  if (!*thread) {
+    sp_semaphore_destroy(&launch->semaphore);
+    sp_mem_os_free(launch, sizeof(sp_thread_launch_t));
+    return;
+  }
+
+  sp_semaphore_wait(&launch->semaphore);
+  sp_semaphore_destroy(&launch->semaphore);
+  sp_mem_os_free(launch, sizeof(sp_thread_launch_t));
 }
 
-void sp_semaphore_wait(sp_semaphore_t* semaphore) {
-  WaitForSingleObject(*semaphore, INFINITE);
+s32 sp_thread_launch(void* args) {
+  sp_thread_launch_t* launch = (sp_thread_launch_t*)args;
+  void* userdata = launch->userdata;
+  sp_thread_fn_t fn = launch->fn;
+  sp_semaphore_signal(&launch->semaphore);
+  return fn(userdata);
 }
 
-bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
-  sp_win32_dword_t result = WaitForSingleObject(*semaphore, ms);
-  return result == WAIT_OBJECT_0;
+void sp_thread_join(sp_thread_t* thread) {
+  if (!*thread) return;
+  WaitForSingleObject(*thread, INFINITE);
+  CloseHandle(*thread);
+  *thread = SP_NULLPTR;
 }
 
-void sp_semaphore_signal(sp_semaphore_t* semaphore) {
-  ReleaseSemaphore(*semaphore, 1, NULL);
+#elif defined(SP_POSIX)
+void* sp_posix_thread_launch(void* args) {
+  return (void*)(intptr_t)sp_thread_launch(args);
 }
-#elif defined(SP_MACOS)
-void sp_semaphore_init(sp_semaphore_t* semaphore) {
-    *semaphore = dispatch_semaphore_create(0);
+
+s32 sp_thread_launch(void* args) {
+  sp_thread_launch_t* launch = (sp_thread_launch_t*)args;
+  void* userdata = launch->userdata;
+  sp_thread_fn_t fn = launch->fn;
+
+  sp_semaphore_signal(&launch->semaphore);
+  s32 result = fn(userdata);
+
+  return result;
 }
 
-void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
-  dispatch_release(*semaphore);
+void sp_thread_join(sp_thread_t* thread) {
+  pthread_join(*thread, NULL);
 }
 
-void sp_semaphore_wait(sp_semaphore_t* semaphore) {
-    dispatch_semaphore_wait(*semaphore, DISPATCH_TIME_FOREVER);
+void sp_thread_init(sp_thread_t* thread, sp_thread_fn_t fn, void* userdata) {
+  sp_thread_launch_t launch = sp_zero;
+  launch.fn = fn;
+  launch.userdata = userdata;
+  sp_semaphore_init(&launch.semaphore);
+
+  pthread_create(thread, NULL, sp_posix_thread_launch, &launch);
+  sp_semaphore_wait(&launch.semaphore);
+  sp_semaphore_destroy(&launch.semaphore);
 }
 
-bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
-    dispatch_time_t timeout = dispatch_time(DISPATCH_TIME_NOW, ms * NSEC_PER_MSEC);
-    return dispatch_semaphore_wait(*semaphore, timeout) == 0;
+#elif defined(SP_WASM) || defined(SP_FREESTANDING)
+s32 sp_thread_launch(void* args) {
+  sp_thread_launch_t* launch = (sp_thread_launch_t*)args;
+  void* userdata = launch->userdata;
+  sp_thread_fn_t fn = launch->fn;
+
+  sp_semaphore_signal(&launch->semaphore);
+  s32 result = fn(userdata);
+
+  return result;
 }
 
-void sp_semaphore_signal(sp_semaphore_t* semaphore) {
-    dispatch_semaphore_signal(*semaphore);
+void sp_thread_join(sp_thread_t* thread) {
+  SP_UNIMPLEMENTED();
 }
-#elif defined(SP_POSIX)
-void sp_semaphore_init(sp_semaphore_t* semaphore) {
-  sem_init(semaphore, 0, 0);
+
+void sp_thread_init(sp_thread_t* thread, sp_thread_fn_t fn, void* userdata) {
+  SP_UNIMPLEMENTED();
 }
 
-void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
-  sem_destroy(semaphore);
+#else
+#error "sp_thread_launch"
+#error "sp_thread_join"
+#error "sp_thread_init"
+#endif
+
+// @cht
+// The home slot inside a shard comes from the top bits of hash * phi, and the Swiss tag from
+// the low seven bits, so pick the shard from a differently mixed copy of the hash; otherwise
+// every key in a shard would share its top bits and crowd one corner of that shard's table.
+u64 sp_cht_shard_index(sp_hash_t hash) {
+  SP_ASSERT(!(SP_CHT_NUM_SHARDS & (SP_CHT_NUM_SHARDS - 1)));
+  u32 bits = sp_ht_ctz(SP_CHT_NUM_SHARDS);
+  if (!bits) return 0;
+
+  u64 mixed = (hash ^ (hash >> 32)) * 0xFF51AFD7ED558CCDull;
+  return mixed >> (64 - bits);
 }
 
-void sp_semaphore_wait(sp_semaphore_t* semaphore) {
-  sem_wait(semaphore);
+sp_cht_shard_t* sp_cht_shard(sp_cht_shard_t* shards, sp_hash_t hash) {
+  return &shards[sp_cht_shard_index(hash)];
 }
 
-bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
-  struct timespec ts;
-  clock_gettime(CLOCK_REALTIME, &ts);
-  ts.tv_sec += ms / 1000;
-  ts.tv_nsec += (ms % 1000) * 1000000;
-  if (ts.tv_nsec >= 1000000000) {
-    ts.tv_sec++;
-    ts.tv_nsec -= 1000000000;
+bool sp_cht_get_impl(sp_cht_shard_t* shards, void* key, void* value, sp_ht_info_t info) {
+  sp_hash_t hash = info.fn.hash(key, info.size.key);
+  sp_cht_shard_t* shard = sp_cht_shard(shards, hash);
+
+  sp_mutex_lock(&shard->mutex);
+  u64 idx = sp_ht_find_hashed(shard->ht, key, hash, info);
+  bool found = idx != SP_HT_INVALID_INDEX;
+  if (found && value) {
+    u8* entry = *(u8**)shard->ht + idx * info.stride.entry;
+    sp_mem_copy(value, entry + info.stride.value, info.size.value);
   }
-  return sem_timedwait(semaphore, &ts) == 0;
+  sp_mutex_unlock(&shard->mutex);
+
+  return found;
 }
 
-void sp_semaphore_signal(sp_semaphore_t* semaphore) {
-  sem_post(semaphore);
+void sp_cht_insert_impl(sp_cht_shard_t* shards, void* key, void* value, sp_ht_info_t info) {
+  sp_hash_t hash = info.fn.hash(key, info.size.key);
+  sp_cht_shard_t* shard = sp_cht_shard(shards, hash);
+
+  sp_mutex_lock(&shard->mutex);
+  sp_ht_insert_hashed(shard->ht, key, value, hash, info);
+  sp_mutex_unlock(&shard->mutex);
 }
 
-#else
-void sp_semaphore_init(sp_semaphore_t* semaphore) {
-  SP_UNIMPLEMENTED();
+bool sp_cht_erase_impl(sp_cht_shard_t* shards, void* key, sp_ht_info_t info) {
+  sp_hash_t hash = info.fn.hash(key, info.size.key);
+  sp_cht_shard_t* shard = sp_cht_shard(shards, hash);
+
+  sp_mutex_lock(&shard->mutex);
+  u64 idx = sp_ht_find_hashed(shard->ht, key, hash, info);
+  if (idx != SP_HT_INVALID_INDEX) {
+    sp_ht_erase_impl(shard->ht, idx, info);
+  }
+  sp_mutex_unlock(&shard->mutex);
+
+  return idx != SP_HT_INVALID_INDEX;
 }
 
-void sp_semaphore_destroy(sp_semaphore_t* semaphore) {
-  SP_UNIMPLEMENTED();
+bool sp_cht_compute_if_absent_impl(sp_cht_shard_t* shards, void* key, sp_cht_compute_fn_t fn, void* user_data, void* value, sp_ht_info_t info) {
+  SP_ASSERT(value);
+  sp_hash_t hash = info.fn.hash(key, info.size.key);
+  sp_cht_shard_t* shard = sp_cht_shard(shards, hash);
+
+  sp_mutex_lock(&shard->mutex);
+  u64 idx = sp_ht_find_hashed(shard->ht, key, hash, info);
+  bool computed = idx == SP_HT_INVALID_INDEX;
+  if (computed) {
+    fn(key, value, user_data);
+    sp_ht_insert_hashed(shard->ht, key, value, hash, info);
+  }
+  else {
+    u8* entry = *(u8**)shard->ht + idx * info.stride.entry;
+    sp_mem_copy(value, entry + info.stride.value, info.size.value);
+  }
+  sp_mutex_unlock(&shard->mutex);
+
+  return computed;
 }
 
-void sp_semaphore_wait(sp_semaphore_t* semaphore) {
-  SP_UNIMPLEMENTED();
+u64 sp_cht_size_impl(sp_cht_shard_t* shards, sp_ht_info_t info) {
+  u64 size = 0;
+  sp_for(i, SP_CHT_NUM_SHARDS) {
+    sp_cht_shard_t* shard = &shards[i];
+    sp_mutex_lock(&shard->mutex);
+    size += *(u64*)((u8*)shard->ht + info.header.size);
+    sp_mutex_unlock(&shard->mutex);
+  }
+  return size;
 }
 
-bool sp_semaphore_wait_for(sp_semaphore_t* semaphore, u32 ms) {
-  SP_UNIMPLEMENTED();
-  return true;
+// @intern
+void sp_intern_init(sp_intern_t* intern, sp_mem_t mem) {
+  intern->mem = mem;
+  intern->arena = sp_mem_arena_new(mem);
+  intern->ids = SP_NULLPTR;
+  sp_str_ht_init(mem, intern->ids);
+  intern->strings = SP_NULLPTR;
+  sp_da_init(mem, intern->strings);
 }
 
-void sp_semaphore_signal(sp_semaphore_t* semaphore) {
-  SP_UNIMPLEMENTED();
+void sp_intern_free(sp_intern_t* intern) {
+  if (!intern->arena) return;
+  sp_str_ht_free(intern->ids);
+  sp_da_free(intern->strings);
+  sp_mem_arena_destroy(intern->arena);
+  *intern = sp_zero_s(sp_intern_t);
 }
-#endif
 
-// @mutex
-#if defined(SP_WIN32)
-s32 sp_mutex_kind_to_c11(sp_mutex_kind_t kind) {
-  return kind;
+u32 sp_intern(sp_intern_t* intern, sp_str_t str) {
+  sp_hash_t hash = intern->ids->info.fn.hash(&str, sizeof(sp_str_t));
+  u64 idx = sp_ht_find_hashed(intern->ids, &str, hash, intern->ids->info);
+  if (idx != SP_HT_INVALID_INDEX) return intern->ids->data[idx].val;
+
+  u32 id = (u32)sp_da_size(intern->strings);
+  sp_str_t copy = sp_str_copy(sp_mem_arena_as_allocator(intern->arena), str);
+  sp_ht_insert_hashed(intern->ids, &copy, &id, hash, intern->ids->info);
+  sp_da_push(intern->strings, copy);
+  return id;
 }
 
-void sp_mutex_init(sp_mutex_t* mutex, sp_mutex_kind_t kind) {
-  SP_UNUSED(kind);
-  InitializeCriticalSection(mutex);
+u32 sp_intern_cstr(sp_intern_t* intern, const c8* str) {
+  return sp_intern(intern, sp_str_view(str));
 }
 
-void sp_mutex_lock(sp_mutex_t* mutex) {
-  EnterCriticalSection(mutex);
+u32 sp_intern_find(sp_intern_t* intern, sp_str_t str) {
+  u32* id = sp_str_ht_get(intern->ids, str);
+  return id ? *id : SP_INTERN_INVALID;
 }
 
-void sp_mutex_unlock(sp_mutex_t* mutex) {
-  LeaveCriticalSection(mutex);
+sp_str_t sp_intern_get(sp_intern_t* intern, u32 id) {
+  if (id >= sp_da_size(intern->strings)) return sp_zero_s(sp_str_t);
+  return intern->strings[id];
 }
 
-void sp_mutex_destroy(sp_mutex_t* mutex) {
-  DeleteCriticalSection(mutex);
+u32 sp_intern_size(sp_intern_t* intern) {
+  return (u32)sp_da_size(intern->strings);
 }
 
-#elif defined(SP_POSIX)
-void sp_mutex_init(sp_mutex_t* mutex, sp_mutex_kind_t kind) {
-  pthread_mutexattr_t attr;
-  pthread_mutexattr_init(&attr);
+void sp_intern_sync_init(sp_intern_sync_t* intern, sp_mem_t mem) {
+  sp_mem_zero(intern, sizeof(sp_intern_sync_t));
+  intern->mem = mem;
+  sp_for(i, SP_CHT_NUM_SHARDS) {
+    sp_intern_shard_t* shard = &intern->shards[i];
+    sp_mutex_init(&shard->mutex, SP_MUTEX_PLAIN);
+    shard->arena = sp_mem_arena_new(mem);
+    sp_str_ht_init(mem, shard->ids);
+  }
+}
 
-  if (kind & SP_MUTEX_RECURSIVE) {
-    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+void sp_intern_sync_free(sp_intern_sync_t* intern) {
+  sp_for(i, SP_CHT_NUM_SHARDS) {
+    sp_intern_shard_t* shard = &intern->shards[i];
+    if (!shard->arena) continue;
+    sp_str_ht_free(shard->ids);
+    sp_mem_arena_destroy(shard->arena);
+    sp_mutex_destroy(&shard->mutex);
+  }
+  sp_for(i, SP_INTERN_MAX_PAGES) {
+    void* page = sp_atomic_ptr_get(&intern->pages[i]);
+    if (page) sp_free(intern->mem, page, SP_INTERN_PAGE_SIZE * sizeof(sp_str_t));
   }
+  sp_mem_zero(intern, sizeof(sp_intern_sync_t));
+}
 
-  pthread_mutex_init(mutex, &attr);
-  pthread_mutexattr_destroy(&attr);
+u32 sp_intern_sync(sp_intern_sync_t* intern, sp_str_t str) {
+  sp_hash_t hash = intern->shards[0].ids->info.fn.hash(&str, sizeof(sp_str_t));
+  sp_intern_shard_t* shard = &intern->shards[sp_cht_shard_index(hash)];
+
+  sp_mutex_lock(&shard->mutex);
+  u64 idx = sp_ht_find_hashed(shard->ids, &str, hash, shard->ids->info);
+  if (idx != SP_HT_INVALID_INDEX) {
+    u32 id = shard->ids->data[idx].val;
+    sp_mutex_unlock(&shard->mutex);
+    return id;
+  }
+
+  u32 id = (u32)sp_atomic_s32_add(&intern->size, 1);
+  u32 page_index = id / SP_INTERN_PAGE_SIZE;
+  if (page_index >= SP_INTERN_MAX_PAGES) {
+    sp_atomic_s32_add(&intern->size, -1);
+    sp_mutex_unlock(&shard->mutex);
+    return SP_INTERN_INVALID;
+  }
+
+  // Whichever thread first needs a page allocates it; a thread that loses the race frees its
+  // copy and uses the winner's
+  sp_str_t* page = (sp_str_t*)sp_atomic_ptr_get(&intern->pages[page_index]);
+  if (!page) {
+    u64 page_size = SP_INTERN_PAGE_SIZE * sizeof(sp_str_t);
+    sp_str_t* fresh = (sp_str_t*)sp_alloc(intern->mem, page_size);
+    if (sp_atomic_ptr_cas(&intern->pages[page_index], SP_NULLPTR, fresh)) {
+      page = fresh;
+    }
+    else {
+      sp_free(intern->mem, fresh, page_size);
+      page = (sp_str_t*)sp_atomic_ptr_get(&intern->pages[page_index]);
+    }
+  }
+
+  sp_str_t copy = sp_str_copy(sp_mem_arena_as_allocator(shard->arena), str);
+  page[id % SP_INTERN_PAGE_SIZE] = copy;
+  sp_ht_insert_hashed(shard->ids, &copy, &id, hash, shard->ids->info);
+  sp_mutex_unlock(&shard->mutex);
+  return id;
 }
 
-void sp_mutex_lock(sp_mutex_t* mutex) {
-  pthread_mutex_lock(mutex);
+u32 sp_intern_sync_find(sp_intern_sync_t* intern, sp_str_t str) {
+  sp_hash_t hash = intern->shards[0].ids->info.fn.hash(&str, sizeof(sp_str_t));
+  sp_intern_shard_t* shard = &intern->shards[sp_cht_shard_index(hash)];
+
+  sp_mutex_lock(&shard->mutex);
+  u64 idx = sp_ht_find_hashed(shard->ids, &str, hash, shard->ids->info);
+  u32 id = idx != SP_HT_INVALID_INDEX ? shard->ids->data[idx].val : SP_INTERN_INVALID;
+  sp_mutex_unlock(&shard->mutex);
+  return id;
 }
 
-void sp_mutex_unlock(sp_mutex_t* mutex) {
-  pthread_mutex_unlock(mutex);
+// A symbol is only handed out after its slot is written, under a lock, so any thread that
+// was given a symbol (through that lock or any other synchronization) can read its slot.
+sp_str_t sp_intern_sync_get(sp_intern_sync_t* intern, u32 id) {
+  if (id >= (u32)sp_atomic_s32_get(&intern->size)) return sp_zero_s(sp_str_t);
+  sp_str_t* page = (sp_str_t*)sp_atomic_ptr_get(&intern->pages[id / SP_INTERN_PAGE_SIZE]);
+  return page ? page[id % SP_INTERN_PAGE_SIZE] : sp_zero_s(sp_str_t);
 }
 
-void sp_mutex_destroy(sp_mutex_t* mutex) {
-  pthread_mutex_destroy(mutex);
+u32 sp_intern_sync_size(sp_intern_sync_t* intern) {
+  return (u32)sp_atomic_s32_get(&intern->size);
 }
 
-#else
-void sp_mutex_init(sp_mutex_t* mutex, sp_mutex_kind_t kind) {
-  sp_unused(mutex);
-  sp_unused(kind);
+// @spsc
+void sp_spsc_init(sp_mem_t mem, sp_spsc_t* queue, u32 stride, u32 capacity) {
+  u32 size = 1;
+  while (size < capacity) size *= 2;
+
+  *queue = sp_zero_s(sp_spsc_t);
+  queue->mem = mem;
+  queue->stride = stride;
+  queue->mask = size - 1;
+  queue->data = (u8*)sp_alloc(mem, (u64)size * stride);
 }
 
-void sp_mutex_lock(sp_mutex_t* mutex) {
-  sp_unused(mutex);
+void sp_spsc_free(sp_spsc_t* queue) {
+  if (queue->data) {
+    sp_free(queue->mem, queue->data, (u64)(queue->mask + 1) * queue->stride);
+  }
+  *queue = sp_zero_s(sp_spsc_t);
 }
 
-void sp_mutex_unlock(sp_mutex_t* mutex) {
-  sp_unused(mutex);
+u32 sp_spsc_capacity(sp_spsc_t* queue) {
+  return queue->mask + 1;
 }
 
-void sp_mutex_destroy(sp_mutex_t* mutex) {
-  sp_unused(mutex);
+u32 sp_spsc_size(sp_spsc_t* queue) {
+  return sp_atomic_u32_load_acquire(&queue->tail) - sp_atomic_u32_load_acquire(&queue->head);
 }
 
-#endif
+void* sp_spsc_write_span(sp_spsc_t* queue, u32* n) {
+  u32 tail = queue->tail;
+  u32 capacity = queue->mask + 1;
+  if (tail - queue->head_cache == capacity) {
+    queue->head_cache = sp_atomic_u32_load_acquire(&queue->head);
+  }
 
-// @cv
-#if defined(SP_WIN32)
-void sp_cv_init(sp_cv_t* cond) {
-  InitializeConditionVariable(cond);
+  u32 index = tail & queue->mask;
+  *n = sp_min(capacity - (tail - queue->head_cache), capacity - index);
+  return queue->data + (u64)index * queue->stride;
 }
 
-void sp_cv_destroy(sp_cv_t* cond) {
-  SP_UNUSED(cond);
+void sp_spsc_write_commit(sp_spsc_t* queue, u32 n) {
+  sp_atomic_u32_store_release(&queue->tail, queue->tail + n);
 }
 
-void sp_cv_wait(sp_cv_t* cond, sp_mutex_t* mutex) {
-  SleepConditionVariableCS(cond, mutex, INFINITE);
-}
+const void* sp_spsc_read_span(sp_spsc_t* queue, u32* n) {
+  u32 head = queue->head;
+  if (queue->tail_cache == head) {
+    queue->tail_cache = sp_atomic_u32_load_acquire(&queue->tail);
+  }
 
-bool sp_cv_wait_for(sp_cv_t* cond, sp_mutex_t* mutex, u32 ms) {
-  return SleepConditionVariableCS(cond, mutex, (DWORD)ms) != 0;
+  u32 index = head & queue->mask;
+  *n = sp_min(queue->tail_cache - head, queue->mask + 1 - index);
+  return queue->data + (u64)index * queue->stride;
 }
 
-void sp_cv_notify_one(sp_cv_t* cond) {
-  WakeConditionVariable(cond);
+void sp_spsc_read_commit(sp_spsc_t* queue, u32 n) {
+  sp_atomic_u32_store_release(&queue->head, queue->head + n);
 }
 
-void sp_cv_notify_all(sp_cv_t* cond) {
-  WakeAllConditionVariable(cond);
+bool sp_spsc_push(sp_spsc_t* queue, const void* item) {
+  return sp_spsc_push_n(queue, item, 1) == 1;
 }
 
-#elif defined(SP_POSIX)
-void sp_cv_init(sp_cv_t* cond) {
-  pthread_cond_init(cond, NULL);
+bool sp_spsc_pop(sp_spsc_t* queue, void* item) {
+  return sp_spsc_pop_n(queue, item, 1) == 1;
 }
 
-void sp_cv_destroy(sp_cv_t* cond) {
-  pthread_cond_destroy(cond);
+u32 sp_spsc_push_n(sp_spsc_t* queue, const void* items, u32 n) {
+  const u8* src = (const u8*)items;
+  u32 pushed = 0;
+
+  // At most two spans: up to the end of the ring, then from its start
+  sp_for(i, 2) {
+    u32 available = 0;
+    void* span = sp_spsc_write_span(queue, &available);
+    u32 count = sp_min(available, n - pushed);
+    if (!count) break;
+    sp_mem_copy(span, src + (u64)pushed * queue->stride, (u64)count * queue->stride);
+    pushed += count;
+    sp_spsc_write_commit(queue, count);
+  }
+
+  return pushed;
 }
 
-void sp_cv_wait(sp_cv_t* cond, sp_mutex_t* mutex) {
-  pthread_cond_wait(cond, mutex);
+u32 sp_spsc_pop_n(sp_spsc_t* queue, void* items, u32 n) {
+  u8* dst = (u8*)items;
+  u32 popped = 0;
+
+  sp_for(i, 2) {
+    u32 available = 0;
+    const void* span = sp_spsc_read_span(queue, &available);
+    u32 count = sp_min(available, n - popped);
+    if (!count) break;
+    sp_mem_copy(dst + (u64)popped * queue->stride, span, (u64)count * queue->stride);
+    popped += count;
+    sp_spsc_read_commit(queue, count);
+  }
+
+  return popped;
 }
 
-bool sp_cv_wait_for(sp_cv_t* cond, sp_mutex_t* mutex, u32 ms) {
-  sp_tm_epoch_t now = sp_tm_now_epoch();
+// @mpmc
+#define SP_MPMC_SPIN_COUNT 64
+#define SP_MPMC_YIELD_COUNT 16
+#define SP_MPMC_FOREVER SP_LIMIT_U32_MAX
 
-  struct timespec ts = {
-    .tv_sec = (time_t)(now.s + (ms / 1000)),
-    .tv_nsec = now.ns + ((ms % 1000) * 1000000),
-  };
+void sp_mpmc_init(sp_mem_t mem, sp_mpmc_t* queue, u32 stride, u32 capacity, sp_mpmc_wait_t wait) {
+  u32 size = 2;
+  while (size < capacity) size *= 2;
 
-  if (ts.tv_nsec >= 1000000000) {
-    ts.tv_sec++;
-    ts.tv_nsec -= 1000000000;
+  *queue = sp_zero_s(sp_mpmc_t);
+  queue->mem = mem;
+  queue->stride = stride;
+  queue->cell_stride = (u32)sp_align_up(sizeof(sp_atomic_u32_t) + stride, sizeof(u64));
+  queue->mask = size - 1;
+  queue->wait = wait;
+  queue->cells = (u8*)sp_alloc(mem, (u64)size * queue->cell_stride);
+
+  // A slot is writable on lap n when its sequence equals its position, and readable once the
+  // producer has bumped it to position + 1
+  sp_for(it, size) {
+    *sp_mpmc_cell(queue, it) = it;
   }
 
-  return pthread_cond_timedwait(cond, mutex, &ts) == 0;
+  if (wait == SP_MPMC_WAIT_SEMAPHORE) {
+    sp_semaphore_init(&queue->not_full);
+    sp_semaphore_init(&queue->not_empty);
+  }
 }
 
-void sp_cv_notify_one(sp_cv_t* cond) {
-  pthread_cond_signal(cond);
+void sp_mpmc_free(sp_mpmc_t* queue) {
+  if (queue->cells) {
+    sp_free(queue->mem, queue->cells, (u64)(queue->mask + 1) * queue->cell_stride);
+  }
+  if (queue->wait == SP_MPMC_WAIT_SEMAPHORE) {
+    sp_semaphore_destroy(&queue->not_full);
+    sp_semaphore_destroy(&queue->not_empty);
+  }
+  *queue = sp_zero_s(sp_mpmc_t);
 }
 
-void sp_cv_notify_all(sp_cv_t* cond) {
-  pthread_cond_broadcast(cond);
+u32 sp_mpmc_capacity(sp_mpmc_t* queue) {
+  return queue->mask + 1;
 }
 
-#else
-void sp_cv_init(sp_cv_t* cond) {
-  SP_UNIMPLEMENTED();
+u32 sp_mpmc_size(sp_mpmc_t* queue) {
+  // Only a snapshot; the head is read first so that the difference can't go negative
+  u32 head = sp_atomic_u32_load_acquire(&queue->head);
+  u32 tail = sp_atomic_u32_load_acquire(&queue->tail);
+  return sp_min(tail - head, queue->mask + 1);
 }
 
-void sp_cv_destroy(sp_cv_t* cond) {
-  SP_UNIMPLEMENTED();
+sp_atomic_u32_t* sp_mpmc_cell(sp_mpmc_t* queue, u32 pos) {
+  return (sp_atomic_u32_t*)(queue->cells + (u64)(pos & queue->mask) * queue->cell_stride);
 }
 
-void sp_cv_wait(sp_cv_t* cond, sp_mutex_t* mutex) {
-  SP_UNIMPLEMENTED();
+bool sp_mpmc_try_push(sp_mpmc_t* queue, const void* item) {
+  u32 pos = sp_atomic_u32_load_acquire(&queue->tail);
+  sp_atomic_u32_t* cell = SP_NULLPTR;
+
+  while (true) {
+    cell = sp_mpmc_cell(queue, pos);
+    s32 diff = (s32)(sp_atomic_u32_load_acquire(cell) - pos);
+    if (!diff) {
+      if (sp_atomic_u32_cas(&queue->tail, pos, pos + 1)) break;
+    }
+    else if (diff < 0) {
+      // The slot still holds the item from the previous lap
+      return false;
+    }
+    pos = sp_atomic_u32_load_acquire(&queue->tail);
+  }
+
+  sp_mem_copy(cell + 1, item, queue->stride);
+  sp_atomic_u32_store_release(cell, pos + 1);
+
+  if (queue->wait == SP_MPMC_WAIT_SEMAPHORE) {
+    sp_mpmc_wake(queue, &queue->pop_waiters, &queue->not_empty);
+  }
+  return true;
 }
 
-bool sp_cv_wait_for(sp_cv_t* cond, sp_mutex_t* mutex, u32 ms) {
-  SP_UNIMPLEMENTED();
+bool sp_mpmc_try_pop(sp_mpmc_t* queue, void* item) {
+  u32 pos = sp_atomic_u32_load_acquire(&queue->head);
+  sp_atomic_u32_t* cell = SP_NULLPTR;
+
+  while (true) {
+    cell = sp_mpmc_cell(queue, pos);
+    s32 diff = (s32)(sp_atomic_u32_load_acquire(cell) - (pos + 1));
+    if (!diff) {
+      if (sp_atomic_u32_cas(&queue->head, pos, pos + 1)) break;
+    }
+    else if (diff < 0) {
+      // Nothing has been written to the slot on this lap
+      return false;
+    }
+    pos = sp_atomic_u32_load_acquire(&queue->head);
+  }
+
+  sp_mem_copy(item, cell + 1, queue->stride);
+  sp_atomic_u32_store_release(cell, pos + queue->mask + 1);
+
+  if (queue->wait == SP_MPMC_WAIT_SEMAPHORE) {
+    sp_mpmc_wake(queue, &queue->push_waiters, &queue->not_full);
+  }
   return true;
 }
 
-void sp_cv_notify_one(sp_cv_t* cond) {
-  SP_UNIMPLEMENTED();
+void sp_mpmc_push(sp_mpmc_t* queue, const void* item) {
+  sp_mpmc_wait_for(queue, (void*)item, true, SP_MPMC_FOREVER);
 }
 
-void sp_cv_notify_all(sp_cv_t* cond) {
-  SP_UNIMPLEMENTED();
+void sp_mpmc_pop(sp_mpmc_t* queue, void* item) {
+  sp_mpmc_wait_for(queue, item, false, SP_MPMC_FOREVER);
 }
 
-#endif
+bool sp_mpmc_push_for(sp_mpmc_t* queue, const void* item, u32 ms) {
+  return sp_mpmc_wait_for(queue, (void*)item, true, ms);
+}
 
-// @thread
-#if defined(SP_WIN32)
-DWORD WINAPI sp_win32_thread_launch(LPVOID args) {
-  s32 result = sp_thread_launch(args);
-  return (DWORD)result;
+bool sp_mpmc_pop_for(sp_mpmc_t* queue, void* item, u32 ms) {
+  return sp_mpmc_wait_for(queue, item, false, ms);
 }
 
-void sp_thread_init(sp_thread_t* thread, sp_thread_fn_t fn, void* userdata) {
-  sp_thread_launch_t* launch = (sp_thread_launch_t*)sp_mem_os_alloc(sizeof(sp_thread_launch_t));
-  *launch = SP_RVAL(sp_thread_launch_t) {
-    .fn = fn,
-    .userdata = userdata,
-    .semaphore = sp_zero_s(sp_semaphore_t)
-  };
-  sp_semaphore_init(&launch->semaphore);
+void sp_mpmc_wake(sp_mpmc_t* queue, sp_atomic_s32_t* waiters, sp_semaphore_t* semaphore) {
+  (void)queue;
 
-  *thread = CreateThread(SP_NULLPTR, 0, sp_win32_thread_launch, launch, 0, SP_NULLPTR);
-  if (!*thread) {
-    sp_semaphore_destroy(&launch->semaphore);
-    sp_mem_os_free(launch, sizeof(sp_thread_launch_t));
-    return;
+  // Claim one sleeper and signal it. Signalling only for a claimed sleeper keeps a burst of
+  // pushes from piling up wakeups that nobody is waiting for.
+  s32 count = sp_atomic_s32_get(waiters);
+  while (count > 0) {
+    if (sp_atomic_s32_cas(waiters, count, count - 1)) {
+      sp_semaphore_signal(semaphore);
+      return;
+    }
+    count = sp_atomic_s32_get(waiters);
   }
-
-  sp_semaphore_wait(&launch->semaphore);
-  sp_semaphore_destroy(&launch->semaphore);
-  sp_mem_os_free(launch, sizeof(sp_thread_launch_t));
 }
 
-s32 sp_thread_launch(void* args) {
-  sp_thread_launch_t* launch = (sp_thread_launch_t*)args;
-  void* userdata = launch->userdata;
-  sp_thread_fn_t fn = launch->fn;
-  sp_semaphore_signal(&launch->semaphore);
-  return fn(userdata);
-}
+bool sp_mpmc_wait_for(sp_mpmc_t* queue, void* item, bool push, u32 ms) {
+  sp_atomic_s32_t* waiters = push ? &queue->push_waiters : &queue->pop_waiters;
+  sp_semaphore_t* semaphore = push ? &queue->not_full : &queue->not_empty;
+  sp_tm_timer_t timer = sp_zero;
+  u32 spins = 0;
+  u32 yields = 0;
 
-void sp_thread_join(sp_thread_t* thread) {
-  if (!*thread) return;
-  WaitForSingleObject(*thread, INFINITE);
-  CloseHandle(*thread);
-  *thread = SP_NULLPTR;
-}
+  while (true) {
+    if (push ? sp_mpmc_try_push(queue, item) : sp_mpmc_try_pop(queue, item)) return true;
+
+    // Don't touch the clock until the fast path has failed, and only if there's a deadline
+    u64 elapsed = 0;
+    if (ms != SP_MPMC_FOREVER) {
+      if (!spins) timer = sp_tm_start_timer();
+      elapsed = sp_tm_ns_to_ms(sp_tm_read_timer(&timer));
+      if (elapsed >= ms) return false;
+    }
 
-#elif defined(SP_POSIX)
-void* sp_posix_thread_launch(void* args) {
-  return (void*)(intptr_t)sp_thread_launch(args);
+    if (spins < SP_MPMC_SPIN_COUNT) {
+      spins++;
+      sp_spin_pause();
+      continue;
+    }
+
+    // Yielding a few times before sleeping lets the other side get a batch of work done,
+    // rather than paying for a wakeup on every item when it's only slightly behind
+    if (queue->wait == SP_MPMC_WAIT_SPIN || yields < SP_MPMC_YIELD_COUNT) {
+      yields++;
+      sp_os_sleep_ns(0);
+      continue;
+    }
+
+    // Register as a sleeper before the last check. The other side publishes its slot before it
+    // looks for sleepers, and both of those are full barriers, so either this check sees the
+    // slot or the other side sees us and signals.
+    sp_atomic_s32_add(waiters, 1);
+    bool done = push ? sp_mpmc_try_push(queue, item) : sp_mpmc_try_pop(queue, item);
+    bool woken = false;
+    if (!done) {
+      if (ms == SP_MPMC_FOREVER) {
+        sp_semaphore_wait(semaphore);
+        woken = true;
+      }
+      else {
+        woken = sp_semaphore_wait_for(semaphore, (u32)(ms - elapsed));
+      }
+    }
+
+    // Whoever woke us already took us off the count; otherwise do it ourselves. If we lost a
+    // race with a waker here, its signal stays in the semaphore and the next sleeper wakes once
+    // for nothing, which the loop tolerates.
+    if (!woken) {
+      s32 count = sp_atomic_s32_get(waiters);
+      while (count > 0 && !sp_atomic_s32_cas(waiters, count, count - 1)) {
+        count = sp_atomic_s32_get(waiters);
+      }
+    }
+    if (done) return true;
+  }
 }
 
-s32 sp_thread_launch(void* args) {
-  sp_thread_launch_t* launch = (sp_thread_launch_t*)args;
-  void* userdata = launch->userdata;
-  sp_thread_fn_t fn = launch->fn;
+// @mirror_rb
+sp_err_t sp_mirror_rb_init(sp_mirror_rb_t* rb, u64 capacity) {
+  *rb = sp_zero_s(sp_mirror_rb_t);
 
-  sp_semaphore_signal(&launch->semaphore);
-  s32 result = fn(userdata);
+  capacity = sp_max(capacity, 1);
+  capacity = (capacity + SP_MIRROR_RB_GRANULARITY - 1) / SP_MIRROR_RB_GRANULARITY * SP_MIRROR_RB_GRANULARITY;
 
-  return result;
+  u8* data = (u8*)sp_sys_map_mirror(capacity);
+  if (!data) return SP_ERR_OS;
+
+  rb->data = data;
+  rb->capacity = capacity;
+  return SP_OK;
 }
 
-void sp_thread_join(sp_thread_t* thread) {
-  pthread_join(*thread, NULL);
+void sp_mirror_rb_free(sp_mirror_rb_t* rb) {
+  sp_sys_unmap_mirror(rb->data, rb->capacity);
+  *rb = sp_zero_s(sp_mirror_rb_t);
 }
 
-void sp_thread_init(sp_thread_t* thread, sp_thread_fn_t fn, void* userdata) {
-  sp_thread_launch_t launch = sp_zero;
-  launch.fn = fn;
-  launch.userdata = userdata;
-  sp_semaphore_init(&launch.semaphore);
+u64 sp_mirror_rb_capacity(sp_mirror_rb_t* rb) {
+  return rb->capacity;
+}
 
-  pthread_create(thread, NULL, sp_posix_thread_launch, &launch);
-  sp_semaphore_wait(&launch.semaphore);
-  sp_semaphore_destroy(&launch.semaphore);
+u64 sp_mirror_rb_size(sp_mirror_rb_t* rb) {
+  return rb->size;
 }
 
-#elif defined(SP_WASM) || defined(SP_FREESTANDING)
-s32 sp_thread_launch(void* args) {
-  sp_thread_launch_t* launch = (sp_thread_launch_t*)args;
-  void* userdata = launch->userdata;
-  sp_thread_fn_t fn = launch->fn;
+u64 sp_mirror_rb_space(sp_mirror_rb_t* rb) {
+  return rb->capacity - rb->size;
+}
 
-  sp_semaphore_signal(&launch->semaphore);
-  s32 result = fn(userdata);
+void sp_mirror_rb_clear(sp_mirror_rb_t* rb) {
+  rb->head = 0;
+  rb->size = 0;
+}
 
-  return result;
+u8* sp_mirror_rb_write_span(sp_mirror_rb_t* rb, u64* n) {
+  // head + size may run past the end of the first mapping; that's the point
+  *n = rb->capacity - rb->size;
+  return rb->data + rb->head + rb->size;
 }
 
-void sp_thread_join(sp_thread_t* thread) {
-  SP_UNIMPLEMENTED();
+void sp_mirror_rb_write_commit(sp_mirror_rb_t* rb, u64 n) {
+  sp_assert(n <= rb->capacity - rb->size);
+  rb->size += n;
 }
 
-void sp_thread_init(sp_thread_t* thread, sp_thread_fn_t fn, void* userdata) {
-  SP_UNIMPLEMENTED();
+const u8* sp_mirror_rb_read_span(sp_mirror_rb_t* rb, u64* n) {
+  *n = rb->size;
+  return rb->data + rb->head;
 }
 
-#else
-#error "sp_thread_launch"
-#error "sp_thread_join"
-#error "sp_thread_init"
-#endif
+void sp_mirror_rb_read_commit(sp_mirror_rb_t* rb, u64 n) {
+  sp_assert(n <= rb->size);
+  rb->size -= n;
+  rb->head += n;
+  if (rb->head >= rb->capacity) rb->head -= rb->capacity;
+}
+
+u64 sp_mirror_rb_write(sp_mirror_rb_t* rb, const void* ptr, u64 size) {
+  u64 n = 0;
+  u8* span = sp_mirror_rb_write_span(rb, &n);
+  n = sp_min(n, size);
+  sp_mem_copy(span, ptr, n);
+  sp_mirror_rb_write_commit(rb, n);
+  return n;
+}
+
+u64 sp_mirror_rb_read(sp_mirror_rb_t* rb, void* ptr, u64 size) {
+  u64 n = 0;
+  const u8* span = sp_mirror_rb_read_span(rb, &n);
+  n = sp_min(n, size);
+  sp_mem_copy(ptr, span, n);
+  sp_mirror_rb_read_commit(rb, n);
+  return n;
+}
 
 
 //  ███████████  ███████████      ███████      █████████  ██████████  █████████   █████████
@@ -12600,7 +17582,7 @@ struct sp_fmon_os {
 struct sp_fmon_os {
   sp_da(s32) fds;
   sp_da(sp_str_t) paths;
-  sp_ht(sp_str_t, u8) files;
+  sp_hs(sp_str_t) files;
   SP_ALIGNED u8 buffer[4096];
   s32 fd;
 };
@@ -12843,7 +17825,7 @@ void sp_fmon_os_init(sp_fmon_t* monitor) {
 
   sp_da_init(monitor->mem, linux_monitor->fds);
   sp_da_init(monitor->mem, linux_monitor->paths);
-  sp_str_ht_init(monitor->mem, linux_monitor->files);
+  sp_str_hs_init(monitor->mem, linux_monitor->files);
 
   monitor->os = linux_monitor;
 }
@@ -12883,13 +17865,13 @@ void sp_fmon_os_deinit(sp_fmon_t* monitor) {
   if (os->fd > 0) {
     sp_sys_close(os->fd);
   }
-  sp_ht_free(os->files);
+  sp_hs_free(os->files);
 }
 
 void sp_fmon_os_add_file(sp_fmon_t* monitor, sp_str_t file_path) {
   sp_fmon_os_t* os = (sp_fmon_os_t*)monitor->os;
   sp_str_t canonical = sp_fs_canonicalize_path(monitor->mem, file_path);
-  sp_str_ht_insert(os->files, canonical, 1);
+  sp_hs_insert(os->files, canonical);
 
   sp_str_t dir_path = sp_fs_parent_path(canonical);
   if (!sp_str_empty(dir_path)) {
@@ -12898,8 +17880,8 @@ void sp_fmon_os_add_file(sp_fmon_t* monitor, sp_str_t file_path) {
 }
 
 SP_PRIVATE bool sp_linux_fmon_file_matches(sp_fmon_os_t* os, sp_str_t full_path) {
-  if (sp_ht_empty(os->files)) return true;
-  return sp_ht_getp(os->files, full_path);
+  if (sp_hs_empty(os->files)) return true;
+  return sp_hs_contains(os->files, full_path);
 }
 
 void sp_fmon_os_process_changes(sp_fmon_t* monitor) {
@@ -14652,6 +19634,108 @@ sp_err_t sp_io_dyn_mem_writer_close(sp_io_dyn_mem_writer_t* w) {
   return SP_OK;
 }
 
+sp_err_t sp_io_hash_writer_write(sp_io_writer_t* writer, const void* ptr, u64 size, u64* bytes_written) {
+  sp_io_hash_writer_t* w = (sp_io_hash_writer_t*)writer;
+  sp_err_t err = SP_OK;
+
+  // Only hash what the inner writer actually accepted, so the hash always matches its contents
+  u64 written = size;
+  if (w->inner) {
+    err = sp_io_write(w->inner, ptr, size, &written);
+  }
+  sp_hasher_update(&w->hasher, ptr, written);
+
+  if (bytes_written) *bytes_written = written;
+  return err;
+}
+
+void sp_io_hash_writer_init(sp_io_hash_writer_t* w, sp_io_writer_t* inner, u64 seed) {
+  *w = (sp_io_hash_writer_t) {
+    .base = { .write = sp_io_hash_writer_write },
+    .inner = inner,
+  };
+  sp_hasher_init(&w->hasher, seed);
+}
+
+sp_hash_t sp_io_hash_writer_final(sp_io_hash_writer_t* w) {
+  sp_io_flush(&w->base);
+  return sp_hasher_final(&w->hasher);
+}
+
+sp_err_t sp_io_hash_file(sp_str_t path, u64 seed, sp_hash_t* hash) {
+  sp_assert(hash);
+
+  sp_io_file_reader_t reader = sp_zero;
+  sp_try(sp_io_file_reader_from_path(&reader, path));
+
+  sp_hasher_t hasher;
+  sp_hasher_init(&hasher, seed);
+  sp_err_t err = sp_hasher_read(&hasher, &reader.base, SP_NULLPTR);
+  sp_io_file_reader_close(&reader);
+  if (err) return err;
+
+  *hash = sp_hasher_final(&hasher);
+  return SP_OK;
+}
+
+void sp_io_mirror_rb_reader_sync(sp_io_mirror_rb_reader_t* r) {
+  // Give back whatever sp_io_read() drained from the buffer, then point the buffer at every
+  // byte that's readable now
+  sp_mirror_rb_read_commit(r->rb, r->base.cursor);
+
+  u64 n = 0;
+  const u8* span = sp_mirror_rb_read_span(r->rb, &n);
+  r->base.buffer = (sp_mem_buffer_t) {
+    .data = (u8*)(uintptr_t)span,
+    .len = n,
+    .capacity = n,
+  };
+  r->base.cursor = 0;
+}
+
+sp_err_t sp_io_mirror_rb_reader_read(sp_io_reader_t* reader, void* ptr, u64 size, u64* bytes_read) {
+  sp_io_mirror_rb_reader_t* r = (sp_io_mirror_rb_reader_t*)reader;
+
+  // sp_io_read() refills a reader by reading into its buffer. Ours already holds the bytes, so
+  // just re-point it and report them, without copying anything.
+  bool refill = ptr == r->base.buffer.data;
+  sp_io_mirror_rb_reader_sync(r);
+
+  u64 n = r->base.buffer.len;
+  if (!refill) {
+    n = sp_min(n, size);
+    sp_mem_copy(ptr, r->base.buffer.data, n);
+    r->base.cursor = n;
+    sp_io_mirror_rb_reader_sync(r);
+  }
+
+  if (bytes_read) *bytes_read = n;
+  return n ? SP_OK : SP_ERR_IO_EOF;
+}
+
+void sp_io_mirror_rb_reader_init(sp_io_mirror_rb_reader_t* r, sp_mirror_rb_t* rb) {
+  *r = (sp_io_mirror_rb_reader_t) {
+    .base = { .read = sp_io_mirror_rb_reader_read },
+    .rb = rb,
+  };
+  sp_io_mirror_rb_reader_sync(r);
+}
+
+sp_err_t sp_io_mirror_rb_writer_write(sp_io_writer_t* writer, const void* ptr, u64 size, u64* bytes_written) {
+  sp_io_mirror_rb_writer_t* w = (sp_io_mirror_rb_writer_t*)writer;
+
+  u64 n = sp_mirror_rb_write(w->rb, ptr, size);
+  if (bytes_written) *bytes_written = n;
+  return n < size ? SP_ERR_IO_NO_SPACE : SP_OK;
+}
+
+void sp_io_mirror_rb_writer_init(sp_io_mirror_rb_writer_t* w, sp_mirror_rb_t* rb) {
+  *w = (sp_io_mirror_rb_writer_t) {
+    .base = { .write = sp_io_mirror_rb_writer_write },
+    .rb = rb,
+  };
+}
+
 void sp_io_dyn_mem_writer_init(sp_mem_t mem, sp_io_dyn_mem_writer_t* w) {
   *w = (sp_io_dyn_mem_writer_t) {
     .base = { .write = sp_io_dyn_mem_writer_write },
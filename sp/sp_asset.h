@@ -54,14 +54,22 @@ struct sp_asset_import_context {
 };
 
 #define SP_ASSET_REGISTRY_CONFIG_MAX_IMPORTERS 32
+
+#ifndef SP_ASSET_COMPLETION_QUEUE_CAPACITY
+  #define SP_ASSET_COMPLETION_QUEUE_CAPACITY 1024
+#endif
 typedef struct {
   sp_asset_importer_config_t importers[SP_ASSET_REGISTRY_CONFIG_MAX_IMPORTERS];
 } sp_asset_registry_config_t;
 
+// Imports may be queued from any thread, so the import queue is locked. Completions only ever
+// flow from the registry's thread to whichever thread calls process_completions(), so they go
+// through a lock free sp_spsc_t; only call process_completions() from one thread. If that
+// thread falls SP_ASSET_COMPLETION_QUEUE_CAPACITY completions behind, the registry's thread
+// waits for it to catch up.
 struct sp_asset_registry {
   sp_mutex_t mutex;
   sp_mutex_t import_mutex;
-  sp_mutex_t completion_mutex;
   sp_mutex_t alloc_mutex;
   sp_semaphore_t semaphore;
   sp_thread_t thread;
@@ -69,7 +77,7 @@ struct sp_asset_registry {
   sp_mem_t mem; // thread-safe wrapper around arena, protected by alloc_mutex
   sp_da(sp_asset_importer_t) importers;
   sp_rb(sp_asset_import_context_t) import_queue;
-  sp_rb(sp_asset_import_context_t) completion_queue;
+  sp_spsc_t completion_queue;
   bool shutdown_requested;
 };
 
@@ -103,17 +111,15 @@ void* sp_asset_registry_on_alloc(void* ud, sp_mem_alloc_mode_t mode, u64 size, v
 void sp_asset_registry_init(sp_asset_registry_t* registry, sp_mem_t mem, sp_asset_registry_config_t config) {
   sp_mutex_init(&registry->mutex, SP_MUTEX_PLAIN);
   sp_mutex_init(&registry->import_mutex, SP_MUTEX_PLAIN);
-  sp_mutex_init(&registry->completion_mutex, SP_MUTEX_PLAIN);
   sp_mutex_init(&registry->alloc_mutex, SP_MUTEX_PLAIN);
   sp_semaphore_init(&registry->semaphore);
   registry->shutdown_requested = false;
   registry->import_queue = SP_NULLPTR;
-  registry->completion_queue = SP_NULLPTR;
   registry->arena = sp_mem_arena_new(mem);
   registry->mem = (sp_mem_t){ .on_alloc = sp_asset_registry_on_alloc, .user_data = registry };
   sp_da_init(registry->mem, registry->importers);
   sp_rb_init(registry->mem, registry->import_queue);
-  sp_rb_init(registry->mem, registry->completion_queue);
+  sp_spsc_init(registry->mem, &registry->completion_queue, sizeof(sp_asset_import_context_t), SP_ASSET_COMPLETION_QUEUE_CAPACITY);
 
   sp_for(index, SP_ASSET_REGISTRY_CONFIG_MAX_IMPORTERS) {
     sp_asset_importer_config_t* cfg = &config.importers[index];
@@ -144,7 +150,6 @@ void sp_asset_registry_shutdown(sp_asset_registry_t* registry) {
 
   sp_mutex_destroy(&registry->mutex);
   sp_mutex_destroy(&registry->import_mutex);
-  sp_mutex_destroy(&registry->completion_mutex);
   sp_mutex_destroy(&registry->alloc_mutex);
   sp_semaphore_destroy(&registry->semaphore);
 
@@ -221,21 +226,14 @@ sp_asset_t* sp_asset_registry_import(sp_asset_registry_t* r, sp_asset_kind_t k,
 }
 
 void sp_asset_registry_process_completions(sp_asset_registry_t* r) {
-  sp_mutex_lock(&r->completion_mutex);
-  while (!sp_rb_empty(r->completion_queue)) {
-    sp_asset_import_context_t context = *sp_rb_peek(r->completion_queue);
-    sp_rb_pop(r->completion_queue);
-    sp_mutex_unlock(&r->completion_mutex);
-
+  sp_asset_import_context_t context;
+  while (sp_spsc_pop(&r->completion_queue, &context)) {
     context.importer->on_completion(&context);
 
     sp_mutex_lock(&r->mutex);
     context.asset->state = SP_ASSET_STATE_COMPLETED;
     sp_mutex_unlock(&r->mutex);
-
-    sp_mutex_lock(&r->completion_mutex);
   }
-  sp_mutex_unlock(&r->completion_mutex);
 }
 
 s32 sp_asset_registry_thread_fn(void* user_data) {
@@ -261,9 +259,14 @@ s32 sp_asset_registry_thread_fn(void* user_data) {
       context.asset->state = SP_ASSET_STATE_IMPORTED;
       sp_mutex_unlock(&registry->mutex);
 
-      sp_mutex_lock(&registry->completion_mutex);
-      sp_rb_push(registry->completion_queue, context);
-      sp_mutex_unlock(&registry->completion_mutex);
+      while (!sp_spsc_push(&registry->completion_queue, &context)) {
+        sp_mutex_lock(&registry->mutex);
+        shutdown = registry->shutdown_requested;
+        sp_mutex_unlock(&registry->mutex);
+        if (shutdown) return 0;
+
+        sp_os_sleep_ms(1);
+      }
 
       sp_mutex_lock(&registry->import_mutex);
     }
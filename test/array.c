@@ -469,3 +469,573 @@ UTEST_F(dyn_array, allocator_realloc_into_scratch_clobber) {
 
   sp_mem_arena_destroy(arena);
 }
+
+UTEST_F(dyn_array, push_n) {
+  sp_da(s32) arr = sp_da_new(ut.mem, s32);
+
+  s32 batch [100];
+  sp_carr_for(batch, it) batch[it] = (s32)it;
+
+  sp_da_push(arr, -1);
+  sp_da_push_n(arr, batch, sp_carr_len(batch));
+  ASSERT_EQ(sp_da_size(arr), 101);
+  ASSERT_EQ(arr[0], -1);
+  sp_carr_for(batch, it) {
+    ASSERT_EQ(arr[it + 1], (s32)it);
+  }
+
+  sp_da_push_n(arr, SP_NULLPTR, 3);
+  ASSERT_EQ(sp_da_size(arr), 104);
+  ASSERT_EQ(arr[101], 0);
+  ASSERT_EQ(arr[103], 0);
+
+  sp_da_push_n(arr, batch, 0);
+  ASSERT_EQ(sp_da_size(arr), 104);
+
+  sp_da_free(arr);
+}
+
+UTEST_F(dyn_array, insert_n) {
+  sp_da(s32) arr = sp_da_new(ut.mem, s32);
+  s32 head [] = { 0, 1, 6, 7 };
+  s32 mid [] = { 2, 3, 4, 5 };
+
+  sp_da_push_n(arr, head, 4);
+  sp_da_insert_n(arr, 2, mid, 4);
+  ASSERT_EQ(sp_da_size(arr), 8);
+  sp_da_for(arr, it) {
+    ASSERT_EQ(arr[it], (s32)it);
+  }
+
+  sp_da_insert(arr, 0, -1);
+  sp_da_insert(arr, sp_da_size(arr), 8);
+  ASSERT_EQ(sp_da_size(arr), 10);
+  ASSERT_EQ(arr[0], -1);
+  ASSERT_EQ(arr[1], 0);
+  ASSERT_EQ(arr[9], 8);
+
+  sp_da_free(arr);
+}
+
+UTEST_F(dyn_array, insert_from_itself) {
+  sp_da(s32) arr = sp_da_new(ut.mem, s32);
+  sp_for(it, 4) sp_da_push(arr, (s32)it);
+
+  // Growing moves the array out from under the values
+  sp_da_push_n(arr, arr, sp_da_size(arr));
+  s32 doubled [] = { 0, 1, 2, 3, 0, 1, 2, 3 };
+  ASSERT_EQ(sp_da_size(arr), sp_carr_len(doubled));
+  EXPECT_TRUE(sp_mem_is_equal(arr, doubled, sizeof(doubled)));
+
+  // The values straddle the insertion point, so half of them shift before the copy
+  sp_da_insert_n(arr, 2, arr + 1, 3);
+  s32 straddled [] = { 0, 1, 1, 2, 3, 2, 3, 0, 1, 2, 3 };
+  ASSERT_EQ(sp_da_size(arr), sp_carr_len(straddled));
+  EXPECT_TRUE(sp_mem_is_equal(arr, straddled, sizeof(straddled)));
+
+  sp_da_insert(arr, 0, arr[4]);
+  EXPECT_EQ(arr[0], 3);
+  EXPECT_EQ(arr[5], 3);
+  EXPECT_EQ(sp_da_size(arr), 12);
+
+  sp_da_free(arr);
+}
+
+UTEST_F(dyn_array, insert_wide_element) {
+  typedef struct { u8 bytes [100]; } wide_t;
+  sp_da(wide_t) arr = sp_da_new(ut.mem, wide_t);
+  sp_for(it, 3) {
+    wide_t wide;
+    sp_mem_fill_u8(wide.bytes, sizeof(wide.bytes), (u8)it);
+    sp_da_push(arr, wide);
+  }
+
+  sp_da_insert(arr, 1, arr[2]);
+  ASSERT_EQ(sp_da_size(arr), 4);
+  u8 expected [] = { 0, 2, 1, 2 };
+  sp_carr_for(expected, it) {
+    EXPECT_EQ(arr[it].bytes[0], expected[it]);
+    EXPECT_EQ(arr[it].bytes[99], expected[it]);
+  }
+
+  sp_da_free(arr);
+}
+
+UTEST_F(dyn_array, erase_range) {
+  sp_da(s32) arr = sp_da_new(ut.mem, s32);
+  sp_for(it, 10) sp_da_push(arr, (s32)it);
+
+  sp_da_erase_range(arr, 2, 3);
+  s32 expected [] = { 0, 1, 5, 6, 7, 8, 9 };
+  ASSERT_EQ(sp_da_size(arr), sp_carr_len(expected));
+  sp_carr_for(expected, it) {
+    ASSERT_EQ(arr[it], expected[it]);
+  }
+
+  sp_da_erase(arr, 0);
+  ASSERT_EQ(arr[0], 1);
+  sp_da_erase_range(arr, 3, 3);
+  ASSERT_EQ(sp_da_size(arr), 3);
+  ASSERT_EQ(*sp_da_back(arr), 6);
+  sp_da_erase_range(arr, 0, 0);
+  ASSERT_EQ(sp_da_size(arr), 3);
+
+  sp_da_free(arr);
+}
+
+UTEST_F(dyn_array, swap_remove) {
+  sp_da(s32) arr = sp_da_new(ut.mem, s32);
+  sp_for(it, 5) sp_da_push(arr, (s32)it);
+
+  sp_da_swap_remove(arr, 1);
+  ASSERT_EQ(sp_da_size(arr), 4);
+  ASSERT_EQ(arr[1], 4);
+  ASSERT_EQ(arr[3], 3);
+
+  sp_da_swap_remove(arr, 3);
+  ASSERT_EQ(sp_da_size(arr), 3);
+  ASSERT_EQ(*sp_da_back(arr), 2);
+
+  sp_da_free(arr);
+}
+
+UTEST(dyn_array, push_n_grows_in_place_at_arena_top) {
+  sp_mem_arena_t* arena = sp_mem_arena_new(sp_mem_os_new());
+  sp_mem_t mem = sp_mem_arena_as_allocator(arena);
+
+  sp_da(u8) arr = sp_da_new(mem, u8);
+  u8* data = arr;
+  u8 batch [256] = sp_zero;
+
+  sp_for(it, 8) {
+    sp_da_push_n(arr, batch, sizeof(batch));
+    ASSERT_EQ((uintptr_t)arr, (uintptr_t)data);
+  }
+  ASSERT_EQ(sp_da_size(arr), 8 * sizeof(batch));
+
+  sp_mem_arena_destroy(arena);
+}
+
+UTEST_F(dyn_array, sa_stays_inline) {
+  sp_sa(s32, 8) arr;
+  sp_sa_init(ut.mem, arr);
+
+  ASSERT_TRUE(sp_sa_empty(arr));
+  ASSERT_EQ(sp_sa_capacity(arr), 8);
+
+  sp_for(it, 8) {
+    sp_sa_push(arr, (s32)it * 10);
+  }
+
+  ASSERT_TRUE(sp_sa_is_inline(arr));
+  ASSERT_TRUE(sp_sa_full(arr));
+  ASSERT_EQ(sp_sa_size(arr), 8);
+  ASSERT_EQ(ut.tracking.live_count, 0);
+  sp_sa_for(arr, it) {
+    ASSERT_EQ(sp_sa_at(arr, it), (s32)it * 10);
+  }
+
+  sp_sa_pop(arr);
+  ASSERT_EQ(sp_sa_size(arr), 7);
+  ASSERT_EQ(*sp_sa_back(arr), 60);
+
+  sp_sa_free(arr);
+  ASSERT_EQ(ut.tracking.live_count, 0);
+}
+
+UTEST_F(dyn_array, sa_spills_past_inline_capacity) {
+  sp_sa(s32, 4) arr;
+  sp_sa_init(ut.mem, arr);
+
+  sp_for(it, 100) {
+    sp_sa_push(arr, (s32)it);
+  }
+
+  ASSERT_FALSE(sp_sa_is_inline(arr));
+  ASSERT_EQ(sp_sa_size(arr), 100);
+  ASSERT_GE(sp_sa_capacity(arr), 100);
+  ASSERT_EQ(ut.tracking.live_count, 1);
+
+  u32 expected = 100;
+  sp_sa_rfor(arr, it) {
+    ASSERT_EQ(sp_sa_at(arr, it), (s32)--expected);
+  }
+
+  sp_sa_free(arr);
+  ASSERT_TRUE(sp_sa_is_inline(arr));
+  ASSERT_TRUE(sp_sa_empty(arr));
+  ASSERT_EQ(ut.tracking.live_count, 0);
+
+  sp_sa_push(arr, 7);
+  ASSERT_TRUE(sp_sa_is_inline(arr));
+  ASSERT_EQ(sp_sa_at(arr, 0), 7);
+}
+
+UTEST_F(dyn_array, sa_reserve) {
+  sp_sa(u8, 16) arr;
+  sp_sa_init(ut.mem, arr);
+
+  sp_sa_reserve(arr, 16);
+  ASSERT_TRUE(sp_sa_is_inline(arr));
+
+  sp_sa_push(arr, 1);
+  sp_sa_push(arr, 2);
+  sp_sa_reserve(arr, 64);
+  ASSERT_FALSE(sp_sa_is_inline(arr));
+  ASSERT_GE(sp_sa_capacity(arr), 64);
+  ASSERT_EQ(sp_sa_size(arr), 2);
+  ASSERT_EQ(sp_sa_at(arr, 0), 1);
+  ASSERT_EQ(sp_sa_at(arr, 1), 2);
+
+  sp_sa_free(arr);
+}
+
+UTEST_F(dyn_array, sa_zeroed_and_copied) {
+  typedef struct {
+    u32 id;
+    sp_sa(sp_str_t, 4) names;
+  } owner_t;
+
+  owner_t a = sp_zero;
+  sp_sa_push(a.names, sp_str_lit("foo"));
+  sp_sa_push(a.names, sp_str_lit("bar"));
+
+  owner_t b = a;
+  sp_sa_push(b.names, sp_str_lit("baz"));
+  sp_sa_at(b.names, 0) = sp_str_lit("qux");
+
+  ASSERT_EQ(sp_sa_size(a.names), 2);
+  ASSERT_EQ(sp_sa_size(b.names), 3);
+  SP_EXPECT_STR_EQ_CSTR(sp_sa_at(a.names, 0), "foo");
+  SP_EXPECT_STR_EQ_CSTR(sp_sa_at(b.names, 0), "qux");
+  SP_EXPECT_STR_EQ_CSTR(sp_sa_at(b.names, 2), "baz");
+}
+
+UTEST_F(dyn_array, chunk_array_push_and_index) {
+  sp_chunk_array(u64) arr = SP_NULLPTR;
+  sp_chunk_array_init_n(ut.mem, arr, 16);
+  ASSERT_TRUE(sp_chunk_array_empty(arr));
+  ASSERT_EQ(sp_chunk_array_chunk_len(arr), 16);
+
+  sp_for(it, 1000) {
+    sp_chunk_array_push(arr, (u64)it * 3);
+  }
+
+  ASSERT_EQ(sp_chunk_array_size(arr), 1000);
+  ASSERT_EQ(sp_chunk_array_num_chunks(arr), 63);
+  ASSERT_GE(sp_chunk_array_capacity(arr), 1000);
+  sp_chunk_array_for(arr, it) {
+    ASSERT_EQ(sp_chunk_array_at(arr, it), it * 3);
+  }
+
+  sp_chunk_array_pop(arr);
+  ASSERT_EQ(*sp_chunk_array_back(arr), 998 * 3);
+
+  sp_chunk_array_free(arr);
+  ASSERT_TRUE(arr == SP_NULLPTR);
+}
+
+UTEST_F(dyn_array, chunk_array_addresses_are_stable) {
+  sp_chunk_array(u32) arr = sp_chunk_array_new(ut.mem, u32);
+
+  sp_chunk_array_push(arr, 0);
+  u32* first = &sp_chunk_array_at(arr, 0);
+  u32* ptrs [64];
+  sp_carr_for(ptrs, it) {
+    sp_chunk_array_push(arr, (u32)it);
+    ptrs[it] = sp_chunk_array_back(arr);
+  }
+
+  sp_for(it, 100000) {
+    sp_chunk_array_push(arr, (u32)it);
+  }
+
+  ASSERT_TRUE(first == &sp_chunk_array_at(arr, 0));
+  sp_carr_for(ptrs, it) {
+    ASSERT_TRUE(ptrs[it] == &sp_chunk_array_at(arr, it + 1));
+    ASSERT_EQ(*ptrs[it], (u32)it);
+  }
+
+  sp_chunk_array_free(arr);
+}
+
+UTEST_F(dyn_array, chunk_array_chunk_iteration) {
+  sp_chunk_array(s32) arr = SP_NULLPTR;
+  sp_chunk_array_init_n(ut.mem, arr, 10);
+  ASSERT_EQ(sp_chunk_array_chunk_len(arr), 8);
+
+  sp_for(it, 21) {
+    sp_chunk_array_push(arr, (s32)it);
+  }
+
+  s32 expected = 0;
+  u64 sizes [3] = { 8, 8, 5 };
+  sp_chunk_array_for_chunk(arr, c) {
+    s32* chunk = sp_chunk_array_chunk(arr, c);
+    ASSERT_EQ(sp_chunk_array_chunk_size(arr, c), sizes[c]);
+    sp_for(it, sp_chunk_array_chunk_size(arr, c)) {
+      ASSERT_EQ(chunk[it], expected++);
+    }
+  }
+  ASSERT_EQ(expected, 21);
+
+  sp_chunk_array_free(arr);
+}
+
+UTEST_F(dyn_array, chunk_array_clear_keeps_chunks) {
+  sp_chunk_array(u8) arr = sp_chunk_array_new(ut.mem, u8);
+  sp_chunk_array_reserve(arr, SP_CHUNK_ARRAY_CHUNK_BYTES * 2);
+  ASSERT_EQ(sp_chunk_array_capacity(arr), SP_CHUNK_ARRAY_CHUNK_BYTES * 2);
+  ASSERT_TRUE(sp_chunk_array_empty(arr));
+
+  u32 live = ut.tracking.live_count;
+  sp_for(it, SP_CHUNK_ARRAY_CHUNK_BYTES + 1) {
+    sp_chunk_array_push(arr, (u8)it);
+  }
+  sp_chunk_array_clear(arr);
+  sp_chunk_array_push(arr, 42);
+  ASSERT_EQ(ut.tracking.live_count, live);
+  ASSERT_EQ(sp_chunk_array_size(arr), 1);
+  ASSERT_EQ(sp_chunk_array_at(arr, 0), 42);
+
+  sp_chunk_array_free(arr);
+}
+
+#define TEST_SOA_FIELDS(X) \
+  X(f32, x)                \
+  X(f32, vx)               \
+  X(u8, flags)             \
+  X(sp_str_t, name)
+
+SP_SOA_DEFINE(test_soa, TEST_SOA_FIELDS)
+
+static test_soa_row_t test_soa_row(u32 it) {
+  test_soa_row_t row = sp_zero;
+  row.x = (f32)it;
+  row.vx = (f32)it * 0.5f;
+  row.flags = (u8)it;
+  row.name = sp_str_lit("row");
+  return row;
+}
+
+UTEST_F(dyn_array, soa_push_and_columns) {
+  test_soa_t soa;
+  test_soa_init(ut.mem, &soa);
+  ASSERT_TRUE(sp_soa_empty(soa));
+
+  sp_for(it, 100) {
+    ASSERT_EQ(test_soa_push(&soa, test_soa_row(it)), it);
+  }
+  ASSERT_EQ(sp_soa_size(soa), 100);
+  ASSERT_GE(sp_soa_capacity(soa), 100);
+  ASSERT_EQ(ut.tracking.live_count, 4);
+
+  sp_soa_for(soa, it) {
+    soa.x[it] += soa.vx[it];
+  }
+
+  sp_soa_for(soa, it) {
+    ASSERT_EQ(soa.x[it], (f32)it * 1.5f);
+    ASSERT_EQ(soa.flags[it], (u8)it);
+    SP_EXPECT_STR_EQ_CSTR(soa.name[it], "row");
+  }
+
+  test_soa_row_t row = test_soa_get(&soa, 10);
+  ASSERT_EQ(row.x, 15.f);
+  row.flags = 0xFF;
+  test_soa_set(&soa, 10, row);
+  ASSERT_EQ(soa.flags[10], 0xFF);
+
+  sp_soa_free(soa);
+  ASSERT_EQ(ut.tracking.live_count, 0);
+  ASSERT_TRUE(soa.x == SP_NULLPTR);
+}
+
+UTEST_F(dyn_array, soa_push_n_zeroes) {
+  test_soa_t soa;
+  test_soa_init(ut.mem, &soa);
+  test_soa_push(&soa, test_soa_row(7));
+
+  u64 first = sp_soa_push_n(soa, 50);
+  ASSERT_EQ(first, 1);
+  ASSERT_EQ(sp_soa_size(soa), 51);
+  for (u64 it = first; it < sp_soa_size(soa); it++) {
+    ASSERT_EQ(soa.x[it], 0.f);
+    ASSERT_EQ(soa.flags[it], 0);
+    ASSERT_EQ(soa.name[it].len, 0);
+  }
+  ASSERT_EQ(soa.flags[0], 7);
+
+  sp_soa_free(soa);
+}
+
+UTEST_F(dyn_array, soa_erase_and_swap) {
+  test_soa_t soa;
+  test_soa_init(ut.mem, &soa);
+  sp_for(it, 10) test_soa_push(&soa, test_soa_row(it));
+
+  sp_soa_erase_range(soa, 2, 3);
+  u8 expected [] = { 0, 1, 5, 6, 7, 8, 9 };
+  ASSERT_EQ(sp_soa_size(soa), sp_carr_len(expected));
+  sp_carr_for(expected, it) {
+    ASSERT_EQ(soa.flags[it], expected[it]);
+    ASSERT_EQ(soa.x[it], (f32)expected[it]);
+  }
+
+  sp_soa_swap_remove(soa, 0);
+  ASSERT_EQ(sp_soa_size(soa), 6);
+  ASSERT_EQ(soa.flags[0], 9);
+  ASSERT_EQ(soa.vx[0], 4.5f);
+
+  sp_soa_swap(soa, 0, 1);
+  ASSERT_EQ(soa.flags[0], 1);
+  ASSERT_EQ(soa.flags[1], 9);
+  ASSERT_EQ(soa.x[1], 9.f);
+  SP_EXPECT_STR_EQ_CSTR(soa.name[1], "row");
+
+  sp_soa_erase(soa, sp_soa_size(soa) - 1);
+  sp_soa_pop(soa);
+  ASSERT_EQ(sp_soa_size(soa), 4);
+  ASSERT_EQ(soa.flags[3], 6);
+
+  sp_soa_free(soa);
+}
+
+UTEST_F(dyn_array, soa_reserve_fills_every_column) {
+  test_soa_t soa;
+  test_soa_init(ut.mem, &soa);
+
+  ASSERT_TRUE(sp_soa_reserve(soa, 1000));
+  ASSERT_EQ(sp_soa_capacity(soa), 1000);
+  ASSERT_TRUE(sp_soa_empty(soa));
+  ASSERT_EQ(ut.tracking.live_count, 4);
+
+  sp_for(it, 1000) test_soa_push(&soa, test_soa_row(it));
+  ASSERT_EQ(sp_soa_capacity(soa), 1000);
+
+  sp_soa_clear(soa);
+  ASSERT_TRUE(sp_soa_empty(soa));
+  sp_soa_free(soa);
+}
+
+typedef struct {
+  sp_mem_t backing;
+  u32 grows_left;
+} test_failing_mem_t;
+
+static void* test_failing_mem_on_alloc(void* user_data, sp_mem_alloc_mode_t mode, u64 size, void* ptr, u64 old_size) {
+  test_failing_mem_t* failing = (test_failing_mem_t*)user_data;
+
+  // Like the arena, resizing to zero doesn't free anything
+  if (mode == SP_ALLOCATOR_MODE_RESIZE && !size) return SP_NULLPTR;
+
+  bool grows = mode == SP_ALLOCATOR_MODE_ALLOC || (mode == SP_ALLOCATOR_MODE_RESIZE && size > old_size);
+  if (grows) {
+    if (!failing->grows_left) return SP_NULLPTR;
+    failing->grows_left--;
+  }
+  return failing->backing.on_alloc(failing->backing.user_data, mode, size, ptr, old_size);
+}
+
+UTEST_F(dyn_array, soa_reserve_rolls_back_on_failure) {
+  test_failing_mem_t failing = { .backing = ut.mem, .grows_left = 2 };
+  sp_mem_t mem = { .on_alloc = test_failing_mem_on_alloc, .user_data = &failing };
+
+  // The first reserve allocates every column; the third column fails and the two before it are freed
+  test_soa_t soa;
+  test_soa_init(mem, &soa);
+  ASSERT_FALSE(sp_soa_reserve(soa, 64));
+  EXPECT_EQ(sp_soa_capacity(soa), 0);
+  EXPECT_EQ(ut.tracking.live_count, 0);
+  EXPECT_EQ(soa.x, SP_NULLPTR);
+  EXPECT_EQ(soa.vx, SP_NULLPTR);
+  EXPECT_EQ(soa.flags, SP_NULLPTR);
+  EXPECT_EQ(soa.name, SP_NULLPTR);
+
+  // Growing an existing set fails on the last column and shrinks the others back
+  failing.grows_left = 4;
+  ASSERT_TRUE(sp_soa_reserve(soa, 64));
+  sp_for(it, 64) test_soa_push(&soa, test_soa_row(it));
+
+  failing.grows_left = 3;
+  ASSERT_FALSE(sp_soa_reserve(soa, 1000));
+  EXPECT_EQ(sp_soa_capacity(soa), 64);
+  EXPECT_EQ(ut.tracking.live_count, 4);
+  sp_for(it, 64) {
+    EXPECT_EQ(soa.x[it], (f32)it);
+    EXPECT_EQ(soa.flags[it], (u8)it);
+  }
+
+  // Once the allocator recovers, the same reserve succeeds
+  failing.grows_left = 4;
+  ASSERT_TRUE(sp_soa_reserve(soa, 1000));
+  EXPECT_EQ(soa.x[63], 63.0f);
+  sp_soa_free(soa);
+}
+
+UTEST_F(dyn_array, sa_push_fails_without_spilling) {
+  test_failing_mem_t failing = { .backing = ut.mem, .grows_left = 0 };
+  sp_mem_t mem = { .on_alloc = test_failing_mem_on_alloc, .user_data = &failing };
+
+  struct {
+    sp_sa(s32, 2) arr;
+    s32 guard;
+  } holder;
+  holder.guard = 1234;
+  sp_sa_init(mem, holder.arr);
+
+  sp_for(it, 3) {
+    sp_sa_push(holder.arr, (s32)it);
+  }
+  EXPECT_EQ(sp_sa_size(holder.arr), 2);
+  EXPECT_TRUE(sp_sa_is_inline(holder.arr));
+  EXPECT_EQ(holder.guard, 1234);
+
+  EXPECT_FALSE(sp_sa_grow(holder.arr, 8));
+  sp_sa_reserve(holder.arr, 8);
+  EXPECT_EQ(sp_sa_capacity(holder.arr), 2);
+
+  // Once the allocator recovers, the next push spills and keeps what was inline
+  failing.grows_left = 1;
+  sp_sa_push(holder.arr, 2);
+  ASSERT_EQ(sp_sa_size(holder.arr), 3);
+  EXPECT_FALSE(sp_sa_is_inline(holder.arr));
+  sp_sa_for(holder.arr, it) {
+    EXPECT_EQ(sp_sa_at(holder.arr, it), (s32)it);
+  }
+  EXPECT_EQ(holder.guard, 1234);
+  sp_sa_free(holder.arr);
+}
+
+UTEST_F(dyn_array, chunk_array_push_fails_cleanly) {
+  test_failing_mem_t failing = { .backing = ut.mem, .grows_left = 1 };
+  sp_mem_t mem = { .on_alloc = test_failing_mem_on_alloc, .user_data = &failing };
+
+  // The directory is the one allocation the budget allows, so the first chunk fails
+  sp_chunk_array(s32) arr = SP_NULLPTR;
+  sp_chunk_array_init_n(mem, arr, 2);
+  sp_chunk_array_push(arr, 0);
+  ASSERT_NE(arr, SP_NULLPTR);
+  EXPECT_EQ(sp_chunk_array_size(arr), 0);
+
+  // Fill the directory's four chunks, then let it regrow but fail the chunk after it
+  failing.grows_left = 4;
+  sp_for(it, 8) sp_chunk_array_push(arr, (s32)it);
+  ASSERT_EQ(sp_chunk_array_size(arr), 8);
+  s32* first = &sp_chunk_array_at(arr, 0);
+
+  failing.grows_left = 1;
+  sp_chunk_array_push(arr, 8);
+  ASSERT_NE(arr, SP_NULLPTR);
+  EXPECT_EQ(sp_chunk_array_size(arr), 8);
+  EXPECT_EQ(&sp_chunk_array_at(arr, 0), first);
+  sp_chunk_array_for(arr, it) {
+    EXPECT_EQ(sp_chunk_array_at(arr, it), (s32)it);
+  }
+
+  failing.grows_left = 1;
+  sp_chunk_array_push(arr, 8);
+  ASSERT_EQ(sp_chunk_array_size(arr), 9);
+  EXPECT_EQ(sp_chunk_array_at(arr, 8), 8);
+  sp_chunk_array_free(arr);
+}
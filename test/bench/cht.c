@@ -0,0 +1,229 @@
+#include "sp.h"
+
+#define SP_TABLE_IMPLEMENTATION
+#include "table.h"
+
+#define BENCH_KEYS (1 << 16)
+#define BENCH_OPS_PER_THREAD (1 << 20)
+#define BENCH_MAX_THREADS 8
+
+typedef struct {
+  const c8* name;
+  u32 read_percent;
+} bench_workload_t;
+
+typedef struct {
+  const c8* name;
+  void* (*create)();
+  void (*destroy)(void* ctx);
+  bool (*get)(void* ctx, u32 key, u64* value);
+  void (*insert)(void* ctx, u32 key, u64 value);
+} bench_backend_t;
+
+typedef struct {
+  const bench_backend_t* backend;
+  const bench_workload_t* workload;
+  void* ctx;
+  u64 rng;
+  u64 hits;
+  sp_thread_t thread;
+} bench_worker_t;
+
+static const bench_workload_t workloads [] = {
+  { .name = "read_heavy",  .read_percent = 90 },
+  { .name = "mixed",       .read_percent = 50 },
+  { .name = "write_heavy", .read_percent = 10 },
+};
+
+static const u32 thread_counts [] = { 1, 2, 4, 8 };
+
+static u64 bench_rng_next(u64* rng) {
+  u64 x = *rng;
+  x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+  *rng = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+//////////////////////////
+// ONE MUTEX, ONE SP_HT //
+//////////////////////////
+typedef struct {
+  sp_mutex_t mutex;
+  sp_ht(u32, u64) ht;
+} bench_locked_ht_t;
+
+static void* bench_locked_ht_create() {
+  bench_locked_ht_t* ctx = (bench_locked_ht_t*)sp_mem_os_alloc(sizeof(bench_locked_ht_t));
+  sp_mutex_init(&ctx->mutex, SP_MUTEX_PLAIN);
+  ctx->ht = SP_NULLPTR;
+  sp_ht_init(sp_mem_os_new(), ctx->ht);
+  return ctx;
+}
+
+static void bench_locked_ht_destroy(void* user_data) {
+  bench_locked_ht_t* ctx = (bench_locked_ht_t*)user_data;
+  sp_ht_free(ctx->ht);
+  sp_mutex_destroy(&ctx->mutex);
+  sp_mem_os_free(ctx, sizeof(bench_locked_ht_t));
+}
+
+static bool bench_locked_ht_get(void* user_data, u32 key, u64* value) {
+  bench_locked_ht_t* ctx = (bench_locked_ht_t*)user_data;
+  sp_mutex_lock(&ctx->mutex);
+  u64* found = sp_ht_getp(ctx->ht, key);
+  if (found) *value = *found;
+  sp_mutex_unlock(&ctx->mutex);
+  return found != SP_NULLPTR;
+}
+
+static void bench_locked_ht_insert(void* user_data, u32 key, u64 value) {
+  bench_locked_ht_t* ctx = (bench_locked_ht_t*)user_data;
+  sp_mutex_lock(&ctx->mutex);
+  sp_ht_insert(ctx->ht, key, value);
+  sp_mutex_unlock(&ctx->mutex);
+}
+
+////////////
+// SP_CHT //
+////////////
+typedef sp_cht(u32, u64) bench_cht_t;
+
+static void* bench_cht_create() {
+  bench_cht_t cht = SP_NULLPTR;
+  sp_cht_init(sp_mem_os_new(), cht);
+  return cht;
+}
+
+static void bench_cht_destroy(void* user_data) {
+  bench_cht_t cht = (bench_cht_t)user_data;
+  sp_cht_free(cht);
+}
+
+static bool bench_cht_get(void* user_data, u32 key, u64* value) {
+  bench_cht_t cht = (bench_cht_t)user_data;
+  return sp_cht_get(cht, &key, value);
+}
+
+static void bench_cht_insert(void* user_data, u32 key, u64 value) {
+  bench_cht_t cht = (bench_cht_t)user_data;
+  sp_cht_insert(cht, &key, &value);
+}
+
+static const bench_backend_t backends [] = {
+  {
+    .name = "mutex+sp_ht",
+    .create = bench_locked_ht_create,
+    .destroy = bench_locked_ht_destroy,
+    .get = bench_locked_ht_get,
+    .insert = bench_locked_ht_insert,
+  },
+  {
+    .name = "sp_cht",
+    .create = bench_cht_create,
+    .destroy = bench_cht_destroy,
+    .get = bench_cht_get,
+    .insert = bench_cht_insert,
+  },
+};
+
+static s32 bench_worker(void* user_data) {
+  bench_worker_t* worker = (bench_worker_t*)user_data;
+  const bench_backend_t* backend = worker->backend;
+
+  sp_for(it, BENCH_OPS_PER_THREAD) {
+    u64 r = bench_rng_next(&worker->rng);
+    u32 key = (u32)(r >> 32) & (BENCH_KEYS - 1);
+    if ((r & 0xFFFF) % 100 < worker->workload->read_percent) {
+      u64 value = 0;
+      worker->hits += backend->get(worker->ctx, key, &value);
+    }
+    else {
+      backend->insert(worker->ctx, key, r);
+    }
+  }
+
+  return 0;
+}
+
+static u64 bench_run(const bench_workload_t* workload, const bench_backend_t* backend, u32 num_threads) {
+  void* ctx = backend->create();
+  sp_for(key, BENCH_KEYS) {
+    backend->insert(ctx, key, key);
+  }
+
+  bench_worker_t workers [BENCH_MAX_THREADS];
+  sp_mem_zero(workers, sizeof(workers));
+
+  sp_tm_timer_t timer = sp_tm_start_timer();
+  sp_for(it, num_threads) {
+    workers[it].backend = backend;
+    workers[it].workload = workload;
+    workers[it].ctx = ctx;
+    workers[it].rng = 0x5EED5EED5EED5EEDULL + it;
+    sp_thread_init(&workers[it].thread, bench_worker, &workers[it]);
+  }
+  sp_for(it, num_threads) {
+    sp_thread_join(&workers[it].thread);
+  }
+  u64 elapsed = sp_tm_read_timer(&timer);
+
+  sp_for(it, num_threads) {
+    SP_ASSERT(workers[it].hits <= BENCH_OPS_PER_THREAD);
+  }
+
+  backend->destroy(ctx);
+  return elapsed / ((u64)num_threads * BENCH_OPS_PER_THREAD);
+}
+
+s32 main(s32 argc, const c8** argv) {
+  sp_str_t workload_filter = argc > 1 ? sp_str_view(argv[1]) : sp_str_lit("");
+
+  sp_carr_for(workloads, w) {
+    const bench_workload_t* workload = &workloads[w];
+    if (!sp_str_empty(workload_filter)) {
+      if (!sp_str_equal_cstr(workload_filter, workload->name)) {
+        continue;
+      }
+    }
+
+    sp_log("> {.yellow}", sp_fmt_cstr(workload->name));
+    sp_log(
+      "keys={.cyan} reads={.cyan}% ops/thread={.cyan}",
+      sp_fmt_uint(BENCH_KEYS),
+      sp_fmt_uint(workload->read_percent),
+      sp_fmt_uint(BENCH_OPS_PER_THREAD)
+    );
+
+    sp_mem_arena_marker_t scratch = sp_mem_begin_scratch();
+    sp_table_writer_t table = sp_zero;
+    sp_table_init(&table, scratch.mem);
+    sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("threads"), .align = SP_FMT_ALIGN_RIGHT });
+    sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("backend") });
+    sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("ns/op"), .align = SP_FMT_ALIGN_RIGHT });
+    sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("ns/best"), .fmt = "{:.2}x", .align = SP_FMT_ALIGN_RIGHT });
+
+    sp_carr_for(thread_counts, t) {
+      u64 ns [sp_carr_len(backends)];
+      u64 best = 0;
+      sp_carr_for(backends, b) {
+        ns[b] = bench_run(workload, &backends[b], thread_counts[t]);
+        if (!b || ns[b] < best) best = ns[b];
+      }
+
+      sp_carr_for(backends, b) {
+        sp_table_begin(&table);
+        sp_table_write_u32(&table, thread_counts[t]);
+        sp_table_write_cstr(&table, backends[b].name);
+        sp_table_write_u64(&table, ns[b]);
+        if (ns[b] == best) sp_table_color(&table, SP_ANSI_FG_GREEN);
+        sp_table_write_f64(&table, best ? (f64)ns[b] / (f64)best : 1.0);
+      }
+    }
+
+    sp_table_log(&table);
+    sp_mem_end_scratch(scratch);
+    sp_log("");
+  }
+
+  return 0;
+}
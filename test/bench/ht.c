@@ -0,0 +1,447 @@
+#include "ubench.h"
+
+#define HT_BENCH_N (1 << 16)
+
+typedef struct {
+  u32 mode;
+  sp_ht_hash_key_fn_t hash;
+  u32 stride;
+} ht_bench_t;
+
+static u32 ht_bench_keys [HT_BENCH_N];
+static u32 ht_bench_missing [HT_BENCH_N];
+
+static sp_hash_t ht_bench_identity_hash(void* key, u64 size) {
+  (void)size;
+  return *(u32*)key;
+}
+
+static void ht_bench_fill_keys(u32 stride) {
+  u64 x = 0x9E3779B97F4A7C15ull;
+  sp_for(i, HT_BENCH_N) {
+    if (stride) {
+      ht_bench_keys[i] = (u32)i * stride;
+      ht_bench_missing[i] = (u32)i * stride + 1;
+    }
+    else {
+      x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+      ht_bench_keys[i] = (u32)(x * 0x2545F4914F6CDD1DULL) & ~1u;
+      ht_bench_missing[i] = ht_bench_keys[i] | 1u;
+    }
+  }
+}
+
+#define ht_bench_init(ht, bench)                              \
+  do {                                                        \
+    sp_ht_init(sp_mem_os_new(), ht);                          \
+    if ((bench).hash) {                                       \
+      sp_ht_set_fns(ht, (bench).hash, sp_ht_on_compare_key);  \
+    }                                                         \
+    sp_ht_set_mode(ht, (bench).mode);                         \
+  } while (0)
+
+static void run_ht_lookup_bench(ubench_run_state_t* ubench_run_state, ht_bench_t bench, bool hit) {
+  ht_bench_fill_keys(bench.stride);
+
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  ht_bench_init(ht, bench);
+  sp_for(i, HT_BENCH_N) {
+    sp_ht_insert(ht, ht_bench_keys[i], (u32)i);
+  }
+
+  u32* keys = hit ? ht_bench_keys : ht_bench_missing;
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32* value = sp_ht_getp(ht, keys[it++ & (HT_BENCH_N - 1)]);
+      UBENCH_DO_NOT_OPTIMIZE(value);
+    }
+  }
+
+  sp_ht_free(ht);
+}
+
+static void run_ht_insert_bench(ubench_run_state_t* ubench_run_state, ht_bench_t bench) {
+  ht_bench_fill_keys(bench.stride);
+
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  ht_bench_init(ht, bench);
+
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32 n = it++ & (HT_BENCH_N - 1);
+      if (!n) sp_ht_clear(ht);
+      sp_ht_insert(ht, ht_bench_keys[n], n);
+    }
+  }
+
+  sp_ht_free(ht);
+}
+
+SP_HT_DEFINE(ht_bench_u32, u32, u32, key, a == b)
+
+static void run_ht_define_lookup_bench(ubench_run_state_t* ubench_run_state, bool hit) {
+  ht_bench_fill_keys(0);
+
+  ht_bench_u32_t ht = SP_NULLPTR;
+  ht_bench_u32_init(sp_mem_os_new(), &ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
+  sp_for(i, HT_BENCH_N) {
+    ht_bench_u32_insert(ht, ht_bench_keys[i], (u32)i);
+  }
+
+  u32* keys = hit ? ht_bench_keys : ht_bench_missing;
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32* value = ht_bench_u32_get(ht, keys[it++ & (HT_BENCH_N - 1)]);
+      UBENCH_DO_NOT_OPTIMIZE(value);
+    }
+  }
+
+  sp_ht_free(ht);
+}
+
+static void run_ht_define_insert_bench(ubench_run_state_t* ubench_run_state) {
+  ht_bench_fill_keys(0);
+
+  ht_bench_u32_t ht = SP_NULLPTR;
+  ht_bench_u32_init(sp_mem_os_new(), &ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
+
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32 n = it++ & (HT_BENCH_N - 1);
+      if (!n) sp_ht_clear(ht);
+      ht_bench_u32_insert(ht, ht_bench_keys[n], n);
+    }
+  }
+
+  sp_ht_free(ht);
+}
+
+// A table much larger than the cache, probed 64 keys at a time, so every probe misses
+#define HT_BENCH_LARGE_N (1 << 21)
+#define HT_BENCH_LARGE_BATCH 64
+
+static void run_ht_large_lookup_bench(ubench_run_state_t* ubench_run_state, u32 mode, bool many) {
+  u32* keys = (u32*)sp_mem_os_alloc(HT_BENCH_LARGE_N * sizeof(u32));
+  u64 x = 0x9E3779B97F4A7C15ull;
+  sp_for(i, HT_BENCH_LARGE_N) {
+    x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+    keys[i] = (u32)(x * 0x2545F4914F6CDD1DULL);
+  }
+
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  ht_bench_init(ht, ((ht_bench_t) { .mode = mode }));
+  sp_for(i, HT_BENCH_LARGE_N) {
+    sp_ht_insert(ht, keys[i], (u32)i);
+  }
+
+  u32* values [HT_BENCH_LARGE_BATCH];
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32* batch = keys + (it++ * HT_BENCH_LARGE_BATCH) % HT_BENCH_LARGE_N;
+      if (many) {
+        sp_ht_get_many(ht, batch, HT_BENCH_LARGE_BATCH, values);
+      }
+      else {
+        sp_for(i, HT_BENCH_LARGE_BATCH) {
+          values[i] = sp_ht_getp(ht, batch[i]);
+        }
+      }
+      UBENCH_DO_NOT_OPTIMIZE(values[0]);
+    }
+  }
+
+  sp_ht_free(ht);
+  sp_mem_os_free(keys, HT_BENCH_LARGE_N * sizeof(u32));
+}
+
+static void run_ht_build_bench(ubench_run_state_t* ubench_run_state, bool bulk) {
+  ht_bench_fill_keys(0);
+  static u32 values [HT_BENCH_N];
+  sp_for(i, HT_BENCH_N) values[i] = i;
+
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      sp_ht(u32, u32) ht = SP_NULLPTR;
+      if (bulk) {
+        sp_ht_from_arrays(sp_mem_os_new(), ht, ht_bench_keys, values, HT_BENCH_N);
+      }
+      else {
+        sp_ht_init(sp_mem_os_new(), ht);
+        sp_for(i, HT_BENCH_N) {
+          sp_ht_insert(ht, ht_bench_keys[i], values[i]);
+        }
+      }
+      UBENCH_DO_NOT_OPTIMIZE(ht);
+      sp_ht_free(ht);
+    }
+  }
+}
+
+static void run_ht_image_lookup_bench(ubench_run_state_t* ubench_run_state, bool hit) {
+  ht_bench_fill_keys(0);
+
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(sp_mem_os_new(), ht);
+  sp_for(i, HT_BENCH_N) {
+    sp_ht_insert(ht, ht_bench_keys[i], (u32)i);
+  }
+
+  sp_io_dyn_mem_writer_t buf;
+  sp_io_dyn_mem_writer_init(sp_mem_os_new(), &buf);
+  sp_ht_image_write(ht, &buf.base);
+  sp_str_t bytes = sp_io_dyn_mem_writer_as_str(&buf);
+  sp_ht_image_t image = sp_zero;
+  sp_ht_image_from_mem(&image, bytes.data, bytes.len);
+
+  u32* keys = hit ? ht_bench_keys : ht_bench_missing;
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      const void* value = sp_ht_image_get(&image, &keys[it++ & (HT_BENCH_N - 1)]);
+      UBENCH_DO_NOT_OPTIMIZE(value);
+    }
+  }
+
+  sp_io_dyn_mem_writer_close(&buf);
+  sp_ht_free(ht);
+}
+
+// Sum every value in a table that's had a quarter of its entries erased
+static void run_ht_iterate_bench(ubench_run_state_t* ubench_run_state, bool index_map) {
+  ht_bench_fill_keys(0);
+
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_im(u32, u32) im = SP_NULLPTR;
+  sp_ht_init(sp_mem_os_new(), ht);
+  sp_im_init(sp_mem_os_new(), im);
+  sp_for(i, HT_BENCH_N) {
+    sp_ht_insert(ht, ht_bench_keys[i], (u32)i);
+    sp_im_insert(im, ht_bench_keys[i], (u32)i);
+  }
+  for (u32 i = 0; i < HT_BENCH_N; i += 4) {
+    sp_ht_erase(ht, ht_bench_keys[i]);
+    sp_im_erase(im, ht_bench_keys[i]);
+  }
+
+  UBENCH_DO_BENCHMARK() {
+    u64 sum = 0;
+    if (index_map) {
+      sp_im_for(im, it) {
+        sum += im->values[it];
+      }
+    }
+    else {
+      sp_ht_for(ht, it) {
+        sum += *sp_ht_it_getp(ht, it);
+      }
+    }
+    UBENCH_DO_NOT_OPTIMIZE(sum);
+  }
+
+  sp_ht_free(ht);
+  sp_im_free(im);
+}
+
+static void run_im_lookup_bench(ubench_run_state_t* ubench_run_state, bool hit) {
+  ht_bench_fill_keys(0);
+
+  sp_im(u32, u32) im = SP_NULLPTR;
+  sp_im_init(sp_mem_os_new(), im);
+  sp_for(i, HT_BENCH_N) {
+    sp_im_insert(im, ht_bench_keys[i], (u32)i);
+  }
+
+  u32* keys = hit ? ht_bench_keys : ht_bench_missing;
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32* value = sp_im_getp(im, keys[it++ & (HT_BENCH_N - 1)]);
+      UBENCH_DO_NOT_OPTIMIZE(value);
+    }
+  }
+
+  sp_im_free(im);
+}
+
+typedef struct {
+  u32 key;
+  u32 value;
+} mph_bench_entry_t;
+
+static void run_mph_lookup_bench(ubench_run_state_t* ubench_run_state, bool hit) {
+  // Distinct keys, which the random ones aren't guaranteed to be
+  ht_bench_fill_keys(7);
+
+  sp_mem_t mem = sp_mem_os_new();
+  sp_mph_t mph = sp_zero;
+  SP_ASSERT(!sp_mph_build(mem, &mph, ht_bench_keys, sizeof(u32), HT_BENCH_N));
+  static mph_bench_entry_t table [HT_BENCH_N];
+  sp_for(i, HT_BENCH_N) {
+    table[sp_mph_index(&mph, &ht_bench_keys[i], sizeof(u32))] = (mph_bench_entry_t) { ht_bench_keys[i], (u32)i };
+  }
+
+  u32* keys = hit ? ht_bench_keys : ht_bench_missing;
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32 key = keys[it++ & (HT_BENCH_N - 1)];
+      mph_bench_entry_t* entry = &table[sp_mph_index(&mph, &key, sizeof(u32))];
+      u32* value = entry->key == key ? &entry->value : SP_NULLPTR;
+      UBENCH_DO_NOT_OPTIMIZE(value);
+    }
+  }
+
+  sp_mph_free(&mph);
+}
+
+static void run_bloom_lookup_bench(ubench_run_state_t* ubench_run_state, bool hit) {
+  ht_bench_fill_keys(0);
+
+  // A big table behind the filter, so misses which reach it pay for the cold probe
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(sp_mem_os_new(), ht);
+  sp_bloom_t bloom = sp_zero;
+  sp_bloom_init(sp_mem_os_new(), &bloom, HT_BENCH_N, 0.01);
+  sp_for(i, HT_BENCH_N) {
+    sp_ht_insert(ht, ht_bench_keys[i], (u32)i);
+    sp_bloom_insert(&bloom, &ht_bench_keys[i], sizeof(u32));
+  }
+
+  u32* keys = hit ? ht_bench_keys : ht_bench_missing;
+  u32 it = 0;
+  UBENCH_DO_BENCHMARK() {
+    UBENCH_LOOP {
+      u32 key = keys[it++ & (HT_BENCH_N - 1)];
+      u32* value = sp_bloom_contains(&bloom, &key, sizeof(u32)) ? sp_ht_getp(ht, key) : SP_NULLPTR;
+      UBENCH_DO_NOT_OPTIMIZE(value);
+    }
+  }
+
+  sp_bloom_free(&bloom);
+  sp_ht_free(ht);
+}
+
+UBENCH_EX(ht, lookup_hit) {
+  run_ht_lookup_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_LINEAR }, true);
+}
+
+UBENCH_EX(ht, lookup_miss) {
+  run_ht_lookup_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_LINEAR }, false);
+}
+
+UBENCH_EX(ht, lookup_hit_weak_hash) {
+  run_ht_lookup_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_LINEAR, .hash = ht_bench_identity_hash, .stride = 64 }, true);
+}
+
+UBENCH_EX(ht, insert) {
+  run_ht_insert_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_LINEAR });
+}
+
+UBENCH_EX(ht, build_incremental) {
+  run_ht_build_bench(ubench_run_state, false);
+}
+
+UBENCH_EX(ht, build_from_arrays) {
+  run_ht_build_bench(ubench_run_state, true);
+}
+
+UBENCH_EX(ht_incremental, lookup_hit) {
+  run_ht_lookup_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_INCREMENTAL }, true);
+}
+
+UBENCH_EX(ht_incremental, insert) {
+  run_ht_insert_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_INCREMENTAL });
+}
+
+UBENCH_EX(ht_swiss, lookup_hit) {
+  run_ht_lookup_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_SWISS }, true);
+}
+
+UBENCH_EX(ht_swiss, lookup_miss) {
+  run_ht_lookup_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_SWISS }, false);
+}
+
+UBENCH_EX(ht_swiss, lookup_hit_weak_hash) {
+  run_ht_lookup_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_SWISS, .hash = ht_bench_identity_hash, .stride = 64 }, true);
+}
+
+UBENCH_EX(ht_swiss, insert) {
+  run_ht_insert_bench(ubench_run_state, (ht_bench_t) { .mode = SP_HT_MODE_SWISS });
+}
+
+UBENCH_EX(ht, lookup_64_large) {
+  run_ht_large_lookup_bench(ubench_run_state, SP_HT_MODE_LINEAR, false);
+}
+
+UBENCH_EX(ht, get_many_64_large) {
+  run_ht_large_lookup_bench(ubench_run_state, SP_HT_MODE_LINEAR, true);
+}
+
+UBENCH_EX(ht_swiss, lookup_64_large) {
+  run_ht_large_lookup_bench(ubench_run_state, SP_HT_MODE_SWISS, false);
+}
+
+UBENCH_EX(ht_swiss, get_many_64_large) {
+  run_ht_large_lookup_bench(ubench_run_state, SP_HT_MODE_SWISS, true);
+}
+
+UBENCH_EX(ht_define, lookup_hit) {
+  run_ht_define_lookup_bench(ubench_run_state, true);
+}
+
+UBENCH_EX(ht_define, lookup_miss) {
+  run_ht_define_lookup_bench(ubench_run_state, false);
+}
+
+UBENCH_EX(ht_define, insert) {
+  run_ht_define_insert_bench(ubench_run_state);
+}
+
+UBENCH_EX(ht_image, lookup_hit) {
+  run_ht_image_lookup_bench(ubench_run_state, true);
+}
+
+UBENCH_EX(ht_image, lookup_miss) {
+  run_ht_image_lookup_bench(ubench_run_state, false);
+}
+
+UBENCH_EX(ht, iterate) {
+  run_ht_iterate_bench(ubench_run_state, false);
+}
+
+UBENCH_EX(im, iterate) {
+  run_ht_iterate_bench(ubench_run_state, true);
+}
+
+UBENCH_EX(im, lookup_hit) {
+  run_im_lookup_bench(ubench_run_state, true);
+}
+
+UBENCH_EX(im, lookup_miss) {
+  run_im_lookup_bench(ubench_run_state, false);
+}
+
+UBENCH_EX(mph, lookup_hit) {
+  run_mph_lookup_bench(ubench_run_state, true);
+}
+
+UBENCH_EX(mph, lookup_miss) {
+  run_mph_lookup_bench(ubench_run_state, false);
+}
+
+UBENCH_EX(bloom_ht, lookup_hit) {
+  run_bloom_lookup_bench(ubench_run_state, true);
+}
+
+UBENCH_EX(bloom_ht, lookup_miss) {
+  run_bloom_lookup_bench(ubench_run_state, false);
+}
+
+UBENCH_MAIN()
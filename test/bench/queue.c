@@ -0,0 +1,355 @@
+#include "sp.h"
+
+#define SP_TABLE_IMPLEMENTATION
+#include "table.h"
+
+#define BENCH_ITEMS (1 << 22)
+#define BENCH_CAPACITY 1024
+#define BENCH_BATCH 32
+#define BENCH_MAX_THREADS 8
+
+typedef struct {
+  u32 producers;
+  u32 consumers;
+} bench_config_t;
+
+typedef struct {
+  const c8* name;
+  u32 batch;
+  u32 max_producers;
+  u32 max_consumers;
+  void* (*create)();
+  void (*destroy)(void* ctx);
+  u32 (*push)(void* ctx, const u64* items, u32 n);
+  u32 (*pop)(void* ctx, u64* items, u32 n);
+} bench_backend_t;
+
+typedef struct {
+  const bench_backend_t* backend;
+  void* ctx;
+  u64 first;
+  u64 count;
+  u64 sum;
+  sp_thread_t thread;
+} bench_worker_t;
+
+static const bench_config_t configs [] = {
+  { .producers = 1, .consumers = 1 },
+  { .producers = 4, .consumers = 1 },
+  { .producers = 1, .consumers = 4 },
+  { .producers = 4, .consumers = 4 },
+  { .producers = 8, .consumers = 8 },
+};
+
+//////////////////////////////
+// ONE MUTEX, BOUNDED SP_RB //
+//////////////////////////////
+typedef struct {
+  sp_mutex_t mutex;
+  sp_rb(u64) rb;
+} bench_locked_rb_t;
+
+static void* bench_locked_rb_create() {
+  bench_locked_rb_t* ctx = (bench_locked_rb_t*)sp_mem_os_alloc(sizeof(bench_locked_rb_t));
+  sp_mutex_init(&ctx->mutex, SP_MUTEX_PLAIN);
+  ctx->rb = SP_NULLPTR;
+  sp_rb_init_cap(sp_mem_os_new(), ctx->rb, BENCH_CAPACITY);
+  return ctx;
+}
+
+static void bench_locked_rb_destroy(void* user_data) {
+  bench_locked_rb_t* ctx = (bench_locked_rb_t*)user_data;
+  sp_rb_free(ctx->rb);
+  sp_mutex_destroy(&ctx->mutex);
+  sp_mem_os_free(ctx, sizeof(bench_locked_rb_t));
+}
+
+static u32 bench_locked_rb_push(void* user_data, const u64* items, u32 n) {
+  bench_locked_rb_t* ctx = (bench_locked_rb_t*)user_data;
+  u32 pushed = 0;
+  sp_mutex_lock(&ctx->mutex);
+  while (pushed < n && !sp_rb_full(ctx->rb)) {
+    sp_rb_push(ctx->rb, items[pushed++]);
+  }
+  sp_mutex_unlock(&ctx->mutex);
+  return pushed;
+}
+
+static u32 bench_locked_rb_pop(void* user_data, u64* items, u32 n) {
+  bench_locked_rb_t* ctx = (bench_locked_rb_t*)user_data;
+  u32 popped = 0;
+  sp_mutex_lock(&ctx->mutex);
+  while (popped < n && !sp_rb_empty(ctx->rb)) {
+    items[popped++] = *sp_rb_peek(ctx->rb);
+    sp_rb_pop(ctx->rb);
+  }
+  sp_mutex_unlock(&ctx->mutex);
+  return popped;
+}
+
+/////////////
+// SP_SPSC //
+/////////////
+static void* bench_spsc_create() {
+  sp_spsc_t* queue = (sp_spsc_t*)sp_mem_os_alloc(sizeof(sp_spsc_t));
+  sp_spsc_init(sp_mem_os_new(), queue, sizeof(u64), BENCH_CAPACITY);
+  return queue;
+}
+
+static void bench_spsc_destroy(void* user_data) {
+  sp_spsc_t* queue = (sp_spsc_t*)user_data;
+  sp_spsc_free(queue);
+  sp_mem_os_free(queue, sizeof(sp_spsc_t));
+}
+
+static u32 bench_spsc_push(void* user_data, const u64* items, u32 n) {
+  return sp_spsc_push_n((sp_spsc_t*)user_data, items, n);
+}
+
+static u32 bench_spsc_pop(void* user_data, u64* items, u32 n) {
+  return sp_spsc_pop_n((sp_spsc_t*)user_data, items, n);
+}
+
+/////////////
+// SP_MPMC //
+/////////////
+static void* bench_mpmc_spin_create() {
+  sp_mpmc_t* queue = (sp_mpmc_t*)sp_mem_os_alloc(sizeof(sp_mpmc_t));
+  sp_mpmc_init(sp_mem_os_new(), queue, sizeof(u64), BENCH_CAPACITY, SP_MPMC_WAIT_SPIN);
+  return queue;
+}
+
+static void* bench_mpmc_semaphore_create() {
+  sp_mpmc_t* queue = (sp_mpmc_t*)sp_mem_os_alloc(sizeof(sp_mpmc_t));
+  sp_mpmc_init(sp_mem_os_new(), queue, sizeof(u64), BENCH_CAPACITY, SP_MPMC_WAIT_SEMAPHORE);
+  return queue;
+}
+
+static void bench_mpmc_destroy(void* user_data) {
+  sp_mpmc_t* queue = (sp_mpmc_t*)user_data;
+  sp_mpmc_free(queue);
+  sp_mem_os_free(queue, sizeof(sp_mpmc_t));
+}
+
+static u32 bench_mpmc_try_push(void* user_data, const u64* items, u32 n) {
+  (void)n;
+  return sp_mpmc_try_push((sp_mpmc_t*)user_data, items);
+}
+
+static u32 bench_mpmc_try_pop(void* user_data, u64* items, u32 n) {
+  (void)n;
+  return sp_mpmc_try_pop((sp_mpmc_t*)user_data, items);
+}
+
+static u32 bench_mpmc_push(void* user_data, const u64* items, u32 n) {
+  (void)n;
+  sp_mpmc_push((sp_mpmc_t*)user_data, items);
+  return 1;
+}
+
+static u32 bench_mpmc_pop(void* user_data, u64* items, u32 n) {
+  (void)n;
+  sp_mpmc_pop((sp_mpmc_t*)user_data, items);
+  return 1;
+}
+
+static const bench_backend_t backends [] = {
+  {
+    .name = "mutex+sp_rb",
+    .batch = 1,
+    .max_producers = BENCH_MAX_THREADS,
+    .max_consumers = BENCH_MAX_THREADS,
+    .create = bench_locked_rb_create,
+    .destroy = bench_locked_rb_destroy,
+    .push = bench_locked_rb_push,
+    .pop = bench_locked_rb_pop,
+  },
+  {
+    .name = "mutex+sp_rb (batch)",
+    .batch = BENCH_BATCH,
+    .max_producers = BENCH_MAX_THREADS,
+    .max_consumers = BENCH_MAX_THREADS,
+    .create = bench_locked_rb_create,
+    .destroy = bench_locked_rb_destroy,
+    .push = bench_locked_rb_push,
+    .pop = bench_locked_rb_pop,
+  },
+  {
+    .name = "sp_spsc",
+    .batch = 1,
+    .max_producers = 1,
+    .max_consumers = 1,
+    .create = bench_spsc_create,
+    .destroy = bench_spsc_destroy,
+    .push = bench_spsc_push,
+    .pop = bench_spsc_pop,
+  },
+  {
+    .name = "sp_spsc (batch)",
+    .batch = BENCH_BATCH,
+    .max_producers = 1,
+    .max_consumers = 1,
+    .create = bench_spsc_create,
+    .destroy = bench_spsc_destroy,
+    .push = bench_spsc_push,
+    .pop = bench_spsc_pop,
+  },
+  {
+    .name = "sp_mpmc",
+    .batch = 1,
+    .max_producers = BENCH_MAX_THREADS,
+    .max_consumers = BENCH_MAX_THREADS,
+    .create = bench_mpmc_spin_create,
+    .destroy = bench_mpmc_destroy,
+    .push = bench_mpmc_try_push,
+    .pop = bench_mpmc_try_pop,
+  },
+  {
+    .name = "sp_mpmc (semaphore)",
+    .batch = 1,
+    .max_producers = BENCH_MAX_THREADS,
+    .max_consumers = BENCH_MAX_THREADS,
+    .create = bench_mpmc_semaphore_create,
+    .destroy = bench_mpmc_destroy,
+    .push = bench_mpmc_push,
+    .pop = bench_mpmc_pop,
+  },
+};
+
+// A full or empty queue means the other side is behind; give it the core rather than spinning
+// through the rest of our timeslice, which matters a great deal with fewer cores than threads
+static void bench_backoff() {
+  sp_os_sleep_ns(0);
+}
+
+static s32 bench_producer(void* user_data) {
+  bench_worker_t* worker = (bench_worker_t*)user_data;
+  const bench_backend_t* backend = worker->backend;
+
+  u64 items [BENCH_BATCH];
+  u64 next = worker->first;
+  u64 end = worker->first + worker->count;
+  while (next < end) {
+    u32 n = (u32)sp_min((u64)backend->batch, end - next);
+    sp_for(it, n) items[it] = next + it;
+
+    u32 pushed = 0;
+    while (pushed < n) {
+      u32 count = backend->push(worker->ctx, items + pushed, n - pushed);
+      if (!count) bench_backoff();
+      pushed += count;
+    }
+    next += n;
+  }
+
+  return 0;
+}
+
+static s32 bench_consumer(void* user_data) {
+  bench_worker_t* worker = (bench_worker_t*)user_data;
+  const bench_backend_t* backend = worker->backend;
+
+  u64 items [BENCH_BATCH];
+  u64 remaining = worker->count;
+  while (remaining) {
+    u32 n = (u32)sp_min((u64)backend->batch, remaining);
+    n = backend->pop(worker->ctx, items, n);
+    if (!n) bench_backoff();
+    sp_for(it, n) worker->sum += items[it];
+    remaining -= n;
+  }
+
+  return 0;
+}
+
+static f64 bench_run(const bench_config_t* config, const bench_backend_t* backend) {
+  void* ctx = backend->create();
+
+  bench_worker_t producers [BENCH_MAX_THREADS];
+  bench_worker_t consumers [BENCH_MAX_THREADS];
+  sp_mem_zero(producers, sizeof(producers));
+  sp_mem_zero(consumers, sizeof(consumers));
+
+  sp_tm_timer_t timer = sp_tm_start_timer();
+  sp_for(it, config->consumers) {
+    consumers[it].backend = backend;
+    consumers[it].ctx = ctx;
+    consumers[it].count = BENCH_ITEMS / config->consumers;
+    sp_thread_init(&consumers[it].thread, bench_consumer, &consumers[it]);
+  }
+  sp_for(it, config->producers) {
+    producers[it].backend = backend;
+    producers[it].ctx = ctx;
+    producers[it].count = BENCH_ITEMS / config->producers;
+    producers[it].first = it * producers[it].count;
+    sp_thread_init(&producers[it].thread, bench_producer, &producers[it]);
+  }
+  sp_for(it, config->producers) {
+    sp_thread_join(&producers[it].thread);
+  }
+  sp_for(it, config->consumers) {
+    sp_thread_join(&consumers[it].thread);
+  }
+  u64 elapsed = sp_tm_read_timer(&timer);
+
+  u64 sum = 0;
+  sp_for(it, config->consumers) {
+    sum += consumers[it].sum;
+  }
+  SP_ASSERT(sum == (u64)BENCH_ITEMS * (BENCH_ITEMS - 1) / 2);
+
+  backend->destroy(ctx);
+  return (f64)elapsed / BENCH_ITEMS;
+}
+
+s32 main() {
+  sp_log(
+    "items={.cyan} capacity={.cyan} batch={.cyan}",
+    sp_fmt_uint(BENCH_ITEMS),
+    sp_fmt_uint(BENCH_CAPACITY),
+    sp_fmt_uint(BENCH_BATCH)
+  );
+
+  sp_mem_arena_marker_t scratch = sp_mem_begin_scratch();
+  sp_table_writer_t table = sp_zero;
+  sp_table_init(&table, scratch.mem);
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("producers"), .align = SP_FMT_ALIGN_RIGHT });
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("consumers"), .align = SP_FMT_ALIGN_RIGHT });
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("backend") });
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("ns/item"), .fmt = "{:.2}", .align = SP_FMT_ALIGN_RIGHT });
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("ns/best"), .fmt = "{:.2}x", .align = SP_FMT_ALIGN_RIGHT });
+
+  sp_carr_for(configs, c) {
+    const bench_config_t* config = &configs[c];
+
+    f64 ns [sp_carr_len(backends)];
+    f64 best = 0;
+    bool first = true;
+    sp_carr_for(backends, b) {
+      ns[b] = 0;
+      if (config->producers > backends[b].max_producers) continue;
+      if (config->consumers > backends[b].max_consumers) continue;
+
+      ns[b] = bench_run(config, &backends[b]);
+      if (first || ns[b] < best) best = ns[b];
+      first = false;
+    }
+
+    sp_carr_for(backends, b) {
+      if (config->producers > backends[b].max_producers) continue;
+      if (config->consumers > backends[b].max_consumers) continue;
+
+      sp_table_begin(&table);
+      sp_table_write_u32(&table, config->producers);
+      sp_table_write_u32(&table, config->consumers);
+      sp_table_write_cstr(&table, backends[b].name);
+      sp_table_write_f64(&table, ns[b]);
+      if (ns[b] == best) sp_table_color(&table, SP_ANSI_FG_GREEN);
+      sp_table_write_f64(&table, best > 0 ? ns[b] / best : 1.0);
+    }
+  }
+
+  sp_table_log(&table);
+  sp_mem_end_scratch(scratch);
+  return 0;
+}
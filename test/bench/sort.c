@@ -0,0 +1,199 @@
+#include "sp.h"
+
+#include <stdlib.h>
+
+#define SP_TABLE_IMPLEMENTATION
+#include "table.h"
+
+#define BENCH_ITEMS (1 << 20)
+
+typedef enum {
+  BENCH_KEY_U32,
+  BENCH_KEY_F64,
+  BENCH_KEY_RECORD,
+} bench_key_t;
+
+typedef enum {
+  BENCH_PATTERN_RANDOM,
+  BENCH_PATTERN_SORTED,
+  BENCH_PATTERN_REVERSED,
+  BENCH_PATTERN_FEW_UNIQUE,
+} bench_pattern_t;
+
+typedef struct {
+  u64 key;
+  u64 payload [3];
+} bench_record_t;
+
+typedef struct {
+  const c8* name;
+  bench_key_t key;
+  bench_pattern_t pattern;
+} bench_workload_t;
+
+typedef struct {
+  const c8* name;
+  void (*sort)(bench_key_t key, void* data, u64 n);
+} bench_backend_t;
+
+static const bench_workload_t workloads [] = {
+  { .name = "u32 random",        .key = BENCH_KEY_U32,    .pattern = BENCH_PATTERN_RANDOM },
+  { .name = "u32 sorted",        .key = BENCH_KEY_U32,    .pattern = BENCH_PATTERN_SORTED },
+  { .name = "u32 reversed",      .key = BENCH_KEY_U32,    .pattern = BENCH_PATTERN_REVERSED },
+  { .name = "u32 few unique",    .key = BENCH_KEY_U32,    .pattern = BENCH_PATTERN_FEW_UNIQUE },
+  { .name = "f64 random",        .key = BENCH_KEY_F64,    .pattern = BENCH_PATTERN_RANDOM },
+  { .name = "32B record random", .key = BENCH_KEY_RECORD, .pattern = BENCH_PATTERN_RANDOM },
+};
+
+static u64 bench_rng_next(u64* rng) {
+  u64 x = *rng;
+  x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+  *rng = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+static u64 bench_stride(bench_key_t key) {
+  switch (key) {
+    case BENCH_KEY_U32:    return sizeof(u32);
+    case BENCH_KEY_F64:    return sizeof(f64);
+    case BENCH_KEY_RECORD: return sizeof(bench_record_t);
+  }
+  return 0;
+}
+
+static void bench_fill(const bench_workload_t* workload, void* data, u64 n) {
+  u64 rng = 0x5EED5EED5EED5EEDULL;
+  for (u64 it = 0; it < n; it++) {
+    u64 r = bench_rng_next(&rng);
+    switch (workload->pattern) {
+      case BENCH_PATTERN_RANDOM:     break;
+      case BENCH_PATTERN_SORTED:     r = it; break;
+      case BENCH_PATTERN_REVERSED:   r = n - it; break;
+      case BENCH_PATTERN_FEW_UNIQUE: r %= 16; break;
+    }
+
+    switch (workload->key) {
+      case BENCH_KEY_U32:    ((u32*)data)[it] = (u32)r; break;
+      case BENCH_KEY_F64:    ((f64*)data)[it] = (f64)(s64)r / 1e9; break;
+      case BENCH_KEY_RECORD: ((bench_record_t*)data)[it] = (bench_record_t) { .key = r, .payload = { it } }; break;
+    }
+  }
+}
+
+static bool bench_is_sorted(bench_key_t key, void* data, u64 n) {
+  for (u64 it = 1; it < n; it++) {
+    switch (key) {
+      case BENCH_KEY_U32:    if (((u32*)data)[it - 1] > ((u32*)data)[it]) return false; break;
+      case BENCH_KEY_F64:    if (((f64*)data)[it - 1] > ((f64*)data)[it]) return false; break;
+      case BENCH_KEY_RECORD: if (((bench_record_t*)data)[it - 1].key > ((bench_record_t*)data)[it].key) return false; break;
+    }
+  }
+  return true;
+}
+
+static s32 bench_cmp_u32(const void* a, const void* b) {
+  u32 x = *(const u32*)a, y = *(const u32*)b;
+  return x < y ? -1 : x > y;
+}
+
+static s32 bench_cmp_f64(const void* a, const void* b) {
+  f64 x = *(const f64*)a, y = *(const f64*)b;
+  return x < y ? -1 : x > y;
+}
+
+static s32 bench_cmp_record(const void* a, const void* b) {
+  u64 x = ((const bench_record_t*)a)->key, y = ((const bench_record_t*)b)->key;
+  return x < y ? -1 : x > y;
+}
+
+static sp_qsort_fn_t bench_cmp(bench_key_t key) {
+  switch (key) {
+    case BENCH_KEY_U32:    return bench_cmp_u32;
+    case BENCH_KEY_F64:    return bench_cmp_f64;
+    case BENCH_KEY_RECORD: return bench_cmp_record;
+  }
+  return SP_NULLPTR;
+}
+
+//////////////
+// BACKENDS //
+//////////////
+static void bench_libc_qsort(bench_key_t key, void* data, u64 n) {
+  qsort(data, n, bench_stride(key), bench_cmp(key));
+}
+
+static void bench_sp_sort(bench_key_t key, void* data, u64 n) {
+  sp_sort(data, n, bench_stride(key), bench_cmp(key));
+}
+
+static void bench_sp_sort_by(bench_key_t key, void* data, u64 n) {
+  switch (key) {
+    case BENCH_KEY_U32:    sp_sort_by((u32*)data, n, u32, a, b, *a < *b); break;
+    case BENCH_KEY_F64:    sp_sort_by((f64*)data, n, f64, a, b, *a < *b); break;
+    case BENCH_KEY_RECORD: sp_sort_by((bench_record_t*)data, n, bench_record_t, a, b, a->key < b->key); break;
+  }
+}
+
+static void bench_sp_radix_sort(bench_key_t key, void* data, u64 n) {
+  switch (key) {
+    case BENCH_KEY_U32:    sp_radix_sort_u32(sp_mem_os_new(), data, n); break;
+    case BENCH_KEY_F64:    sp_radix_sort_f64(sp_mem_os_new(), data, n); break;
+    case BENCH_KEY_RECORD: sp_radix_sort_ex(sp_mem_os_new(), data, n, sizeof(bench_record_t), 0, SP_RADIX_KEY_U64); break;
+  }
+}
+
+static const bench_backend_t backends [] = {
+  { .name = "qsort",         .sort = bench_libc_qsort },
+  { .name = "sp_sort",       .sort = bench_sp_sort },
+  { .name = "sp_sort_by",    .sort = bench_sp_sort_by },
+  { .name = "sp_radix_sort", .sort = bench_sp_radix_sort },
+};
+
+static f64 bench_run(const bench_workload_t* workload, const bench_backend_t* backend, void* data) {
+  bench_fill(workload, data, BENCH_ITEMS);
+
+  sp_tm_timer_t timer = sp_tm_start_timer();
+  backend->sort(workload->key, data, BENCH_ITEMS);
+  u64 elapsed = sp_tm_read_timer(&timer);
+
+  SP_ASSERT(bench_is_sorted(workload->key, data, BENCH_ITEMS));
+  return (f64)elapsed / BENCH_ITEMS;
+}
+
+s32 main() {
+  sp_log("items={.cyan}", sp_fmt_uint(BENCH_ITEMS));
+
+  u64 size = BENCH_ITEMS * sizeof(bench_record_t);
+  void* data = sp_mem_os_alloc(size);
+
+  sp_mem_arena_marker_t scratch = sp_mem_begin_scratch();
+  sp_table_writer_t table = sp_zero;
+  sp_table_init(&table, scratch.mem);
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("workload") });
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("backend") });
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("ns/item"), .fmt = "{:.2}", .align = SP_FMT_ALIGN_RIGHT });
+  sp_table_add_col(&table, (sp_table_col_t) { .header = sp_str_lit("ns/best"), .fmt = "{:.2}x", .align = SP_FMT_ALIGN_RIGHT });
+
+  sp_carr_for(workloads, w) {
+    f64 ns [sp_carr_len(backends)];
+    f64 best = 0;
+    sp_carr_for(backends, b) {
+      ns[b] = bench_run(&workloads[w], &backends[b], data);
+      if (!b || ns[b] < best) best = ns[b];
+    }
+
+    sp_carr_for(backends, b) {
+      sp_table_begin(&table);
+      sp_table_write_cstr(&table, workloads[w].name);
+      sp_table_write_cstr(&table, backends[b].name);
+      sp_table_write_f64(&table, ns[b]);
+      if (ns[b] == best) sp_table_color(&table, SP_ANSI_FG_GREEN);
+      sp_table_write_f64(&table, best > 0 ? ns[b] / best : 1.0);
+    }
+  }
+
+  sp_table_log(&table);
+  sp_mem_end_scratch(scratch);
+  sp_mem_os_free(data, size);
+  return 0;
+}
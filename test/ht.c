@@ -329,9 +329,9 @@ UTEST_F(sp_ht, collision) {
   s32 num_found = 0;
 
   for (u32 candidate = 0; candidate < 1000; candidate++) {
-    sp_hash_t hash = sp_hash_bytes(&candidate, sizeof(candidate), SP_HT_HASH_SEED);
+    sp_hash_t hash = ht->info.fn.hash(&candidate, sizeof(candidate));
 
-    u64 bucket = hash % capacity;
+    u64 bucket = sp_ht_home(hash, capacity);
     if (bucket == 0) {
       keys[num_found++] = candidate;
     }
@@ -606,6 +606,158 @@ UTEST_F(siphash, collision_resistance) {
   sp_free(ut.mem, hashes, count * sizeof(u64));
 }
 
+UTEST(sp_hash_fast, consistency) {
+  const c8* data = "Hello, World!";
+  u64 seed = 0x12345678;
+
+  EXPECT_EQ(sp_hash_fast(data, sp_cstr_len(data), seed), sp_hash_fast(data, sp_cstr_len(data), seed));
+  EXPECT_NE(sp_hash_fast(data, sp_cstr_len(data), seed), sp_hash_fast(data, sp_cstr_len(data), seed + 1));
+  EXPECT_NE(sp_hash_fast(data, sp_cstr_len(data), seed), sp_hash_bytes(data, sp_cstr_len(data), seed));
+}
+
+UTEST(sp_hash_fast, every_length_and_bit) {
+  // Cover each of the short key paths and the bulk loop, flipping every bit of every length
+  u8 data [130] = sp_zero;
+  for (u32 i = 0; i < sizeof(data); i++) data[i] = (u8)(i * 31 + 7);
+
+  sp_hash_t hashes [130] = sp_zero;
+  for (u32 len = 0; len < sizeof(data); len++) {
+    hashes[len] = sp_hash_fast(data, len, SP_HT_HASH_SEED);
+    for (u32 j = 0; j < len; j++) {
+      EXPECT_NE(hashes[len], hashes[j]);
+    }
+
+    for (u32 bit = 0; bit < len * 8; bit++) {
+      data[bit / 8] ^= (u8)(1 << (bit % 8));
+      sp_hash_t flipped = sp_hash_fast(data, len, SP_HT_HASH_SEED);
+      data[bit / 8] ^= (u8)(1 << (bit % 8));
+      EXPECT_NE(flipped, hashes[len]);
+    }
+  }
+}
+
+UTEST(sp_hash_fast, collision_resistance) {
+  const s32 count = 1000;
+  sp_hash_t hashes [1000];
+  for (s32 i = 0; i < count; i++) {
+    hashes[i] = sp_hash_fast(&i, sizeof(i), SP_HT_HASH_SEED);
+  }
+
+  s32 collisions = 0;
+  for (s32 i = 0; i < count; i++) {
+    for (s32 j = i + 1; j < count; j++) {
+      if (hashes[i] == hashes[j]) collisions++;
+    }
+  }
+  EXPECT_EQ(collisions, 0);
+}
+
+UTEST(sp_hasher, matches_sp_hash_bytes_however_the_input_is_split) {
+  u8 data [100];
+  sp_for(i, sizeof(data)) data[i] = (u8)(i * 37 + 11);
+
+  for (u32 len = 0; len <= sizeof(data); len++) {
+    sp_hash_t expected = sp_hash_bytes(data, len, 0x1234);
+
+    for (u32 split = 1; split <= 17; split++) {
+      sp_hasher_t hasher;
+      sp_hasher_init(&hasher, 0x1234);
+      for (u32 offset = 0; offset < len; offset += split) {
+        sp_hasher_update(&hasher, data + offset, sp_min(split, len - offset));
+      }
+      EXPECT_EQ(sp_hasher_final(&hasher), expected);
+    }
+  }
+}
+
+UTEST(sp_hasher, fields_are_length_prefixed) {
+  sp_hasher_t a, b;
+  sp_hasher_init(&a, 0);
+  sp_hasher_update_str(&a, sp_str_lit("ab"));
+  sp_hasher_update_str(&a, sp_str_lit("c"));
+  sp_hasher_init(&b, 0);
+  sp_hasher_update_str(&b, sp_str_lit("a"));
+  sp_hasher_update_str(&b, sp_str_lit("bc"));
+  EXPECT_NE(sp_hasher_final(&a), sp_hasher_final(&b));
+
+  sp_hasher_init(&a, 0);
+  sp_hasher_update_u64(&a, 69);
+  EXPECT_EQ(sp_hasher_final(&a), sp_hash_bytes("\x45\0\0\0\0\0\0\0", 8, 0));
+}
+
+UTEST_F(siphash, streaming_through_io) {
+  SKIP_ON_WASM()
+  sp_test_file_manager_t files;
+  sp_test_file_manager_init(&files);
+  sp_str_t path = sp_test_file_path_c(&files, "hashed.txt");
+
+  // Hash bytes on their way into a file, and into nothing at all
+  sp_io_file_writer_t file = sp_zero;
+  ASSERT_EQ(sp_io_file_writer_from_path(&file, path), SP_OK);
+  sp_io_hash_writer_t tee, sink;
+  sp_io_hash_writer_init(&tee, &file.base, 7);
+  sp_io_hash_writer_init(&sink, SP_NULLPTR, 7);
+
+  sp_io_dyn_mem_writer_t expected;
+  sp_io_dyn_mem_writer_init(ut.mem, &expected);
+  sp_for(i, 2000) {
+    sp_str_t line = sp_fmt(files.mem, "line {}\n", sp_fmt_uint(i)).value;
+    ASSERT_EQ(sp_io_write_str(&tee.base, line, SP_NULLPTR), SP_OK);
+    ASSERT_EQ(sp_io_write_str(&sink.base, line, SP_NULLPTR), SP_OK);
+    ASSERT_EQ(sp_io_write_str(&expected.base, line, SP_NULLPTR), SP_OK);
+  }
+
+  sp_str_t content = sp_io_dyn_mem_writer_as_str(&expected);
+  sp_hash_t hash = sp_hash_bytes(content.data, content.len, 7);
+  EXPECT_EQ(sp_io_hash_writer_final(&tee), hash);
+  EXPECT_EQ(sp_io_hash_writer_final(&sink), hash);
+  ASSERT_EQ(sp_io_file_writer_close(&file), SP_OK);
+
+  // Read it back in chunks
+  sp_hash_t from_file = 0;
+  ASSERT_EQ(sp_io_hash_file(path, 7, &from_file), SP_OK);
+  EXPECT_EQ(from_file, hash);
+
+  sp_io_reader_t reader;
+  sp_io_reader_from_mem(&reader, content.data, content.len);
+  sp_hasher_t hasher;
+  sp_hasher_init(&hasher, 7);
+  u64 bytes_read = 0;
+  ASSERT_EQ(sp_hasher_read(&hasher, &reader, &bytes_read), SP_OK);
+  EXPECT_EQ(bytes_read, content.len);
+  EXPECT_EQ(sp_hasher_final(&hasher), hash);
+
+  EXPECT_NE(sp_io_hash_file(sp_test_file_path_c(&files, "missing.txt"), 7, &from_file), SP_OK);
+
+  sp_io_dyn_mem_writer_close(&expected);
+  sp_test_file_manager_cleanup(&files);
+}
+
+UTEST_F(sp_ht, set_hash_sip) {
+  sp_mem_arena_marker_t s = sp_mem_begin_scratch();
+
+  sp_str_ht(s32) ht = SP_NULLPTR;
+  sp_str_ht_init(ut.mem, ht);
+
+  for (s32 i = 0; i < 64; i++) {
+    sp_str_ht_insert(ht, sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value, i);
+  }
+
+  // Switching the hash function of a populated table rehashes the existing entries
+  sp_ht_set_hash(ht, sp_ht_on_hash_str_key_sip);
+  EXPECT_EQ(ht->info.fn.hash, sp_ht_on_hash_str_key_sip);
+  EXPECT_EQ(sp_str_ht_size(ht), 64u);
+
+  for (s32 i = 0; i < 64; i++) {
+    s32* value = sp_str_ht_get(ht, sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value);
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, i);
+  }
+
+  sp_str_ht_free(ht);
+  sp_mem_end_scratch(s);
+}
+
 UTEST_F(sp_ht, hash_table_with_dyn_array_values) {
     typedef int* int_array;
     sp_ht(int, int_array) ht = SP_NULLPTR;
@@ -895,14 +1047,22 @@ UTEST_F(sp_ht, issue_rehash_breaks_lookups_after_resize) {
   sp_ht(s32, s32) ht = SP_NULLPTR;
   sp_ht_init(ut.mem, ht);
   sp_ht_set_fns(ht, sp_test_identity_hash, cmp_s32);
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
 
   sp_ht_insert(ht, 1, 0);
   u64 initial_capacity = sp_ht_capacity(ht);
 
-  s32 ka = (s32)initial_capacity;
+  // Find a key whose home slot doesn't collide with 1 and changes when the table grows
+  u64 grown_capacity = initial_capacity * 2;
+  s32 ka = 2;
+  while (sp_ht_home((sp_hash_t)ka, initial_capacity) == sp_ht_home(1, initial_capacity) ||
+         sp_ht_home((sp_hash_t)ka, grown_capacity) == sp_ht_home(1, grown_capacity) ||
+         sp_ht_home((sp_hash_t)ka, grown_capacity) == sp_ht_home((sp_hash_t)ka, initial_capacity)) {
+    ka++;
+  }
   sp_ht_insert(ht, ka, 2000);
 
-  u64 slot_before_resize = (u64)ka % initial_capacity;
+  u64 slot_before_resize = sp_ht_home((sp_hash_t)ka, initial_capacity);
   EXPECT_EQ(ht->data[slot_before_resize].key, ka);
 
   for (s32 i = 10000; sp_ht_capacity(ht) == initial_capacity; i++) {
@@ -910,7 +1070,8 @@ UTEST_F(sp_ht, issue_rehash_breaks_lookups_after_resize) {
   }
   EXPECT_GT(sp_ht_capacity(ht), initial_capacity);
 
-  u64 slot_after_resize = (u64)ka % sp_ht_capacity(ht);
+  EXPECT_EQ(sp_ht_capacity(ht), grown_capacity);
+  u64 slot_after_resize = sp_ht_home((sp_hash_t)ka, sp_ht_capacity(ht));
   EXPECT_NE(slot_before_resize, slot_after_resize);
 
   EXPECT_NE(ht->data[slot_before_resize].key, ka);
@@ -995,3 +1156,1568 @@ UTEST_F(sp_ht, issue_insert_evaluates_args_multiple_times) {
 
   sp_ht_free(ht);
 }
+
+static sp_hash_t sp_test_constant_hash(void* key, u64 size) {
+  (void)key; (void)size;
+  return 0x1234;
+}
+
+UTEST_F(sp_ht, swiss_basic) {
+  sp_ht(s32, s32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_SWISS);
+  EXPECT_NE(ht->ctrl, SP_NULLPTR);
+  EXPECT_GE(sp_ht_capacity(ht), (u64)SP_HT_GROUP_WIDTH);
+
+  for (s32 i = 0; i < 1000; i++) {
+    sp_ht_insert(ht, i, i * 2);
+  }
+  EXPECT_EQ(sp_ht_size(ht), 1000u);
+
+  for (s32 i = 0; i < 1000; i++) {
+    s32* value = sp_ht_getp(ht, i);
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, i * 2);
+  }
+  EXPECT_FALSE(sp_ht_getp(ht, 1000));
+  EXPECT_FALSE(sp_ht_getp(ht, -1));
+
+  for (s32 i = 0; i < 1000; i += 2) {
+    sp_ht_erase(ht, i);
+  }
+  EXPECT_EQ(sp_ht_size(ht), 500u);
+
+  for (s32 i = 0; i < 1000; i++) {
+    EXPECT_EQ(sp_ht_getp(ht, i) != SP_NULLPTR, i % 2 == 1);
+  }
+
+  u32 count = 0;
+  sp_ht_for(ht, it) {
+    EXPECT_EQ(*sp_ht_it_getkp(ht, it) % 2, 1);
+    count++;
+  }
+  EXPECT_EQ(count, 500u);
+
+  sp_ht_clear(ht);
+  EXPECT_EQ(sp_ht_size(ht), 0u);
+  EXPECT_FALSE(sp_ht_getp(ht, 1));
+  sp_ht_insert(ht, 7, 7);
+  EXPECT_EQ(*sp_ht_getp(ht, 7), 7);
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, swiss_set_mode_preserves_entries) {
+  sp_ht(s32, s32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+
+  for (s32 i = 0; i < 100; i++) {
+    sp_ht_insert(ht, i, i + 1);
+  }
+  sp_ht_erase(ht, 50);
+
+  sp_ht_set_mode(ht, SP_HT_MODE_SWISS);
+  EXPECT_EQ(sp_ht_size(ht), 99u);
+  for (s32 i = 0; i < 100; i++) {
+    EXPECT_EQ(sp_ht_getp(ht, i) != SP_NULLPTR, i != 50);
+  }
+
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
+  EXPECT_EQ(ht->ctrl, SP_NULLPTR);
+  EXPECT_EQ(sp_ht_size(ht), 99u);
+  for (s32 i = 0; i < 100; i++) {
+    if (i == 50) continue;
+    EXPECT_EQ(*sp_ht_getp(ht, i), i + 1);
+  }
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, swiss_all_same_hash) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_fns(ht, sp_test_constant_hash, sp_ht_on_compare_key);
+  sp_ht_set_mode(ht, SP_HT_MODE_SWISS);
+
+  // Every key shares a tag and a home group, so probes must cross group boundaries
+  for (u32 i = 0; i < 100; i++) {
+    sp_ht_insert(ht, i, i * 100);
+  }
+  for (u32 i = 0; i < 100; i += 3) {
+    sp_ht_erase(ht, i);
+  }
+  for (u32 i = 0; i < 100; i++) {
+    u32* value = sp_ht_getp(ht, i);
+    if (i % 3 == 0) {
+      EXPECT_FALSE(value);
+    }
+    else {
+      ASSERT_TRUE(value);
+      EXPECT_EQ(*value, i * 100);
+    }
+  }
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, swiss_churn_reuses_tombstones) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_SWISS);
+
+  for (u32 i = 0; i < 10; i++) {
+    sp_ht_insert(ht, i, i);
+  }
+  u64 capacity = sp_ht_capacity(ht);
+
+  for (u32 i = 10; i < 10000; i++) {
+    sp_ht_insert(ht, i, i);
+    sp_ht_erase(ht, i - 10);
+  }
+
+  EXPECT_EQ(sp_ht_size(ht), 10u);
+  EXPECT_LE(sp_ht_capacity(ht), capacity * 2);
+  for (u32 i = 9990; i < 10000; i++) {
+    EXPECT_EQ(*sp_ht_getp(ht, i), i);
+  }
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, swiss_str_key) {
+  sp_mem_arena_marker_t s = sp_mem_begin_scratch();
+
+  sp_str_ht(s32) ht = SP_NULLPTR;
+  sp_str_ht_init(ut.mem, ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_SWISS);
+
+  for (s32 i = 0; i < 256; i++) {
+    sp_str_ht_insert(ht, sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value, i);
+  }
+  for (s32 i = 0; i < 256; i++) {
+    s32* value = sp_str_ht_get(ht, sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value);
+    ASSERT_TRUE(value);
+    EXPECT_EQ(*value, i);
+  }
+  EXPECT_FALSE(sp_str_ht_get(ht, sp_str_lit("key_256")));
+
+  sp_str_ht_free(ht);
+  sp_mem_end_scratch(s);
+}
+
+static u32 g_compare_call_count = 0;
+
+static bool sp_test_counting_compare_calls(void* ka, void* kb, u64 size) {
+  g_compare_call_count++;
+  return sp_mem_is_equal(ka, kb, size);
+}
+
+UTEST_F(sp_ht, cache_hash_skips_rehash_on_growth) {
+  u32 modes [2] = { SP_HT_MODE_CACHE_HASH, SP_HT_MODE_SWISS | SP_HT_MODE_CACHE_HASH };
+  for (u32 m = 0; m < SP_CARR_LEN(modes); m++) {
+    sp_ht(s32, s32) ht = SP_NULLPTR;
+    sp_ht_init(ut.mem, ht);
+    sp_ht_set_fns(ht, sp_test_counting_hash, sp_test_counting_compare_calls);
+    sp_ht_set_mode(ht, modes[m]);
+    EXPECT_NE(ht->hashes, SP_NULLPTR);
+
+    g_hash_call_count = 0;
+    for (s32 i = 0; i < 1000; i++) {
+      sp_ht_insert(ht, i, i);
+    }
+    EXPECT_EQ(g_hash_call_count, 1000u);
+
+    g_compare_call_count = 0;
+    for (s32 i = 0; i < 1000; i++) {
+      EXPECT_EQ(*sp_ht_getp(ht, i), i);
+    }
+    EXPECT_EQ(g_compare_call_count, 1000u);
+
+    g_compare_call_count = 0;
+    for (s32 i = 1000; i < 2000; i++) {
+      EXPECT_FALSE(sp_ht_getp(ht, i));
+    }
+    EXPECT_EQ(g_compare_call_count, 0u);
+
+    sp_ht_free(ht);
+  }
+}
+
+UTEST_F(sp_ht, cache_hash_set_mode) {
+  sp_mem_arena_marker_t s = sp_mem_begin_scratch();
+
+  sp_str_ht(s32) ht = SP_NULLPTR;
+  sp_str_ht_init(ut.mem, ht);
+
+  for (s32 i = 0; i < 100; i++) {
+    sp_str_ht_insert(ht, sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value, i);
+  }
+
+  sp_ht_set_mode(ht, SP_HT_MODE_CACHE_HASH);
+  for (s32 i = 0; i < 100; i++) {
+    sp_str_t key = sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value;
+    EXPECT_EQ(*sp_str_ht_get(ht, key), i);
+  }
+
+  for (s32 i = 0; i < 100; i += 2) {
+    sp_str_ht_erase(ht, sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value);
+  }
+  sp_ht_set_hash(ht, sp_ht_on_hash_str_key_sip);
+
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
+  EXPECT_EQ(ht->hashes, SP_NULLPTR);
+  EXPECT_EQ(sp_str_ht_size(ht), 50u);
+  for (s32 i = 0; i < 100; i++) {
+    s32* value = sp_str_ht_get(ht, sp_fmt(s.mem, "key_{}", sp_fmt_int(i)).value);
+    EXPECT_EQ(value != SP_NULLPTR, i % 2 == 1);
+  }
+
+  sp_str_ht_free(ht);
+  sp_mem_end_scratch(s);
+}
+
+static sp_hash_t sp_test_identity_hash_u32(void* key, u64 size) {
+  (void)size;
+  return *(u32*)key;
+}
+
+UTEST_F(sp_ht, fibonacci_index_spreads_weak_hashes) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_fns(ht, sp_test_identity_hash_u32, sp_test_counting_compare_calls);
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
+
+  // Masking the low bits would send every one of these keys to slot zero
+  for (u32 i = 0; i < 1000; i++) {
+    sp_ht_insert(ht, i << 12, i);
+  }
+  EXPECT_EQ(sp_ht_capacity(ht) & (sp_ht_capacity(ht) - 1), 0u);
+
+  g_compare_call_count = 0;
+  for (u32 i = 0; i < 1000; i++) {
+    EXPECT_EQ(*sp_ht_getp(ht, i << 12), i);
+  }
+  EXPECT_LT(g_compare_call_count, 4000u);
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, backshift_erase_leaves_no_tombstones) {
+  u32 modes [2] = { SP_HT_MODE_BACKSHIFT, SP_HT_MODE_BACKSHIFT | SP_HT_MODE_CACHE_HASH };
+  for (u32 m = 0; m < SP_CARR_LEN(modes); m++) {
+    sp_ht(u32, u32) ht = SP_NULLPTR;
+    sp_ht_init(ut.mem, ht);
+    sp_ht_set_mode(ht, modes[m]);
+
+    // Check every operation against a plain array, with keys drawn from a small range so
+    // that runs collide, wrap around the end of the table, and get erased from the middle
+    bool present [512] = sp_zero;
+    u32 num_present = 0;
+    u64 x = 0x2545F4914F6CDD1Dull;
+    for (u32 i = 0; i < 20000; i++) {
+      x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+      u32 key = (u32)(x % SP_CARR_LEN(present));
+      if (present[key]) {
+        sp_ht_erase(ht, key);
+        present[key] = false;
+        num_present--;
+      }
+      else {
+        sp_ht_insert(ht, key, key * 3);
+        present[key] = true;
+        num_present++;
+      }
+    }
+
+    EXPECT_EQ(ht->tombstones, 0u);
+    EXPECT_EQ(sp_ht_size(ht), (u64)num_present);
+    for (u32 key = 0; key < SP_CARR_LEN(present); key++) {
+      u32* value = sp_ht_getp(ht, key);
+      EXPECT_EQ(value != SP_NULLPTR, present[key]);
+      if (value) EXPECT_EQ(*value, key * 3);
+    }
+
+    u32 count = 0;
+    sp_ht_for(ht, it) {
+      EXPECT_NE(ht->data[it].state, SP_HT_ENTRY_DELETED);
+      count++;
+    }
+    EXPECT_EQ(count, num_present);
+
+    sp_ht_free(ht);
+  }
+}
+
+UTEST_F(sp_ht, backshift_erase_all_same_hash) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_fns(ht, sp_test_constant_hash, sp_ht_on_compare_key);
+  sp_ht_set_mode(ht, SP_HT_MODE_BACKSHIFT);
+
+  for (u32 i = 0; i < 20; i++) {
+    sp_ht_insert(ht, i, i);
+  }
+  EXPECT_EQ(sp_ht_stats(ht).max_probe, 19u);
+
+  sp_ht_erase(ht, 0);
+  sp_ht_erase(ht, 10);
+  EXPECT_EQ(sp_ht_stats(ht).max_probe, 17u);
+  for (u32 i = 0; i < 20; i++) {
+    EXPECT_EQ(sp_ht_getp(ht, i) != SP_NULLPTR, i != 0 && i != 10);
+  }
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, stats) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_stats_t stats = sp_ht_stats(ht);
+  EXPECT_EQ(stats.size, 0u);
+  EXPECT_EQ(stats.capacity, 0u);
+
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_fns(ht, sp_test_constant_hash, sp_ht_on_compare_key);
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
+
+  // Every key shares a home slot, so the nth key inserted probes n slots
+  for (u32 i = 0; i < 10; i++) {
+    sp_ht_insert(ht, i, i);
+  }
+  stats = sp_ht_stats(ht);
+  EXPECT_EQ(stats.size, 10u);
+  EXPECT_EQ(stats.capacity, sp_ht_capacity(ht));
+  EXPECT_EQ(stats.max_probe, 9u);
+  EXPECT_EQ(stats.total_probe, 45u);
+  EXPECT_EQ(stats.mean_probe, 4.5);
+  EXPECT_EQ(stats.load, 10.0 / (f64)sp_ht_capacity(ht));
+
+  sp_ht_erase(ht, 3);
+  EXPECT_EQ(sp_ht_stats(ht).tombstones, 1u);
+
+  sp_ht_set_mode(ht, SP_HT_MODE_SWISS);
+  stats = sp_ht_stats(ht);
+  EXPECT_EQ(stats.tombstones, 0u);
+  EXPECT_EQ(stats.max_probe, 0u);
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, linear_churn_reclaims_tombstones) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_LINEAR);
+
+  for (u32 i = 0; i < 100; i++) {
+    sp_ht_insert(ht, i, i);
+  }
+  u64 capacity = sp_ht_capacity(ht);
+
+  for (u32 i = 100; i < 100000; i++) {
+    sp_ht_insert(ht, i, i);
+    sp_ht_erase(ht, i - 100);
+  }
+
+  sp_ht_stats_t stats = sp_ht_stats(ht);
+  EXPECT_EQ(stats.size, 100u);
+  EXPECT_EQ(stats.capacity, capacity);
+  EXPECT_LE(stats.tombstones * 4, capacity * 3);
+  for (u32 i = 99900; i < 100000; i++) {
+    EXPECT_EQ(*sp_ht_getp(ht, i), i);
+  }
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, cht_basic) {
+  sp_cht(u32, u64) cht = SP_NULLPTR;
+  sp_cht_init(ut.mem, cht);
+
+  for (u32 i = 0; i < 1000; i++) {
+    u64 value = (u64)i * 3;
+    sp_cht_insert(cht, &i, &value);
+  }
+  EXPECT_EQ(sp_cht_size(cht), 1000);
+
+  for (u32 i = 0; i < 1000; i++) {
+    u64 value = 0;
+    ASSERT_TRUE(sp_cht_get(cht, &i, &value));
+    EXPECT_EQ(value, (u64)i * 3);
+  }
+
+  u32 missing = 5000;
+  u64 untouched = 7;
+  EXPECT_FALSE(sp_cht_get(cht, &missing, &untouched));
+  EXPECT_EQ(untouched, 7);
+
+  for (u32 i = 0; i < 1000; i += 2) {
+    EXPECT_TRUE(sp_cht_erase(cht, &i));
+  }
+  EXPECT_FALSE(sp_cht_erase(cht, &missing));
+  EXPECT_EQ(sp_cht_size(cht), 500);
+
+  for (u32 i = 0; i < 1000; i++) {
+    EXPECT_EQ(sp_cht_contains(cht, &i), (bool)(i & 1));
+  }
+
+  u32 key = 1;
+  u64 value = 99;
+  sp_cht_insert(cht, &key, &value);
+  EXPECT_EQ(sp_cht_size(cht), 500);
+  value = 0;
+  sp_cht_get(cht, &key, &value);
+  EXPECT_EQ(value, 99);
+
+  sp_cht_free(cht);
+  EXPECT_EQ(cht, SP_NULLPTR);
+}
+
+UTEST_F(sp_ht, cht_str_key) {
+  sp_cht(sp_str_t, s32) cht = SP_NULLPTR;
+  sp_str_cht_init(ut.mem, cht);
+  sp_cht_set_mode(cht, SP_HT_MODE_SWISS | SP_HT_MODE_CACHE_HASH);
+
+  c8 buffer [] = "hello";
+  sp_str_t key = sp_str_lit("hello");
+  s32 value = 42;
+  sp_cht_insert(cht, &key, &value);
+
+  sp_str_t lookup = sp_str(buffer, 5);
+  value = 0;
+  EXPECT_TRUE(sp_cht_get(cht, &lookup, &value));
+  EXPECT_EQ(value, 42);
+
+  sp_cht_free(cht);
+}
+
+static void sp_test_cht_compute_square(const void* key, void* value, void* user_data) {
+  sp_atomic_s32_add((sp_atomic_s32_t*)user_data, 1);
+  u32 k = *(const u32*)key;
+  *(u64*)value = (u64)k * k;
+}
+
+UTEST_F(sp_ht, cht_compute_if_absent) {
+  sp_cht(u32, u64) cht = SP_NULLPTR;
+  sp_cht_init(ut.mem, cht);
+  sp_atomic_s32_t calls = 0;
+
+  u32 key = 12;
+  u64 value = 0;
+  EXPECT_TRUE(sp_cht_compute_if_absent(cht, &key, sp_test_cht_compute_square, &calls, &value));
+  EXPECT_EQ(value, 144);
+
+  value = 0;
+  EXPECT_FALSE(sp_cht_compute_if_absent(cht, &key, sp_test_cht_compute_square, &calls, &value));
+  EXPECT_EQ(value, 144);
+  EXPECT_EQ(sp_atomic_s32_get(&calls), 1);
+
+  sp_cht_free(cht);
+}
+
+#define SP_TEST_CHT_THREADS 4
+#define SP_TEST_CHT_KEYS 4096
+
+typedef sp_cht(u32, u64) sp_test_cht_t;
+
+typedef struct {
+  sp_test_cht_t cht;
+  sp_atomic_s32_t* calls;
+  bool mismatch;
+  u32 thread;
+  sp_thread_t handle;
+} sp_test_cht_worker_t;
+
+static s32 sp_test_cht_insert_worker(void* user_data) {
+  sp_test_cht_worker_t* worker = (sp_test_cht_worker_t*)user_data;
+  for (u32 i = worker->thread; i < SP_TEST_CHT_KEYS; i += SP_TEST_CHT_THREADS) {
+    u64 value = (u64)i << 8 | worker->thread;
+    sp_cht_insert(worker->cht, &i, &value);
+  }
+  // Erase every fourth key this thread inserted, so erases interleave with other threads' inserts
+  for (u32 i = worker->thread; i < SP_TEST_CHT_KEYS; i += 4 * SP_TEST_CHT_THREADS) {
+    sp_cht_erase(worker->cht, &i);
+  }
+  return 0;
+}
+
+static s32 sp_test_cht_compute_worker(void* user_data) {
+  sp_test_cht_worker_t* worker = (sp_test_cht_worker_t*)user_data;
+  for (u32 i = 0; i < SP_TEST_CHT_KEYS; i++) {
+    u64 value = 0;
+    sp_cht_compute_if_absent(worker->cht, &i, sp_test_cht_compute_square, worker->calls, &value);
+    if (value != (u64)i * i) worker->mismatch = true;
+  }
+  return 0;
+}
+
+UTEST(sp_cht, concurrent_insert_erase) {
+  SKIP_ON_WASM()
+  SKIP_ON_FREESTANDING();
+  sp_test_cht_t cht = SP_NULLPTR;
+  sp_cht_init(sp_mem_os_new(), cht);
+
+  sp_test_cht_worker_t workers [SP_TEST_CHT_THREADS] = sp_zero;
+  sp_carr_for(workers, it) {
+    workers[it].cht = cht;
+    workers[it].thread = it;
+    sp_thread_init(&workers[it].handle, sp_test_cht_insert_worker, &workers[it]);
+  }
+  sp_carr_for(workers, it) {
+    sp_thread_join(&workers[it].handle);
+  }
+
+  u64 expected = 0;
+  for (u32 i = 0; i < SP_TEST_CHT_KEYS; i++) {
+    u64 value = 0;
+    bool erased = (i % (4 * SP_TEST_CHT_THREADS)) < SP_TEST_CHT_THREADS;
+    ASSERT_EQ(sp_cht_get(cht, &i, &value), !erased);
+    if (!erased) {
+      EXPECT_EQ(value, (u64)i << 8 | (i % SP_TEST_CHT_THREADS));
+      expected++;
+    }
+  }
+  EXPECT_EQ(sp_cht_size(cht), expected);
+
+  sp_cht_free(cht);
+}
+
+UTEST(sp_cht, concurrent_compute_if_absent_runs_once) {
+  SKIP_ON_WASM()
+  SKIP_ON_FREESTANDING();
+  sp_test_cht_t cht = SP_NULLPTR;
+  sp_cht_init(sp_mem_os_new(), cht);
+  sp_atomic_s32_t calls = 0;
+
+  sp_test_cht_worker_t workers [SP_TEST_CHT_THREADS] = sp_zero;
+  sp_carr_for(workers, it) {
+    workers[it].cht = cht;
+    workers[it].calls = &calls;
+    sp_thread_init(&workers[it].handle, sp_test_cht_compute_worker, &workers[it]);
+  }
+  sp_carr_for(workers, it) {
+    sp_thread_join(&workers[it].handle);
+    EXPECT_FALSE(workers[it].mismatch);
+  }
+
+  EXPECT_EQ(sp_atomic_s32_get(&calls), SP_TEST_CHT_KEYS);
+  EXPECT_EQ(sp_cht_size(cht), SP_TEST_CHT_KEYS);
+
+  sp_cht_free(cht);
+}
+
+typedef struct {
+  s32 x;
+  s32 y;
+} sp_test_cell_t;
+
+SP_HT_DEFINE(sp_test_u32_ht, u32, u64, key, a == b)
+SP_HT_DEFINE(sp_test_cell_ht, sp_test_cell_t, f32, (u64)(u32)key.x << 32 | (u32)key.y, a.x == b.x && a.y == b.y)
+
+UTEST_F(sp_ht, define_basic) {
+  sp_test_u32_ht_t ht = SP_NULLPTR;
+  sp_test_u32_ht_init(ut.mem, &ht);
+
+  for (u32 i = 0; i < 1000; i++) {
+    sp_test_u32_ht_insert(ht, i * 7, (u64)i);
+  }
+  EXPECT_EQ(sp_ht_size(ht), 1000);
+
+  for (u32 i = 0; i < 1000; i++) {
+    u64* value = sp_test_u32_ht_get(ht, i * 7);
+    ASSERT_NE(value, SP_NULLPTR);
+    EXPECT_EQ(*value, (u64)i);
+    EXPECT_FALSE(sp_test_u32_ht_contains(ht, i * 7 + 1));
+  }
+
+  sp_test_u32_ht_insert(ht, 7, 99);
+  EXPECT_EQ(sp_ht_size(ht), 1000);
+  EXPECT_EQ(*sp_test_u32_ht_get(ht, 7), 99);
+
+  for (u32 i = 0; i < 1000; i += 2) {
+    EXPECT_TRUE(sp_test_u32_ht_erase(ht, i * 7));
+  }
+  EXPECT_FALSE(sp_test_u32_ht_erase(ht, 0));
+  EXPECT_EQ(sp_ht_size(ht), 500);
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, define_interops_with_generic_macros) {
+  sp_test_cell_ht_t ht = SP_NULLPTR;
+  sp_test_cell_ht_init(ut.mem, &ht);
+
+  for (s32 x = -10; x < 10; x++) {
+    for (s32 y = -10; y < 10; y++) {
+      sp_test_cell_t cell = { x, y };
+      sp_test_cell_ht_insert(ht, cell, (f32)(x * y));
+    }
+  }
+
+  // Generic lookups go through the generated callbacks and see the same entries
+  sp_test_cell_t cell = { -3, 4 };
+  f32* value = sp_ht_getp(ht, cell);
+  ASSERT_NE(value, SP_NULLPTR);
+  EXPECT_EQ(*value, -12.f);
+
+  cell.x = 5;
+  sp_ht_insert(ht, cell, 1.f);
+  EXPECT_EQ(*sp_test_cell_ht_get(ht, cell), 1.f);
+
+  u32 visited = 0;
+  sp_ht_for(ht, it) {
+    visited++;
+  }
+  EXPECT_EQ(visited, 400);
+  EXPECT_EQ(sp_ht_size(ht), 400);
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, define_matches_generic_in_every_mode) {
+  u32 modes [] = {
+    SP_HT_MODE_LINEAR,
+    SP_HT_MODE_SWISS,
+    SP_HT_MODE_CACHE_HASH,
+    SP_HT_MODE_BACKSHIFT,
+    SP_HT_MODE_SWISS | SP_HT_MODE_CACHE_HASH,
+    SP_HT_MODE_INCREMENTAL,
+    SP_HT_MODE_INCREMENTAL | SP_HT_MODE_BACKSHIFT | SP_HT_MODE_CACHE_HASH,
+  };
+
+  sp_carr_for(modes, m) {
+    sp_test_u32_ht_t ht = SP_NULLPTR;
+    sp_test_u32_ht_init(ut.mem, &ht);
+    sp_ht_set_mode(ht, modes[m]);
+
+    sp_ht(u32, u64) reference = SP_NULLPTR;
+    sp_ht_init(ut.mem, reference);
+
+    u64 x = 0x9E3779B97F4A7C15ull;
+    sp_for(it, 20000) {
+      x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+      u32 key = (u32)(x >> 40) & 1023;
+      if (x & 1) {
+        sp_test_u32_ht_insert(ht, key, x);
+        sp_ht_insert(reference, key, x);
+      }
+      else {
+        bool erased = sp_test_u32_ht_erase(ht, key);
+        EXPECT_EQ(erased, sp_ht_getp(reference, key) != SP_NULLPTR);
+        sp_ht_erase(reference, key);
+      }
+    }
+
+    EXPECT_EQ(sp_ht_size(ht), sp_ht_size(reference));
+    sp_for(key, 1024) {
+      u64* expected = sp_ht_getp(reference, key);
+      u64* actual = sp_test_u32_ht_get(ht, key);
+      ASSERT_EQ(actual == SP_NULLPTR, expected == SP_NULLPTR);
+      if (expected) EXPECT_EQ(*actual, *expected);
+    }
+
+    sp_ht_free(ht);
+    sp_ht_free(reference);
+  }
+}
+
+UTEST_F(sp_ht, get_many_and_insert_many) {
+  u32 modes [] = {
+    SP_HT_MODE_LINEAR,
+    SP_HT_MODE_SWISS,
+    SP_HT_MODE_LINEAR | SP_HT_MODE_CACHE_HASH,
+    SP_HT_MODE_SWISS | SP_HT_MODE_CACHE_HASH,
+    SP_HT_MODE_INCREMENTAL,
+  };
+
+  // Not a multiple of the batch size, so the last batch is partial
+  enum { n = 3 * SP_HT_BATCH_SIZE + 5 };
+  u32 keys [n];
+  u64 values [n];
+  sp_for(i, n) {
+    keys[i] = i * 13;
+    values[i] = (u64)i << 32;
+  }
+
+  sp_carr_for(modes, m) {
+    sp_ht(u32, u64) ht = SP_NULLPTR;
+    sp_ht_init(ut.mem, ht);
+    sp_ht_set_mode(ht, modes[m]);
+
+    sp_ht_insert_many(ht, keys, n, values);
+    EXPECT_EQ(sp_ht_size(ht), n);
+
+    // Every other key is missing
+    u32 lookups [2 * n];
+    u64* found [2 * n];
+    sp_for(i, n) {
+      lookups[2 * i] = keys[i];
+      lookups[2 * i + 1] = keys[i] + 1;
+    }
+    EXPECT_EQ(sp_ht_get_many(ht, lookups, 2 * n, found), n);
+
+    sp_for(i, n) {
+      ASSERT_NE(found[2 * i], SP_NULLPTR);
+      EXPECT_EQ(*found[2 * i], values[i]);
+      EXPECT_EQ(found[2 * i + 1], SP_NULLPTR);
+      EXPECT_EQ(found[2 * i], sp_ht_getp(ht, keys[i]));
+    }
+
+    sp_ht_free(ht);
+  }
+
+  sp_ht(u32, u64) empty = SP_NULLPTR;
+  u64* missing [2] = { (u64*)values, (u64*)values };
+  EXPECT_EQ(sp_ht_get_many(empty, keys, 2, missing), 0);
+  EXPECT_EQ(missing[0], SP_NULLPTR);
+  EXPECT_EQ(missing[1], SP_NULLPTR);
+}
+
+UTEST_F(sp_ht, get_many_str_keys) {
+  sp_str_ht(s32) ht = SP_NULLPTR;
+  sp_str_ht_init(ut.mem, ht);
+
+  sp_str_t keys [] = { sp_str_lit("alpha"), sp_str_lit("beta"), sp_str_lit("gamma") };
+  s32 values [] = { 1, 2, 3 };
+  sp_str_ht_insert_many(ht, keys, 3, values);
+
+  sp_str_t lookups [] = { sp_str_lit("gamma"), sp_str_lit("delta"), sp_str_lit("alpha") };
+  s32* found [3];
+  EXPECT_EQ(sp_str_ht_get_many(ht, lookups, 3, found), 2);
+  EXPECT_EQ(*found[0], 3);
+  EXPECT_EQ(found[1], SP_NULLPTR);
+  EXPECT_EQ(*found[2], 1);
+
+  sp_str_ht_free(ht);
+}
+
+UTEST_F(sp_ht, reserve_prevents_growth) {
+  u32 modes [] = { SP_HT_MODE_LINEAR, SP_HT_MODE_SWISS, SP_HT_MODE_SWISS | SP_HT_MODE_CACHE_HASH };
+  u64 counts [] = { 1, 3, 12, 13, 100, 1000 };
+
+  sp_carr_for(modes, m) {
+    sp_carr_for(counts, c) {
+      sp_ht(u32, u32) ht = SP_NULLPTR;
+      sp_ht_init(ut.mem, ht);
+      sp_ht_set_mode(ht, modes[m]);
+
+      sp_ht_reserve(ht, counts[c]);
+      u64 capacity = sp_ht_capacity(ht);
+      void* data = ht->data;
+
+      sp_for(i, counts[c]) {
+        sp_ht_insert(ht, i, i);
+      }
+      EXPECT_EQ(sp_ht_capacity(ht), capacity);
+      EXPECT_EQ(ht->data, data);
+      EXPECT_EQ(sp_ht_size(ht), counts[c]);
+
+      // Reserving less than the current capacity is a no-op
+      sp_ht_reserve(ht, 1);
+      EXPECT_EQ(sp_ht_capacity(ht), capacity);
+
+      sp_ht_free(ht);
+    }
+  }
+
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_reserve(ht, 100);
+  EXPECT_EQ(ht, SP_NULLPTR);
+}
+
+UTEST_F(sp_ht, from_arrays) {
+  u32 keys [500];
+  f32 values [500];
+  sp_for(i, 500) {
+    keys[i] = i * 31;
+    values[i] = (f32)i / 2.f;
+  }
+
+  sp_ht(u32, f32) ht = SP_NULLPTR;
+  sp_ht_from_arrays(ut.mem, ht, keys, values, 500);
+  EXPECT_EQ(sp_ht_size(ht), 500);
+  sp_for(i, 500) {
+    f32* value = sp_ht_getp(ht, keys[i]);
+    ASSERT_NE(value, SP_NULLPTR);
+    EXPECT_EQ(*value, values[i]);
+  }
+  sp_ht_free(ht);
+
+  sp_str_t names [] = { sp_str_lit("x"), sp_str_lit("y"), sp_str_lit("z") };
+  s32 axes [] = { 0, 1, 2 };
+  sp_str_ht(s32) str = SP_NULLPTR;
+  sp_str_ht_from_arrays(ut.mem, str, names, axes, 3);
+  EXPECT_EQ(*sp_str_ht_get(str, sp_str_lit("y")), 1);
+  sp_str_ht_free(str);
+}
+
+UTEST_F(sp_ht, image_round_trip_in_memory) {
+  sp_ht(u32, vec3_t) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_for(i, 1000) {
+    sp_ht_insert(ht, i * 7, ((vec3_t) { (f32)i, (f32)i * 2.f, (f32)i * 3.f }));
+  }
+
+  sp_io_dyn_mem_writer_t buf;
+  sp_io_dyn_mem_writer_init(ut.mem, &buf);
+  ASSERT_EQ(sp_ht_image_write(ht, &buf.base), SP_OK);
+  sp_str_t bytes = sp_io_dyn_mem_writer_as_str(&buf);
+
+  sp_ht_image_t image = sp_zero;
+  ASSERT_EQ(sp_ht_image_from_mem(&image, bytes.data, bytes.len), SP_OK);
+  EXPECT_EQ(sp_ht_image_size(&image), 1000);
+
+  sp_for(i, 1000) {
+    u32 key = i * 7;
+    const vec3_t* value = (const vec3_t*)sp_ht_image_get(&image, &key);
+    ASSERT_NE(value, SP_NULLPTR);
+    EXPECT_EQ(value->x, (f32)i);
+    EXPECT_EQ(value->z, (f32)i * 3.f);
+
+    u32 missing = i * 7 + 1;
+    EXPECT_EQ(sp_ht_image_get(&image, &missing), SP_NULLPTR);
+  }
+
+  EXPECT_EQ(sp_ht_image_get_str(&image, sp_str_lit("wrong kind")), SP_NULLPTR);
+
+  sp_ht_image_close(&image);
+  sp_io_dyn_mem_writer_close(&buf);
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, image_str_keys_through_file) {
+  SKIP_ON_WASM()
+  sp_test_file_manager_t files;
+  sp_test_file_manager_init(&files);
+  sp_str_t path = sp_test_file_path_c(&files, "ht.image");
+
+  sp_str_ht(u64) ht = SP_NULLPTR;
+  sp_str_ht_init(ut.mem, ht);
+  sp_str_ht_insert(ht, sp_str_lit(""), 0);
+  sp_for(i, 256) {
+    sp_str_t key = sp_fmt(files.mem, "key_{}", sp_fmt_uint(i)).value;
+    sp_str_ht_insert(ht, key, (u64)i * 1000);
+  }
+
+  sp_io_file_writer_t io = sp_zero;
+  ASSERT_EQ(sp_io_file_writer_from_path(&io, path), SP_OK);
+  ASSERT_EQ(sp_str_ht_image_write(ht, &io.base), SP_OK);
+  ASSERT_EQ(sp_io_file_writer_close(&io), SP_OK);
+  sp_str_ht_free(ht);
+
+  sp_ht_image_t image = sp_zero;
+  ASSERT_EQ(sp_ht_image_open(&image, path), SP_OK);
+  EXPECT_EQ(sp_ht_image_size(&image), 257);
+
+  sp_for(i, 256) {
+    sp_str_t key = sp_fmt(files.mem, "key_{}", sp_fmt_uint(i)).value;
+    const u64* value = (const u64*)sp_ht_image_get_str(&image, key);
+    ASSERT_NE(value, SP_NULLPTR);
+    EXPECT_EQ(*value, (u64)i * 1000);
+  }
+
+  const u64* empty = (const u64*)sp_ht_image_get_str(&image, sp_str_lit(""));
+  ASSERT_NE(empty, SP_NULLPTR);
+  EXPECT_EQ(*empty, 0);
+  EXPECT_EQ(sp_ht_image_get_str(&image, sp_str_lit("key_256")), SP_NULLPTR);
+  EXPECT_EQ(sp_ht_image_get_str(&image, sp_str_lit("key_")), SP_NULLPTR);
+
+  sp_ht_image_close(&image);
+  EXPECT_EQ(image.base, SP_NULLPTR);
+  sp_test_file_manager_cleanup(&files);
+}
+
+UTEST_F(sp_ht, image_rejects_corrupt_headers) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_for(i, 64) {
+    sp_ht_insert(ht, i, i);
+  }
+
+  sp_io_dyn_mem_writer_t buf;
+  sp_io_dyn_mem_writer_init(ut.mem, &buf);
+  ASSERT_EQ(sp_ht_image_write(ht, &buf.base), SP_OK);
+  sp_str_t bytes = sp_io_dyn_mem_writer_as_str(&buf);
+  sp_ht_image_header_t* header = (sp_ht_image_header_t*)bytes.data;
+
+  sp_ht_image_t image = sp_zero;
+  EXPECT_EQ(sp_ht_image_from_mem(&image, bytes.data, bytes.len - 1), SP_ERR);
+  EXPECT_EQ(sp_ht_image_from_mem(&image, bytes.data, sizeof(sp_ht_image_header_t) - 1), SP_ERR);
+  EXPECT_EQ(sp_ht_image_from_mem(&image, SP_NULLPTR, 0), SP_ERR);
+
+  sp_ht_image_header_t original = *header;
+  header->magic ^= 1;
+  EXPECT_EQ(sp_ht_image_from_mem(&image, bytes.data, bytes.len), SP_ERR);
+  *header = original;
+
+  header->capacity = 3;
+  EXPECT_EQ(sp_ht_image_from_mem(&image, bytes.data, bytes.len), SP_ERR);
+  *header = original;
+
+  header->entries = (u64)-16;
+  EXPECT_EQ(sp_ht_image_from_mem(&image, bytes.data, bytes.len), SP_ERR);
+  *header = original;
+
+  header->value_offset = header->entry_stride;
+  EXPECT_EQ(sp_ht_image_from_mem(&image, bytes.data, bytes.len), SP_ERR);
+  *header = original;
+
+  EXPECT_EQ(sp_ht_image_from_mem(&image, bytes.data, bytes.len), SP_OK);
+  u32 key = 63;
+  EXPECT_EQ(*(const u32*)sp_ht_image_get(&image, &key), 63);
+  EXPECT_EQ(image.header->capacity & (image.header->capacity - 1), 0);
+
+  sp_ht_image_t missing = sp_zero;
+  EXPECT_NE(sp_ht_image_open(&missing, sp_str_lit("/nonexistent/ht.image")), SP_OK);
+
+  sp_io_dyn_mem_writer_close(&buf);
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, intern_basic) {
+  sp_intern_t intern = sp_zero;
+  sp_intern_init(&intern, ut.mem);
+
+  c8 buffer [] = "foo";
+  u32 foo = sp_intern(&intern, sp_str_view(buffer));
+  u32 bar = sp_intern_cstr(&intern, "bar");
+  EXPECT_EQ(foo, 0);
+  EXPECT_EQ(bar, 1);
+  EXPECT_EQ(sp_intern_cstr(&intern, "foo"), foo);
+  EXPECT_EQ(sp_intern_size(&intern), 2);
+
+  // The table keeps its own copy of the bytes
+  buffer[0] = 'x';
+  SP_EXPECT_STR_EQ_CSTR(sp_intern_get(&intern, foo), "foo");
+  SP_EXPECT_STR_EQ_CSTR(sp_intern_get(&intern, bar), "bar");
+  EXPECT_EQ(sp_intern_find(&intern, sp_str_lit("xoo")), SP_INTERN_INVALID);
+  EXPECT_EQ(sp_intern_find(&intern, sp_str_lit("bar")), bar);
+  EXPECT_EQ(sp_intern_get(&intern, 2).len, 0);
+
+  u32 empty = sp_intern(&intern, sp_str_lit(""));
+  EXPECT_EQ(sp_intern(&intern, sp_str_lit("")), empty);
+  EXPECT_EQ(sp_intern_size(&intern), 3);
+
+  sp_intern_free(&intern);
+}
+
+UTEST_F(sp_ht, intern_many_symbols_are_dense) {
+  sp_intern_t intern = sp_zero;
+  sp_intern_init(&intern, ut.mem);
+
+  sp_mem_arena_t* arena = sp_mem_arena_new(ut.mem);
+  sp_mem_t scratch = sp_mem_arena_as_allocator(arena);
+  sp_for(round, 2) {
+    sp_for(i, 5000) {
+      sp_str_t str = sp_fmt(scratch, "symbol_{}", sp_fmt_uint(i)).value;
+      ASSERT_EQ(sp_intern(&intern, str), i);
+    }
+  }
+  EXPECT_EQ(sp_intern_size(&intern), 5000);
+  SP_EXPECT_STR_EQ_CSTR(sp_intern_get(&intern, 4321), "symbol_4321");
+
+  sp_mem_arena_destroy(arena);
+  sp_intern_free(&intern);
+}
+
+#define SP_TEST_INTERN_THREADS 4
+#define SP_TEST_INTERN_STRINGS 2000
+
+typedef struct {
+  sp_intern_sync_t* intern;
+  u32 ids [SP_TEST_INTERN_STRINGS];
+  bool mismatch;
+  sp_thread_t handle;
+} sp_test_intern_worker_t;
+
+static s32 sp_test_intern_worker(void* user_data) {
+  sp_test_intern_worker_t* worker = (sp_test_intern_worker_t*)user_data;
+  sp_mem_arena_t* arena = sp_mem_arena_new(sp_mem_os_new());
+  for (u32 i = 0; i < SP_TEST_INTERN_STRINGS; i++) {
+    sp_str_t str = sp_fmt(sp_mem_arena_as_allocator(arena), "s{}", sp_fmt_uint(i)).value;
+    worker->ids[i] = sp_intern_sync(worker->intern, str);
+    if (!sp_str_equal(sp_intern_sync_get(worker->intern, worker->ids[i]), str)) {
+      worker->mismatch = true;
+    }
+  }
+  sp_mem_arena_destroy(arena);
+  return 0;
+}
+
+UTEST(sp_intern, sync_threads_agree_on_symbols) {
+  SKIP_ON_WASM()
+  SKIP_ON_FREESTANDING();
+  sp_intern_sync_t* intern = (sp_intern_sync_t*)sp_mem_os_alloc(sizeof(sp_intern_sync_t));
+  sp_intern_sync_init(intern, sp_mem_os_new());
+
+  sp_test_intern_worker_t* workers = (sp_test_intern_worker_t*)sp_mem_os_alloc(SP_TEST_INTERN_THREADS * sizeof(sp_test_intern_worker_t));
+  sp_mem_zero(workers, SP_TEST_INTERN_THREADS * sizeof(sp_test_intern_worker_t));
+  sp_for(it, SP_TEST_INTERN_THREADS) {
+    workers[it].intern = intern;
+    sp_thread_init(&workers[it].handle, sp_test_intern_worker, &workers[it]);
+  }
+  sp_for(it, SP_TEST_INTERN_THREADS) {
+    sp_thread_join(&workers[it].handle);
+  }
+
+  EXPECT_EQ(sp_intern_sync_size(intern), SP_TEST_INTERN_STRINGS);
+  sp_for(it, SP_TEST_INTERN_THREADS) {
+    EXPECT_FALSE(workers[it].mismatch);
+    sp_for(i, SP_TEST_INTERN_STRINGS) {
+      ASSERT_EQ(workers[it].ids[i], workers[0].ids[i]);
+      ASSERT_LT(workers[it].ids[i], SP_TEST_INTERN_STRINGS);
+    }
+  }
+  EXPECT_EQ(sp_intern_sync_find(intern, sp_str_lit("s1999")), workers[0].ids[1999]);
+  EXPECT_EQ(sp_intern_sync_find(intern, sp_str_lit("s2000")), SP_INTERN_INVALID);
+
+  sp_mem_os_free(workers, SP_TEST_INTERN_THREADS * sizeof(sp_test_intern_worker_t));
+  sp_intern_sync_free(intern);
+  sp_mem_os_free(intern, sizeof(sp_intern_sync_t));
+}
+
+UTEST_F(sp_ht, im_basic) {
+  sp_im(u32, f32) im = SP_NULLPTR;
+  sp_im_init(ut.mem, im);
+  EXPECT_TRUE(sp_im_empty(im));
+  EXPECT_EQ(sp_im_getp(im, 1), SP_NULLPTR);
+
+  sp_for(i, 100) {
+    sp_im_insert(im, i * 3, (f32)i);
+  }
+  sp_im_insert(im, 3, 69.f);
+  EXPECT_EQ(sp_im_size(im), 100);
+  EXPECT_EQ(*sp_im_getp(im, 3), 69.f);
+  EXPECT_EQ(sp_im_index(im, 30), 10);
+  EXPECT_FALSE(sp_im_contains(im, 31));
+
+  // Iteration is insertion order
+  sp_im_for(im, it) {
+    EXPECT_EQ(im->keys[it], it * 3);
+  }
+
+  sp_im_free(im);
+  EXPECT_EQ(im, SP_NULLPTR);
+}
+
+UTEST_F(sp_ht, im_erase_swaps_last_into_place) {
+  sp_im(u32, u32) im = SP_NULLPTR;
+  sp_im_init(ut.mem, im);
+  sp_for(i, 10) {
+    sp_im_insert(im, i, i * 10);
+  }
+
+  EXPECT_TRUE(sp_im_erase(im, 2));
+  EXPECT_FALSE(sp_im_erase(im, 2));
+  EXPECT_EQ(sp_im_size(im), 9);
+  EXPECT_EQ(im->keys[2], 9);
+  EXPECT_EQ(im->values[2], 90);
+  EXPECT_EQ(sp_im_index(im, 9), 2);
+
+  EXPECT_TRUE(sp_im_erase(im, 9));
+  EXPECT_EQ(im->keys[2], 8);
+  EXPECT_EQ(sp_im_index(im, 8), 2);
+
+  EXPECT_TRUE(sp_im_erase(im, 7));
+  EXPECT_EQ(sp_im_size(im), 7);
+  sp_im_for(im, it) {
+    EXPECT_EQ(*sp_im_getp(im, im->keys[it]), im->keys[it] * 10);
+  }
+
+  sp_im_clear(im);
+  EXPECT_EQ(sp_im_size(im), 0);
+  EXPECT_EQ(sp_im_getp(im, 0), SP_NULLPTR);
+  sp_im_insert(im, 5, 6);
+  EXPECT_EQ(*sp_im_getp(im, 5), 6);
+
+  sp_im_free(im);
+}
+
+UTEST_F(sp_ht, im_matches_sp_ht_under_random_churn) {
+  sp_im(u32, u64) im = SP_NULLPTR;
+  sp_im_init(ut.mem, im);
+  sp_ht(u32, u64) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+
+  u64 x = 0x9E3779B97F4A7C15ull;
+  sp_for(i, 20000) {
+    x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+    u64 r = x * 0x2545F4914F6CDD1DULL;
+    u32 key = (u32)(r >> 32) % 512;
+    if (r & 1) {
+      sp_im_insert(im, key, r);
+      sp_ht_insert(ht, key, r);
+    }
+    else {
+      bool erased = sp_im_erase(im, key);
+      EXPECT_EQ(erased, sp_ht_getp(ht, key) != SP_NULLPTR);
+      sp_ht_erase(ht, key);
+    }
+  }
+
+  ASSERT_EQ(sp_im_size(im), sp_ht_size(ht));
+  sp_ht_for_kv(ht, it) {
+    u64* value = sp_im_getp(im, *it.key);
+    ASSERT_NE(value, SP_NULLPTR);
+    EXPECT_EQ(*value, *it.val);
+  }
+  sp_im_for(im, it) {
+    EXPECT_EQ(sp_im_index(im, im->keys[it]), it);
+  }
+
+  sp_ht_free(ht);
+  sp_im_free(im);
+}
+
+UTEST_F(sp_ht, im_str_keys) {
+  sp_str_im(s32) im = SP_NULLPTR;
+  sp_str_im_init(ut.mem, im);
+  sp_im_insert(im, sp_str_lit("x"), 0);
+  sp_im_insert(im, sp_str_lit("y"), 1);
+  sp_im_reserve(im, 100);
+  sp_im_insert(im, sp_str_lit("z"), 2);
+
+  c8 buffer [] = "y";
+  EXPECT_EQ(*sp_im_getp(im, sp_str_view(buffer)), 1);
+  SP_EXPECT_STR_EQ_CSTR(im->keys[2], "z");
+  sp_im_free(im);
+}
+
+UTEST_F(sp_ht, hs_basic) {
+  sp_hs(u32) hs = SP_NULLPTR;
+  sp_hs_init(ut.mem, hs);
+  EXPECT_FALSE(sp_hs_contains(hs, 1));
+  EXPECT_FALSE(sp_hs_erase(hs, 1));
+
+  sp_for(i, 1000) {
+    EXPECT_TRUE(sp_hs_insert(hs, i * 7));
+  }
+  EXPECT_FALSE(sp_hs_insert(hs, 7));
+  EXPECT_EQ(sp_hs_size(hs), 1000);
+  EXPECT_TRUE(sp_hs_contains(hs, 700));
+  EXPECT_FALSE(sp_hs_contains(hs, 701));
+
+  for (u32 i = 0; i < 1000; i += 2) {
+    EXPECT_TRUE(sp_hs_erase(hs, i * 7));
+  }
+  EXPECT_EQ(sp_hs_size(hs), 500);
+
+  u64 count = 0;
+  sp_hs_for(hs, it) {
+    u32 key = *sp_hs_it_getkp(hs, it);
+    EXPECT_EQ(key % 14, 7);
+    count++;
+  }
+  EXPECT_EQ(count, 500);
+
+  sp_hs_clear(hs);
+  EXPECT_TRUE(sp_hs_empty(hs));
+  EXPECT_TRUE(sp_hs_insert(hs, 7));
+
+  sp_hs_free(hs);
+  EXPECT_EQ(hs, SP_NULLPTR);
+}
+
+UTEST_F(sp_ht, hs_tombstones_dont_grow_the_table) {
+  sp_hs(u64) hs = SP_NULLPTR;
+  sp_hs_init(ut.mem, hs);
+  sp_hs_reserve(hs, 64);
+  u64 capacity = sp_hs_capacity(hs);
+
+  sp_for(i, 100000) {
+    sp_hs_insert(hs, (u64)i);
+    if (i >= 32) sp_hs_erase(hs, (u64)i - 32);
+  }
+  EXPECT_EQ(sp_hs_size(hs), 32);
+  EXPECT_EQ(sp_hs_capacity(hs), capacity);
+  sp_for(i, 32) {
+    EXPECT_TRUE(sp_hs_contains(hs, (u64)(100000 - 32 + i)));
+  }
+
+  sp_hs_free(hs);
+}
+
+UTEST_F(sp_ht, hs_set_algebra) {
+  sp_hs(u32) a = SP_NULLPTR;
+  sp_hs(u32) b = SP_NULLPTR;
+  sp_hs(u32) evens = SP_NULLPTR;
+  sp_hs_init(ut.mem, a);
+  sp_hs_init(ut.mem, b);
+  sp_hs_init(ut.mem, evens);
+  sp_for(i, 100) {
+    sp_hs_insert(a, i);
+    sp_hs_insert(b, i + 50);
+    sp_hs_insert(evens, i * 2);
+  }
+
+  sp_hs_union(a, b);
+  EXPECT_EQ(sp_hs_size(a), 150);
+  EXPECT_TRUE(sp_hs_contains(a, 149));
+
+  sp_hs_intersect(a, evens);
+  EXPECT_EQ(sp_hs_size(a), 75);
+  EXPECT_TRUE(sp_hs_contains(a, 148));
+  EXPECT_FALSE(sp_hs_contains(a, 149));
+
+  // Exercise both directions of difference
+  sp_hs_difference(a, b);
+  EXPECT_EQ(sp_hs_size(a), 25);
+  sp_hs_for(a, it) {
+    EXPECT_LT(*sp_hs_it_getkp(a, it), 50);
+  }
+  sp_hs_difference(evens, a);
+  EXPECT_EQ(sp_hs_size(evens), 75);
+  EXPECT_FALSE(sp_hs_contains(evens, 48));
+  EXPECT_TRUE(sp_hs_contains(evens, 50));
+
+  sp_hs_free(a);
+  sp_hs_free(b);
+  sp_hs_free(evens);
+}
+
+UTEST_F(sp_ht, hs_str_keys) {
+  sp_hs(sp_str_t) hs = SP_NULLPTR;
+  sp_str_hs_init(ut.mem, hs);
+  EXPECT_TRUE(sp_hs_insert(hs, sp_str_lit("foo")));
+  EXPECT_TRUE(sp_hs_insert(hs, sp_str_lit("bar")));
+
+  c8 buffer [] = "foo";
+  EXPECT_FALSE(sp_hs_insert(hs, sp_str_view(buffer)));
+  EXPECT_TRUE(sp_hs_contains(hs, sp_str_view(buffer)));
+  EXPECT_TRUE(sp_hs_erase(hs, sp_str_lit("foo")));
+  EXPECT_FALSE(sp_hs_contains(hs, sp_str_view(buffer)));
+  EXPECT_EQ(sp_hs_size(hs), 1);
+  sp_hs_free(hs);
+}
+
+UTEST_F(sp_ht, incremental_growth_is_spread_over_later_operations) {
+  u32 modes [] = {
+    SP_HT_MODE_INCREMENTAL,
+    SP_HT_MODE_INCREMENTAL | SP_HT_MODE_CACHE_HASH,
+    SP_HT_MODE_INCREMENTAL | SP_HT_MODE_BACKSHIFT,
+  };
+
+  sp_carr_for(modes, m) {
+    sp_ht(u32, u32) ht = SP_NULLPTR;
+    sp_ht_init(ut.mem, ht);
+    sp_ht_set_mode(ht, modes[m]);
+
+    bool migrated = false;
+    sp_for(i, 5000) {
+      sp_ht_insert(ht, i, i);
+      migrated |= sp_ht_migrating(ht);
+
+      // Every key stays reachable while entries are split across both tables
+      if (sp_ht_migrating(ht)) {
+        sp_for(j, i + 1) {
+          u32* value = sp_ht_getp(ht, j);
+          ASSERT_NE(value, SP_NULLPTR);
+          ASSERT_EQ(*value, j);
+          if (!sp_ht_migrating(ht)) break;
+        }
+      }
+    }
+    EXPECT_TRUE(migrated);
+    EXPECT_EQ(sp_ht_size(ht), 5000);
+
+    sp_ht_free(ht);
+  }
+}
+
+UTEST_F(sp_ht, incremental_mutation_during_migration) {
+  sp_ht(u32, u32) ht = SP_NULLPTR;
+  sp_ht_init(ut.mem, ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_INCREMENTAL);
+
+  // Grow past the tiny tables, then insert until the next growth starts, so that most entries
+  // still sit in the old table when they're overwritten and erased
+  u32 n = 0;
+  while (n < 1000 || !sp_ht_migrating(ht)) {
+    sp_ht_insert(ht, n, n);
+    n++;
+  }
+
+  u32 erased = 0;
+  sp_for(i, n) {
+    if (i % 4 == 1) {
+      sp_ht_erase(ht, i);
+      erased++;
+    }
+    else if (i % 2 == 0) {
+      sp_ht_insert(ht, i, i + 69);
+    }
+  }
+  EXPECT_EQ(sp_ht_size(ht), n - erased);
+  sp_for(i, n) {
+    u32* value = sp_ht_getp(ht, i);
+    if (i % 4 == 1) EXPECT_EQ(value, SP_NULLPTR);
+    else EXPECT_EQ(*value, i % 2 ? i : i + 69);
+  }
+
+  // Iterating finishes the migration, so it sees every entry exactly once
+  sp_ht_insert(ht, n, n);
+  n++;
+  u32 count = 0;
+  sp_ht_for(ht, it) {
+    count++;
+  }
+  EXPECT_EQ(count, n - erased);
+  EXPECT_FALSE(sp_ht_migrating(ht));
+
+  sp_ht_free(ht);
+}
+
+UTEST_F(sp_ht, incremental_clear_free_and_migrate) {
+  sp_str_ht(u32) ht = SP_NULLPTR;
+  sp_str_ht_init(ut.mem, ht);
+  sp_ht_set_mode(ht, SP_HT_MODE_INCREMENTAL | SP_HT_MODE_CACHE_HASH);
+
+  sp_str_t names [] = {
+    sp_str_lit("a"), sp_str_lit("b"), sp_str_lit("c"), sp_str_lit("d"),
+    sp_str_lit("e"), sp_str_lit("f"), sp_str_lit("g"), sp_str_lit("h"),
+  };
+  sp_carr_for(names, i) {
+    sp_str_ht_insert(ht, names[i], i);
+  }
+
+  sp_ht_migrate(ht, UINT64_MAX);
+  EXPECT_FALSE(sp_ht_migrating(ht));
+  EXPECT_EQ(*sp_str_ht_get(ht, sp_str_lit("h")), 7);
+
+  // Clearing or freeing mid-migration releases the old table too
+  sp_ht_clear(ht);
+  sp_for(i, 200) {
+    sp_str_ht_insert(ht, names[i % 8], i);
+  }
+  EXPECT_EQ(sp_ht_size(ht), 8);
+
+  sp_ht(u32, u32) big = SP_NULLPTR;
+  sp_ht_init(ut.mem, big);
+  sp_ht_set_mode(big, SP_HT_MODE_INCREMENTAL);
+  u32 n = 0;
+  while (!sp_ht_migrating(big)) {
+    sp_ht_insert(big, n, n);
+    n++;
+  }
+  sp_ht_clear(big);
+  EXPECT_FALSE(sp_ht_migrating(big));
+  EXPECT_EQ(sp_ht_getp(big, 0), SP_NULLPTR);
+  while (!sp_ht_migrating(big)) {
+    sp_ht_insert(big, n, n);
+    n++;
+  }
+  sp_ht_set_mode(big, SP_HT_MODE_LINEAR);
+  EXPECT_FALSE(sp_ht_migrating(big));
+  while (sp_ht_size(big) < 1000) {
+    sp_ht_insert(big, n, n);
+    n++;
+  }
+  sp_ht_set_mode(big, SP_HT_MODE_INCREMENTAL);
+  while (!sp_ht_migrating(big)) {
+    sp_ht_insert(big, n, n);
+    n++;
+  }
+
+  sp_ht_free(ht);
+  sp_ht_free(big);
+}
+
+UTEST_F(sp_ht, mph_maps_keys_one_to_one) {
+  u32 sizes [] = { 1, 2, 3, 7, 64, 1000, 50000 };
+
+  sp_carr_for(sizes, s) {
+    u32 n = sizes[s];
+    u32* keys = sp_alloc_n(ut.mem, u32, n);
+    sp_for(i, n) keys[i] = (u32)i * 2654435761u;
+
+    sp_mph_t mph = sp_zero;
+    ASSERT_EQ(sp_mph_build(ut.mem, &mph, keys, sizeof(u32), n), SP_OK);
+    EXPECT_EQ(sp_mph_size(&mph), n);
+
+    u8* seen = sp_alloc_n(ut.mem, u8, n);
+    sp_for(i, n) {
+      u32 index = sp_mph_index(&mph, &keys[i], sizeof(u32));
+      ASSERT_LT(index, n);
+      EXPECT_FALSE(seen[index]);
+      seen[index] = 1;
+    }
+
+    sp_free(ut.mem, seen, n);
+    sp_free(ut.mem, keys, n * sizeof(u32));
+    sp_mph_free(&mph);
+  }
+}
+
+UTEST_F(sp_ht, mph_str_keys_and_misses) {
+  sp_str_t names [] = {
+    sp_str_lit("black"), sp_str_lit("red"), sp_str_lit("green"), sp_str_lit("yellow"),
+    sp_str_lit("blue"), sp_str_lit("magenta"), sp_str_lit("cyan"), sp_str_lit("white"),
+    sp_str_lit("gray"), sp_str_lit("bold"), sp_str_lit("italic"), sp_str_lit(""),
+  };
+  u32 n = sp_carr_len(names);
+
+  sp_mph_t mph = sp_zero;
+  ASSERT_EQ(sp_mph_build_str(ut.mem, &mph, names, n), SP_OK);
+
+  sp_str_t table [sp_carr_len(names)];
+  sp_carr_for(names, i) {
+    table[sp_mph_index_str(&mph, names[i])] = names[i];
+  }
+  sp_carr_for(names, i) {
+    EXPECT_TRUE(sp_str_equal(table[sp_mph_index_str(&mph, names[i])], names[i]));
+  }
+
+  // A key outside the set lands somewhere, but never on itself
+  sp_str_t missing = sp_str_lit("purple");
+  u32 index = sp_mph_index_str(&mph, missing);
+  ASSERT_LT(index, n);
+  EXPECT_FALSE(sp_str_equal(table[index], missing));
+
+  sp_mph_free(&mph);
+  EXPECT_EQ(mph.pilots, SP_NULLPTR);
+
+  // Duplicates can't be separated
+  sp_str_t dupes [] = { sp_str_lit("a"), sp_str_lit("b"), sp_str_lit("a") };
+  EXPECT_NE(sp_mph_build_str(ut.mem, &mph, dupes, 3), SP_OK);
+
+  ASSERT_EQ(sp_mph_build_str(ut.mem, &mph, names, 0), SP_OK);
+  EXPECT_EQ(sp_mph_size(&mph), 0);
+  EXPECT_EQ(sp_mph_index_str(&mph, missing), 0);
+  sp_mph_free(&mph);
+}
+
+UTEST_F(sp_ht, mph_serializes) {
+  u64 keys [500];
+  sp_carr_for(keys, i) keys[i] = (u64)i * i + 7;
+
+  sp_mph_t mph = sp_zero;
+  ASSERT_EQ(sp_mph_build(ut.mem, &mph, keys, sizeof(u64), 500), SP_OK);
+
+  sp_io_dyn_mem_writer_t io;
+  sp_io_dyn_mem_writer_init(ut.mem, &io);
+  ASSERT_EQ(sp_mph_write(&mph, &io.base), SP_OK);
+  sp_str_t bytes = sp_io_dyn_mem_writer_as_str(&io);
+
+  sp_mph_t view = sp_zero;
+  ASSERT_EQ(sp_mph_from_mem(&view, bytes.data, bytes.len), SP_OK);
+  EXPECT_EQ(sp_mph_size(&view), 500);
+  EXPECT_EQ((void*)view.pilots, (void*)(bytes.data + sizeof(sp_mph_header_t)));
+  sp_carr_for(keys, i) {
+    EXPECT_EQ(sp_mph_index(&view, &keys[i], sizeof(u64)), sp_mph_index(&mph, &keys[i], sizeof(u64)));
+  }
+
+  // Truncated, misaligned, or not an mph at all
+  EXPECT_NE(sp_mph_from_mem(&view, bytes.data, bytes.len - 1), SP_OK);
+  EXPECT_NE(sp_mph_from_mem(&view, bytes.data, sizeof(sp_mph_header_t) - 1), SP_OK);
+  EXPECT_NE(sp_mph_from_mem(&view, bytes.data + 4, bytes.len - 4), SP_OK);
+  io.storage.data[0] ^= 0xFF;
+  EXPECT_NE(sp_mph_from_mem(&view, bytes.data, bytes.len), SP_OK);
+  EXPECT_EQ(view.pilots, SP_NULLPTR);
+
+  // Freeing a view doesn't touch the bytes it was made from
+  io.storage.data[0] ^= 0xFF;
+  ASSERT_EQ(sp_mph_from_mem(&view, bytes.data, bytes.len), SP_OK);
+  sp_mph_free(&view);
+  EXPECT_EQ(view.pilots, SP_NULLPTR);
+  EXPECT_EQ(ut.tracking.wild_frees, 0);
+
+  sp_io_dyn_mem_writer_close(&io);
+  sp_mph_free(&mph);
+}
+
+UTEST_F(sp_ht, bloom_has_no_false_negatives_and_meets_its_rate) {
+  f64 rates [] = { 0.1, 0.01, 0.001 };
+
+  sp_carr_for(rates, r) {
+    sp_bloom_t bloom = sp_zero;
+    sp_bloom_init(ut.mem, &bloom, 20000, rates[r]);
+    EXPECT_LE(sp_bloom_fp_rate(bloom.num_blocks, 20000), rates[r]);
+    EXPECT_EQ(sp_uptr(bloom.blocks) % 32, 0);
+
+    sp_for(i, 20000) {
+      u64 key = i;
+      sp_bloom_insert(&bloom, &key, sizeof(key));
+    }
+    sp_for(i, 20000) {
+      u64 key = i;
+      ASSERT_TRUE(sp_bloom_contains(&bloom, &key, sizeof(key)));
+    }
+
+    // Allow for noise, but not for being off by a factor of two
+    u32 false_positives = 0;
+    sp_for(i, 100000) {
+      u64 key = 1000000 + i;
+      false_positives += sp_bloom_contains(&bloom, &key, sizeof(key));
+    }
+    EXPECT_LT((f64)false_positives / 100000, rates[r] * 2);
+
+    sp_bloom_clear(&bloom);
+    u64 key = 0;
+    EXPECT_FALSE(sp_bloom_contains(&bloom, &key, sizeof(key)));
+    sp_bloom_free(&bloom);
+    EXPECT_EQ(bloom.storage, SP_NULLPTR);
+  }
+}
+
+UTEST_F(sp_ht, bloom_clamps_out_of_range_rates) {
+  sp_bloom_t floor = sp_zero;
+  sp_bloom_init(ut.mem, &floor, 1000, SP_BLOOM_MIN_FP_RATE);
+
+  f64 zero = 0.0;
+  f64 low [] = { 0.0, -1.0, 1e-300, zero / zero };
+  sp_carr_for(low, r) {
+    sp_bloom_t bloom = sp_zero;
+    sp_bloom_init(ut.mem, &bloom, 1000, low[r]);
+    ASSERT_NE(bloom.storage, SP_NULLPTR);
+    EXPECT_EQ(bloom.num_blocks, floor.num_blocks);
+    sp_bloom_free(&bloom);
+  }
+
+  f64 high [] = { 1.0, 2.0 };
+  sp_carr_for(high, r) {
+    sp_bloom_t bloom = sp_zero;
+    sp_bloom_init(ut.mem, &bloom, 1000, high[r]);
+    ASSERT_NE(bloom.storage, SP_NULLPTR);
+    EXPECT_EQ(bloom.num_blocks, 1000 / 128);
+
+    u64 key = 42;
+    sp_bloom_insert(&bloom, &key, sizeof(key));
+    EXPECT_TRUE(sp_bloom_contains(&bloom, &key, sizeof(key)));
+    sp_bloom_free(&bloom);
+  }
+
+  sp_bloom_free(&floor);
+}
+
+UTEST_F(sp_ht, bloom_merge_and_serialize) {
+  sp_bloom_t a = sp_zero, b = sp_zero, small = sp_zero;
+  sp_bloom_init(ut.mem, &a, 1000, 0.01);
+  sp_bloom_init(ut.mem, &b, 1000, 0.01);
+  sp_bloom_init(ut.mem, &small, 10, 0.01);
+  sp_mem_arena_marker_t scratch = sp_mem_begin_scratch();
+
+  sp_for(i, 500) {
+    sp_bloom_insert_str(&a, sp_fmt(scratch.mem, "a{}", sp_fmt_uint(i)).value);
+    sp_bloom_insert_hash(&b, sp_hash_fast(&i, sizeof(i), 0));
+  }
+  EXPECT_NE(sp_bloom_merge(&a, &small), SP_OK);
+  ASSERT_EQ(sp_bloom_merge(&a, &b), SP_OK);
+
+  sp_io_dyn_mem_writer_t io;
+  sp_io_dyn_mem_writer_init(ut.mem, &io);
+  ASSERT_EQ(sp_bloom_write(&a, &io.base), SP_OK);
+  sp_str_t bytes = sp_io_dyn_mem_writer_as_str(&io);
+
+  sp_bloom_t view = sp_zero;
+  ASSERT_EQ(sp_bloom_from_mem(&view, bytes.data, bytes.len), SP_OK);
+  sp_for(i, 500) {
+    EXPECT_TRUE(sp_bloom_contains_str(&view, sp_fmt(scratch.mem, "a{}", sp_fmt_uint(i)).value));
+    EXPECT_TRUE(sp_bloom_contains_hash(&view, sp_hash_fast(&i, sizeof(i), 0)));
+  }
+  EXPECT_NE(sp_bloom_from_mem(&view, bytes.data, bytes.len - 1), SP_OK);
+  EXPECT_NE(sp_bloom_from_mem(&view, bytes.data + 8, bytes.len - 8), SP_OK);
+
+  sp_mem_end_scratch(scratch);
+  sp_io_dyn_mem_writer_close(&io);
+  sp_bloom_free(&a);
+  sp_bloom_free(&b);
+  sp_bloom_free(&small);
+}
@@ -0,0 +1,115 @@
+#include "io.h"
+
+static u8 io_mirror_rb_byte(u64 n) {
+  return (u8)(n * 131 + (n >> 8));
+}
+
+UTEST_F(io, mirror_rb_spans_stay_contiguous_across_the_wrap) {
+  SKIP_ON_WASM()
+  sp_mirror_rb_t rb = sp_zero;
+  ASSERT_EQ(sp_mirror_rb_init(&rb, 1000), SP_OK);
+
+  u64 capacity = sp_mirror_rb_capacity(&rb);
+  EXPECT_EQ(capacity, SP_MIRROR_RB_GRANULARITY);
+
+  // Both mappings are the same memory
+  rb.data[3] = 0xAB;
+  EXPECT_EQ(rb.data[capacity + 3], 0xAB);
+
+  // Push the head most of the way around, so that every span below straddles the end
+  u64 written = 0;
+  u64 consumed = 0;
+  u64 n = 0;
+  u8* dst = sp_mirror_rb_write_span(&rb, &n);
+  EXPECT_EQ(n, capacity);
+  u64 first = capacity - 100;
+  sp_for(it, first) dst[it] = io_mirror_rb_byte(written + it);
+  sp_mirror_rb_write_commit(&rb, first);
+  written += first;
+  sp_mirror_rb_read_commit(&rb, first - 10);
+  consumed += first - 10;
+
+  dst = sp_mirror_rb_write_span(&rb, &n);
+  EXPECT_EQ(n, capacity - 10);
+  sp_for(it, n) dst[it] = io_mirror_rb_byte(written + it);
+  sp_mirror_rb_write_commit(&rb, n);
+  written += n;
+  EXPECT_EQ(sp_mirror_rb_space(&rb), 0);
+  EXPECT_EQ(sp_mirror_rb_write(&rb, "x", 1), 0);
+
+  const u8* src = sp_mirror_rb_read_span(&rb, &n);
+  EXPECT_EQ(n, capacity);
+  bool match = true;
+  sp_for(it, n) match &= src[it] == io_mirror_rb_byte(consumed + it);
+  EXPECT_TRUE(match);
+
+  u8 out [64];
+  EXPECT_EQ(sp_mirror_rb_read(&rb, out, sizeof(out)), sizeof(out));
+  EXPECT_EQ(out[63], io_mirror_rb_byte(consumed + 63));
+  EXPECT_EQ(sp_mirror_rb_size(&rb), capacity - sizeof(out));
+
+  sp_mirror_rb_clear(&rb);
+  EXPECT_EQ(sp_mirror_rb_size(&rb), 0);
+
+  sp_mirror_rb_free(&rb);
+}
+
+UTEST_F(io, mirror_rb_reader_and_writer) {
+  SKIP_ON_WASM()
+  sp_mirror_rb_t rb = sp_zero;
+  ASSERT_EQ(sp_mirror_rb_init(&rb, 0), SP_OK);
+  u64 capacity = sp_mirror_rb_capacity(&rb);
+
+  sp_io_mirror_rb_writer_t w = sp_zero;
+  sp_io_mirror_rb_writer_init(&w, &rb);
+  sp_io_mirror_rb_reader_t r = sp_zero;
+  sp_io_mirror_rb_reader_init(&r, &rb);
+
+  u8 out [16];
+  u64 bytes = 0;
+  EXPECT_EQ(sp_io_read(&r.base, out, sizeof(out), &bytes), SP_ERR_IO_EOF);
+  EXPECT_EQ(bytes, 0);
+
+  // Fill all but the last few bytes, then read most of it back out
+  u8 block [4096];
+  sp_for(it, sizeof(block)) block[it] = (u8)it;
+  u64 total = 0;
+  while (total < capacity - 8) {
+    u64 n = sp_min(sizeof(block), capacity - 8 - total);
+    EXPECT_EQ(sp_io_write(&w.base, block, n, &bytes), SP_OK);
+    total += bytes;
+  }
+  while (sp_mirror_rb_size(&rb) - r.base.cursor > 32 || !r.base.buffer.len) {
+    EXPECT_EQ(sp_io_read(&r.base, out, sizeof(out), &bytes), SP_OK);
+    EXPECT_EQ(bytes, sizeof(out));
+  }
+
+  // Nothing goes back to the ring until the reader syncs
+  u64 space = sp_mirror_rb_space(&rb);
+  sp_io_mirror_rb_reader_sync(&r);
+  EXPECT_TRUE(sp_mirror_rb_space(&rb) > space);
+
+  // Wrap around, and the reader sees everything through one buffer
+  EXPECT_EQ(sp_io_write_str(&w.base, sp_str_lit("hello, mirror"), &bytes), SP_OK);
+  sp_io_mirror_rb_reader_sync(&r);
+  u64 len = r.base.buffer.len - r.base.cursor;
+  sp_str_t tail = sp_str((const c8*)r.base.buffer.data + r.base.cursor + len - 13, 13);
+  EXPECT_TRUE(sp_str_equal(tail, sp_str_lit("hello, mirror")));
+  EXPECT_TRUE(r.base.buffer.data + len > rb.data + capacity);
+
+  // Draining through sp_io_read() ends on the same bytes
+  u8* rest = (u8*)sp_alloc(ut.mem, capacity);
+  EXPECT_EQ(sp_io_read(&r.base, rest, capacity, &bytes), SP_OK);
+  EXPECT_EQ(bytes, len);
+  EXPECT_TRUE(sp_mem_is_equal(rest + len - 13, "hello, mirror", 13));
+  EXPECT_EQ(sp_io_read(&r.base, rest, capacity, &bytes), SP_ERR_IO_EOF);
+  EXPECT_EQ(sp_mirror_rb_size(&rb), 0);
+
+  // A write that doesn't fit takes what it can
+  sp_mirror_rb_clear(&rb);
+  sp_mirror_rb_write_commit(&rb, capacity - 4);
+  EXPECT_EQ(sp_io_write(&w.base, "abcdefgh", 8, &bytes), SP_ERR_IO_NO_SPACE);
+  EXPECT_EQ(bytes, 4);
+
+  sp_mirror_rb_free(&rb);
+}
@@ -387,3 +387,258 @@ UTEST_F(sp_rb, set_mode_after_init) {
 
   sp_rb_free(q);
 }
+
+UTEST_F(sp_rb, overwrite_odd_capacity) {
+  sp_rb(s32) q = SP_NULLPTR;
+  sp_rb_init_cap(ut.mem, q, 5);
+  sp_rb_set_mode(q, SP_RQ_MODE_OVERWRITE);
+  EXPECT_EQ(5, sp_rb_capacity(q));
+
+  sp_for(i, 12) {
+    sp_rb_push(q, (s32)i);
+  }
+
+  EXPECT_EQ(5, sp_rb_size(q));
+  sp_rb_for(q, it) {
+    EXPECT_EQ((s32)(7 + it), sp_rb_at(q, it));
+  }
+
+  sp_rb_free(q);
+}
+
+//////////
+// SPSC //
+//////////
+UTEST_F(sp_rb, spsc_push_pop_wraps) {
+  sp_spsc_t queue = sp_zero;
+  sp_spsc_init(ut.mem, &queue, sizeof(u32), 6);
+  EXPECT_EQ(8, sp_spsc_capacity(&queue));
+
+  u32 value = 0;
+  EXPECT_FALSE(sp_spsc_pop(&queue, &value));
+
+  u32 next_push = 0, next_pop = 0;
+  sp_for(round, 10) {
+    while (sp_spsc_push(&queue, &next_push)) next_push++;
+    EXPECT_EQ(8, sp_spsc_size(&queue));
+
+    sp_for(it, 5) {
+      ASSERT_TRUE(sp_spsc_pop(&queue, &value));
+      EXPECT_EQ(next_pop++, value);
+    }
+    EXPECT_EQ(3, sp_spsc_size(&queue));
+  }
+
+  while (sp_spsc_pop(&queue, &value)) {
+    EXPECT_EQ(next_pop++, value);
+  }
+  EXPECT_EQ(next_push, next_pop);
+  EXPECT_EQ(0, sp_spsc_size(&queue));
+
+  sp_spsc_free(&queue);
+}
+
+UTEST_F(sp_rb, spsc_bulk_and_spans) {
+  sp_spsc_t queue = sp_zero;
+  sp_spsc_init(ut.mem, &queue, sizeof(u64), 16);
+
+  u64 items [24];
+  sp_carr_for(items, it) items[it] = it;
+
+  // Offset the ring so that bulk operations have to split across the end
+  EXPECT_EQ(10, sp_spsc_push_n(&queue, items, 10));
+  EXPECT_EQ(10, sp_spsc_pop_n(&queue, items, 10));
+
+  EXPECT_EQ(16, sp_spsc_push_n(&queue, items, 24));
+  EXPECT_EQ(0, sp_spsc_push_n(&queue, items, 1));
+
+  u64 out [24] = sp_zero;
+  EXPECT_EQ(16, sp_spsc_pop_n(&queue, out, 24));
+  sp_for(it, 16) {
+    EXPECT_EQ(items[it], out[it]);
+  }
+
+  // The write span stops at the end of the storage, even when more slots are free
+  u32 n = 0;
+  u64* span = (u64*)sp_spsc_write_span(&queue, &n);
+  EXPECT_EQ(6, n);
+  sp_for(it, 4) span[it] = 100 + it;
+  sp_spsc_write_commit(&queue, 4);
+  EXPECT_EQ(4, sp_spsc_size(&queue));
+
+  const u64* read = (const u64*)sp_spsc_read_span(&queue, &n);
+  EXPECT_EQ(4, n);
+  EXPECT_EQ(100, read[0]);
+  EXPECT_EQ(103, read[3]);
+  sp_spsc_read_commit(&queue, 2);
+  EXPECT_EQ(2, sp_spsc_size(&queue));
+
+  sp_spsc_free(&queue);
+}
+
+#define SPSC_THREADED_ITEMS 200000
+
+typedef struct {
+  sp_spsc_t* queue;
+  u64 sum;
+  bool ordered;
+} spsc_consumer_t;
+
+static s32 spsc_consumer(void* user_data) {
+  spsc_consumer_t* consumer = (spsc_consumer_t*)user_data;
+  u64 expected = 0;
+  u64 items [32];
+  while (expected < SPSC_THREADED_ITEMS) {
+    u32 n = sp_spsc_pop_n(consumer->queue, items, sp_carr_len(items));
+    if (!n) sp_os_sleep_ns(0);
+    sp_for(it, n) {
+      consumer->ordered &= items[it] == expected;
+      consumer->sum += items[it];
+      expected++;
+    }
+  }
+  return 0;
+}
+
+UTEST_F(sp_rb, spsc_threaded_preserves_order) {
+  sp_spsc_t queue = sp_zero;
+  sp_spsc_init(ut.mem, &queue, sizeof(u64), 64);
+
+  spsc_consumer_t consumer = { .queue = &queue, .sum = 0, .ordered = true };
+  sp_thread_t thread;
+  sp_thread_init(&thread, spsc_consumer, &consumer);
+
+  u64 expected_sum = 0;
+  for (u64 item = 0; item < SPSC_THREADED_ITEMS; item++) {
+    while (!sp_spsc_push(&queue, &item)) sp_os_sleep_ns(0);
+    expected_sum += item;
+  }
+
+  sp_thread_join(&thread);
+  EXPECT_TRUE(consumer.ordered);
+  EXPECT_EQ(expected_sum, consumer.sum);
+  EXPECT_EQ(0, sp_spsc_size(&queue));
+
+  sp_spsc_free(&queue);
+}
+
+//////////
+// MPMC //
+//////////
+UTEST_F(sp_rb, mpmc_fill_and_drain) {
+  sp_mpmc_t queue = sp_zero;
+  sp_mpmc_init(ut.mem, &queue, sizeof(u32), 5, SP_MPMC_WAIT_SPIN);
+  EXPECT_EQ(8, sp_mpmc_capacity(&queue));
+
+  u32 value = 0;
+  EXPECT_FALSE(sp_mpmc_try_pop(&queue, &value));
+  EXPECT_FALSE(sp_mpmc_pop_for(&queue, &value, 1));
+
+  // Several laps, so every slot's sequence number wraps at least once
+  u32 next_push = 0, next_pop = 0;
+  sp_for(round, 10) {
+    while (sp_mpmc_try_push(&queue, &next_push)) next_push++;
+    EXPECT_EQ(8, sp_mpmc_size(&queue));
+    EXPECT_FALSE(sp_mpmc_push_for(&queue, &next_push, 1));
+
+    sp_for(it, 5) {
+      ASSERT_TRUE(sp_mpmc_try_pop(&queue, &value));
+      EXPECT_EQ(next_pop++, value);
+    }
+  }
+
+  while (sp_mpmc_try_pop(&queue, &value)) {
+    EXPECT_EQ(next_pop++, value);
+  }
+  EXPECT_EQ(next_push, next_pop);
+  EXPECT_EQ(0, sp_mpmc_size(&queue));
+
+  sp_mpmc_free(&queue);
+}
+
+UTEST_F(sp_rb, mpmc_capacity_is_at_least_two) {
+  sp_mpmc_t queue = sp_zero;
+  sp_mpmc_init(ut.mem, &queue, sizeof(u64), 1, SP_MPMC_WAIT_SPIN);
+  EXPECT_EQ(2, sp_mpmc_capacity(&queue));
+
+  u64 value = 7;
+  EXPECT_TRUE(sp_mpmc_try_push(&queue, &value));
+  EXPECT_TRUE(sp_mpmc_try_push(&queue, &value));
+  EXPECT_FALSE(sp_mpmc_try_push(&queue, &value));
+
+  sp_mpmc_free(&queue);
+}
+
+#define MPMC_THREADS 4
+#define MPMC_ITEMS_PER_THREAD 50000
+
+typedef struct {
+  sp_mpmc_t* queue;
+  u64 first;
+  u64 sum;
+  sp_thread_t thread;
+} mpmc_worker_t;
+
+static s32 mpmc_producer(void* user_data) {
+  mpmc_worker_t* worker = (mpmc_worker_t*)user_data;
+  sp_for(it, MPMC_ITEMS_PER_THREAD) {
+    u64 item = worker->first + it;
+    sp_mpmc_push(worker->queue, &item);
+  }
+  return 0;
+}
+
+static s32 mpmc_consumer(void* user_data) {
+  mpmc_worker_t* worker = (mpmc_worker_t*)user_data;
+  sp_for(it, MPMC_ITEMS_PER_THREAD) {
+    u64 item = 0;
+    sp_mpmc_pop(worker->queue, &item);
+    worker->sum += item;
+  }
+  return 0;
+}
+
+static u64 mpmc_run_threads(sp_mpmc_t* queue) {
+  mpmc_worker_t producers [MPMC_THREADS] = sp_zero;
+  mpmc_worker_t consumers [MPMC_THREADS] = sp_zero;
+
+  sp_for(it, MPMC_THREADS) {
+    consumers[it].queue = queue;
+    sp_thread_init(&consumers[it].thread, mpmc_consumer, &consumers[it]);
+  }
+  sp_for(it, MPMC_THREADS) {
+    producers[it].queue = queue;
+    producers[it].first = (u64)it * MPMC_ITEMS_PER_THREAD;
+    sp_thread_init(&producers[it].thread, mpmc_producer, &producers[it]);
+  }
+
+  u64 sum = 0;
+  sp_for(it, MPMC_THREADS) {
+    sp_thread_join(&producers[it].thread);
+    sp_thread_join(&consumers[it].thread);
+    sum += consumers[it].sum;
+  }
+  return sum;
+}
+
+UTEST_F(sp_rb, mpmc_threaded_spin) {
+  sp_mpmc_t queue = sp_zero;
+  sp_mpmc_init(ut.mem, &queue, sizeof(u64), 64, SP_MPMC_WAIT_SPIN);
+
+  u64 n = (u64)MPMC_THREADS * MPMC_ITEMS_PER_THREAD;
+  EXPECT_EQ(n * (n - 1) / 2, mpmc_run_threads(&queue));
+  EXPECT_EQ(0, sp_mpmc_size(&queue));
+
+  sp_mpmc_free(&queue);
+}
+
+UTEST_F(sp_rb, mpmc_threaded_semaphore) {
+  sp_mpmc_t queue = sp_zero;
+  sp_mpmc_init(ut.mem, &queue, sizeof(u64), 16, SP_MPMC_WAIT_SEMAPHORE);
+
+  u64 n = (u64)MPMC_THREADS * MPMC_ITEMS_PER_THREAD;
+  EXPECT_EQ(n * (n - 1) / 2, mpmc_run_threads(&queue));
+  EXPECT_EQ(0, sp_mpmc_size(&queue));
+
+  sp_mpmc_free(&queue);
+}
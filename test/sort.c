@@ -0,0 +1,267 @@
+#include "sp.h"
+#include "test.h"
+
+#include "utest.h"
+
+SP_TEST_MAIN()
+
+typedef struct {
+  u32 key;
+  u32 order;
+} test_sort_record_t;
+
+typedef enum {
+  TEST_SORT_RANDOM,
+  TEST_SORT_SORTED,
+  TEST_SORT_REVERSED,
+  TEST_SORT_FEW_UNIQUE,
+  TEST_SORT_ORGAN_PIPE,
+  TEST_SORT_SAWTOOTH,
+} test_sort_pattern_t;
+
+static u64 test_sort_rng(u64* state) {
+  u64 x = *state;
+  x ^= x >> 12; x ^= x << 25; x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void test_sort_fill(u32* keys, u32 n, test_sort_pattern_t pattern) {
+  u64 rng = 0x5EED5EED5EED5EEDULL + n;
+  sp_for(it, n) {
+    switch (pattern) {
+      case TEST_SORT_RANDOM:     keys[it] = (u32)test_sort_rng(&rng); break;
+      case TEST_SORT_SORTED:     keys[it] = it; break;
+      case TEST_SORT_REVERSED:   keys[it] = n - it; break;
+      case TEST_SORT_FEW_UNIQUE: keys[it] = (u32)(test_sort_rng(&rng) % 4); break;
+      case TEST_SORT_ORGAN_PIPE: keys[it] = it < n / 2 ? it : n - it; break;
+      case TEST_SORT_SAWTOOTH:   keys[it] = it % 37; break;
+    }
+  }
+}
+
+static s32 test_sort_cmp_u32(const void* a, const void* b) {
+  u32 x = *(const u32*)a;
+  u32 y = *(const u32*)b;
+  return x < y ? -1 : x > y;
+}
+
+static s32 test_sort_cmp_record(const void* a, const void* b) {
+  return test_sort_cmp_u32(&((const test_sort_record_t*)a)->key, &((const test_sort_record_t*)b)->key);
+}
+
+static bool test_sort_is_sorted(u32* keys, u32 n) {
+  for (u32 it = 1; it < n; it++) {
+    if (keys[it - 1] > keys[it]) return false;
+  }
+  return true;
+}
+
+static u64 test_sort_checksum(u32* keys, u32 n) {
+  u64 sum = 0;
+  sp_for(it, n) sum += (u64)keys[it] * 0x9E3779B97F4A7C15ULL ^ keys[it];
+  return sum;
+}
+
+static const u32 test_sort_sizes [] = { 0, 1, 2, 3, 23, 24, 25, 127, 128, 129, 1000, 50000 };
+static const test_sort_pattern_t test_sort_patterns [] = {
+  TEST_SORT_RANDOM, TEST_SORT_SORTED, TEST_SORT_REVERSED,
+  TEST_SORT_FEW_UNIQUE, TEST_SORT_ORGAN_PIPE, TEST_SORT_SAWTOOTH,
+};
+
+UTEST(sp_sort, patterns) {
+  u32* keys = (u32*)sp_mem_os_alloc(50000 * sizeof(u32));
+  sp_carr_for(test_sort_patterns, p) {
+    sp_carr_for(test_sort_sizes, s) {
+      u32 n = test_sort_sizes[s];
+      test_sort_fill(keys, n, test_sort_patterns[p]);
+      u64 checksum = test_sort_checksum(keys, n);
+
+      sp_sort(keys, n, sizeof(u32), test_sort_cmp_u32);
+      EXPECT_TRUE(test_sort_is_sorted(keys, n));
+      EXPECT_EQ(test_sort_checksum(keys, n), checksum);
+    }
+  }
+  sp_mem_os_free(keys, 50000 * sizeof(u32));
+}
+
+UTEST(sp_sort_by, patterns) {
+  u32* keys = (u32*)sp_mem_os_alloc(50000 * sizeof(u32));
+  sp_carr_for(test_sort_patterns, p) {
+    sp_carr_for(test_sort_sizes, s) {
+      u32 n = test_sort_sizes[s];
+      test_sort_fill(keys, n, test_sort_patterns[p]);
+      u64 checksum = test_sort_checksum(keys, n);
+
+      sp_sort_by(keys, n, u32, a, b, *a < *b);
+      EXPECT_TRUE(test_sort_is_sorted(keys, n));
+      EXPECT_EQ(test_sort_checksum(keys, n), checksum);
+    }
+  }
+  sp_mem_os_free(keys, 50000 * sizeof(u32));
+}
+
+UTEST(sp_sort, large_stride) {
+  typedef struct {
+    u32 key;
+    u8 payload [100];
+  } big_t;
+
+  big_t items [300];
+  u64 rng = 7;
+  sp_carr_for(items, it) {
+    items[it].key = (u32)(test_sort_rng(&rng) % 1000);
+    sp_mem_fill_u8(items[it].payload, sizeof(items[it].payload), (u8)items[it].key);
+  }
+
+  sp_sort(items, sp_carr_len(items), sizeof(big_t), test_sort_cmp_u32);
+  for (u32 it = 1; it < sp_carr_len(items); it++) {
+    EXPECT_LE(items[it - 1].key, items[it].key);
+  }
+  sp_carr_for(items, it) {
+    EXPECT_EQ(items[it].payload[99], (u8)items[it].key);
+  }
+}
+
+UTEST(sp_sort, os_qsort_strings) {
+  sp_str_t strings [] = {
+    sp_str_lit("pear"), sp_str_lit("apple"), sp_str_lit("fig"), sp_str_lit("banana"),
+  };
+  sp_os_qsort(strings, sp_carr_len(strings), sizeof(sp_str_t), sp_str_sort_kernel_alphabetical);
+  SP_EXPECT_STR_EQ_CSTR(strings[0], "apple");
+  SP_EXPECT_STR_EQ_CSTR(strings[1], "banana");
+  SP_EXPECT_STR_EQ_CSTR(strings[2], "fig");
+  SP_EXPECT_STR_EQ_CSTR(strings[3], "pear");
+}
+
+static u32 test_sort_distance(u32 key, u32 pivot) {
+  return key > pivot ? key - pivot : pivot - key;
+}
+
+UTEST(sp_sort_by, da_struct_field) {
+  sp_da(test_sort_record_t) records = sp_da_new(sp_mem_get_scratch(), test_sort_record_t);
+  u64 rng = 11;
+  sp_for(it, 500) {
+    test_sort_record_t record = { .key = (u32)(test_sort_rng(&rng) % 100), .order = it };
+    sp_da_push(records, record);
+  }
+
+  sp_da_sort_by(records, test_sort_record_t, a, b, a->key > b->key);
+  for (u32 it = 1; it < sp_da_size(records); it++) {
+    EXPECT_GE(records[it - 1].key, records[it].key);
+  }
+
+  // The comparison reads caller variables named like the range bounds the macro keeps while
+  // partitioning, and like the element names other sorts use; if the macro shadowed any of
+  // them, the order below would be wrong
+  u32 lo = 20, hi = 80, a = 10;
+  sp_da_sort_by(records, test_sort_record_t, x, y,
+    test_sort_distance(x->key, (lo + hi) / 2 + a) < test_sort_distance(y->key, (lo + hi) / 2 + a));
+  for (u32 it = 1; it < sp_da_size(records); it++) {
+    EXPECT_LE(test_sort_distance(records[it - 1].key, 60), test_sort_distance(records[it].key, 60));
+  }
+}
+
+UTEST(sp_radix_sort, u32_matches_sp_sort) {
+  u32* keys = (u32*)sp_mem_os_alloc(50000 * sizeof(u32));
+  u32* expected = (u32*)sp_mem_os_alloc(50000 * sizeof(u32));
+  sp_carr_for(test_sort_patterns, p) {
+    sp_carr_for(test_sort_sizes, s) {
+      u32 n = test_sort_sizes[s];
+      test_sort_fill(keys, n, test_sort_patterns[p]);
+      sp_mem_copy(expected, keys, n * sizeof(u32));
+
+      sp_sort(expected, n, sizeof(u32), test_sort_cmp_u32);
+      ASSERT_EQ(sp_radix_sort_u32(sp_mem_os_new(), keys, n), SP_OK);
+      EXPECT_TRUE(sp_mem_is_equal(keys, expected, n * sizeof(u32)));
+    }
+  }
+  sp_mem_os_free(keys, 50000 * sizeof(u32));
+  sp_mem_os_free(expected, 50000 * sizeof(u32));
+}
+
+UTEST(sp_radix_sort, signed_and_float) {
+  s32 ints [] = { 5, -1, 0, -2147483647 - 1, 2147483647, -7, 3 };
+  s32 ints_sorted [] = { -2147483647 - 1, -7, -1, 0, 3, 5, 2147483647 };
+  ASSERT_EQ(sp_radix_sort_s32(sp_mem_os_new(), ints, sp_carr_len(ints)), SP_OK);
+  EXPECT_TRUE(sp_mem_is_equal(ints, ints_sorted, sizeof(ints)));
+
+  s64 longs [] = { 1ll << 40, -(1ll << 40), 0, -1, 1 };
+  s64 longs_sorted [] = { -(1ll << 40), -1, 0, 1, 1ll << 40 };
+  ASSERT_EQ(sp_radix_sort_s64(sp_mem_os_new(), longs, sp_carr_len(longs)), SP_OK);
+  EXPECT_TRUE(sp_mem_is_equal(longs, longs_sorted, sizeof(longs)));
+
+  f32 floats [] = { 1.5f, -0.25f, 0.f, -1000.f, 3.f, -0.5f, 1e30f, -1e-30f };
+  f32 floats_sorted [] = { -1000.f, -0.5f, -0.25f, -1e-30f, 0.f, 1.5f, 3.f, 1e30f };
+  ASSERT_EQ(sp_radix_sort_f32(sp_mem_os_new(), floats, sp_carr_len(floats)), SP_OK);
+  EXPECT_TRUE(sp_mem_is_equal(floats, floats_sorted, sizeof(floats)));
+
+  f64 doubles [] = { 2.0, -3.5, 0.125, -0.125, 1e300, -1e300 };
+  f64 doubles_sorted [] = { -1e300, -3.5, -0.125, 0.125, 2.0, 1e300 };
+  ASSERT_EQ(sp_radix_sort_f64(sp_mem_os_new(), doubles, sp_carr_len(doubles)), SP_OK);
+  EXPECT_TRUE(sp_mem_is_equal(doubles, doubles_sorted, sizeof(doubles)));
+
+  u64 wide [] = { 0xFFFFFFFF00000000ull, 1, 0x100000000ull, 0 };
+  u64 wide_sorted [] = { 0, 1, 0x100000000ull, 0xFFFFFFFF00000000ull };
+  ASSERT_EQ(sp_radix_sort_u64(sp_mem_os_new(), wide, sp_carr_len(wide)), SP_OK);
+  EXPECT_TRUE(sp_mem_is_equal(wide, wide_sorted, sizeof(wide)));
+}
+
+UTEST(sp_radix_sort, records_are_stable) {
+  test_sort_record_t records [2000];
+  u64 rng = 3;
+  sp_carr_for(records, it) {
+    records[it].key = (u32)(test_sort_rng(&rng) % 50) << 16;
+    records[it].order = it;
+  }
+
+  u64 stride = sizeof(test_sort_record_t);
+  ASSERT_EQ(sp_radix_sort_ex(sp_mem_os_new(), records, sp_carr_len(records), stride, 0, SP_RADIX_KEY_U32), SP_OK);
+  for (u32 it = 1; it < sp_carr_len(records); it++) {
+    EXPECT_LE(records[it - 1].key, records[it].key);
+    if (records[it - 1].key == records[it].key) {
+      EXPECT_LT(records[it - 1].order, records[it].order);
+    }
+  }
+
+  sp_sort(records, sp_carr_len(records), sizeof(test_sort_record_t), test_sort_cmp_record);
+  for (u32 it = 1; it < sp_carr_len(records); it++) {
+    EXPECT_LE(records[it - 1].key, records[it].key);
+  }
+}
+
+UTEST(sp_radix_sort, packed_keys) {
+  // One tag byte followed by a u64 key, so every key after the first is misaligned
+  u8 records [300 * 9];
+  u64 rng = 5;
+  sp_for(it, 300) {
+    u64 key = test_sort_rng(&rng) % 1000;
+    records[it * 9] = (u8)it;
+    sp_mem_copy(records + it * 9 + 1, &key, sizeof(key));
+  }
+
+  ASSERT_EQ(sp_radix_sort_ex(sp_mem_os_new(), records, 300, 9, 1, SP_RADIX_KEY_U64), SP_OK);
+  u64 last = 0;
+  sp_for(it, 300) {
+    u64 key = 0;
+    sp_mem_copy(&key, records + it * 9 + 1, sizeof(key));
+    EXPECT_LE(last, key);
+    last = key;
+  }
+}
+
+static void* test_sort_no_mem(void* user_data, sp_mem_alloc_mode_t mode, u64 size, void* ptr, u64 old_size) {
+  (void)user_data; (void)mode; (void)size; (void)ptr; (void)old_size;
+  return SP_NULLPTR;
+}
+
+UTEST(sp_radix_sort, reports_allocation_failure) {
+  sp_mem_t mem = { .on_alloc = test_sort_no_mem };
+  u32 keys [] = { 3, 1, 2 };
+  u32 unsorted [] = { 3, 1, 2 };
+  EXPECT_NE(sp_radix_sort_u32(mem, keys, sp_carr_len(keys)), SP_OK);
+  EXPECT_TRUE(sp_mem_is_equal(keys, unsorted, sizeof(keys)));
+
+  // Nothing to sort, so nothing to allocate
+  EXPECT_EQ(sp_radix_sort_u32(mem, keys, 1), SP_OK);
+}
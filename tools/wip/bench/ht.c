@@ -1,4 +1,4 @@
-#define SP_APP
+#define SP_IMPLEMENTATION
 #include "sp.h"
 #include "sp/sp_math.h"
 
@@ -39,6 +39,7 @@ static sp_str_t color_for_ratio(f64 ratio) {
 
 typedef enum {
   BENCH_LIB_SP,
+  BENCH_LIB_SP_SIP,
   BENCH_LIB_STB,
 } bench_lib_t;
 
@@ -70,6 +71,7 @@ typedef struct {
   sp_str_t name;
   u32 n;
   u64 sp_time_ns;
+  u64 sp_sip_time_ns;
   u64 stb_time_ns;
 } bench_result_pair_t;
 
@@ -119,12 +121,14 @@ static void run_benchmarks(bench_t* benches, u32 num_benches) {
       if (!n) break;
 
       u64 sp_time = run_single_bench(bench, (bench_params_t){ .n = n, .lib = BENCH_LIB_SP }, &data);
+      u64 sp_sip_time = run_single_bench(bench, (bench_params_t){ .n = n, .lib = BENCH_LIB_SP_SIP }, &data);
       u64 stb_time = run_single_bench(bench, (bench_params_t){ .n = n, .lib = BENCH_LIB_STB }, &data);
 
       sp_da_push(results, ((bench_result_pair_t){
         .name = bench->name,
         .n = n,
         .sp_time_ns = sp_time,
+        .sp_sip_time_ns = sp_sip_time,
         .stb_time_ns = stb_time,
       }));
     }
@@ -142,13 +146,14 @@ static void run_benchmarks(bench_t* benches, u32 num_benches) {
     if (n_str.len > max_n_width) max_n_width = n_str.len;
   }
 
-  sp_io_writer_t sb = sp_zero;
+  sp_io_dyn_mem_writer_t sb = sp_zero;
   sp_io_dyn_mem_writer_init(sp_mem_get_scratch(), &sb);
-  sp_fmt_io(&sb, "{}{} {} {} {} {}{}\n",
+  sp_fmt_io(&sb.base, "{}{} {} {} {} {} {}{}\n",
     sp_fmt_cstr(SP_ANSI_FG_BRIGHT_BLACK),
     sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), sp_str_lit("test"), max_name)),
     sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), sp_str_lit("n"), max_n_width)),
     sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), sp_str_lit("sp_ht"), time_width)),
+    sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), sp_str_lit("sp_ht (sip)"), time_width)),
     sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), sp_str_lit("stb_ds"), time_width)),
     sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), sp_str_lit("ratio"), ratio_width)),
     sp_fmt_cstr(SP_ANSI_RESET));
@@ -158,18 +163,21 @@ static void run_benchmarks(bench_t* benches, u32 num_benches) {
 
     sp_str_t n_str = sp_fmt(sp_mem_get_scratch(), "{}", sp_fmt_uint(r->n)).value;
     f64 sp_ms = sp_tm_ns_to_ms_f((f64)r->sp_time_ns);
+    f64 sp_sip_ms = sp_tm_ns_to_ms_f((f64)r->sp_sip_time_ns);
     f64 stb_ms = sp_tm_ns_to_ms_f((f64)r->stb_time_ns);
     f64 ratio = sp_ms / stb_ms;
 
     sp_str_t sp_time_str = sp_str_pad(sp_mem_get_scratch(), sp_fmt(sp_mem_get_scratch(), "{}ms", sp_fmt_float(sp_ms)).value, time_width);
+    sp_str_t sp_sip_time_str = sp_str_pad(sp_mem_get_scratch(), sp_fmt(sp_mem_get_scratch(), "{}ms", sp_fmt_float(sp_sip_ms)).value, time_width);
     sp_str_t stb_time_str = sp_str_pad(sp_mem_get_scratch(), sp_fmt(sp_mem_get_scratch(), "{}ms", sp_fmt_float(stb_ms)).value, time_width);
     sp_str_t ratio_color = color_for_ratio(ratio);
     sp_str_t ratio_str = sp_str_pad(sp_mem_get_scratch(), sp_fmt(sp_mem_get_scratch(), "{}x", sp_fmt_float(ratio)).value, ratio_width);
 
-    sp_fmt_io(&sb, "{} {} {} {} {}{}{}\n",
+    sp_fmt_io(&sb.base, "{} {} {} {} {} {}{}{}\n",
       sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), r->name, max_name)),
       sp_fmt_str(sp_str_pad(sp_mem_get_scratch(), n_str, max_n_width)),
       sp_fmt_str(sp_time_str),
+      sp_fmt_str(sp_sip_time_str),
       sp_fmt_str(stb_time_str),
       sp_fmt_str(ratio_color),
       sp_fmt_str(ratio_str),
@@ -180,10 +188,18 @@ static void run_benchmarks(bench_t* benches, u32 num_benches) {
   sp_os_print(output);
 }
 
+static void bench_sp_init(bench_params_t p, bench_data_t* data) {
+  sp_ht_init(sp_mem_os_new(), data->sp);
+  if (p.lib == BENCH_LIB_SP_SIP) {
+    sp_ht_set_hash(data->sp, sp_ht_on_hash_key_sip);
+  }
+}
+
 static void kernel_deinit(bench_params_t p, bench_data_t* data) {
   (void)p;
   switch (p.lib) {
-    case BENCH_LIB_SP: {
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
       sp_ht_free(data->sp);
       data->sp = SP_NULLPTR;
       break;
@@ -198,8 +214,9 @@ static void kernel_deinit(bench_params_t p, bench_data_t* data) {
 
 static void kernel_seq_insert(bench_params_t p, bench_data_t* data) {
   switch (p.lib) {
-    case BENCH_LIB_SP: {
-      sp_ht_init(sp_mem_os_new(), data->sp);
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
+      bench_sp_init(p, data);
       sp_for(i, p.n) {
         sp_ht_insert(data->sp, i, i);
         SP_COMPILER_BARRIER();
@@ -218,8 +235,9 @@ static void kernel_seq_insert(bench_params_t p, bench_data_t* data) {
 
 static void kernel_seq_lookup_init(bench_params_t p, bench_data_t* data) {
   switch (p.lib) {
-    case BENCH_LIB_SP: {
-      sp_ht_init(sp_mem_os_new(), data->sp);
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
+      bench_sp_init(p, data);
       sp_for(i, p.n) {
         sp_ht_insert(data->sp, (s32)i, (u64)i);
       }
@@ -237,7 +255,8 @@ static void kernel_seq_lookup_init(bench_params_t p, bench_data_t* data) {
 static void kernel_seq_lookup(bench_params_t p, bench_data_t* data) {
   u64 sum = 0;
   switch (p.lib) {
-    case BENCH_LIB_SP: {
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
       sp_for(i, p.n) {
         u64* v = sp_ht_getp(data->sp, (s32)i);
         if (v) sum += *v;
@@ -270,8 +289,9 @@ static void kernel_rnd_init(bench_params_t p, bench_data_t* data) {
 static void kernel_rnd_insert(bench_params_t p, bench_data_t* data) {
   kernel_rnd_init(p, data);
   switch (p.lib) {
-    case BENCH_LIB_SP: {
-      sp_ht_init(sp_mem_os_new(), data->sp);
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
+      bench_sp_init(p, data);
       sp_for(i, p.n) {
         sp_ht_insert(data->sp, data->random_keys[i], (u64)i);
         SP_COMPILER_BARRIER();
@@ -291,8 +311,9 @@ static void kernel_rnd_insert(bench_params_t p, bench_data_t* data) {
 static void kernel_rnd_lookup_init(bench_params_t p, bench_data_t* data) {
   kernel_rnd_init(p, data);
   switch (p.lib) {
-    case BENCH_LIB_SP: {
-      sp_ht_init(sp_mem_os_new(), data->sp);
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
+      bench_sp_init(p, data);
       sp_for(i, p.n) {
         sp_ht_insert(data->sp, data->random_keys[i], (u64)i);
       }
@@ -310,7 +331,8 @@ static void kernel_rnd_lookup_init(bench_params_t p, bench_data_t* data) {
 static void kernel_rnd_lookup(bench_params_t p, bench_data_t* data) {
   u64 sum = 0;
   switch (p.lib) {
-    case BENCH_LIB_SP: {
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
       sp_for(i, p.n) {
         u64* v = sp_ht_getp(data->sp, data->random_keys[i]);
         if (v) sum += *v;
@@ -332,8 +354,9 @@ static void kernel_rnd_lookup(bench_params_t p, bench_data_t* data) {
 
 static void kernel_delete_init(bench_params_t p, bench_data_t* data) {
   switch (p.lib) {
-    case BENCH_LIB_SP: {
-      sp_ht_init(sp_mem_os_new(), data->sp);
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
+      bench_sp_init(p, data);
       sp_for(i, p.n) {
         sp_ht_insert(data->sp, (s32)i, (u64)i);
       }
@@ -350,7 +373,8 @@ static void kernel_delete_init(bench_params_t p, bench_data_t* data) {
 
 static void kernel_delete(bench_params_t p, bench_data_t* data) {
   switch (p.lib) {
-    case BENCH_LIB_SP: {
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
       sp_for(i, p.n) {
         sp_ht_erase(data->sp, (s32)i);
         SP_COMPILER_BARRIER();
@@ -370,8 +394,9 @@ static void kernel_delete(bench_params_t p, bench_data_t* data) {
 static void kernel_mixed(bench_params_t p, bench_data_t* data) {
   u64 sum = 0;
   switch (p.lib) {
-    case BENCH_LIB_SP: {
-      sp_ht_init(sp_mem_os_new(), data->sp);
+    case BENCH_LIB_SP:
+    case BENCH_LIB_SP_SIP: {
+      bench_sp_init(p, data);
       sp_for(i, p.n) {
         sp_ht_insert(data->sp, (s32)i, (u64)i);
         if (i > 0) {